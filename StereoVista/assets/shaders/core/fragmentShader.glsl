@@ -83,7 +83,42 @@ uniform samplerCube skybox;
 uniform float skyboxIntensity;
 
 // Voxel cone tracing uniforms
-uniform sampler3D voxelGrid;
+// Clipmap cascades: cascade i covers cascadeExtent[i] (twice the extent of cascade i - 1) from
+// cascadeMin[i] and wraps toroidally, so world position / extent is its texture coordinate
+#define MAX_VOXEL_CASCADES 4
+uniform sampler3D voxelGrid;        // Cascade 0 (finest)
+uniform sampler3D voxelCascade1;
+uniform sampler3D voxelCascade2;
+uniform sampler3D voxelCascade3;
+uniform int voxelCascadeCount;
+uniform vec3 cascadeMin[MAX_VOXEL_CASCADES];
+uniform float cascadeExtent[MAX_VOXEL_CASCADES];
+uniform float cascadeResolution;    // Texels per axis of every cascade
+
+// Directional mips of the cascades (AnisotropicVoxelMips): level k holds cascade mipmap k + 1 as
+// seen along +X, -X, +Y, -Y, +Z and -Z, the six faces side by side along x
+uniform bool anisotropicMips;
+uniform sampler3D voxelAniso0;
+uniform sampler3D voxelAniso1;
+uniform sampler3D voxelAniso2;
+uniform sampler3D voxelAniso3;
+
+// Sparse volume (static scenes, finer than cascade 0 over its window): a brick map into atlases of
+// bricks with a one texel apron per in-brick level, and a coarse volume with one texel per brick
+// whose mips form the occupancy hierarchy
+#define SPARSE_BRICK_SIZE 8
+#define SPARSE_EMPTY_BRICK 0xFFFFFFFFu
+uniform bool sparseVolumeEnabled;
+uniform usampler3D sparseBrickMap;
+uniform sampler3D sparseBricks0;    // 8^3 texels per brick
+uniform sampler3D sparseBricks1;    // 4^3
+uniform sampler3D sparseBricks2;    // 2^3
+uniform sampler3D sparseCoarse;
+uniform int sparseAtlasBricks;      // Bricks per atlas row and column
+uniform vec3 sparseMin;
+uniform float sparseVoxelSize;
+uniform float sparseResolution;
+uniform float sparseLevelOffset;    // log2(cascade 0 voxel size / sparse voxel size)
 uniform float voxelSize;
 uniform VCTSettings vctSettings;
 
@@ -100,7 +135,7 @@ uniform int numLights;
 uniform Sun sun;
 uniform vec3 viewPos;
 
-// Voxel grid bounds
+// Voxel grid bounds (outermost cascade window)
 uniform vec3 gridMin;
 uniform vec3 gridMax;
 uniform bool enableVoxelVisualization;
@@ -129,9 +164,137 @@ bool isInVoxelGrid(vec3 worldPos) {
     return all(greaterThanEqual(worldPos, gridMin)) && all(lessThanEqual(worldPos, gridMax));
 }
 
-// Convert world position to voxel grid texture coordinates [0,1]
-vec3 worldToVoxelCoord(vec3 worldPos) {
-    return (worldPos - gridMin) / (gridMax - gridMin);
+// Sample one in-brick level of a sparse brick through its atlas slot (voxel in level 0 units)
+vec4 sampleSparseBrick(uint brickIndex, ivec3 brick, vec3 voxel, int level) {
+    float brickTexels = float(SPARSE_BRICK_SIZE >> level);
+    ivec3 slot = ivec3(int(brickIndex) % sparseAtlasBricks, (int(brickIndex) / sparseAtlasBricks) % sparseAtlasBricks,
+                       int(brickIndex) / (sparseAtlasBricks * sparseAtlasBricks));
+    vec3 local = (voxel - vec3(brick * SPARSE_BRICK_SIZE)) / float(1 << level);
+    vec3 atlasTexel = vec3(slot) * (brickTexels + 2.0) + 1.0 + local;
+    if (level == 0) return textureLod(sparseBricks0, atlasTexel / vec3(textureSize(sparseBricks0, 0)), 0.0);
+    if (level == 1) return textureLod(sparseBricks1, atlasTexel / vec3(textureSize(sparseBricks1, 0)), 0.0);
+    return textureLod(sparseBricks2, atlasTexel / vec3(textureSize(sparseBricks2, 0)), 0.0);
+}
+
+// Sample the sparse volume at one of its own mipmap levels. Empty bricks return without
+// touching the atlases; levels of a brick and coarser come from the dense coarse volume.
+vec4 sampleSparseVoxels(vec3 worldPos, float level) {
+    vec3 voxel = (worldPos - sparseMin) / sparseVoxelSize;
+    float coarseLevel = level - 3.0;
+    if (coarseLevel >= 0.0) return textureLod(sparseCoarse, voxel / sparseResolution, coarseLevel);
+
+    ivec3 brick = ivec3(floor(voxel / float(SPARSE_BRICK_SIZE)));
+    uint brickIndex = texelFetch(sparseBrickMap, brick, 0).r;
+    if (brickIndex == SPARSE_EMPTY_BRICK) return vec4(0.0);
+
+    int lower = int(level);
+    vec4 lowerSample = sampleSparseBrick(brickIndex, brick, voxel, lower);
+    vec4 upperSample = lower < 2 ? sampleSparseBrick(brickIndex, brick, voxel, lower + 1)
+                                 : textureLod(sparseCoarse, voxel / sparseResolution, 0.0);
+    return mix(lowerSample, upperSample, fract(level));
+}
+
+// Distance along 'direction' to the exit of the largest empty cell of the sparse occupancy
+// hierarchy around 'pos'. Zero if the brick is occupied, the cell is narrower than the cone
+// (it would skip geometry inside the footprint) or there is no sparse volume there.
+float sparseEmptyDistance(vec3 pos, vec3 direction, float coneRadius) {
+    if (!sparseVolumeEnabled) return 0.0;
+    vec3 voxel = (pos - sparseMin) / sparseVoxelSize;
+    if (any(lessThan(voxel, vec3(0.0))) || any(greaterThanEqual(voxel, vec3(sparseResolution)))) return 0.0;
+
+    ivec3 cell = ivec3(0);
+    float cellSize = 0.0;
+    int coarseLevels = textureQueryLevels(sparseCoarse);
+    for (int h = 0; h < coarseLevels; h++) {
+        ivec3 candidate = ivec3(voxel / float(SPARSE_BRICK_SIZE << h));
+        if (texelFetch(sparseCoarse, candidate, h).a > 0.0) break;
+        cell = candidate;
+        cellSize = sparseVoxelSize * float(SPARSE_BRICK_SIZE << h);
+    }
+    if (cellSize < 2.0 * coneRadius) return 0.0;
+
+    vec3 cellMin = sparseMin + vec3(cell) * cellSize;
+    vec3 exitPlane = cellMin + step(0.0, direction) * cellSize;
+    vec3 safeDirection = mix(vec3(1e-6), direction, greaterThan(abs(direction), vec3(1e-6)));
+    vec3 t = (exitPlane - pos) / safeDirection;
+    return max(min(t.x, min(t.y, t.z)), 0.0);
+}
+
+vec4 sampleCascadeLevel(int cascade, vec3 coord, float lod) {
+    if (cascade == 0) return textureLod(voxelGrid, coord, lod);
+    if (cascade == 1) return textureLod(voxelCascade1, coord, lod);
+    if (cascade == 2) return textureLod(voxelCascade2, coord, lod);
+    return textureLod(voxelCascade3, coord, lod);
+}
+
+vec4 sampleAnisoTexture(int cascade, vec3 coord, float lod) {
+    if (cascade == 0) return textureLod(voxelAniso0, coord, lod);
+    if (cascade == 1) return textureLod(voxelAniso1, coord, lod);
+    if (cascade == 2) return textureLod(voxelAniso2, coord, lod);
+    return textureLod(voxelAniso3, coord, lod);
+}
+
+// One face at a directional level. The window wraps in x inside the face's block, so within half
+// a texel of its edges two samples clamped to the block are blended across the wrap instead.
+vec4 sampleAnisoFace(int cascade, vec3 coord, int face, float lod) {
+    float faceTexels = max(cascadeResolution * 0.5 * exp2(-ceil(lod)), 1.0);
+    float halfTexel = 0.5 / faceTexels;
+    float x = fract(coord.x);
+    if (x >= halfTexel && x <= 1.0 - halfTexel) {
+        return sampleAnisoTexture(cascade, vec3((float(face) + x) / 6.0, coord.yz), lod);
+    }
+    float across = (x < halfTexel ? x + 1.0 : x) - (1.0 - halfTexel);
+    vec4 before = sampleAnisoTexture(cascade, vec3((float(face) + 1.0 - halfTexel) / 6.0, coord.yz), lod);
+    vec4 after = sampleAnisoTexture(cascade, vec3((float(face) + halfTexel) / 6.0, coord.yz), lod);
+    return mix(before, after, across / (2.0 * halfTexel));
+}
+
+// The three faces a cone travelling along 'direction' looks through, weighted by its squared
+// components
+vec4 sampleAnisotropic(int cascade, vec3 coord, float lod, vec3 direction) {
+    vec3 weights = direction * direction / dot(direction, direction);
+    return weights.x * sampleAnisoFace(cascade, coord, direction.x >= 0.0 ? 0 : 1, lod)
+         + weights.y * sampleAnisoFace(cascade, coord, direction.y >= 0.0 ? 2 : 3, lod)
+         + weights.z * sampleAnisoFace(cascade, coord, direction.z >= 0.0 ? 4 : 5, lod);
+}
+
+// Sample the voxel clipmap at a mipmap level of the finest cascade. Voxels of cascade c are 2^c
+// times larger, so level L is served by cascade floor(L) at mipmap L - c. Positions within one
+// filter footprint of a window edge (where the wrap would blend in the opposite side) fall
+// through to the next coarser cascade. With a cone direction, mipmaps above level 0 come from
+// the directional mips (the sparse volume stays isotropic).
+vec4 sampleVoxelGrid(vec3 worldPos, float level, vec3 direction) {
+    // The sparse volume replaces the cascades inside its window
+    if (sparseVolumeEnabled) {
+        float sparseLevel = level + sparseLevelOffset;
+        float margin = sparseVoxelSize * exp2(sparseLevel);
+        vec3 sparseMax = sparseMin + sparseVoxelSize * sparseResolution;
+        if (all(greaterThanEqual(worldPos, sparseMin + margin)) && all(lessThanEqual(worldPos, sparseMax - margin))) {
+            return sampleSparseVoxels(worldPos, sparseLevel);
+        }
+    }
+
+    int cascade = clamp(int(level), 0, voxelCascadeCount - 1);
+    for (; cascade < voxelCascadeCount - 1; cascade++) {
+        float margin = cascadeExtent[cascade] / cascadeResolution * exp2(max(level - float(cascade), 0.0));
+        if (all(greaterThanEqual(worldPos, cascadeMin[cascade] + margin)) &&
+            all(lessThanEqual(worldPos, cascadeMin[cascade] + cascadeExtent[cascade] - margin))) break;
+    }
+
+    float lod = max(level - float(cascade), 0.0);
+    vec3 coord = worldPos / cascadeExtent[cascade];
+
+    // Directional level 0 is cascade mipmap 1; below that cones blend in from level 0
+    if (anisotropicMips && lod > 0.0 && dot(direction, direction) > 0.0) {
+        vec4 directional = sampleAnisotropic(cascade, coord, max(lod - 1.0, 0.0), direction);
+        if (lod >= 1.0) return directional;
+        return mix(sampleCascadeLevel(cascade, coord, 0.0), directional, lod);
+    }
+    return sampleCascadeLevel(cascade, coord, lod);
+}
+
+vec4 sampleVoxelGrid(vec3 worldPos, float level) {
+    return sampleVoxelGrid(worldPos, level, vec3(0.0));
 }
 
 // Returns an orthogonal vector to the input vector
@@ -267,20 +430,18 @@ float traceShadowCone(vec3 from, vec3 direction, float targetDistance) {
         float mipmapLevel = max(0.0, log2(coneRadius / voxelSize));
         mipmapLevel = min(mipmapLevel, MIPMAP_HARDCAP);
         
-        vec3 texCoord = worldToVoxelCoord(samplePos);
-        
         // Multi-sample within cone for better quality
         vec4 samples = vec4(0.0);
-        samples.x = textureLod(voxelGrid, texCoord, mipmapLevel).a;
+        samples.x = sampleVoxelGrid(samplePos, mipmapLevel, direction).a;
         
         // Add offset samples for cone aperture (jittered sampling)
         if (coneRadius > voxelSize * 1.5) {
             vec3 offset1 = orthogonal(direction) * coneRadius * 0.3;
             vec3 offset2 = cross(direction, offset1) * coneRadius * 0.3;
             
-            samples.y = textureLod(voxelGrid, worldToVoxelCoord(samplePos + offset1), mipmapLevel).a;
-            samples.z = textureLod(voxelGrid, worldToVoxelCoord(samplePos + offset2), mipmapLevel).a;
-            samples.w = textureLod(voxelGrid, worldToVoxelCoord(samplePos - offset1), mipmapLevel).a;
+            samples.y = sampleVoxelGrid(samplePos + offset1, mipmapLevel, direction).a;
+            samples.z = sampleVoxelGrid(samplePos + offset2, mipmapLevel, direction).a;
+            samples.w = sampleVoxelGrid(samplePos - offset1, mipmapLevel, direction).a;
         }
         
         // Average samples for smoother shadows
@@ -330,8 +491,6 @@ vec3 traceDiffuseVoxelCone(vec3 from, vec3 direction) {
         float level = max(0.0, log2(coneRadius / voxelSize * 1.2)); // Slightly faster LOD
         level = min(level, MIPMAP_HARDCAP);
         
-        vec3 texCoord = worldToVoxelCoord(samplePos);
-        
         // Multi-sample for larger cones to reduce aliasing
         vec4 voxel = vec4(0.0);
         float sampleWeight = 1.0;
@@ -342,15 +501,15 @@ vec3 traceDiffuseVoxelCone(vec3 from, vec3 direction) {
             vec3 ortho2 = cross(direction, ortho1);
             float offset = coneRadius * 0.25;
             
-            voxel += textureLod(voxelGrid, texCoord, level); // Center
-            voxel += textureLod(voxelGrid, worldToVoxelCoord(samplePos + ortho1 * offset), level);
-            voxel += textureLod(voxelGrid, worldToVoxelCoord(samplePos - ortho1 * offset), level);
-            voxel += textureLod(voxelGrid, worldToVoxelCoord(samplePos + ortho2 * offset), level);
-            voxel += textureLod(voxelGrid, worldToVoxelCoord(samplePos - ortho2 * offset), level);
+            voxel += sampleVoxelGrid(samplePos, level, direction); // Center
+            voxel += sampleVoxelGrid(samplePos + ortho1 * offset, level, direction);
+            voxel += sampleVoxelGrid(samplePos - ortho1 * offset, level, direction);
+            voxel += sampleVoxelGrid(samplePos + ortho2 * offset, level, direction);
+            voxel += sampleVoxelGrid(samplePos - ortho2 * offset, level, direction);
             voxel *= 0.2; // Average 5 samples
             sampleWeight = 1.2; // Boost multi-sample contribution
         } else {
-            voxel = textureLod(voxelGrid, texCoord, level);
+            voxel = sampleVoxelGrid(samplePos, level, direction);
         }
         
         // Distance-based attenuation for realistic lighting falloff
@@ -363,6 +522,7 @@ vec3 traceDiffuseVoxelCone(vec3 from, vec3 direction) {
         // Adaptive step size - faster steps for distant samples
         float stepMultiplier = 1.8 + 0.6 * level;
         dist += voxelSize * stepMultiplier;
+        if (voxel.a <= 0.0) dist += sparseEmptyDistance(samplePos, direction, coneRadius);
     }
     
     // Better tone mapping and energy conservation
@@ -403,12 +563,11 @@ vec3 traceSpecularVoxelCone(vec3 from, vec3 direction) {
         float level = max(0.0, log2(coneRadius / voxelSize));
         level = min(level, MIPMAP_HARDCAP);
         
-        vec3 texCoord = worldToVoxelCoord(samplePos);
         vec4 voxel = vec4(0.0);
         
         // For very tight cones (sharp reflections), use single sample
         if (coneRadius < voxelSize * 1.5) {
-            voxel = textureLod(voxelGrid, texCoord, level);
+            voxel = sampleVoxelGrid(samplePos, level, direction);
         } else {
             // For wider cones, use multi-sampling for better quality
             vec3 ortho1 = orthogonal(direction);
@@ -416,11 +575,11 @@ vec3 traceSpecularVoxelCone(vec3 from, vec3 direction) {
             float sampleOffset = coneRadius * 0.3;
             
             // Sample center and 4 offset points
-            voxel += textureLod(voxelGrid, texCoord, level) * 0.4; // Center weighted more
-            voxel += textureLod(voxelGrid, worldToVoxelCoord(samplePos + ortho1 * sampleOffset), level) * 0.15;
-            voxel += textureLod(voxelGrid, worldToVoxelCoord(samplePos - ortho1 * sampleOffset), level) * 0.15;
-            voxel += textureLod(voxelGrid, worldToVoxelCoord(samplePos + ortho2 * sampleOffset), level) * 0.15;
-            voxel += textureLod(voxelGrid, worldToVoxelCoord(samplePos - ortho2 * sampleOffset), level) * 0.15;
+            voxel += sampleVoxelGrid(samplePos, level, direction) * 0.4; // Center weighted more
+            voxel += sampleVoxelGrid(samplePos + ortho1 * sampleOffset, level, direction) * 0.15;
+            voxel += sampleVoxelGrid(samplePos - ortho1 * sampleOffset, level, direction) * 0.15;
+            voxel += sampleVoxelGrid(samplePos + ortho2 * sampleOffset, level, direction) * 0.15;
+            voxel += sampleVoxelGrid(samplePos - ortho2 * sampleOffset, level, direction) * 0.15;
         }
         
         // Distance-based attenuation for realistic reflections
@@ -436,6 +595,7 @@ vec3 traceSpecularVoxelCone(vec3 from, vec3 direction) {
         // Adaptive step size based on cone radius and distance
         float stepSize = voxelSize * (0.8 + 0.4 * level + 0.01 * dist);
         dist += stepSize;
+        if (voxel.a <= 0.0) dist += sparseEmptyDistance(samplePos, direction, coneRadius);
     }
     
     // Final specular contribution with material properties
@@ -464,15 +624,13 @@ vec3 traceRefractiveVoxelCone(vec3 from, vec3 direction) {
         vec3 samplePos = from + dist * direction;
         if(!isInVoxelGrid(samplePos)) break;
         
-        vec3 texCoord = worldToVoxelCoord(samplePos);
-        
         // Faster refraction LOD transition for better performance
         // Use higher mipmap levels sooner to improve performance
         float specDiffusion = max(0.05, 0.6 * material.specularDiffusion);
         float level = 0.12 * specDiffusion * log2(1.0 + dist / voxelSize * 1.4); // 1.4x faster falloff
         
         // Sample surrounding points and average to reduce noise
-        vec4 voxelCenter = textureLod(voxelGrid, texCoord, min(level, MIPMAP_HARDCAP));
+        vec4 voxelCenter = sampleVoxelGrid(samplePos, min(level, MIPMAP_HARDCAP), direction);
         
         // Calculate blending weights
         float weight = 0.3 * (1.0 + 0.5 * specDiffusion);
@@ -860,8 +1018,7 @@ void main() {
         
         // Add voxel visualization if enabled
         if (enableVoxelVisualization && isInVoxelGrid(fs_in.FragPos)) {
-            vec3 voxelCoord = worldToVoxelCoord(fs_in.FragPos);
-            vec4 voxelValue = texture(voxelGrid, voxelCoord);
+            vec4 voxelValue = sampleVoxelGrid(fs_in.FragPos, 0.0);
             if (voxelValue.a > 0.0) {
                 result = mix(result, voxelValue.rgb, 0.6);
             }
@@ -115,14 +115,17 @@ struct HitInfo {
     int materialId;
 };
 
-// Triangle for actual scene geometry
-struct Triangle {
-    vec3 v0, v1, v2;    // Vertices
-    vec3 normal;        // Triangle normal
-    vec3 color;         // Material color
-    float emissiveness; // Material emissiveness
-    float shininess;    // Material shininess
-    int materialId;     // Material identifier
+// Scene triangles (model space, BVH leaf order) are split into a hot stream read by every
+// intersection test and a cold stream read once for the closest hit
+struct TriangleGeometry {
+    vec3 v0;            // First vertex
+    vec3 edge1;         // v1 - v0
+    vec3 edge2;         // v2 - v0
+};
+
+struct TriangleMaterial {
+    vec4 normalShininess;   // Triangle normal, shininess
+    vec4 colorEmissive;     // Material color, emissiveness
 };
 
 // BVH Node structure for acceleration
@@ -133,20 +136,42 @@ struct BVHNode {
     uint triCount;      // Triangle count (0 for interior nodes)
 };
 
+// Model instance referenced by the top-level BVH
+struct Instance {
+    mat4 worldToLocal;  // World to model space transform
+    uint rootNode;      // Root of the model's bottom-level BVH
+    uint triangleOffset;// First triangle of the model
+    uint triangleCount; // Triangle count of the model
+    uint padding;
+};
+
 // Scene geometry setup using Storage Buffer Objects
 layout(std430, binding = 0) readonly buffer TriangleBuffer {
-    Triangle triangles[];
+    TriangleGeometry triangles[];
 };
 layout(std430, binding = 1) readonly buffer BVHNodeBuffer {
-    BVHNode bvhNodes[];
+    BVHNode bvhNodes[];         // Bottom-level BVHs of all models
+};
+layout(std430, binding = 2) readonly buffer TriangleMaterialBuffer {
+    TriangleMaterial triangleMaterials[];
 };
-layout(std430, binding = 2) readonly buffer TriangleIndexBuffer {
-    uint triangleIndices[];
+layout(std430, binding = 3) readonly buffer TLASNodeBuffer {
+    BVHNode tlasNodes[];        // Top-level BVH over the instances
+};
+layout(std430, binding = 4) readonly buffer InstanceBuffer {
+    Instance instances[];       // In top-level leaf order
+};
+layout(std430, binding = 5) readonly buffer WideBVHNodeBuffer {
+    uint wideNodes[];           // Quantized BVH4/BVH8 nodes of all models (bvhWidth > 2)
 };
 
 uniform int numTriangles;
 uniform int numBVHNodes;
+uniform int numTLASNodes;
+uniform int numInstances;
 uniform bool enableBVH;
+uniform int bvhWidth;           // 2 = binary nodes, 4/8 = wide nodes
+uniform int numWideNodes;
 
 // Simple ground plane for basic scene setup
 struct GroundPlane {
@@ -189,11 +214,11 @@ vec2 random2(vec2 co, inout uint state) {
 }
 
 
-// Optimized ray-triangle intersection (like sample project)
-bool intersectTriangle(Ray ray, Triangle tri, out float t) {
+// Optimized ray-triangle intersection (like sample project); edges are precomputed on the CPU
+bool intersectTriangle(Ray ray, TriangleGeometry tri, out float t) {
     const float EPSILON = 0.0000001;
-    vec3 edge1 = tri.v1 - tri.v0;
-    vec3 edge2 = tri.v2 - tri.v0;
+    vec3 edge1 = tri.edge1;
+    vec3 edge2 = tri.edge2;
     vec3 h = cross(ray.direction, edge2);
     float a = dot(edge1, h);
     
@@ -238,6 +263,27 @@ Ray createRay(vec3 origin, vec3 direction) {
     return ray;
 }
 
+// Transform a world ray into model space. The direction is not renormalized, so hit
+// distances stay comparable between instances and with the world ray.
+Ray transformRay(Ray ray, mat4 worldToLocal) {
+    return createRay((worldToLocal * vec4(ray.origin, 1.0)).xyz,
+                     (worldToLocal * vec4(ray.direction, 0.0)).xyz);
+}
+
+// Record a triangle hit; the model-space normal goes through the inverse transpose
+void recordHit(inout HitInfo result, Ray worldRay, Instance instance, uint triIdx, float t) {
+    result.hit = true;
+    result.distance = t;
+    result.point = worldRay.origin + worldRay.direction * t;
+    TriangleMaterial material = triangleMaterials[triIdx];
+    result.normal = normalize(transpose(mat3(instance.worldToLocal)) * material.normalShininess.xyz);
+    result.albedo = material.colorEmissive.rgb;
+    result.emissiveness = material.colorEmissive.a;
+    result.shininess = material.normalShininess.w;
+    result.roughness = 1.0 - clamp(material.normalShininess.w / 256.0, 0.0, 1.0);
+    result.materialId = int(triIdx);
+}
+
 // Fast ray-AABB intersection test (boolean only - like sample project)
 bool rayAABBIntersect(Ray ray, vec3 boxMin, vec3 boxMax) {
     vec3 tMin = (boxMin - ray.origin) * ray.invDir;
@@ -263,20 +309,94 @@ float rayBoundingBoxDistance(Ray ray, vec3 boxMin, vec3 boxMax) {
     return hit ? (tNear > 0.0 ? tNear : 0.0) : 1.0e30;
 }
 
-// Optimized BVH traversal matching sample project
-HitInfo castRayBVH(Ray ray) {
-    HitInfo result;
-    result.hit = false;
-    result.distance = rayMaxDistance;
+// Wide node layout (see WideBVH.h): origin (3 words), exponents | childCount << 24,
+// six planes of 8-bit child bounds, then one word per child
+const uint WIDE_LEAF_FLAG = 0x80000000u;
+const uint WIDE_LEAF_FIRST_MASK = 0x07FFFFFFu;
+// WideBVH::TRAVERSAL_STACK_SIZE; SceneBVH packs binary nodes when a BLAS could need more
+const int WIDE_STACK_SIZE = 64;
+
+// Quantized plane value of one child
+uint wideChildByte(uint base, uint plane, uint child, uint planeWords) {
+    return (wideNodes[base + 4u + plane * planeWords + child / 4u] >> ((child % 4u) * 8u)) & 0xFFu;
+}
+
+// Bottom-level traversal over the quantized wide nodes of one instance (ray in model space)
+void traverseWideBLAS(Ray worldRay, Ray ray, Instance instance, inout HitInfo result) {
+    uint stride = bvhWidth == 8 ? 24u : 16u;
+    uint planeWords = uint(bvhWidth) / 4u;
     
-    if (numBVHNodes == 0) return result;
+    uint stack[WIDE_STACK_SIZE];
+    int stackIndex = 0;
+    stack[stackIndex++] = instance.rootNode;
+    
+    while (stackIndex > 0) {
+        uint nodeIdx = stack[--stackIndex];
+        if (nodeIdx >= uint(numWideNodes)) continue; // Safety check
+        
+        // Decode the quantization frame: child bound = origin + q * 2^exponent
+        uint base = nodeIdx * stride;
+        vec3 origin = uintBitsToFloat(uvec3(wideNodes[base], wideNodes[base + 1u], wideNodes[base + 2u]));
+        uint header = wideNodes[base + 3u];
+        vec3 scale = uintBitsToFloat(uvec3(header & 0xFFu, (header >> 8u) & 0xFFu, (header >> 16u) & 0xFFu) << 23u);
+        uint childCount = header >> 24u;
+        uint childBase = base + 4u + 6u * planeWords;
+        
+        // Leaves are tested right away, internal children are sorted far to near
+        float hitDistance[8];
+        uint hitChild[8];
+        int hitCount = 0;
+        for (uint i = 0u; i < childCount; i++) {
+            vec3 qlo = vec3(wideChildByte(base, 0u, i, planeWords), wideChildByte(base, 1u, i, planeWords), wideChildByte(base, 2u, i, planeWords));
+            vec3 qhi = vec3(wideChildByte(base, 3u, i, planeWords), wideChildByte(base, 4u, i, planeWords), wideChildByte(base, 5u, i, planeWords));
+            float dist = rayBoundingBoxDistance(ray, origin + qlo * scale, origin + qhi * scale);
+            if (dist >= result.distance) continue;
+            
+            uint word = wideNodes[childBase + i];
+            if ((word & WIDE_LEAF_FLAG) != 0u) {
+                uint first = word & WIDE_LEAF_FIRST_MASK;
+                uint count = (word >> 27u) & 0xFu;
+                for (uint j = 0u; j < count; j++) {
+                    uint triIdx = first + j;
+                    if (triIdx >= numTriangles) continue; // Safety check
+                    
+                    float t;
+                    if (intersectTriangle(ray, triangles[triIdx], t) && t < result.distance) {
+                        recordHit(result, worldRay, instance, triIdx, t);
+                    }
+                }
+            } else {
+                int j = hitCount++;
+                while (j > 0 && hitDistance[j - 1] < dist) {
+                    hitDistance[j] = hitDistance[j - 1];
+                    hitChild[j] = hitChild[j - 1];
+                    j--;
+                }
+                hitDistance[j] = dist;
+                hitChild[j] = word;
+            }
+        }
+        
+        // Closest child ends up on top of the stack
+        for (int i = 0; i < hitCount && stackIndex < WIDE_STACK_SIZE; i++) {
+            stack[stackIndex++] = hitChild[i];
+        }
+    }
+}
+
+// Bottom-level traversal of one instance (ray in model space)
+void traverseBLAS(Ray worldRay, Ray ray, Instance instance, inout HitInfo result) {
+    if (bvhWidth > 2 && numWideNodes > 0) {
+        traverseWideBLAS(worldRay, ray, instance, result);
+        return;
+    }
     
     // Smaller stack like in sample project (32 elements is usually sufficient)
     uint stack[32];
     int stackIndex = 0;
     
-    // Start with root node (index 0)
-    stack[stackIndex++] = 0u;
+    // Start with the instance's root node
+    stack[stackIndex++] = instance.rootNode;
     
     while (stackIndex > 0) {
         // Pop node from stack
@@ -286,20 +406,12 @@ HitInfo castRayBVH(Ray ray) {
         if (isLeaf) {
             // Leaf node - test triangles
             for (uint i = 0u; i < node.triCount; i++) {
-                uint triIdx = triangleIndices[node.leftFirst + i];
+                uint triIdx = node.leftFirst + i;
                 if (triIdx >= numTriangles) continue; // Safety check
                 
                 float t;
                 if (intersectTriangle(ray, triangles[triIdx], t) && t < result.distance) {
-                    result.hit = true;
-                    result.distance = t;
-                    result.point = ray.origin + ray.direction * t;
-                    result.normal = triangles[triIdx].normal;
-                    result.albedo = triangles[triIdx].color;
-                    result.emissiveness = triangles[triIdx].emissiveness;
-                    result.shininess = triangles[triIdx].shininess;
-                    result.roughness = 1.0 - clamp(triangles[triIdx].shininess / 256.0, 0.0, 1.0);
-                    result.materialId = triangles[triIdx].materialId;
+                    recordHit(result, worldRay, instance, triIdx, t);
                 }
             }
         } else {
@@ -342,6 +454,54 @@ HitInfo castRayBVH(Ray ray) {
             // If neither intersects, skip both (major optimization!)
         }
     }
+}
+
+// Two-level traversal: the top-level BVH finds instances, each instance is traversed in model space
+HitInfo castRayBVH(Ray ray) {
+    HitInfo result;
+    result.hit = false;
+    result.distance = rayMaxDistance;
+    
+    if (numTLASNodes == 0 || numBVHNodes == 0) return result;
+    
+    uint stack[32];
+    int stackIndex = 0;
+    stack[stackIndex++] = 0u;
+    
+    while (stackIndex > 0) {
+        BVHNode node = tlasNodes[stack[--stackIndex]];
+        
+        // Skip nodes behind the closest hit so far
+        if (rayBoundingBoxDistance(ray, node.minBounds, node.maxBounds) >= result.distance) continue;
+        
+        if (node.triCount > 0u) {
+            // Leaf node - traverse the instances it references
+            for (uint i = 0u; i < node.triCount; i++) {
+                uint instanceIdx = node.leftFirst + i;
+                if (instanceIdx >= numInstances) continue; // Safety check
+                
+                Instance instance = instances[instanceIdx];
+                traverseBLAS(ray, transformRay(ray, instance.worldToLocal), instance, result);
+            }
+        } else {
+            uint childIndexA = node.leftFirst + 0u;
+            uint childIndexB = node.leftFirst + 1u;
+            
+            if (childIndexA >= numTLASNodes || childIndexB >= numTLASNodes) continue; // Safety check
+            
+            float dstA = rayBoundingBoxDistance(ray, tlasNodes[childIndexA].minBounds, tlasNodes[childIndexA].maxBounds);
+            float dstB = rayBoundingBoxDistance(ray, tlasNodes[childIndexB].minBounds, tlasNodes[childIndexB].maxBounds);
+            
+            // Closer child on top of the stack
+            if (dstA <= dstB) {
+                if (dstB < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexB;
+                if (dstA < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexA;
+            } else {
+                if (dstA < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexA;
+                if (dstB < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexB;
+            }
+        }
+    }
     
     return result;
 }
@@ -352,19 +512,17 @@ HitInfo castRayLinear(Ray ray) {
     hit.hit = false;
     hit.distance = rayMaxDistance;
     
-    // Check intersection with triangles (actual scene geometry)
-    for (int i = 0; i < numTriangles; i++) {
-        float t;
-        if (intersectTriangle(ray, triangles[i], t) && t < hit.distance) {
-            hit.hit = true;
-            hit.distance = t;
-            hit.point = ray.origin + ray.direction * t;
-            hit.normal = triangles[i].normal;
-            hit.albedo = triangles[i].color;
-            hit.emissiveness = triangles[i].emissiveness;
-            hit.shininess = triangles[i].shininess;
-            hit.roughness = 1.0 - clamp(triangles[i].shininess / 256.0, 0.0, 1.0);
-            hit.materialId = triangles[i].materialId;
+    // Check intersection with triangles (actual scene geometry), one instance at a time
+    for (int instanceIdx = 0; instanceIdx < numInstances; instanceIdx++) {
+        Instance instance = instances[instanceIdx];
+        Ray localRay = transformRay(ray, instance.worldToLocal);
+        
+        uint lastTriangle = min(instance.triangleOffset + instance.triangleCount, uint(numTriangles));
+        for (uint i = instance.triangleOffset; i < lastTriangle; i++) {
+            float t;
+            if (intersectTriangle(localRay, triangles[i], t) && t < hit.distance) {
+                recordHit(hit, ray, instance, i, t);
+            }
         }
     }
     
@@ -376,7 +534,7 @@ HitInfo castRay(Ray ray) {
     HitInfo hit;
     
     // Use BVH traversal if enabled and available, otherwise fall back to linear
-    if (enableBVH && numBVHNodes > 0) {
+    if (enableBVH && numTLASNodes > 0) {
         hit = castRayBVH(ray);
         // Debug: If you want to see if BVH is being used, uncomment next line
         // hit.albedo = vec3(0, 1, 0); // Green tint means BVH is active
@@ -37,7 +37,9 @@ uniform PointLight pointLights[MAX_LIGHTS];
 uniform int numberOfLights;
 uniform vec3 cameraPosition;
 uniform int mipmapLevel;  // Current mipmap level
-uniform float gridSize;   // Actual voxel grid size
+uniform float voxelSize;  // Voxel size of the cascade being written
+uniform vec3 regionMin;   // Voxel region being re-voxelized (absolute voxels, inclusive, inside the window)
+uniform vec3 regionMax;
 
 layout(rgba8, binding = 0) uniform image3D texture3D;
 
@@ -53,17 +55,17 @@ vec3 calculatePointLight(const PointLight light) {
     return diff * POINT_LIGHT_INTENSITY * attenuation * light.color;
 }
 
-bool isInsideCube(const vec3 p, float e) { 
-    // Check if the world position is within the voxel grid bounds
-    float halfGrid = gridSize * 0.5;
-    return abs(p.x) < halfGrid + e && 
-           abs(p.y) < halfGrid + e && 
-           abs(p.z) < halfGrid + e; 
+bool isInsideRegion(const ivec3 coord) {
+    return all(greaterThanEqual(vec3(coord), regionMin)) && all(lessThanEqual(vec3(coord), regionMax));
 }
 
 void main() {
-    // Skip voxels outside the grid boundary
-    if(!isInsideCube(worldPositionFrag, 0.0)) return;
+    // Absolute voxel of the fragment, snapped to the block of the current mipmap level
+    int stride = 1 << mipmapLevel;
+    ivec3 voxelCoord = ivec3(floor(worldPositionFrag / (voxelSize * float(stride)))) * stride;
+
+    // Skip voxels outside the cleared region (and so outside the cascade window)
+    if (!isInsideRegion(voxelCoord)) return;
 
     // Get the base color (from texture or material)
     vec3 baseColor;
@@ -93,59 +95,35 @@ void main() {
     // Ensure colors are in a reasonable range
     finalColor = clamp(finalColor, vec3(0.0), vec3(1.0));
 
-    // Convert world position to normalized voxel coordinates [0,1]
-    float halfGrid = gridSize * 0.5;
-    vec3 normalizedPos = (worldPositionFrag + halfGrid) / gridSize;
-    
-    // Get texture dimensions
+    // The window wraps toroidally: voxel v is stored at texel v mod resolution. Blocks are
+    // aligned to the stride, so they never straddle the wrap.
     ivec3 texDim = imageSize(texture3D);
+    ivec3 storageCoord = voxelCoord - texDim * ivec3(floor(vec3(voxelCoord) / vec3(texDim)));
+
+    // Set alpha based on transparency
+    float alpha = 1.0 - material.transparency;
+    vec4 voxelColor = vec4(finalColor, alpha);
     
-    // Account for mipmap level - compute the effective resolution
-    int effectiveRes = texDim.x >> mipmapLevel;
-    if (effectiveRes < 1) effectiveRes = 1;
-    
-    // Scale from [0,1] to [0, effectiveRes-1]
-    vec3 voxelPos = normalizedPos * float(effectiveRes);
-    
-    // Convert to integer coordinates with rounding
-    ivec3 baseVoxelCoord = ivec3(floor(voxelPos));
+    // Atomic max blending for better overlapping fragment handling
+    // Read existing value and blend with new color
+    vec4 existingColor = imageLoad(texture3D, storageCoord);
+    vec4 blendedColor = max(existingColor, voxelColor);
     
-    // Calculate the stride for this mipmap level
-    int stride = 1 << mipmapLevel;
+    // Write to the voxel grid
+    imageStore(texture3D, storageCoord, blendedColor);
     
-    // Calculate the final storage coordinates
-    ivec3 storageCoord = baseVoxelCoord * stride;
     
-    // Check bounds before writing
-    if (storageCoord.x >= 0 && storageCoord.x < texDim.x &&
-        storageCoord.y >= 0 && storageCoord.y < texDim.y &&
-        storageCoord.z >= 0 && storageCoord.z < texDim.z) {
-        
-        // Set alpha based on transparency
-        float alpha = 1.0 - material.transparency;
-        vec4 voxelColor = vec4(finalColor, alpha);
-        
-        // Atomic max blending for better overlapping fragment handling
-        // Read existing value and blend with new color
-        vec4 existingColor = imageLoad(texture3D, storageCoord);
-        vec4 blendedColor = max(existingColor, voxelColor);
-        
-        // Write to the voxel grid
-        imageStore(texture3D, storageCoord, blendedColor);
-        
-        
-        // Fill in additional voxels at higher mipmap levels for proper LOD
-        if (mipmapLevel > 0) {
-            for (int x = 0; x < stride && storageCoord.x + x < texDim.x; x++) {
-                for (int y = 0; y < stride && storageCoord.y + y < texDim.y; y++) {
-                    for (int z = 0; z < stride && storageCoord.z + z < texDim.z; z++) {
-                        if (x == 0 && y == 0 && z == 0) continue; // Skip the center voxel
-                        ivec3 neighborCoord = storageCoord + ivec3(x, y, z);
-                        
-                        vec4 existingMip = imageLoad(texture3D, neighborCoord);
-                        vec4 blendedMip = max(existingMip, voxelColor);
-                        imageStore(texture3D, neighborCoord, blendedMip);
-                    }
+    // Fill in additional voxels at higher mipmap levels for proper LOD
+    if (mipmapLevel > 0) {
+        for (int x = 0; x < stride; x++) {
+            for (int y = 0; y < stride; y++) {
+                for (int z = 0; z < stride; z++) {
+                    if (x == 0 && y == 0 && z == 0) continue; // Skip the center voxel
+                    ivec3 neighborCoord = storageCoord + ivec3(x, y, z);
+                    
+                    vec4 existingMip = imageLoad(texture3D, neighborCoord);
+                    vec4 blendedMip = max(existingMip, voxelColor);
+                    imageStore(texture3D, neighborCoord, blendedMip);
                 }
             }
         }
@@ -48,6 +48,12 @@ namespace Engine {
     };
 
     void saveScene(const std::string& filename, const Scene& scene, const Camera& camera);
+
+    // Data directory saveScene writes next to the scene file (<name>/ beside <name>.scene)
+    std::string getSceneDataDirectory(const std::string& filename);
+
+    // BVH cache inside the scene's data directory
+    std::string getSceneBVHCacheDirectory(const std::string& filename);
     void saveModelData(const Model& model, const std::string& filename);
     Scene loadScene(const std::string& filename, Camera& camera);
     void loadModelData(Model& model, const std::string& filename);
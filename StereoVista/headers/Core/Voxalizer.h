@@ -2,6 +2,10 @@
 #include "Engine/Core.h"
 #include "Engine/Shader.h"
 #include "Loaders/ModelLoader.h"
+#include "Engine/CPUVoxelizer.h"
+#include "Engine/PointCloudVoxelSplatter.h"
+#include "Engine/AnisotropicVoxelMips.h"
+#include <array>
 
 namespace Engine {
 
@@ -20,15 +24,100 @@ namespace Engine {
         float voxelColorIntensity = 1.0f; // Controls brightness of voxel colors
         VisualizationMode visualizationMode = VISUALIZATION_NORMAL;
 
+        // Debug voxels are extracted on the GPU (compute append into the instance buffer, drawn
+        // indirectly); the CPU path reads back only the displayed level and only when it changed
+        static constexpr size_t MAX_DEBUG_VOXELS = 200000;
+        bool gpuVoxelExtraction = true;
+        bool hasGPUVoxelExtraction() const { return m_voxelExtractShader != nullptr; }
+        void refreshDebugVoxels() { m_voxelDataNeedsUpdate = true; }
+
+        // Clipmap: nested cascades of the same resolution, each covering twice the extent of the
+        // previous one, centred on the camera. Cascade 0 covers getVoxelGridSize().
+        static constexpr int MAX_CASCADES = 4;
+        static constexpr int CASCADE_SNAP = 8;  // Cascade windows move in steps of this many voxels
+
         Voxelizer(int resolution = 128);
         ~Voxelizer();
 
-        void update(const glm::vec3& cameraPos, const std::vector<Model>& models);
+        // Re-voxelize what changed since the last call: models are compared with their state at
+        // their last voxelization (transform, material, visibility, meshes), and only the voxel
+        // region covered by their old and new bounds is cleared and re-rasterized. Cascades follow
+        // the camera toroidally, so a camera move only re-voxelizes the slabs that entered each
+        // window. Calls without changes (e.g. the second eye of a stereo frame) do no GPU work.
+        // Point clouds are splatted into the same regions (see PointCloudVoxelSplatter).
+        void update(const glm::vec3& cameraPos, const std::vector<Model>& models, const std::vector<PointCloud>& pointClouds);
+
+        // Re-voxelize everything on the next update (e.g. after editing mesh vertices in place)
+        void invalidate() { m_fullUpdatePending = true; }
+
+        bool getVoxelizePointClouds() const { return m_voxelizePointClouds; }
+        void setVoxelizePointClouds(bool enabled) {
+            if (enabled != m_voxelizePointClouds) m_fullUpdatePending = true;
+            m_voxelizePointClouds = enabled;
+        }
+        const PointCloudVoxelSplatter::Stats& getPointSplatStats() const { return m_pointSplatter.getStats(); }
+
+        // True if the last update() voxelized anything
+        bool wasUpdated() const { return m_lastUpdateVoxelized; }
         void renderDebugVisualization(const glm::vec3& cameraPos, const glm::mat4& projection, const glm::mat4& view);
 
-        GLuint getVoxelTexture() const { return m_voxelTexture; }
+        // Finest cascade
+        GLuint getVoxelTexture() const { return m_cascades[0].texture; }
+        int getResolution() const { return m_resolution; }
         float getVoxelGridSize() const { return m_voxelGridSize; }
-        void setVoxelGridSize(float size) { m_voxelGridSize = size; }
+        void setVoxelGridSize(float size) {
+            if (size != m_voxelGridSize) m_fullUpdatePending = true;
+            m_voxelGridSize = size;
+        }
+
+        int getCascadeCount() const { return static_cast<int>(m_cascades.size()); }
+        void setCascadeCount(int count);
+        GLuint getCascadeTexture(int cascade) const { return m_cascades[cascade].texture; }
+        float getCascadeExtent(int cascade) const { return m_voxelGridSize * static_cast<float>(1 << cascade); }
+        float getCascadeVoxelSize(int cascade) const { return getCascadeExtent(cascade) / m_resolution; }
+
+        // Anisotropic mips: besides its isotropic chain every cascade has six directional ones (see
+        // AnisotropicVoxelMips) in a texture of (3 * resolution, resolution / 2, resolution / 2),
+        // rebuilt by voxel_mips.comp over the regions update() re-voxelized. Cone traces sample
+        // them along their direction when anisotropicMips is set.
+        bool anisotropicMips = true;
+        bool hasAnisotropicMips() const { return m_mipShader != nullptr; }
+        GLuint getCascadeDirectionalTexture(int cascade) const { return m_cascades[cascade].directional; }
+        AnisotropicVoxelMips::Levels readCascadeDirectional(int cascade) const;
+
+        // World-space corner of a cascade window. Voxel v of the window is stored at texel
+        // v mod resolution, so world positions divided by the extent are wrapped texture coordinates.
+        glm::vec3 getCascadeMin(int cascade) const {
+            return glm::vec3(m_cascades[cascade].origin) * getCascadeVoxelSize(cascade);
+        }
+
+        // CPU voxelization: snapshot the scene with the voxelization lights, voxelize a cascade
+        // window (on any thread) and upload the result, or read a cascade back to compare.
+        // The CPU voxelizer only sees models: uploads splat the point clouds on top on the GPU
+        // (from the splat cache), comparisons merge collectCascadeSplats into the CPU volume.
+        void fillCPUVoxelizer(CPUVoxelizer& cpuVoxelizer, const std::vector<Model>& models) const;
+        CPUVoxelizer::Window getCascadeWindow(int cascade) const;
+        CPUVoxelizer::Volume readCascade(int cascade) const;
+        void uploadCascade(int cascade, const CPUVoxelizer::Volume& volume, const std::vector<PointCloud>& pointClouds);
+        std::vector<PointCloudVoxelSplatter::Splat> collectCascadeSplats(int cascade, const std::vector<PointCloud>& pointClouds);
+
+        // Sparse volume: a static, finer replacement for cascade 0 over its current window, built
+        // brick by brick by the CPU voxelizer. Only bricks with geometry are stored; the GPU copy is
+        // a brick map into per-level brick atlases plus the coarse occupancy volume. It is dropped
+        // when models or lights change.
+        static constexpr int SPARSE_ATLAS_BRICKS = 32;     // Bricks per atlas row and column
+        bool useSparseVolume = true;
+
+        bool buildSparseVolume(const std::vector<Model>& models, const std::vector<PointCloud>& pointClouds,
+                               int resolution, CPUVoxelizer::Stats* stats = nullptr);
+        void clearSparseVolume();
+        bool hasSparseVolume() const { return m_sparseBrickMap != 0; }
+        const SparseVoxelVolume& getSparseVolume() const { return m_sparseVolume; }
+        GLuint getSparseBrickMapTexture() const { return m_sparseBrickMap; }
+        GLuint getSparseAtlasTexture(int level) const { return m_sparseAtlases[level]; }
+        GLuint getSparseCoarseTexture() const { return m_sparseCoarse; }
+        glm::vec3 getSparseMin() const { return glm::vec3(m_sparseVolume.getOrigin()) * m_sparseVolume.getVoxelSize(); }
+        size_t getSparseGPUBytes() const { return m_sparseGPUBytes; }
 
         // Change visualization state (mipmap level)
         void increaseState();
@@ -50,21 +139,24 @@ namespace Engine {
         }
 
         void clearVoxelTexture() {
-            glClearTexImage(m_voxelTexture, 0, GL_RGBA, GL_FLOAT, nullptr);
+            for (const auto& cascade : m_cascades) {
+                glClearTexImage(cascade.texture, 0, GL_RGBA, GL_FLOAT, nullptr);
+            }
+            m_fullUpdatePending = true;
         }
 
-        void generateMipmaps() {
-            glBindTexture(GL_TEXTURE_3D, m_voxelTexture);
-            glGenerateMipmap(GL_TEXTURE_3D);
-        }
+        // Rebuild the isotropic and directional mips of every cascade window from level 0
+        void generateMipmaps();
 
-        // Method to re-initialize the voxel texture with a new resolution
+        // Method to re-initialize the cascade textures with a new resolution
         void resizeVoxelTexture(int newResolution) {
-            glDeleteTextures(1, &m_voxelTexture);
+            int cascadeCount = getCascadeCount();
+            deleteCascades();
 
             m_resolution = newResolution;
+            m_fullUpdatePending = true;
 
-            initializeVoxelTexture();
+            initializeCascades(cascadeCount);
         }
 
         // Method to set voxel material properties for rendering
@@ -82,7 +174,26 @@ namespace Engine {
     private:
         int m_resolution;
         float m_voxelGridSize;
-        GLuint m_voxelTexture;
+
+        // Inclusive box in absolute voxel coordinates of a cascade (world position / voxel size)
+        struct VoxelRegion {
+            glm::ivec3 min;
+            glm::ivec3 max;
+        };
+
+        struct Cascade {
+            GLuint texture = 0;
+            GLuint directional = 0;             // Directional mips, faces side by side along x
+            glm::ivec3 origin = glm::ivec3(0);  // First voxel of the window
+            bool valid = false;                 // Window content matches origin
+        };
+        std::vector<Cascade> m_cascades;
+
+        SparseVoxelVolume m_sparseVolume;
+        GLuint m_sparseBrickMap = 0;
+        GLuint m_sparseAtlases[SparseVoxelVolume::BRICK_LEVELS - 1] = {};   // In-brick levels below one texel per brick
+        GLuint m_sparseCoarse = 0;
+        size_t m_sparseGPUBytes = 0;
 
         Shader* m_voxelShader;
 
@@ -93,16 +204,25 @@ namespace Engine {
         // Cube for visualization
         GLuint m_cubeVAO, m_cubeVBO;
 
-        // Voxel data for direct rendering
-        struct VoxelData {
-            glm::vec3 position;
-            glm::vec4 color;
-            int mipmapLevel;  // Store the mipmap level for proper size rendering
-        };
-        std::vector<VoxelData> m_visibleVoxels;
-        GLuint m_voxelInstanceVBO;
+        // Debug voxel instances: position, color and mipmap level (8 floats each)
+        Shader* m_voxelExtractShader = nullptr;
+        GLuint m_voxelInstanceVBO;                  // MAX_DEBUG_VOXELS instances, also the extraction output
+        GLuint m_voxelIndirectBuffer = 0;           // DrawArraysIndirectCommand written by the extraction
+        bool m_voxelInstancesOnGPU = false;         // Last extraction ran on the GPU (count only in m_voxelIndirectBuffer)
+        size_t m_visibleVoxelCount = 0;             // Instances uploaded by the CPU path
         bool m_voxelDataNeedsUpdate = true;
 
+        // CPU extraction: instances per level tagged with the cascade 0 version they came from
+        struct ExtractedLevel {
+            uint64_t version = 0;
+            std::vector<float> instances;
+        };
+        uint64_t m_cascadeVersion = 1;              // Bumped whenever cascade 0 is written
+        std::vector<ExtractedLevel> m_extractedLevels;
+        std::vector<glm::u8vec4> m_levelReadback;
+        std::vector<std::vector<float>> m_sliceInstances;
+        std::vector<float> m_uploadInstances;
+
         // Lights for voxelization
         struct PointLight {
             glm::vec3 position;
@@ -111,9 +231,59 @@ namespace Engine {
 
         std::vector<PointLight> m_lights;
 
-        void initializeVoxelTexture();
+        // Voxelization inputs of a scene model as of its last voxelization
+        struct ModelState {
+            glm::mat4 transform = glm::mat4(1.0f);
+            std::array<float, 14> material = {};    // Colors and material scalars as set for the shader
+            bool visible = false;
+            const void* meshData = nullptr;         // Mesh storage (geometry identity)
+            std::vector<glm::uvec4> meshes;         // VAO, index count, visibility, first texture
+            glm::vec3 localMin = glm::vec3(0.0f);   // Bounds over all mesh vertices
+            glm::vec3 localMax = glm::vec3(0.0f);
+            glm::vec3 worldMin = glm::vec3(0.0f);
+            glm::vec3 worldMax = glm::vec3(0.0f);
+
+            bool sameInputs(const ModelState& other) const {
+                return transform == other.transform && material == other.material && visible == other.visible &&
+                       meshData == other.meshData && meshes == other.meshes;
+            }
+        };
+        std::vector<ModelState> m_modelStates;      // Per scene model, as last voxelized
+        std::vector<PointLight> m_voxelizedLights;
+        int m_voxelizedState = -1;                  // Mipmap level the volume was written for
+        bool m_fullUpdatePending = true;
+        bool m_lastUpdateVoxelized = false;
+
+        // Point cloud splats, uploaded per region for voxel_splat.comp
+        PointCloudVoxelSplatter m_pointSplatter;
+        bool m_voxelizePointClouds = true;
+        Shader* m_splatShader = nullptr;
+        GLuint m_splatBuffer = 0;
+        size_t m_splatBufferCapacity = 0;           // In splats
+        std::vector<PointCloudVoxelSplatter::Splat> m_regionSplats;
+
+        // Isotropic and directional mips over dirty regions; without it glGenerateMipmap is used
+        Shader* m_mipShader = nullptr;
+
+        // Capture a model's inputs; local bounds are reused from 'previous' if the geometry matches
+        static ModelState captureModelState(const Model& model, const ModelState* previous);
+        static glm::mat4 getModelMatrix(const Model& model);
+
+        void initializeCascades(int count);
+        void uploadSparseVolume();
+        void deleteSparseTextures();
+        void collectSparseVoxels(std::vector<float>& instances) const;  // Debug voxels of the sparse volume at the current state level
+        void deleteCascades();
+        void clearRegion(const Cascade& cascade, const VoxelRegion& region) const;
+        void voxelizeRegion(const Cascade& cascade, int cascadeIdx, const VoxelRegion& region, const std::vector<Model>& models);
+        void splatRegion(const Cascade& cascade, int cascadeIdx, const VoxelRegion& region, const std::vector<PointCloud>& pointClouds);
+        void generateCascadeMips(const Cascade& cascade, const std::vector<VoxelRegion>& regions);
         void initializeVisualization();
         void setupUnitCube();
+        void setupVoxelInstances();
+        void extractVoxelsGPU(int level);
+        void extractVoxelsCPU(int level);
+        void uploadVoxelInstances(const std::vector<float>& instances);
         void renderVoxelsAsCubes(const glm::vec3& cameraPos, const glm::mat4& projection, const glm::mat4& view);
         void updateVisibleVoxels(const glm::vec3& cameraPos);
     };
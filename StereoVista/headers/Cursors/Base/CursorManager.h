@@ -6,8 +6,20 @@
 #include "Cursors/Types/PlaneCursor.h"
 #include "Core/Camera.h"
 #include <memory>
+#include <functional>
 
 namespace Cursor {
+    // Result of a CPU-side scene ray cast used for cursor placement
+    struct RaycastResult {
+        bool hit = false;
+        glm::vec3 position = glm::vec3(0.0f);
+        // Set when the scene holds geometry the raycaster cannot test (falls back to depth readback)
+        bool depthReadbackNeeded = true;
+    };
+
+    // Casts a world-space ray (origin, direction, angular tolerance in radians) against the scene
+    using SceneRaycaster = std::function<RaycastResult(const glm::vec3&, const glm::vec3&, float)>;
+
     // Central manager for all cursor types
     class CursorManager {
     public:
@@ -51,6 +63,13 @@ namespace Cursor {
         float getOrbitCenterSphereRadius() const { return m_orbitCenterSphereRadius; }
         void setOrbitCenterSphereRadius(float radius) { m_orbitCenterSphereRadius = radius; }
 
+        // CPU picking (avoids the glReadPixels pipeline stall when possible)
+        void setSceneRaycaster(SceneRaycaster raycaster) { m_sceneRaycaster = std::move(raycaster); }
+        bool isCPUPickingEnabled() const { return m_cpuPickingEnabled; }
+        void setCPUPickingEnabled(bool enabled) { m_cpuPickingEnabled = enabled; }
+        float getPickTolerancePixels() const { return m_pickTolerancePixels; }
+        void setPickTolerancePixels(float pixels) { m_pickTolerancePixels = pixels; }
+
         // Cursor position getters
         const glm::vec3& getCursorPosition() const { return m_cursorPosition; }
         bool isCursorPositionValid() const { return m_cursorPositionValid; }
@@ -78,6 +97,11 @@ namespace Cursor {
         glm::vec4 m_orbitCenterColor;
         float m_orbitCenterSphereRadius;
 
+        // CPU picking
+        SceneRaycaster m_sceneRaycaster;
+        bool m_cpuPickingEnabled;
+        float m_pickTolerancePixels;
+
         // Window dimensions
         int m_windowWidth;
         int m_windowHeight;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CPUVoxelizer.h"
+
+namespace Engine {
+
+    // CPU reference of voxel_mips.comp: the isotropic and the six directional mip chains of a
+    // cascade, rebuilt only over the blocks a set of dirty voxel regions touches.
+    //
+    // Directional level k holds cascade mip k + 1 as seen along one of six directions: each texel
+    // composites its 2x2x2 children front to back along the face's axis (front + (1 - front.a) *
+    // back, colors taken as premultiplied like the cone traces accumulate them) and averages the
+    // four resulting columns. Level 0 is built from the cascade's level 0, level k from the same
+    // face of level k - 1. The six faces are stored side by side along x, face f covering texels
+    // [f * res, (f + 1) * res) of a level that is res texels deep, so a cascade needs one extra
+    // 3D texture. Texel layout is the cascade's (voxel v at texel v mod res), so regions wrap.
+    class AnisotropicVoxelMips {
+    public:
+        // Face order along x, matching fragmentShader.glsl
+        enum Face { POSITIVE_X, NEGATIVE_X, POSITIVE_Y, NEGATIVE_Y, POSITIVE_Z, NEGATIVE_Z, FACE_COUNT };
+
+        // Inclusive box in absolute level 0 voxel coordinates
+        struct Region {
+            glm::ivec3 min;
+            glm::ivec3 max;
+        };
+
+        using Levels = std::vector<std::vector<glm::u8vec4>>;
+
+        struct Difference {
+            int maxIsotropic = 0;           // Largest channel difference over isotropic levels 1..n
+            int maxDirectional = 0;         // Largest channel difference over all directional levels
+            size_t differingTexels = 0;     // Texels differing by more than one (rounding) in any channel
+        };
+
+        // Zeroed directional levels for a cascade resolution (six faces of resolution >> (k + 1))
+        static Levels allocateDirectional(int resolution);
+
+        // Rebuild isotropic levels 1..n of 'volume' and all directional levels over the regions
+        static void update(CPUVoxelizer::Volume& volume, Levels& directional, const std::vector<Region>& regions);
+        static void build(CPUVoxelizer::Volume& volume, Levels& directional);
+
+        static Difference compare(const CPUVoxelizer::Volume& firstVolume, const Levels& firstDirectional,
+                                  const CPUVoxelizer::Volume& secondVolume, const Levels& secondDirectional);
+
+        // Composite of two texels along a view direction, front first
+        static glm::vec4 composite(const glm::vec4& front, const glm::vec4& back) {
+            return front + (1.0f - front.a) * back;
+        }
+    };
+
+}
@@ -8,6 +8,9 @@
 #include <vector>
 #include <array>
 #include <cfloat>
+#include <atomic>
+#include <cstdint>
+#include "ThreadPool.h"
 
 namespace Engine {
 
@@ -53,6 +56,10 @@ namespace Engine {
             return minBounds.x <= maxBounds.x && minBounds.y <= maxBounds.y && minBounds.z <= maxBounds.z;
         }
         
+        AABB intersection(const AABB& other) const {
+            return AABB(glm::max(minBounds, other.minBounds), glm::min(maxBounds, other.maxBounds));
+        }
+        
         int getLongestAxis() const {
             glm::vec3 size = getSize();
             if (size.x > size.y && size.x > size.z) return 0;
@@ -113,56 +120,224 @@ namespace Engine {
         }
     };
 
+    // Counters of a CPU traversal
+    struct BVHTraversalStats {
+        uint32_t nodesVisited = 0;      // Node fetches
+        uint32_t triangleTests = 0;
+    };
+
     class BVHBuilder {
+    public:
+        enum class BuildMode {
+            BinnedSAH,          // Object splits over binned centroids
+            SpatialSplits,      // SBVH: object or spatial splits that clip triangle references
+            LBVH                // Linear BVH over sorted Morton codes: fastest build, lower quality
+        };
+        
+        struct BuildSettings {
+            BuildMode mode = BuildMode::BinnedSAH;
+            float spatialSplitBudget = 0.3f;    // Max extra references, as a fraction of the triangles
+            
+            bool operator==(const BuildSettings& other) const {
+                return mode == other.mode && spatialSplitBudget == other.spatialSplitBudget;
+            }
+            bool operator!=(const BuildSettings& other) const { return !(*this == other); }
+        };
+        
+        // Wall time of the stages of the last build (phases a builder does not have stay 0)
+        struct BuildPhaseTimes {
+            double prepareMs = 0.0;     // Reference bounds, centroids and root bounds
+            double sortMs = 0.0;        // Morton encoding and radix sort (LBVH)
+            double hierarchyMs = 0.0;   // Split search and partitioning, or Morton splits
+            double refitMs = 0.0;       // Bottom-up node bounds (LBVH)
+            double finalizeMs = 0.0;    // Leaf order and triangle reordering
+        };
+        
     private:
         std::vector<BVHTriangle> triangles;
         std::vector<BVHNode> nodes;
-        std::vector<uint32_t> triangleIndices;
+        std::vector<uint32_t> primitiveIndices;     // Leaf order of a bounds build
         uint32_t rootNodeIdx;
-        uint32_t nodesUsed;
+        std::atomic<uint32_t> nodesUsed;
+        
+        // Compact per-triangle build data, partitioned in place so binning reads sequentially
+        struct PrimRef {
+            AABB bounds;
+            glm::vec3 centroid;
+            uint32_t triangleIdx;
+        };
+        std::vector<PrimRef> primRefs;
+        std::vector<PrimRef> scratchRefs; // Target of the parallel partition
+        
+        double lastBuildTimeMs;
+        BuildPhaseTimes lastBuildPhases;
+        bool restoredFromCache = false;
+        BuildSettings settings;
+        uint32_t inputTriangleCount = 0;
+        
+        // Spatial split state of the current build
+        std::atomic<int64_t> spatialReferencesLeft;
+        std::atomic<uint32_t> spatialSplitCount;
+        float rootSurfaceArea = 0.0f;
+        std::vector<PrimRef> leafRefs;      // Leaf references, in the order leaves were finished
+        std::mutex leafMutex;
+        
+        // LBVH state of the current build
+        std::vector<uint32_t> mortonCodes;  // Sorted, parallel to primRefs
+        std::vector<uint32_t> nodeParents;
         
         // SAH (Surface Area Heuristic) parameters
         static constexpr float TRAVERSAL_COST = 1.25f; // Slightly higher than intersection
         static constexpr float INTERSECTION_COST = 1.0f;
         static constexpr uint32_t MAX_TRIANGLES_PER_LEAF = 4; // Allow slightly more triangles per leaf
         static constexpr uint32_t SAH_BINS = 16; // More bins for better split quality
+        static constexpr uint32_t MAX_DEPTH = 20; // Limit depth for GPU traversal stack
+        
+        // Parallel build thresholds (triangles per node)
+        static constexpr uint32_t PARALLEL_SPLIT_THRESHOLD = 64 * 1024; // Parallel binning/partitioning
+        static constexpr uint32_t SUBTREE_TASK_THRESHOLD = 4 * 1024;    // Subtrees built as separate tasks
+        
+        // Spatial splits are only tried where object-split children overlap by more than this
+        // fraction of the root surface area
+        static constexpr float SPATIAL_SPLIT_ALPHA = 1e-5f;
 
     public:
-        BVHBuilder() : rootNodeIdx(0), nodesUsed(1) {}
+        BVHBuilder() : rootNodeIdx(0), nodesUsed(1), lastBuildTimeMs(0.0), spatialReferencesLeft(0), spatialSplitCount(0) {}
+        
+        // Builder used by the next triangle build
+        void setBuildSettings(const BuildSettings& buildSettings) { settings = buildSettings; }
+        const BuildSettings& getBuildSettings() const { return settings; }
         
-        // Build BVH from triangle data
-        void build(const std::vector<BVHTriangle>& inputTriangles);
+        // Build BVH from triangle data (pass an rvalue to avoid copying the triangles).
+        // The triangles are stored in leaf order, so leaf ranges address getTriangles() directly;
+        // materialId keeps whatever the caller put there (e.g. the input index). With spatial
+        // splits a triangle can be referenced by several leaves and is then stored once per leaf.
+        void build(std::vector<BVHTriangle> inputTriangles);
+        
+        // Build over plain primitive bounds (e.g. instances of a top-level BVH); leaf ranges
+        // address getPrimitiveIndices(), which maps back to the input. Spatial splits need
+        // triangles, so only BinnedSAH and LBVH apply here.
+        void build(const std::vector<AABB>& primitiveBounds);
+        
+        // Adopt a tree from an earlier build (see BVHCache) instead of building: 'inputTriangles'
+        // in input order (copied in leaf order), 'order' gives the input triangle of every leaf-order reference.
+        // Returns false (and leaves the builder empty) if the nodes do not fit the triangles.
+        bool restore(const std::vector<BVHTriangle>& inputTriangles, const BVHNode* cachedNodes, uint32_t nodeCount,
+                     const uint32_t* order, uint32_t referenceCount, uint32_t rootNode);
         
         // Get the constructed BVH data for GPU upload
         const std::vector<BVHNode>& getNodes() const { return nodes; }
-        const std::vector<uint32_t>& getTriangleIndices() const { return triangleIndices; }
+        const std::vector<uint32_t>& getPrimitiveIndices() const { return primitiveIndices; }
         const std::vector<BVHTriangle>& getTriangles() const { return triangles; }
         uint32_t getRootNodeIndex() const { return rootNodeIdx; }
         
-    private:
-        // Recursive BVH construction
-        void subdivide(uint32_t nodeIdx, uint32_t depth = 0);
+        // CPU closest-hit traversal (mirrors the shader); tHit holds the max distance on input,
+        // triangleIdx is in leaf order
+        bool intersect(const glm::vec3& origin, const glm::vec3& direction, float& tHit, uint32_t& triangleIdx,
+                       BVHTraversalStats* stats = nullptr) const;
+
+        // CPU any-hit traversal: true as soon as some triangle is hit closer than tMax
+        bool intersectAny(const glm::vec3& origin, const glm::vec3& direction, float tMax) const;
+        
+        // Möller-Trumbore test shared by the CPU traversal kernels
+        static bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const BVHTriangle& tri, float& t);
+        
+        // Slab test; returns the entry distance or FLT_MAX on a miss
+        static float intersectAABB(const glm::vec3& origin, const glm::vec3& invDirection,
+                                   const glm::vec3& minBounds, const glm::vec3& maxBounds);
+        
+        // Timing of the last build
+        double getLastBuildTimeMs() const { return lastBuildTimeMs; }
+        const BuildPhaseTimes& getLastBuildPhases() const { return lastBuildPhases; }
+        bool wasRestored() const { return restoredFromCache; }  // Last tree came from restore()
+        double getLastBuildMTrisPerSecond() const {
+            return lastBuildTimeMs > 0.0 ? inputTriangleCount / (lastBuildTimeMs * 1000.0) : 0.0;
+        }
+        
+        // Quality of the last build: SAH cost of the whole tree (relative to the root area),
+        // triangles before and references after spatial splitting
+        float computeSAHCost() const;
+        uint32_t getInputTriangleCount() const { return inputTriangleCount; }
+        uint32_t getReferenceCount() const { return static_cast<uint32_t>(triangles.size()); }
+        uint32_t getSpatialSplitCount() const { return spatialSplitCount.load(); }
         
-        // Calculate node bounds from triangle indices
-        AABB calculateBounds(uint32_t first, uint32_t count);
+    private:
+        struct SAHBin {
+            AABB bounds;
+            uint32_t count = 0;
+        };
+        using BinSet = std::array<std::array<SAHBin, SAH_BINS>, 3>;
         
-        // Find best split using SAH
         struct SplitResult {
-            int axis;
-            float position;
-            float cost;
-            uint32_t leftCount;
+            int axis = -1;
+            uint32_t bin = 0;       // First bin of the right child
+            float cost = FLT_MAX;
+            uint32_t leftCount = 0;
+            AABB leftBounds, rightBounds;
+        };
+        
+        // Spatial split bins count references entering and leaving them (chopped binning)
+        struct SpatialBin {
+            AABB bounds;
+            uint32_t enter = 0;
+            uint32_t exit = 0;
+        };
+        
+        struct SpatialSplitResult {
+            int axis = -1;
+            float position = 0.0f;  // Split plane
+            float cost = FLT_MAX;
+            uint32_t leftCount = 0;
+            uint32_t rightCount = 0;
+            AABB leftBounds, rightBounds;
         };
         
-        SplitResult findBestSplit(uint32_t first, uint32_t count, const AABB& nodeBounds);
+        // Build the tree over the prepared primRefs
+        void buildTree(const AABB& rootBounds, const AABB& rootCentroidBounds);
+        
+        // Permute the triangles into leaf order (drops the index indirection)
+        void reorderTriangles();
+        
+        // Recursive BVH construction; large subtrees are handed to 'tasks'
+        void subdivide(uint32_t nodeIdx, const AABB& centroidBounds, uint32_t depth, TaskGroup* tasks);
+        
+        // Bin the references [first, first + count) on all three axes (in parallel for large nodes)
+        void binTriangles(const std::vector<PrimRef>& refs, uint32_t first, uint32_t count,
+                          const AABB& centroidBounds, BinSet& bins);
+        
+        // Best binned SAH split using prefix/suffix sweeps over the bins
+        SplitResult findBestSplit(const BinSet& bins, const AABB& nodeBounds);
         
         // Evaluate SAH cost for a potential split
         float evaluateSAH(uint32_t leftCount, uint32_t rightCount, 
                          const AABB& leftBounds, const AABB& rightBounds, 
                          const AABB& nodeBounds);
         
-        // Partition triangles based on split
-        uint32_t partition(uint32_t first, uint32_t count, int axis, float splitPos);
+        // Partition triangles by bin (in parallel for large nodes); returns the left count and
+        // gathers the centroid bounds of both sides for binning the children
+        uint32_t partition(uint32_t first, uint32_t count, int axis, uint32_t splitBin, const AABB& centroidBounds,
+                           AABB& leftCentroidBounds, AABB& rightCentroidBounds);
+        
+        // SBVH construction over per-node reference lists; large subtrees are handed to 'tasks'
+        void buildSpatial(const AABB& rootBounds);
+        void subdivideSpatial(uint32_t nodeIdx, std::vector<PrimRef> refs, uint32_t depth, TaskGroup* tasks);
+        
+        // Best spatial split of the node over SAH_BINS uniform planes per axis
+        SpatialSplitResult findSpatialSplit(const std::vector<PrimRef>& refs, const AABB& nodeBounds);
+        
+        // Bounds of the part of a triangle between two planes on 'axis', limited to the
+        // reference's current bounds (invalid if nothing is left)
+        AABB clipTriangle(uint32_t triangleIdx, int axis, float lower, float upper, const AABB& refBounds) const;
+        
+        // LBVH construction over the prepared primRefs: parallel Morton encode and radix sort,
+        // hierarchy from the code bits, then a parallel bottom-up bounds pass
+        void buildLinear(const AABB& rootCentroidBounds);
+        void sortMortonCodes(const AABB& centroidBounds);
+        
+        // Split a node's sorted code range at its highest differing bit; large subtrees are
+        // handed to 'tasks'. Node bounds are filled in afterwards by computeLinearBounds().
+        void subdivideLinear(uint32_t nodeIdx, uint32_t depth, TaskGroup* tasks);
+        void computeLinearBounds();
     };
 
     // GPU-friendly data structures for SSBO upload
@@ -174,16 +349,19 @@ namespace Engine {
         // Total: 32 bytes
     };
 
-    struct GPUTriangle {
+    // Triangles are split into two streams in BVH leaf order. The intersection test only reads the
+    // hot stream, the cold stream is fetched once for the closest hit.
+    struct GPUTriangleGeometry {
         float v0[4];    // vec3 + padding
-        float v1[4];    // vec3 + padding  
-        float v2[4];    // vec3 + padding
-        float normal[4]; // vec3 + padding
+        float edge1[4]; // v1 - v0 + padding (precomputed Möller-Trumbore edge)
+        float edge2[4]; // v2 - v0 + padding
+        // Total: 48 bytes
+    };
+
+    struct GPUTriangleMaterial {
+        float normal[4]; // vec3 + shininess
         float color[4];  // vec3 + emissiveness
-        float shininess; // float
-        uint32_t materialId; // int (as uint32_t)
-        float padding[2]; // align to 64 bytes
-        // Total: 64 bytes (matches current Triangle struct)
+        // Total: 32 bytes
     };
 
 } // namespace Engine
\ No newline at end of file
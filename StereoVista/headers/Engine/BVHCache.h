@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "BVH.h"
+
+namespace Engine {
+
+    // On-disk cache of built bottom-level BVHs, one file per model geometry.
+    //
+    // Files are keyed by a hash of the vertex positions, the index data and the builder settings,
+    // so any edit to the geometry or a different builder misses the cache instead of loading a
+    // stale tree. A file holds a small header, the nodes in their in-memory layout and the
+    // leaf-order permutation of the input triangles (materialId of the built triangles).
+    // Files are memory-mapped on load; the nodes are copied out of the mapping in one block and
+    // the triangles are re-gathered from the caller's mesh data.
+    class BVHCache {
+    public:
+        static constexpr uint32_t FORMAT_VERSION = 1;
+
+        // Hash of the triangles (positions and triangle order) and the builder settings
+        static uint64_t hashTriangles(const std::vector<BVHTriangle>& triangles, const BVHBuilder::BuildSettings& settings);
+
+        // <directory>/<hash as hex>.bvh
+        static std::string getCachePath(const std::string& directory, uint64_t hash);
+
+        // Restore 'builder' from the cache file if it exists and matches; 'triangles' are the
+        // builder input in their original order (materialId = input index)
+        static bool load(const std::string& path, uint64_t hash, const std::vector<BVHTriangle>& triangles, BVHBuilder& builder);
+
+        // Write a built tree whose triangles carry their input index in materialId
+        static bool save(const std::string& path, uint64_t hash, const BVHBuilder& builder);
+
+    private:
+        struct FileHeader {
+            char magic[4];              // "SVBH"
+            uint32_t version;
+            uint64_t hash;
+            uint32_t inputTriangleCount;
+            uint32_t nodeCount;
+            uint32_t referenceCount;
+            uint32_t rootNode;
+        };
+    };
+
+}
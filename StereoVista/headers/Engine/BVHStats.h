@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "BVH.h"
+#include "RayQuery.h"
+
+namespace Engine {
+
+    // Quality report of a built BVHBuilder tree, so builder variants can be compared by more
+    // than their node count: SAH cost, shape histograms, sibling overlap, memory footprint and
+    // the per-phase build times. Traversal cost is measured separately by tracing a fixed ray
+    // set through the tree on the CPU.
+    struct BVHStats {
+        // CPU traversal counters over a ray set, averaged per ray
+        struct Traversal {
+            uint32_t rayCount = 0;
+            uint32_t hitCount = 0;
+            double nodesPerRay = 0.0;       // Node fetches (top-level nodes included for scenes)
+            double testsPerRay = 0.0;       // Triangle tests
+            double instancesPerRay = 0.0;   // Bottom-level trees entered (scenes only)
+            uint32_t maxNodes = 0;          // Worst ray
+            uint32_t maxTests = 0;
+            double timeMs = 0.0;            // Single thread, counters included
+        };
+
+        BVHBuilder::BuildMode mode = BVHBuilder::BuildMode::BinnedSAH;
+        uint32_t primitiveCount = 0;        // Input triangles (or bounds of a bounds build)
+        uint32_t referenceCount = 0;        // Leaf references (spatial splits add some)
+
+        // Tree shape
+        float sahCost = 0.0f;
+        uint32_t nodeCount = 0;
+        uint32_t leafCount = 0;
+        uint32_t maxDepth = 0;
+        double averageLeafDepth = 0.0;
+        double averageLeafSize = 0.0;
+        std::vector<uint32_t> depthHistogram;       // Leaves per depth
+        std::vector<uint32_t> leafSizeHistogram;    // Leaves per reference count
+
+        // Sibling overlap: surface area of the intersection of an interior node's child boxes.
+        // Rays through that region must visit both children.
+        uint32_t overlappingNodes = 0;      // Interior nodes whose children overlap
+        double averageOverlapRatio = 0.0;   // Mean overlap area / parent area over interior nodes
+        double overlapCost = 0.0;           // Summed overlap area / root area (SAH-like weighting)
+
+        // Memory footprint
+        size_t nodeBytes = 0;               // Binary nodes (same size on CPU and GPU)
+        size_t triangleBytes = 0;           // CPU triangles in leaf order
+        size_t gpuTriangleBytes = 0;        // Hot and cold triangle streams
+        size_t indexBytes = 0;              // Leaf order of a bounds build
+
+        // Build
+        double buildMs = 0.0;
+        BVHBuilder::BuildPhaseTimes buildPhases;
+        bool restored = false;              // Loaded from the BVH cache instead of built
+
+        Traversal traversal;
+
+        // Shape, overlap, memory and build statistics (traversal left empty)
+        static BVHStats analyze(const BVHBuilder& builder);
+
+        // Trace 'rays' through a triangle tree (closest hit, unbounded distance)
+        static Traversal measureTraversal(const BVHBuilder& builder, const std::vector<Ray>& rays);
+
+        // One ray per pixel center of a width x height grid over the view frustum (near plane origins)
+        static std::vector<Ray> cameraRays(const glm::mat4& view, const glm::mat4& projection, uint32_t width, uint32_t height);
+
+        static const char* getBuildModeName(BVHBuilder::BuildMode mode);
+    };
+
+    // Statistics of a two-level scene (see SceneBVH::analyze): the TLAS, every distinct BLAS and
+    // the traversal cost of the camera rays through the whole scene
+    struct SceneBVHStats {
+        BVHStats tlas;
+        std::vector<BVHStats> blas;         // One per distinct geometry
+        BVHStats::Traversal traversal;
+
+        // Triangle-weighted BLAS totals
+        uint32_t blasTriangles = 0;
+        double blasSAHCost = 0.0;
+        double blasBuildMs = 0.0;
+        BVHBuilder::BuildPhaseTimes blasPhases;     // Summed over the BLAS
+        size_t totalBytes = 0;              // All nodes, triangle streams and instances as uploaded
+
+        // Pretty-printed JSON for benchmark scripts
+        std::string toJson() const;
+        bool saveJson(const std::string& path) const;
+    };
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <vector>
+#include <cstdint>
+#include "SparseVoxelVolume.h"
+
+namespace Engine {
+
+    // Multithreaded CPU counterpart of the voxelization shaders (voxelization.vert/geom/frag).
+    //
+    // Triangles are binned into bricks of BRICK_SIZE^3 voxels with a conservative triangle/box
+    // overlap test (separating axes), then bricks are voxelized in parallel on the shared
+    // ThreadPool: every voxel a triangle overlaps gets the shader's lighting (ambient, point light
+    // diffuse, emissive) evaluated at the triangle point closest to the voxel center, blended with
+    // max like the shader's imageStore. The result uses the cascade texture layout (voxel v at texel
+    // v mod resolution) and carries box-filtered mips, so it can be uploaded as is or compared with
+    // a GPU cascade read back with Voxelizer::readCascade.
+    //
+    // Inputs are plain data, so voxelize() can run on a background thread while the GPU renders.
+    // Textures are not sampled (diffuse colors only) and coverage is exact rather than the
+    // multisampled approximation of the rasterizer, so the GPU volume should be a subset of this one.
+    class CPUVoxelizer {
+    public:
+        static constexpr int BRICK_SIZE = SparseVoxelVolume::BRICK_SIZE;
+
+        // Material inputs used by voxelization.frag
+        struct Material {
+            glm::vec3 diffuseColor = glm::vec3(1.0f);
+            float emissivity = 0.0f;
+            float transparency = 0.0f;
+        };
+
+        struct Light {
+            glm::vec3 position;
+            glm::vec3 color;
+        };
+
+        // World-space triangle with per-vertex normals
+        struct Triangle {
+            glm::vec3 v0, v1, v2;
+            glm::vec3 n0, n1, n2;
+            uint32_t material;
+        };
+
+        // Cascade window: voxels origin .. origin + resolution - 1 (absolute voxel coordinates)
+        struct Window {
+            glm::ivec3 origin = glm::ivec3(0);
+            int resolution = 128;
+            float voxelSize = 10.0f / 128.0f;
+        };
+
+        // RGBA8 volume in texture layout, with its mip chain (level 0 first)
+        struct Volume {
+            Window window;
+            std::vector<std::vector<glm::u8vec4>> levels;
+
+            int getLevelResolution(int level) const { return window.resolution >> level; }
+            size_t getOccupiedCount(int level = 0) const;
+        };
+
+        // Level 0 difference of two volumes over the same window (alpha > 0 counts as occupied)
+        struct Comparison {
+            size_t occupiedInBoth = 0;
+            size_t onlyInFirst = 0;
+            size_t onlyInSecond = 0;
+            int maxColorDifference = 0;         // Largest channel difference where both are occupied
+            double averageColorDifference = 0.0;
+        };
+
+        struct Stats {
+            double binMs = 0.0;
+            double voxelizeMs = 0.0;
+            double mipMs = 0.0;
+            uint32_t triangles = 0;             // Triangles overlapping the window
+            uint32_t bricks = 0;                // Bricks with at least one triangle
+            uint64_t brickReferences = 0;       // Triangle references over all bricks
+            size_t threads = 0;
+        };
+
+        void addMaterial(const Material& material) { materials.push_back(material); }
+        void addTriangle(const Triangle& triangle) { triangles.push_back(triangle); }
+        void setLights(const std::vector<Light>& sceneLights) { lights = sceneLights; }
+        uint32_t getMaterialCount() const { return static_cast<uint32_t>(materials.size()); }
+        size_t getTriangleCount() const { return triangles.size(); }
+        void clear();
+
+        Volume voxelize(const Window& window, Stats* stats = nullptr) const;
+
+        // Voxelize into bricks allocated only where triangles cover voxels (window-relative, no
+        // toroidal wrap); the resolution must be a multiple of BRICK_SIZE
+        void voxelizeSparse(const Window& window, SparseVoxelVolume& volume, Stats* stats = nullptr) const;
+
+        static void generateMips(Volume& volume);
+        static Comparison compare(const Volume& first, const Volume& second);
+
+        // Separating axis test of a triangle against an axis-aligned box
+        static bool triangleBoxOverlap(const glm::vec3& boxCenter, const glm::vec3& boxHalfSize,
+                                       const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2);
+
+    private:
+        // Triangle references per brick of a window (counting-sorted by brick)
+        struct BrickBins {
+            int bricksPerAxis = 0;
+            std::vector<uint32_t> brickStart;       // bricksPerAxis^3 + 1 offsets into brickTriangles
+            std::vector<uint32_t> brickTriangles;
+            std::vector<uint32_t> occupiedBricks;   // Bricks with at least one triangle
+        };
+
+        // Voxel box of a triangle relative to the window, clamped to it (false if outside)
+        static bool getTriangleVoxelBox(const Triangle& triangle, const Window& window, glm::ivec3& boxMin, glm::ivec3& boxMax);
+
+        BrickBins binTriangles(const Window& window, Stats& stats) const;
+
+        // Max-blend the brick's triangles into BRICK_SIZE^3 texels (x fastest)
+        void voxelizeBrick(const Window& window, const BrickBins& bins, uint32_t brick, glm::u8vec4* texels) const;
+
+        glm::vec4 shade(const Triangle& triangle, const glm::vec3& voxelCenter) const;
+
+        std::vector<Triangle> triangles;
+        std::vector<Material> materials;
+        std::vector<Light> lights;
+    };
+
+}
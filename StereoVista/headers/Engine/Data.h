@@ -44,6 +44,13 @@ namespace Engine {
         }
     };
 
+    // Encoding of octree node cache files (see PointCloudCodec.h)
+    enum class NodeCodecType : uint8_t {
+        Raw = 0,            // Uncompressed HDF5 file
+        DeltaBitpack = 1,
+        DeltaBitpackLZ = 2
+    };
+
     // Enhanced octree-based point cloud structures
     struct PointCloudOctreeNode {
         // Node identification
@@ -55,19 +62,22 @@ namespace Engine {
         // Point storage - either in memory or on disk
         std::vector<PointCloudPoint> points; // In-memory points (for active nodes)
         size_t totalPointCount;
+        float spacing; // Estimated point spacing (internal nodes: finest spacing below)
         
         // Disk storage information
         bool isOnDisk;
         std::string diskFilePath;
         size_t diskFileOffset;
+        NodeCodecType diskCodec; // Codec the cache file was written with
         
         // LOD information
         std::vector<size_t> lodPointCounts; // Points per LOD level
+        std::vector<PointCloudPoint> lodSamples; // Small subset that stays resident when the node is unloaded
         std::vector<GLuint> lodVBOs; // OpenGL VBOs for each LOD level
         bool vbosGenerated;
         
         // Memory management
-        bool isLoaded;
+        std::atomic<bool> isLoaded; // Set by the loader threads after filling points; check it before reading points off the main thread
         std::chrono::steady_clock::time_point lastAccessed;
         size_t memoryUsage; // Bytes used by this node
         
@@ -77,7 +87,7 @@ namespace Engine {
         
         PointCloudOctreeNode() : 
             nodeId(0), depth(0), center(0.0f), bounds(0.0f), 
-            totalPointCount(0), isOnDisk(false), diskFileOffset(0),
+            totalPointCount(0), spacing(0.0f), isOnDisk(false), diskFileOffset(0), diskCodec(NodeCodecType::Raw),
             vbosGenerated(false), isLoaded(false), memoryUsage(0), isLeaf(true) {
             lodPointCounts.resize(5);
             lodVBOs.resize(5, 0);
@@ -103,6 +113,7 @@ namespace Engine {
         size_t maxMemoryMB;
         size_t currentMemoryMB;
         std::string cacheDirectory;
+        NodeCodecType codec = NodeCodecType::Raw;   // Used for node files written from now on (the delta codecs are lossy)
         std::unordered_map<uint64_t, std::weak_ptr<PointCloudOctreeNode>> nodeCache;
         std::list<uint64_t> accessOrder; // LRU tracking
         
@@ -129,8 +140,9 @@ namespace Engine {
         glm::vec3 octreeBoundsMax;
         glm::vec3 octreeCenter;
         float octreeSize;
-        int maxOctreeDepth = 12; // Maximum octree depth
-        size_t maxPointsPerNode = 5000; // Points per leaf node before subdivision
+        int maxOctreeDepth = 32; // Safety cap only - depth adapts to local density
+        size_t maxLeafBytes = 128 * 1024; // Leaves above this size are split (while spacing allows)
+        uint64_t nextNodeId = 1; // Next free node id (nodes created by incremental updates)
         
         // LOD and distance management  
         float lodDistances[5] = { 10.0f, 25.0f, 50.0f, 100.0f, 200.0f };
@@ -168,7 +180,8 @@ namespace Engine {
               basePointSize(other.basePointSize), octreeRoot(std::move(other.octreeRoot)),
               octreeBoundsMin(other.octreeBoundsMin), octreeBoundsMax(other.octreeBoundsMax),
               octreeCenter(other.octreeCenter), octreeSize(other.octreeSize),
-              maxOctreeDepth(other.maxOctreeDepth), maxPointsPerNode(other.maxPointsPerNode),
+              maxOctreeDepth(other.maxOctreeDepth), maxLeafBytes(other.maxLeafBytes),
+              nextNodeId(other.nextNodeId),
               lodMultiplier(other.lodMultiplier), chunkCache(std::move(other.chunkCache)),
               useOctree(other.useOctree), useDiskCache(other.useDiskCache),
               totalLoadedNodes(other.totalLoadedNodes), chunkOutlineVAO(other.chunkOutlineVAO),
@@ -211,7 +224,8 @@ namespace Engine {
                 octreeCenter = other.octreeCenter;
                 octreeSize = other.octreeSize;
                 maxOctreeDepth = other.maxOctreeDepth;
-                maxPointsPerNode = other.maxPointsPerNode;
+                maxLeafBytes = other.maxLeafBytes;
+                nextNodeId = other.nextNodeId;
                 
                 for (int i = 0; i < 5; i++) {
                     lodDistances[i] = other.lodDistances[i];
@@ -1,5 +1,6 @@
 #pragma once
 #include "Data.h"
+#include "PointCloudCodec.h"
 #include "../Utils/octree.h"
 #include <hdf5/H5Cpp.h>
 #include <filesystem>
@@ -11,9 +12,53 @@
 #include <queue>
 #include <future>
 #include <atomic>
+#include <unordered_map>
+#include <functional>
 
 namespace Engine {
 
+    // Spatial query types for the out-of-core octree.
+    // All positions and distances are in the point cloud's local (octree) space.
+    struct PointQueryOptions {
+        float latencyBudgetMs = 50.0f;  // Max time spent waiting on disk loads (<= 0 waits for all)
+        bool loadMissingNodes = true;   // Request non-resident leaves through the async loader
+        size_t maxResults = 0;          // Cap for box/sphere/ray results (0 = unlimited)
+    };
+
+    struct PointQueryHit {
+        PointCloudPoint point;
+        float distance;    // Distance to the query centre, or ray parameter t for ray queries
+        uint64_t nodeId;
+    };
+
+    // Result of a CPU pick against the octree (world space)
+    struct PointPickResult {
+        bool hit = false;
+        glm::vec3 position = glm::vec3(0.0f);
+        float distance = 0.0f;          // Distance from the ray origin
+        uint64_t nodeId = 0;
+        bool fromLODSamples = false;    // Hit came from the resident samples of an unloaded node
+    };
+
+    struct PointQueryResult {
+        std::vector<PointQueryHit> hits;
+        size_t nodesVisited = 0;   // Leaves whose points were tested
+        size_t nodesSkipped = 0;   // Candidate leaves that were not resident within the budget
+        bool complete = true;      // False if any candidate leaf was skipped
+    };
+
+    // Distribution of leaf sizes (bucket i holds leaves of FIRST_BUCKET_BYTES << i bytes and up)
+    struct OctreeLeafHistogram {
+        static constexpr int BUCKET_COUNT = 16;
+        static constexpr size_t FIRST_BUCKET_BYTES = 1024;
+        std::array<size_t, BUCKET_COUNT> leafCounts = {};
+        size_t leafCount = 0;
+        size_t minLeafBytes = 0;
+        size_t maxLeafBytes = 0;
+        double meanLeafBytes = 0.0;
+        int maxDepth = 0;
+    };
+
     class OctreePointCloudManager {
     public:
         static void buildOctree(PointCloud& pointCloud);
@@ -26,25 +71,62 @@ namespace Engine {
         static size_t getMemoryUsage(const PointCloud& pointCloud);
         
         // Disk storage
-        static void saveToDisk(PointCloudOctreeNode* node, const std::string& cacheDir);
+        static void saveToDisk(PointCloudOctreeNode* node, const std::string& cacheDir, NodeCodecType codec = NodeCodecType::Raw);
         static void loadFromDisk(PointCloudOctreeNode* node, const std::string& cacheDir);
         static void createCacheDirectory(const std::string& cacheDir);
         
         // Async loading system
         static void initializeAsyncSystem();
         static void shutdownAsyncSystem();
-        static void requestAsyncLoad(PointCloudOctreeNode* node, const std::string& cacheDirectory);
+        static std::shared_future<bool> requestAsyncLoad(PointCloudOctreeNode* node, const std::string& cacheDirectory);
         static void processCompletedLoads();
         
+        // Spatial queries (prune by node bounds, load needed leaves, test leaves in parallel)
+        static PointQueryResult queryBox(PointCloud& pointCloud, const glm::vec3& boxMin, const glm::vec3& boxMax,
+                                         const PointQueryOptions& options = PointQueryOptions());
+        static PointQueryResult queryRadius(PointCloud& pointCloud, const glm::vec3& center, float radius,
+                                            const PointQueryOptions& options = PointQueryOptions());
+        static PointQueryResult queryKNearest(PointCloud& pointCloud, const glm::vec3& center, size_t k,
+                                              const PointQueryOptions& options = PointQueryOptions());
+        // Points inside a cone around the ray (radius grows by tan(coneHalfAngle) per unit of t),
+        // sorted front to back. coneHalfAngle = 0 with baseRadius > 0 gives a cylinder.
+        static PointQueryResult queryRay(PointCloud& pointCloud, const glm::vec3& origin, const glm::vec3& direction,
+                                         float maxDistance, float coneHalfAngle, float baseRadius = 0.0f,
+                                         const PointQueryOptions& options = PointQueryOptions());
+        
+        // Picking - nearest point inside an angular tolerance around a world-space ray.
+        // Only resident data is used; unloaded nodes fall back to their LOD samples.
+        static PointPickResult pickPoint(const PointCloud& pointCloud, const glm::vec3& rayOrigin,
+                                         const glm::vec3& rayDirection, float angularTolerance, float maxDistance);
+        static glm::mat4 getModelMatrix(const PointCloud& pointCloud);
+        
+        // Incremental updates (local octree space, render thread only).
+        // Only the touched leaves are rewritten on disk; their ancestors refresh their LOD samples.
+        static void insertPoints(PointCloud& pointCloud, const std::vector<PointCloudPoint>& points);
+        static size_t removePointsInBox(PointCloud& pointCloud, const glm::vec3& boxMin, const glm::vec3& boxMax);
+        static size_t removePointsInRadius(PointCloud& pointCloud, const glm::vec3& center, float radius);
+        
+        // Encodes up to maxLeaves leaves with every node codec and reports ratio / decode speed
+        static std::vector<NodeCodecBenchmark> benchmarkCodecs(PointCloud& pointCloud, size_t maxLeaves = 64);
+        
+        // Leaf size statistics (printed after every build)
+        static OctreeLeafHistogram computeLeafHistogram(const PointCloud& pointCloud);
+        static void printLeafHistogram(const OctreeLeafHistogram& histogram, const std::string& name);
+        
         // Visualization
         static void generateOctreeVisualization(PointCloud& pointCloud, int depth);
         
     private:
+        // Points kept resident per node for picking when its full data is on disk
+        static constexpr size_t LOD_SAMPLES_PER_NODE = 32;
+        
         struct BuildContext {
             size_t nextNodeId;
             std::string cacheDirectory;
-            size_t maxPointsPerNode;
+            size_t maxLeafPoints;   // maxLeafBytes in points
             int maxDepth;
+            float minCellSize;      // Cells are not split below this edge length
+            NodeCodecType codec;
         };
         
         // Async loading task structure
@@ -65,7 +147,14 @@ namespace Engine {
             PointCloud& pointCloud
         );
         
+        // Split policy: leaves are bounded in bytes, depth follows the local point spacing
+        static float estimatePointSpacing(const glm::vec3& pointsMin, const glm::vec3& pointsMax, size_t pointCount);
+        static bool shouldSplitNode(size_t pointCount, const glm::vec3& bounds, float spacing,
+                                    int depth, const BuildContext& context);
+        static void updateInternalNode(PointCloudOctreeNode* node); // Refresh count, spacing and LOD samples
+        
         static void generateLODForNode(PointCloudOctreeNode* node);
+        static void generateLODSamples(PointCloudOctreeNode* node);
         static void createVBOsForNode(PointCloudOctreeNode* node);
         
         static float calculateNodeDistance(const PointCloudOctreeNode* node, const glm::vec3& cameraPos);
@@ -101,7 +190,8 @@ namespace Engine {
         );
         
         // Disk I/O helpers
-        static std::string getNodeFilePath(const std::string& cacheDir, uint64_t nodeId);
+        static std::string getNodeFilePath(const std::string& cacheDir, uint64_t nodeId, NodeCodecType codec);
+        static void loadNodeData(PointCloudOctreeNode* node); // Decodes by node->diskCodec
         static void saveNodeToHDF5(const PointCloudOctreeNode* node, const std::string& filePath);
         static void loadNodeFromHDF5(PointCloudOctreeNode* node, const std::string& filePath);
         
@@ -112,6 +202,50 @@ namespace Engine {
                                      std::vector<std::pair<std::chrono::steady_clock::time_point, PointCloudOctreeNode*>>& nodesByAge);
         static void unloadOldestNodes(PointCloud& pointCloud, size_t targetMemoryMB);
         
+        // Spatial query helpers
+        using NodeFilter = std::function<bool(const PointCloudOctreeNode*)>;
+        static void collectCandidateLeaves(PointCloudOctreeNode* node, const NodeFilter& filter,
+                                           std::vector<PointCloudOctreeNode*>& leaves);
+        static void ensureLeavesResident(PointCloud& pointCloud, std::vector<PointCloudOctreeNode*>& leaves,
+                                         const PointQueryOptions& options, PointQueryResult& result);
+        // Finite reciprocal of a ray direction, keeping the sign of zero components
+        static glm::vec3 safeInverse(const glm::vec3& direction);
+        static bool rayIntersectsBox(const glm::vec3& origin, const glm::vec3& invDirection,
+                                     const glm::vec3& boxMin, const glm::vec3& boxMax,
+                                     float maxDistance, float& tEnter, float& tExit);
+        
+        // Picking helpers
+        struct PickRay {
+            glm::vec3 origin;
+            glm::vec3 direction;
+            glm::vec3 invDirection;
+            float coneSlope;
+            float maxDistance;
+        };
+        struct PickState {
+            float bestT;
+            PointCloudPoint bestPoint;
+            uint64_t nodeId;
+            bool fromLODSamples;
+        };
+        static void pickNodeRecursive(const PointCloudOctreeNode* node, const PickRay& ray, PickState& state);
+        static bool pickPointsInCone(const std::vector<PointCloudPoint>& points, const PickRay& ray, PickState& state);
+        
+        // Incremental update helpers
+        using PointFilter = std::function<bool(const PointCloudPoint&)>;
+        static void growRootToFit(PointCloud& pointCloud, const glm::vec3& pointsMin, const glm::vec3& pointsMax);
+        static void insertIntoNode(PointCloudOctreeNode* node, std::vector<PointCloudPoint>& points,
+                                   BuildContext& context, PointCloud& pointCloud);
+        static size_t removeFromNode(PointCloudOctreeNode* node, const NodeFilter& nodeFilter,
+                                     const PointFilter& pointFilter, PointCloud& pointCloud);
+        static size_t removePoints(PointCloud& pointCloud, const NodeFilter& nodeFilter, const PointFilter& pointFilter);
+        static void collapseIntoLeaf(PointCloudOctreeNode* node, PointCloud& pointCloud);
+        static void rewriteLeaf(PointCloudOctreeNode* node, const std::string& cacheDirectory, NodeCodecType codec);
+        static bool ensureNodeResident(PointCloudOctreeNode* node);
+        static void waitForPendingLoad(PointCloudOctreeNode* node);
+        static void discardNodeData(PointCloudOctreeNode* node);
+        static BuildContext makeBuildContext(const PointCloud& pointCloud);
+        
         // Visualization helpers
         static void generateOctreeVisualizationRecursive(PointCloudOctreeNode* node, int targetDepth, 
                                                        int currentDepth, std::vector<glm::vec3>& vertices);
@@ -125,7 +259,7 @@ namespace Engine {
         static std::mutex s_queueMutex;
         static std::condition_variable s_queueCondition;
         static std::atomic<bool> s_shutdownRequested;
-        static std::vector<std::future<bool>> s_completedTasks;
+        static std::unordered_map<PointCloudOctreeNode*, std::shared_future<bool>> s_pendingLoads;
         static std::mutex s_completedMutex;
         static std::mutex s_hdf5Mutex; // Serialize HDF5 operations for thread safety
     };
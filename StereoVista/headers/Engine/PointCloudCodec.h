@@ -0,0 +1,47 @@
+#pragma once
+#include "Data.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace Engine {
+
+    // Encoders for octree leaf point blocks (disk cache / transfer).
+    //
+    // DeltaBitpack quantizes positions to a 20-bit grid over the block bounds, sorts the block in
+    // Morton order and stores per-axis deltas; colours are predicted from the previous point
+    // (8-bit) and intensity is stored as 16-bit deltas. Every stream is zigzag coded and
+    // bit-packed in blocks of 128 values with one bit width per block, so the decoder runs
+    // fixed-width unpack loops. DeltaBitpackLZ runs a byte-oriented LZ77 pass over the result.
+    class NodeCodec {
+    public:
+        virtual ~NodeCodec() = default;
+
+        virtual NodeCodecType getType() const = 0;
+        virtual const char* getName() const = 0;
+
+        // Encoders may reorder the points (the block is stored in Morton order)
+        virtual void encode(const std::vector<PointCloudPoint>& points, std::vector<uint8_t>& out) const = 0;
+        virtual bool decode(const uint8_t* data, size_t size, size_t pointCount, std::vector<PointCloudPoint>& points) const = 0;
+
+        static const NodeCodec* get(NodeCodecType type);
+
+        // Node cache files: small header with the codec tag and point count, followed by the payload
+        static bool writeFile(const std::string& filePath, NodeCodecType type, const std::vector<PointCloudPoint>& points);
+        static bool readFile(const std::string& filePath, std::vector<PointCloudPoint>& points);
+    };
+
+    struct NodeCodecBenchmark {
+        NodeCodecType type;
+        const char* name;
+        size_t rawBytes = 0;
+        size_t encodedBytes = 0;
+        double ratio = 0.0;
+        double encodeMBps = 0.0;
+        double decodeGBps = 0.0;    // Decoded point bytes per second (single thread)
+    };
+
+    // Encodes and decodes every block with each codec and reports size and throughput
+    std::vector<NodeCodecBenchmark> benchmarkNodeCodecs(const std::vector<std::vector<PointCloudPoint>>& blocks, int iterations = 5);
+
+}
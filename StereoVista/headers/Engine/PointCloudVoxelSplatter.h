@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Data.h"
+#include "CPUVoxelizer.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <cfloat>
+
+namespace Engine {
+
+    // Splats octree point clouds into the voxel cascades, so scanned environments take part in
+    // voxel cone tracing like models do.
+    //
+    // Per cascade the octree is cut where a node's sample spacing first drops to the voxel size:
+    // internal nodes are sampled through their resident LOD samples, leaves through their points
+    // thinned to a few per voxel. Every selected node is splatted on its own (in parallel on the
+    // ThreadPool) into the voxels its samples fall into, with averaged colors lit like
+    // voxelization.frag (no normals, so the diffuse term uses the mean cosine of one half space).
+    // The work therefore follows the number of occupied voxels, not the raw point count.
+    //
+    // Splats are cached per node and cascade: moving windows only splat nodes that entered them,
+    // and nodes that left a window are evicted. Leaves that were on disk when splatted are redone
+    // (and reported as streamed, not as a scene change) once their points are resident.
+    class PointCloudVoxelSplatter {
+    public:
+        // One voxel in absolute voxel coordinates of its cascade; the color is RGBA8 packed for
+        // GLSL unpackUnorm4x8 (an ivec4 in std430)
+        struct Splat {
+            glm::ivec3 voxel;
+            uint32_t color;
+        };
+
+        struct Stats {
+            size_t nodesSelected = 0;       // Nodes overlapping the regions at a matching LOD
+            size_t nodesSplatted = 0;       // Of those, splatted in this update
+            size_t pointsRead = 0;          // Samples read by the splatted nodes
+            size_t splats = 0;              // Splats handed to the GPU
+            size_t cachedNodes = 0;         // Nodes cached over all cascades after the update
+            double splatMs = 0.0;
+        };
+
+        // Changing the lights drops every cached splat
+        void setLights(const std::vector<CPUVoxelizer::Light>& sceneLights);
+        void clear();
+
+        // Compare the point clouds with their last seen state. Clouds that moved, changed
+        // visibility or were edited lose their cached splats and their old and new world bounds
+        // are merged into dirtyMin/dirtyMax. Cached leaves whose points became resident since
+        // are dropped too; their bounds go to streamedMin/streamedMax, as streaming only refines
+        // the splats of an unchanged scene.
+        void syncClouds(const std::vector<PointCloud>& pointClouds, glm::vec3& dirtyMin, glm::vec3& dirtyMax,
+                        glm::vec3& streamedMin, glm::vec3& streamedMax);
+
+        // Append the splats of all visible clouds inside the voxel box [regionMin, regionMax] of a
+        // cascade, splatting nodes that are not cached yet
+        void collect(const std::vector<PointCloud>& pointClouds, int cascade, float voxelSize,
+                     const glm::ivec3& regionMin, const glm::ivec3& regionMax, std::vector<Splat>& splats);
+
+        // Drop the cached nodes of a cascade outside its window
+        void evict(int cascade, const glm::ivec3& windowMin, const glm::ivec3& windowMax);
+
+        // Max-blend splats into level 0 of a CPU volume like voxel_splat.comp (splats outside its
+        // window are skipped); the mips are left to the caller
+        static void blendSplats(CPUVoxelizer::Volume& volume, const std::vector<Splat>& splats);
+
+        void resetStats();
+        const Stats& getStats() const { return stats; }
+
+    private:
+        // Keyed by node id in CascadeCache; no node pointers are kept across updates
+        struct NodeSplats {
+            bool complete = true;               // False if the leaf's points were not resident
+            glm::vec3 worldMin, worldMax;
+            glm::ivec3 voxelMin, voxelMax;
+            std::vector<Splat> splats;
+        };
+
+        struct CascadeCache {
+            float voxelSize = 0.0f;
+            std::unordered_map<uint64_t, NodeSplats> nodes;
+        };
+
+        // What a cloud's splats depend on besides the lights
+        struct CloudState {
+            std::string filePath;
+            glm::mat4 transform = glm::mat4(1.0f);
+            bool visible = false;
+            size_t pointCount = 0;
+            uint64_t nextNodeId = 0;
+            glm::vec3 worldMin = glm::vec3(FLT_MAX), worldMax = glm::vec3(-FLT_MAX);
+            std::vector<CascadeCache> cascades;
+
+            bool sameInputs(const CloudState& other) const {
+                return filePath == other.filePath && transform == other.transform && visible == other.visible &&
+                       pointCount == other.pointCount && nextNodeId == other.nextNodeId;
+            }
+        };
+
+        static CloudState captureCloudState(const PointCloud& pointCloud);
+        static void findLoadedLeaves(const PointCloudOctreeNode* node, const std::unordered_set<uint64_t>& nodeIds,
+                                     std::unordered_set<uint64_t>& loaded);
+        static void getNodeWorldBounds(const PointCloudOctreeNode* node, const glm::mat4& transform, glm::vec3& worldMin, glm::vec3& worldMax);
+
+        void selectNodes(const PointCloudOctreeNode* node, const glm::mat4& transform, float scale, float voxelSize,
+                         const glm::vec3& regionWorldMin, const glm::vec3& regionWorldMax,
+                         std::vector<const PointCloudOctreeNode*>& selected) const;
+        void splatNode(const PointCloudOctreeNode* node, const glm::mat4& transform, float scale, float voxelSize, NodeSplats& result) const;
+        glm::vec3 shade(const glm::vec3& position, const glm::vec3& color) const;
+
+        std::vector<CloudState> clouds;
+        std::vector<CPUVoxelizer::Light> lights;
+        Stats stats;
+    };
+
+}
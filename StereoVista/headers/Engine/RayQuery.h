@@ -0,0 +1,135 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include <future>
+#include <cfloat>
+#include "BVH.h"
+#include "SimdBVH.h"
+#include "Loaders/ModelLoader.h"
+
+namespace Engine {
+
+    // World-space ray; the direction does not need to be normalized, distances are in units of it
+    struct Ray {
+        glm::vec3 origin;
+        glm::vec3 direction;
+    };
+
+    // Closest surface hit of a ray query
+    struct RayHit {
+        int model = -1;                 // Index into the queried model list (-1: no hit)
+        int mesh = -1;                  // Mesh of the model
+        uint32_t triangle = 0;          // Triangle of the mesh (index / 3)
+        float t = FLT_MAX;              // Ray parameter of the hit
+        glm::vec2 barycentrics = glm::vec2(0.0f); // Weights of vertex 1 and 2 (vertex 0: 1 - u - v)
+        glm::vec3 position = glm::vec3(0.0f);     // World-space hit point
+
+        bool isHit() const { return model >= 0; }
+    };
+
+    class SceneBVH;
+
+    // CPU BVH over a model's triangles in model space, used for picking and pivot hit testing.
+    // It is built in the background and kept with the model (Model::rayBVH), so transforms
+    // never invalidate it; copies of a model share it as long as the geometry matches.
+    // Queries run on a SimdBVH collapsed from the binary tree (SSE2/AVX2 picked at runtime).
+    // The binary tree is the SceneBVH BLAS of the same geometry when one exists, so the
+    // radiance renderer and the ray queries keep a single copy of the triangles.
+    class ModelRayBVH {
+    public:
+        // Build on the ThreadPool. The geometry is copied on the calling thread, so the model may
+        // change or go away meanwhile; with a shared binary tree only the SIMD collapse is left.
+        static std::shared_future<std::shared_ptr<ModelRayBVH>> buildAsync(const Model& model,
+                                                                           std::shared_ptr<const BVHBuilder> shared = nullptr);
+
+        // True if the tree was built from geometry with the model's mesh and triangle layout
+        bool matches(const Model& model) const;
+
+        // Closest hit in model space (t in units of 'direction'); fills mesh, triangle, t and barycentrics
+        bool closestHit(const glm::vec3& origin, const glm::vec3& direction, float maxT, RayHit& hit) const;
+        bool anyHit(const glm::vec3& origin, const glm::vec3& direction, float maxT) const;
+
+        // Closest hits of up to SimdBVH::MAX_PACKET coherent model-space rays; hits[i].t holds the
+        // max distance on input, returns a bit mask of the rays that hit
+        uint32_t closestHitPacket(const glm::vec3* origins, const glm::vec3* directions, uint32_t count, RayHit* hits) const;
+
+        uint32_t getTriangleCount() const { return triangleCount; }
+        const BVHBuilder& getBuilder() const { return *builder; }
+        const SimdBVH& getSimdBVH() const { return simd; }
+        bool sharesBuilder(const BVHBuilder* other) const { return builder.get() == other; }
+
+    private:
+        // Geometry the BVH was built from: the model's geometry id (shared with the SceneBVH
+        // BLAS cache) plus the counts as a guard against unreported edits
+        struct Signature {
+            uint64_t geometryId = 0;
+            size_t meshCount = 0;
+            size_t vertexCount = 0;
+            uint32_t triangleCount = 0;
+
+            bool operator==(const Signature& other) const {
+                return geometryId == other.geometryId && meshCount == other.meshCount &&
+                       vertexCount == other.vertexCount && triangleCount == other.triangleCount;
+            }
+        };
+        static Signature makeSignature(const Model& model);
+
+        // Model-space triangle vertices in mesh order (three per triangle) and the mesh layout
+        struct Source {
+            std::string name;
+            Signature signature;
+            std::vector<uint32_t> meshTriangleOffsets;
+            std::vector<glm::vec3> positions;
+        };
+        static Source makeSource(const Model& model, bool copyPositions);
+        static std::shared_ptr<ModelRayBVH> build(Source source, std::shared_ptr<const BVHBuilder> shared);
+
+        // Mesh, triangle and barycentrics of a leaf-order triangle hit at t
+        void resolveHit(uint32_t leafIdx, const glm::vec3& origin, const glm::vec3& direction, float t, RayHit& hit) const;
+
+        std::shared_ptr<const BVHBuilder> builder;
+        SimdBVH simd;
+        std::vector<uint32_t> meshTriangleOffsets;  // First mesh-order triangle of each mesh
+        Signature signature;
+        uint32_t triangleCount = 0;
+    };
+
+    // Ray queries against the scene models. Invisible models are skipped. Models without a
+    // current BVH get one built in the background and are answered meanwhile by a parallel scan
+    // over their triangles, so no query waits for a build.
+    class RayQuery {
+    public:
+        // Closest hit over all models; hit.t and hit.position are in world space
+        static RayHit raycast(std::vector<Model>& models, const Ray& ray, float maxDistance = FLT_MAX);
+
+        // Closest hit against a single model (hit.model = modelIndex)
+        static bool closestHit(Model& model, int modelIndex, const Ray& ray, RayHit& hit, float maxDistance = FLT_MAX);
+
+        // Occlusion test: true if anything lies on the ray before maxDistance
+        static bool anyHit(std::vector<Model>& models, const Ray& ray, float maxDistance = FLT_MAX);
+
+        // Closest hits of up to SimdBVH::MAX_PACKET coherent rays (e.g. a cone of rays around a
+        // hit-test ray), traced together through every model
+        static void raycastPacket(std::vector<Model>& models, const Ray* rays, uint32_t count, RayHit* hits,
+                                  float maxDistance = FLT_MAX);
+        static void closestHitPacket(Model& model, int modelIndex, const Ray* rays, uint32_t count, RayHit* hits,
+                                     float maxDistance = FLT_MAX);
+
+        // Kernel throughput over the scene models' ray BVHs (single core, see SimdBVH::benchmark);
+        // models whose BVH is still building are left out
+        static SimdBVH::Benchmark benchmark(std::vector<Model>& models, uint32_t raysPerModel = 65536);
+
+        // Start (or refresh) the model's BVH build ahead of the first query. Returns the BVH once
+        // it is current, nullptr while it is building.
+        static const ModelRayBVH* prepare(Model& model);
+
+        // prepare() on every model; true once every visible model has a current BVH
+        static bool prepare(std::vector<Model>& models);
+
+        // Scene whose BLAS are reused as binary trees (nullptr: every model builds its own)
+        static void setSceneBVH(const SceneBVH* scene);
+    };
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+namespace Engine {
+
+    // Headless checks of the CPU reference implementations, run with
+    // "StereoVista --reference-checks" instead of the application.
+    //
+    // A fixed scene (ground plane, cube, sphere, one point light) is traced and voxelized without
+    // any GPU readback, and every reference is compared with a brute force version of the same
+    // computation:
+    //   - ReferenceRenderer: binary and wide BVH traversal against the linear triangle scan
+    //   - CPUVoxelizer: brick-binned coverage against per-triangle overlap tests, dense against sparse
+    //   - AnisotropicVoxelMips: mips updated over edited regions against a full rebuild
+    // Error metrics are printed per check. A GL context must be current, as the meshes of the
+    // test scene upload their buffers; nothing is drawn or read back.
+    //
+    // Returns 0 if every check passes, 1 otherwise (the process exit code).
+    int runReferenceChecks();
+
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "BVH.h"
+#include "Data.h"
+#include "SceneBVH.h"
+
+namespace Engine {
+
+    // CPU copy of a cubemap (faces +X, -X, +Y, -Y, +Z, -Z), sampled like a samplerCube with
+    // linear filtering and clamp-to-edge
+    struct ReferenceCubemap {
+        struct Face {
+            int width = 0;
+            int height = 0;
+            std::vector<glm::vec3> texels;  // Rows in upload order (first row = t 0)
+        };
+        Face faces[6];
+
+        bool isValid() const;
+        glm::vec3 sample(const glm::vec3& direction) const;
+
+        // Read a GL cubemap texture back to the CPU (needs a current context)
+        static ReferenceCubemap fromTexture(GLuint texture);
+    };
+
+    // Multithreaded CPU path tracer mirroring radianceFragmentShader.glsl.
+    //
+    // It reads the same buffers the shader does (SceneBVH's CPU mirrors of the triangle streams,
+    // BLAS/TLAS nodes, instances and wide nodes) and runs the same traversal, RNG and lighting
+    // code, so its images serve as a headless oracle for shader changes and its rays/s as a
+    // benchmark for BVH layout work. The rasterized fragment the shader starts from is replaced by
+    // a primary ray: the closest hit provides position, face normal and baked material, primary
+    // misses show the skybox. The image is split into tiles that idle pool threads claim one at
+    // a time, so expensive tiles (many bounces, large leaves) do not stall the others.
+    class ReferenceRenderer {
+    public:
+        // Mirrors the radiance uniforms (see GUI::ApplicationPreferences::RadianceSettings)
+        struct Settings {
+            int maxBounces = 2;
+            int samplesPerPixel = 1;
+            float rayMaxDistance = 50.0f;
+            bool enableIndirectLighting = true;
+            bool enableEmissiveLighting = true;
+            float indirectIntensity = 0.3f;
+            float skyIntensity = 1.0f;
+            float emissiveIntensity = 1.0f;
+            bool enableBVH = true;
+            bool directLighting = false;        // evaluateDirectLighting is defined in the shader but not called yet
+            uint32_t tileSize = 16;
+        };
+
+        // Scene lights and background, as set for the shader
+        struct Lighting {
+            Sun sun = { glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f), 0.0f, false };
+            std::vector<PointLight> pointLights;  // At most MAX_POINT_LIGHTS are used
+            ReferenceCubemap skybox;              // Background of primary misses
+            glm::vec3 background = glm::vec3(0.0f); // Used when the skybox is empty
+        };
+
+        struct View {
+            glm::mat4 view = glm::mat4(1.0f);
+            glm::mat4 projection = glm::mat4(1.0f);
+            int width = 0;
+            int height = 0;
+        };
+
+        // Display-ready colors (tone mapped and gamma corrected), rows from top to bottom
+        struct Image {
+            int width = 0;
+            int height = 0;
+            std::vector<glm::vec3> pixels;
+
+            // Binary PPM (P6)
+            bool savePPM(const std::string& path) const;
+
+            // Largest per-channel difference to another image of the same size (-1 if sizes differ)
+            float maxDifference(const Image& other) const;
+        };
+
+        struct Stats {
+            double renderMs = 0.0;
+            uint64_t rays = 0;                  // Primary, bounce and shadow rays
+            double raysPerSecond = 0.0;
+            uint32_t tiles = 0;
+            size_t threads = 0;
+        };
+
+        static constexpr int MAX_POINT_LIGHTS = 8;
+
+        // Snapshot the scene buffers (SceneBVH::update must have run)
+        void setScene(const SceneBVH& scene);
+        bool hasScene() const { return !instances.empty(); }
+
+        Image render(const View& view, const Settings& settings, const Lighting& lighting, Stats* stats = nullptr) const;
+
+    private:
+        struct TraceRay {
+            glm::vec3 origin;
+            glm::vec3 direction;
+            glm::vec3 invDir;
+        };
+
+        struct HitInfo {
+            bool hit = false;
+            float distance = 0.0f;
+            glm::vec3 point = glm::vec3(0.0f);
+            glm::vec3 normal = glm::vec3(0.0f);
+            glm::vec3 albedo = glm::vec3(0.0f);
+            float emissiveness = 0.0f;
+            float shininess = 0.0f;
+            float roughness = 0.0f;
+            int materialId = -1;
+        };
+
+        // Per-thread state of one pixel's paths
+        struct PathContext {
+            const Settings& settings;
+            const Lighting& lighting;
+            uint32_t rngState;
+            uint64_t rays;
+        };
+
+        static TraceRay createRay(const glm::vec3& origin, const glm::vec3& direction);
+        bool intersectTriangle(const TraceRay& ray, uint32_t triIdx, float& t) const;
+        void recordHit(HitInfo& result, const TraceRay& worldRay, const GPUInstance& instance, uint32_t triIdx, float t) const;
+
+        void traverseBLAS(const TraceRay& worldRay, const TraceRay& ray, const GPUInstance& instance, HitInfo& result) const;
+        void traverseWideBLAS(const TraceRay& worldRay, const TraceRay& ray, const GPUInstance& instance, HitInfo& result) const;
+        HitInfo castRayBVH(const TraceRay& ray, float maxDistance) const;
+        HitInfo castRayLinear(const TraceRay& ray, float maxDistance) const;
+        HitInfo castRay(const TraceRay& ray, float maxDistance, PathContext& context) const;
+
+        bool isInShadow(const glm::vec3& point, const glm::vec3& normal, const glm::vec3& lightDir, float lightDistance, PathContext& context) const;
+        glm::vec3 evaluateDirectLighting(const HitInfo& hit, const glm::vec3& viewDir, PathContext& context) const;
+        glm::vec3 rayColor(const TraceRay& initialRay, PathContext& context) const;
+        glm::vec3 calculateRadianceLighting(const glm::vec3& worldPos, const glm::vec3& normal, const glm::vec3& materialColor,
+                                            float emissive, PathContext& context) const;
+        glm::vec3 shadePixel(int x, int y, const View& view, const glm::mat4& invViewProj, PathContext& context) const;
+
+        std::vector<GPUTriangleGeometry> triangles;
+        std::vector<GPUTriangleMaterial> materials;
+        std::vector<GPUBVHNode> bvhNodes;
+        std::vector<GPUBVHNode> tlasNodes;
+        std::vector<GPUInstance> instances;
+        std::vector<uint32_t> wideNodes;
+        uint32_t bvhWidth = 2;
+    };
+
+}
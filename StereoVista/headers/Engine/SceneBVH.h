@@ -0,0 +1,194 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <string>
+#include "BVH.h"
+#include "WideBVH.h"
+#include "BVHCache.h"
+#include "BVHStats.h"
+#include "Loaders/ModelLoader.h"
+
+namespace Engine {
+
+    // Per-instance data for the top-level BVH (std430 layout, 80 bytes)
+    struct GPUInstance {
+        glm::mat4 worldToLocal;     // Rays are transformed into model space
+        uint32_t rootNode;          // Root of the instance's BLAS in the node buffer
+        uint32_t triangleOffset;    // First triangle of the model in the triangle buffer
+        uint32_t triangleCount;
+        uint32_t padding;
+    };
+
+    // Two-level acceleration structure and persistent triangle buffers for the radiance renderer.
+    //
+    // Every model gets a bottom-level BVH (BLAS) built once over its triangles in model space and
+    // cached across frames. A small top-level BVH (TLAS) over the world-space instance bounds is
+    // rebuilt whenever a transform changes, so moving a model never touches its triangles.
+    // Triangles are stored per model in BLAS leaf order, so leaves address them directly. The hot
+    // geometry stream (binding 0) only changes with the BLAS set; the cold material stream
+    // (binding 2) is re-packed per model when its material changes, unchanged frames do no work.
+    // All BLAS nodes are concatenated with their offsets baked in (binding 1); the TLAS nodes and
+    // the instances (in TLAS leaf order) use bindings 3 and 4.
+    // With a BVH width of 4 or 8 the BLAS are additionally collapsed into quantized wide nodes
+    // (binding 5) and the instance roots point into that stream instead.
+    class SceneBVH {
+    public:
+        SceneBVH() = default;
+
+        // Refresh BLAS cache and TLAS from the scene models (triangle order: models, then meshes)
+        void update(const std::vector<Model>& models);
+
+        // Upload buffers changed since the last upload and bind them
+        void uploadBuffers();
+
+        // Bind the buffers to bindings 0-5 again (after passes that borrowed the binding points)
+        void bindBuffers() const;
+        void cleanup();
+
+        bool isBuilt() const { return !tlasNodes.empty(); }
+        uint32_t getTriangleCount() const { return totalTriangles; }
+        size_t getInstanceCount() const { return gpuInstances.size(); }
+        size_t getTLASNodeCount() const { return tlasNodes.size(); }
+        size_t getBLASNodeCount() const { return gpuNodes.size(); }
+        const std::vector<BVHNode>& getTLASNodes() const { return tlasNodes; }
+
+        // CPU mirrors of the shader buffers (bindings 0-5), valid after update()
+        const std::vector<GPUTriangleGeometry>& getTriangleGeometry() const { return gpuTriangleGeometry; }
+        const std::vector<GPUTriangleMaterial>& getTriangleMaterials() const { return gpuTriangleMaterials; }
+        const std::vector<GPUBVHNode>& getBLASNodes() const { return gpuNodes; }
+        const std::vector<GPUBVHNode>& getGPUTLASNodes() const { return gpuTLASNodes; }
+        const std::vector<GPUInstance>& getInstances() const { return gpuInstances; }
+        const std::vector<uint32_t>& getWideNodes() const { return gpuWideNodes; }
+
+        // True after update() if the TLAS or BLAS set was rebuilt
+        bool wasRebuilt() const { return tlasRebuilt; }
+
+        // Triangles re-packed by the last update()
+        uint32_t getLastRepackedTriangles() const { return lastRepackedTriangles; }
+
+        // Builder for the BLAS (binned SAH or spatial splits); changing it rebuilds every BLAS
+        void setBuildSettings(const BVHBuilder::BuildSettings& settings);
+        const BVHBuilder::BuildSettings& getBuildSettings() const { return buildSettings; }
+
+        // Directory of the on-disk BLAS cache (empty: no caching). BLAS built while it is set are
+        // written there, later builds of the same geometry and settings load instead of building.
+        void setCacheDirectory(const std::string& directory) { cacheDirectory = directory; }
+        const std::string& getCacheDirectory() const { return cacheDirectory; }
+
+        // Write the BLAS of the current models to the cache directory (existing files are kept)
+        void saveCache() const;
+
+        // BLAS quality: triangle-weighted SAH cost, input triangles and stored references
+        float getBLASSAHCost() const { return blasSAHCost; }
+        uint32_t getBLASInputTriangleCount() const { return blasInputTriangles; }
+
+        // BLAS layout used by the shader: 2 (binary nodes), 4 or 8 (quantized wide nodes).
+        // getBVHWidth() is the packed layout; it stays binary while a wide BLAS would overflow
+        // the traversal stack (WideBVH::TRAVERSAL_STACK_SIZE).
+        void setBVHWidth(uint32_t width);
+        uint32_t getBVHWidth() const { return traversalWidth; }
+        size_t getWideNodeCount() const { return traversalWidth > 2 ? gpuWideNodes.size() / WideBVH::getNodeStride(traversalWidth) : 0; }
+
+        // Binary vs wide traversal cost over random rays through every BLAS (CPU, for the GUI)
+        WideBVH::TraversalComparison measureTraversal(uint32_t width, uint32_t raysPerModel = 4096) const;
+
+        // Statistics of the TLAS and every distinct BLAS, plus the cost of tracing the world-space
+        // 'cameraRays' through both levels (binary nodes, as the CPU reference traverses them)
+        SceneBVHStats analyze(const std::vector<Ray>& cameraRays) const;
+
+        // Binary BLAS of the model's geometry if it is cached (shared with the CPU ray queries)
+        std::shared_ptr<const BVHBuilder> findBLAS(const Model& model) const;
+
+        static glm::mat4 getModelMatrix(const Model& model);
+
+    private:
+        struct BLAS {
+            BVHBuilder builder;
+            WideBVH wide;                                   // Collapsed on demand for the current width
+            uint32_t triangleCount = 0;                     // Stored triangles (spatial splits add references)
+            AABB localBounds;
+            uint64_t cacheHash = 0;                         // Geometry and builder hash (see BVHCache)
+        };
+
+        // Material values baked into a model's triangles
+        struct MaterialState {
+            glm::vec3 color = glm::vec3(-1.0f);
+            float emissive = 0.0f;
+            float shininess = 0.0f;
+
+            bool operator==(const MaterialState& other) const {
+                return color == other.color && emissive == other.emissive && shininess == other.shininess;
+            }
+        };
+
+        // Geometry identity of a model: its geometry id (see Model::geometryId) plus triangle count
+        struct GeometryKey {
+            uint64_t geometryId = 0;
+            uint32_t triangleCount = 0;
+
+            bool operator==(const GeometryKey& other) const {
+                return geometryId == other.geometryId && triangleCount == other.triangleCount;
+            }
+        };
+        struct GeometryKeyHash {
+            size_t operator()(const GeometryKey& key) const {
+                return std::hash<uint64_t>()(key.geometryId) ^ (static_cast<size_t>(key.triangleCount) * 0x9E3779B97F4A7C15ull);
+            }
+        };
+
+        static GeometryKey makeKey(const Model& model);
+        std::shared_ptr<BLAS> buildBLAS(const Model& model) const;
+
+        // Concatenate the BLAS of the current models with baked offsets
+        // (geometryChanged = false when only the node layout width changed)
+        void packBLAS(bool geometryChanged);
+        void buildTLAS(const std::vector<Model>& models);
+
+        // Re-pack the material sub-ranges of models whose material changed
+        void packMaterials(const std::vector<Model>& models);
+
+        std::unordered_map<GeometryKey, std::shared_ptr<BLAS>, GeometryKeyHash> blasCache;
+        std::vector<GeometryKey> modelKeys;                 // Per scene model
+        std::vector<std::shared_ptr<BLAS>> modelBLAS;       // Per scene model (null for empty models)
+        std::vector<glm::mat4> modelTransforms;             // Per scene model, last TLAS build
+        std::vector<uint32_t> modelRootNodes;               // Per scene model, global BLAS root
+        std::vector<uint32_t> modelTriangleOffsets;         // Per scene model, first global triangle
+        std::vector<MaterialState> modelMaterials;          // Per scene model, as packed
+
+        std::vector<GPUBVHNode> gpuNodes;                   // All BLAS nodes
+        std::vector<uint32_t> gpuWideNodes;                 // All wide BLAS nodes (traversalWidth > 2)
+        std::vector<BVHNode> tlasNodes;
+        std::vector<GPUBVHNode> gpuTLASNodes;
+        std::vector<GPUInstance> gpuInstances;              // In TLAS leaf order
+        std::vector<uint32_t> instanceModels;               // Scene model of each instance
+        std::vector<GPUTriangleGeometry> gpuTriangleGeometry;   // CPU mirror of the hot triangle stream
+        std::vector<GPUTriangleMaterial> gpuTriangleMaterials;  // CPU mirror of the cold triangle stream
+        std::vector<std::pair<uint32_t, uint32_t>> dirtyMaterialRanges; // {first, count} to upload
+        uint32_t totalTriangles = 0;
+        uint32_t lastRepackedTriangles = 0;
+        BVHBuilder::BuildSettings buildSettings;
+        std::string cacheDirectory;
+        float blasSAHCost = 0.0f;
+        uint32_t blasInputTriangles = 0;
+        uint32_t bvhWidth = 2;
+        uint32_t packedWidth = 0;                           // Requested width of the packed BLAS streams
+        uint32_t traversalWidth = 2;                        // Layout actually packed (bvhWidth or 2)
+
+        BVHBuilder tlasBuilder;
+        bool tlasRebuilt = false;
+        bool blasDirty = false;
+        bool tlasDirty = false;
+        bool trianglesReallocated = false;
+
+        GLuint triangleSSBO = 0;
+        GLuint materialSSBO = 0;
+        GLuint nodeSSBO = 0;
+        GLuint tlasNodeSSBO = 0;
+        GLuint instanceSSBO = 0;
+        GLuint wideNodeSSBO = 0;
+    };
+
+}
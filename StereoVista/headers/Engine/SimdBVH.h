@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "BVH.h"
+
+namespace Engine {
+
+    // Instruction sets of the CPU ray traversal kernels
+    enum class SimdLevel {
+        Scalar,         // Plain C++ over the wide layout
+        SSE2,           // 4 children, triangles or rays per instruction
+        AVX2            // 8 wide, with FMA
+    };
+
+    // Best level this CPU and OS support (checked once)
+    SimdLevel detectSimdLevel();
+    const char* getSimdLevelName(SimdLevel level);
+
+    // Wide BVH for CPU ray queries, collapsed from a binary SAH tree.
+    //
+    // Nodes have 4 children (8 for AVX2) with full-precision child bounds in SoA layout, so one
+    // slab test covers every child of a node. Leaves hold at most 'width' triangles, stored as
+    // SoA vertex/edge planes in the binary tree's leaf order, so one batched Möller-Trumbore test
+    // covers a whole leaf. Coherent rays can be traced as packets of 4 or 8 (one ray per lane).
+    // The kernels are picked at runtime from the detected SimdLevel, with a scalar fallback.
+    // Triangle indices returned are indices into binary.getTriangles().
+    class SimdBVH {
+    public:
+        static constexpr uint32_t MAX_WIDTH = 8;
+        static constexpr uint32_t MAX_PACKET = 8;
+        static constexpr uint32_t LEAF_FLAG = 0x80000000u;
+        static constexpr uint32_t LEAF_COUNT_SHIFT = 27;
+        static constexpr uint32_t LEAF_FIRST_MASK = (1u << LEAF_COUNT_SHIFT) - 1;
+        static constexpr uint32_t EMPTY_CHILD = 0xFFFFFFFFu;
+        static constexpr uint32_t INVALID_TRIANGLE = 0xFFFFFFFFu;
+
+        // Levels above the detected one fall back to it
+        void build(const BVHBuilder& binary, SimdLevel requestedLevel = detectSimdLevel());
+        void clear();
+
+        SimdLevel getLevel() const { return level; }
+        uint32_t getWidth() const { return width; }
+        uint32_t getNodeCount() const { return width ? static_cast<uint32_t>(nodeData.size() / getNodeStride()) : 0; }
+        bool isBuilt() const { return !nodeData.empty(); }
+
+        // Closest hit; tHit holds the max distance on input
+        bool intersect(const glm::vec3& origin, const glm::vec3& direction, float& tHit, uint32_t& triangleIdx) const;
+        bool intersectAny(const glm::vec3& origin, const glm::vec3& direction, float tMax) const;
+
+        // Closest hits of up to MAX_PACKET coherent rays traversed together; tHit per ray on input
+        // and output, triangleIdx is INVALID_TRIANGLE for rays that miss
+        void intersectPacket(const glm::vec3* origins, const glm::vec3* directions, uint32_t count,
+                             float* tHit, uint32_t* triangleIdx) const;
+
+        // Single-core throughput of each kernel on a coherent grid of rays through the bounds
+        struct Benchmark {
+            uint32_t rayCount = 0;
+            double binaryRaysPerSecond = 0.0;   // BVHBuilder::intersect (binary nodes, scalar glm)
+            double scalarRaysPerSecond = 0.0;
+            double sse2RaysPerSecond = 0.0;
+            double avx2RaysPerSecond = 0.0;     // 0 without AVX2
+            double packetRaysPerSecond = 0.0;   // Packets of 4/8 rays at the detected level
+            uint32_t mismatches = 0;            // Hits differing from the binary tree
+        };
+        static Benchmark benchmark(const BVHBuilder& binary, uint32_t rayCount = 65536);
+
+    private:
+        // Node: six bound planes (min x/y/z, max x/y/z) of 'width' floats, then one child word
+        // per slot (node index, LEAF_FLAG | count << LEAF_COUNT_SHIFT | first, or EMPTY_CHILD).
+        // Empty slots have inverted bounds so the slab tests reject them without a branch.
+        uint32_t getNodeStride() const { return 7 * width; }
+
+        // Subtree reference during collapse: a binary node or a slice of a large leaf
+        struct ChildRef {
+            AABB bounds;
+            uint32_t binaryNode = 0;
+            uint32_t first = 0;
+            uint32_t count = 0;
+            bool leaf = false;
+        };
+
+        ChildRef makeRef(const BVHBuilder& binary, uint32_t nodeIdx) const;
+        ChildRef makeLeafSlice(const BVHBuilder& binary, uint32_t first, uint32_t count) const;
+        bool canExpand(const ChildRef& ref) const { return !ref.leaf || ref.count > width; }
+        void expand(const BVHBuilder& binary, const ChildRef& ref, ChildRef& a, ChildRef& b) const;
+        uint32_t buildNode(const BVHBuilder& binary, const ChildRef& ref);
+
+        SimdLevel level = SimdLevel::Scalar;
+        uint32_t width = 0;
+        std::vector<float> nodeData;
+        std::vector<float> triangleData;    // Planes v0.xyz, edge1.xyz, edge2.xyz of planeStride floats
+        size_t planeStride = 0;             // Triangle count plus MAX_WIDTH padding for full-width loads
+    };
+
+}
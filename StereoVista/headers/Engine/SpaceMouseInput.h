@@ -80,6 +80,10 @@ public:
     std::function<void()> OnNavigationStarted;
     std::function<void()> OnNavigationEnded;
     std::function<void(const std::string&)> OnCommandExecuted;
+
+    // Hit test for the navlib pivot: world-space ray (normalized direction), aperture diameter
+    // around it, whether only the selection counts; returns true and the hit point on a hit
+    std::function<bool(const glm::vec3&, const glm::vec3&, float, bool, glm::vec3&)> OnHitTest;
     
 
 private:
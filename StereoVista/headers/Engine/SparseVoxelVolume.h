@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace Engine {
+
+    // Sparse RGBA8 voxel volume: a brick map over BRICK_SIZE^3 bricks, with bricks allocated from a
+    // pool only where geometry exists.
+    //
+    // Every allocated brick carries its own mip chain (8^3, 4^3, 2^3 and 1^3 texels). The 1^3 level
+    // of all bricks forms a dense coarse volume with one texel per brick, mipmapped down to a single
+    // texel; it doubles as the occupancy hierarchy (alpha 0 = empty), so tracers can skip empty
+    // bricks and larger empty regions without touching the pool. Voxel coordinates are relative to
+    // the window origin (absolute voxel coordinates, as for the cascades).
+    class SparseVoxelVolume {
+    public:
+        static constexpr int BRICK_SIZE = 8;
+        static constexpr int BRICK_LEVELS = 4;          // Levels stored per brick (8, 4, 2, 1 texels per axis)
+        static constexpr uint32_t EMPTY_BRICK = 0xFFFFFFFFu;
+
+        // Drop all bricks and set a new window; resolution must be a multiple of BRICK_SIZE
+        void reset(const glm::ivec3& origin, int resolution, float voxelSize);
+
+        const glm::ivec3& getOrigin() const { return origin; }
+        int getResolution() const { return resolution; }
+        float getVoxelSize() const { return voxelSize; }
+        int getBricksPerAxis() const { return bricksPerAxis; }
+        uint32_t getBrickCount() const { return static_cast<uint32_t>(brickCoords.size()); }
+        int getLevelCount() const;
+
+        // Pool index of a brick (brick coordinates), EMPTY_BRICK if unallocated or outside
+        uint32_t getBrickIndex(const glm::ivec3& brick) const;
+        const glm::ivec3& getBrickCoord(uint32_t index) const { return brickCoords[index]; }
+        const std::vector<uint32_t>& getBrickMap() const { return brickMap; }
+
+        // Allocate a brick (or return the existing one); its texels start out empty
+        uint32_t allocateBrick(const glm::ivec3& brick);
+
+        // Texels of a brick at an in-brick level, x fastest
+        glm::u8vec4* getBrickTexels(uint32_t index, int level = 0);
+        const glm::u8vec4* getBrickTexels(uint32_t index, int level = 0) const;
+
+        // Voxel at a level (level coordinates); zero where no brick is allocated
+        glm::u8vec4 fetch(const glm::ivec3& voxel, int level = 0) const;
+
+        // Build the in-brick mips from level 0 and the coarse levels above the brick size
+        void generateMips();
+
+        // Dense levels with one texel per brick and coarser (level BRICK_LEVELS - 1 and up)
+        const std::vector<std::vector<glm::u8vec4>>& getCoarseLevels() const { return coarseLevels; }
+
+        size_t getMemoryBytes() const;
+        size_t getDenseMemoryBytes() const;     // The same volume stored densely with a full mip chain
+
+    private:
+        static int getBrickTexelCount(int level) { int size = BRICK_SIZE >> level; return size * size * size; }
+
+        glm::ivec3 origin = glm::ivec3(0);
+        int resolution = 0;
+        float voxelSize = 1.0f;
+        int bricksPerAxis = 0;
+
+        std::vector<uint32_t> brickMap;                         // bricksPerAxis^3 pool indices
+        std::vector<glm::ivec3> brickCoords;                    // Per allocated brick
+        std::vector<glm::u8vec4> brickPools[BRICK_LEVELS];      // Per in-brick level, brick after brick
+        std::vector<std::vector<glm::u8vec4>> coarseLevels;
+    };
+
+}
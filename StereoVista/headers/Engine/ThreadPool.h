@@ -0,0 +1,77 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+namespace Engine {
+
+    // Shared worker pool for CPU-side data-parallel work (octree queries, BVH builds, ...).
+    // Callers of parallelFor take part in the work themselves, so nested parallel loops
+    // issued from inside a worker cannot deadlock the pool.
+    class ThreadPool {
+    public:
+        explicit ThreadPool(size_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Process-wide pool sized to the machine (hardware threads - 1 workers)
+        static ThreadPool& getInstance();
+
+        size_t getThreadCount() const { return m_workers.size(); }
+
+        // Queue a task for execution on a worker thread
+        void submit(std::function<void()> task);
+
+        // Execute one queued task on the calling thread (used to help while waiting)
+        bool runPendingTask();
+
+        // Split [begin, end) into chunks of 'grain' elements and run body(chunkBegin, chunkEnd)
+        // on the pool. A grain of 0 picks a chunk size from the range and thread count.
+        // Returns once every chunk has completed.
+        void parallelFor(size_t begin, size_t end, size_t grain,
+                         const std::function<void(size_t, size_t)>& body);
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread> m_workers;
+        std::queue<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stop = false;
+    };
+
+    // Group of tasks on a pool that can be waited on together (for recursive task parallelism).
+    // Tasks may add further tasks to the same group; wait() returns once all of them finished.
+    class TaskGroup {
+    public:
+        explicit TaskGroup(ThreadPool& pool = ThreadPool::getInstance());
+        ~TaskGroup();
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        void run(std::function<void()> task);
+
+        // Executes queued pool work on the calling thread while waiting
+        void wait();
+
+    private:
+        struct State {
+            std::atomic<size_t> pending{ 0 };
+            std::mutex mutex;
+            std::condition_variable condition;
+        };
+
+        ThreadPool& m_pool;
+        std::shared_ptr<State> m_state;
+    };
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Engine {
+
+    // Lighting terms of voxelization.frag for the CPU paths that reproduce it (CPUVoxelizer,
+    // PointCloudVoxelSplatter). Keep in sync with the defines at the top of the shader.
+    namespace VoxelLighting {
+
+        constexpr float POINT_LIGHT_INTENSITY = 1.0f;
+        constexpr size_t MAX_LIGHTS = 180;
+        constexpr float AMBIENT_STRENGTH = 0.3f;
+        constexpr float DIST_FACTOR = 1.1f;
+
+        inline float attenuate(float dist) {
+            dist *= DIST_FACTOR;
+            return 1.0f / (1.0f + dist * dist);
+        }
+
+    }
+
+}
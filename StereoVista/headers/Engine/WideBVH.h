@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "BVH.h"
+
+namespace Engine {
+
+    // 4- or 8-wide BVH collapsed from a binary SAH tree, with child bounds quantized to 8 bits
+    // relative to the parent.
+    //
+    // Nodes are stored as a flat uint stream (SSBO friendly) with a fixed stride per width:
+    //   [0..2]  quantization origin (float bits, parent min)
+    //   [3]     biased exponents of the per-axis scale (x | y << 8 | z << 16) | childCount << 24
+    //   [4..]   six planes (lo.x, lo.y, lo.z, hi.x, hi.y, hi.z) of width bytes each, one byte per child
+    //   [..]    one word per child: internal child = node index,
+    //           leaf child = LEAF_FLAG | count << LEAF_COUNT_SHIFT | first triangle index
+    // BVH4: 4 + 6 + 4 words padded to 16 (64 bytes); BVH8: 4 + 12 + 8 = 24 words (96 bytes).
+    class WideBVH {
+    public:
+        static constexpr uint32_t LEAF_FLAG = 0x80000000u;
+        static constexpr uint32_t LEAF_COUNT_SHIFT = 27;
+        static constexpr uint32_t MAX_LEAF_TRIANGLES = 15;
+        static constexpr uint32_t LEAF_FIRST_MASK = (1u << LEAF_COUNT_SHIFT) - 1;
+        // Traversal stack of intersect() and of traverseWideBLAS in the radiance shader
+        static constexpr uint32_t TRAVERSAL_STACK_SIZE = 64;
+
+        // Collapse 'binary' into a tree of the given width (4 or 8)
+        void build(const BVHBuilder& binary, uint32_t width);
+        void clear();
+
+        uint32_t getWidth() const { return width; }
+        uint32_t getNodeStride() const { return getNodeStride(width); }
+        uint32_t getNodeCount() const { return width ? static_cast<uint32_t>(nodeData.size() / getNodeStride()) : 0; }
+        const std::vector<uint32_t>& getNodeData() const { return nodeData; }
+
+        // Stack entries a closest-hit traversal can need, over any near-to-far child order.
+        // Above TRAVERSAL_STACK_SIZE, intersect() uses the binary tree and SceneBVH packs binary nodes.
+        uint32_t getMaxStackDepth() const { return maxStackDepth; }
+        bool fitsTraversalStack() const { return maxStackDepth <= TRAVERSAL_STACK_SIZE; }
+        static uint32_t getNodeStride(uint32_t width) { return width == 8 ? 24 : 16; }
+
+        // Append the nodes to a scene stream, rebasing child node and triangle indices
+        void appendTo(std::vector<uint32_t>& out, uint32_t nodeOffset, uint32_t triangleOffset) const;
+
+        // CPU closest-hit traversal mirroring the shader (triangles of the binary tree, in leaf order)
+        bool intersect(const BVHBuilder& binary, const glm::vec3& origin, const glm::vec3& direction,
+                       float& tHit, uint32_t& triangleIdx, BVHTraversalStats* stats = nullptr) const;
+
+        // Average per-ray cost of the binary and the wide tree over random rays through the bounds
+        struct TraversalComparison {
+            uint32_t rayCount = 0;
+            double binaryNodesPerRay = 0.0;
+            double binaryTestsPerRay = 0.0;
+            double wideNodesPerRay = 0.0;
+            double wideTestsPerRay = 0.0;
+            uint32_t mismatches = 0;            // Rays where the closest hits differ
+        };
+        TraversalComparison compareTraversal(const BVHBuilder& binary, uint32_t rayCount = 4096) const;
+
+    private:
+        // Subtree reference during collapse: a binary node or a slice of a large leaf
+        struct ChildRef {
+            AABB bounds;
+            uint32_t binaryNode = 0;
+            uint32_t first = 0;             // Leaf slice (triangle index range)
+            uint32_t count = 0;
+            bool leaf = false;
+        };
+
+        ChildRef makeRef(const BVHBuilder& binary, uint32_t nodeIdx) const;
+        ChildRef makeLeafSlice(const BVHBuilder& binary, uint32_t first, uint32_t count) const;
+        bool canExpand(const ChildRef& ref) const { return !ref.leaf || ref.count > MAX_LEAF_TRIANGLES; }
+        void expand(const BVHBuilder& binary, const ChildRef& ref, ChildRef& a, ChildRef& b) const;
+
+        // Returns the node index; stackDepth receives the stack bound of its subtree
+        uint32_t buildNode(const BVHBuilder& binary, const ChildRef& ref, uint32_t& stackDepth);
+
+        // Decoded child bounds as the shader sees them
+        void decodeChild(uint32_t nodeIdx, uint32_t child, glm::vec3& minBounds, glm::vec3& maxBounds) const;
+
+        uint32_t width = 0;
+        uint32_t maxStackDepth = 0;
+        std::vector<uint32_t> nodeData;
+    };
+
+}
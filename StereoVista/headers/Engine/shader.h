@@ -26,6 +26,7 @@ namespace Engine {
         void setVec2(const std::string& name, glm::vec2 vec);
         void setVec3(const std::string& name, glm::vec3 vec);
         void setVec4(const std::string& name, glm::vec4 vec);
+        void setIVec3(const std::string& name, glm::ivec3 vec);
         GLuint getID() const { return shaderID; }
 
         // Helper method to check if shader is valid
@@ -38,4 +39,7 @@ namespace Engine {
 
     // Modified shader loader function
     Shader* loadShader(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath = "");
+
+    // Single-stage compute program, searched in the same paths as loadShader
+    Shader* loadComputeShader(const std::string& computePath);
 }
\ No newline at end of file
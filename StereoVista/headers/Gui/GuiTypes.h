@@ -118,6 +118,9 @@ namespace GUI {
             float emissiveIntensity = 1.0f;
             float materialRoughness = 0.5f;
             bool enableBVH = true;
+            int bvhWidth = 2; // 2=binary, 4=BVH4, 8=BVH8 (quantized wide nodes)
+            int bvhBuilder = 0; // 0=binned SAH, 1=spatial splits (SBVH), 2=LBVH
+            float spatialSplitBudget = 0.3f; // Max extra triangle references for spatial splits
             bool showBVHDebug = false;
             int bvhDebugMaxDepth = 3;
             int bvhDebugRenderMode = 1; // 0=DEPTH_TESTED, 1=ALWAYS_ON_TOP, 2=DEPTH_BIASED
@@ -5,6 +5,8 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include "../Engine/Core.h"
+#include <memory>
+#include <future>
 
 // Material type enum for presets
 enum class MaterialType {
@@ -20,6 +22,7 @@ enum class MaterialType {
 namespace Engine {
 
     class Shader;
+    class ModelRayBVH;
 
     struct Texture {
         GLuint id;
@@ -101,6 +104,17 @@ namespace Engine {
 
         std::vector<Mesh> meshes;
 
+        // Identity of the geometry for caches keyed on it (SceneBVH BLAS, ray query BVHs). Every
+        // model gets a fresh one and copies share it; call markGeometryChanged() after editing
+        // vertices or indices in place.
+        uint64_t geometryId = nextGeometryId();
+        void markGeometryChanged() { geometryId = nextGeometryId(); }
+        static uint64_t nextGeometryId();
+
+        // CPU BVH for ray queries and its pending background build (see RayQuery.h)
+        std::shared_ptr<ModelRayBVH> rayBVH;
+        std::shared_future<std::shared_ptr<ModelRayBVH>> rayBVHBuild;
+
         bool hasNormalMap() const {
             if (meshes.empty()) return false;
             for (const auto& texture : meshes[0].textures) {
@@ -11,6 +11,15 @@ using json = nlohmann::json;
 
 namespace Engine {
 
+    std::string getSceneDataDirectory(const std::string& filename) {
+        std::filesystem::path scenePath(filename);
+        return (scenePath.parent_path() / scenePath.stem()).string();
+    }
+
+    std::string getSceneBVHCacheDirectory(const std::string& filename) {
+        return (std::filesystem::path(getSceneDataDirectory(filename)) / "bvh").string();
+    }
+
     void saveScene(const std::string& filename, const Scene& scene, const Camera& camera) {
         try {
             // Ensure filename has .scene extension
@@ -1,13 +1,13 @@
 #include "Core/Voxalizer.h"
+#include "Engine/ThreadPool.h"
 #include <iostream>
-#include <random>
+#include <cfloat>
 
 namespace Engine {
 
     Voxelizer::Voxelizer(int resolution)
         : m_resolution(resolution)
         , m_voxelGridSize(10.0f)
-        , m_voxelTexture(0)
         , m_voxelShader(nullptr)
         , m_voxelCubeShader(nullptr)
         , m_cubeVAO(0)
@@ -16,7 +16,7 @@ namespace Engine {
         , voxelOpacity(1.0f)
         , voxelColorIntensity(1.0f) {
 
-        initializeVoxelTexture();
+        initializeCascades(3);
         initializeVisualization();
 
         // Setup default light
@@ -44,35 +44,105 @@ namespace Engine {
             throw;
         }
 
-        // Generate instance VBO for voxel instances
-        glGenBuffers(1, &m_voxelInstanceVBO);
+        // Debug voxel extraction on the GPU; without it the CPU path is used
+        try {
+            m_voxelExtractShader = Engine::loadComputeShader("voxelization/voxel_extract.comp");
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Voxel extraction shader unavailable, extracting debug voxels on the CPU: " << e.what() << std::endl;
+        }
+
+        // Point cloud splatting; without it point clouds are left out of the volume
+        try {
+            m_splatShader = Engine::loadComputeShader("voxelization/voxel_splat.comp");
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Voxel splat shader unavailable, point clouds are not voxelized: " << e.what() << std::endl;
+        }
+        glGenBuffers(1, &m_splatBuffer);
+
+        // Mips over dirty regions, with the directional chains; without it the isotropic chains are
+        // regenerated whole and cone traces stay isotropic
+        try {
+            m_mipShader = Engine::loadComputeShader("voxelization/voxel_mips.comp");
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Voxel mip shader unavailable, using isotropic mips: " << e.what() << std::endl;
+        }
+
+        setupVoxelInstances();
     }
 
     Voxelizer::~Voxelizer() {
-        glDeleteTextures(1, &m_voxelTexture);
+        deleteCascades();
+        deleteSparseTextures();
         glDeleteVertexArrays(1, &m_cubeVAO);
         glDeleteBuffers(1, &m_cubeVBO);
         glDeleteBuffers(1, &m_voxelInstanceVBO);
+        glDeleteBuffers(1, &m_voxelIndirectBuffer);
+        glDeleteBuffers(1, &m_splatBuffer);
 
         delete m_voxelShader;
         delete m_voxelCubeShader;
+        delete m_voxelExtractShader;
+        delete m_splatShader;
+        delete m_mipShader;
     }
 
-    void Voxelizer::initializeVoxelTexture() {
-        glGenTextures(1, &m_voxelTexture);
-        glBindTexture(GL_TEXTURE_3D, m_voxelTexture);
-
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    void Voxelizer::initializeCascades(int count) {
+        m_cascades.resize(std::clamp(count, 1, MAX_CASCADES));
+        for (auto& cascade : m_cascades) {
+            glGenTextures(1, &cascade.texture);
+            glBindTexture(GL_TEXTURE_3D, cascade.texture);
+
+            // Windows wrap toroidally, so sampling repeats instead of clamping
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+
+            glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8,
+                m_resolution, m_resolution, m_resolution,
+                0, GL_RGBA, GL_FLOAT, nullptr);
+
+            glGenerateMipmap(GL_TEXTURE_3D);
+
+            // Directional level k holds cascade level k + 1, so it starts at half the resolution
+            int directionalResolution = m_resolution / 2;
+            int directionalLevels = static_cast<int>(std::log2(directionalResolution)) + 1;
+            glGenTextures(1, &cascade.directional);
+            glBindTexture(GL_TEXTURE_3D, cascade.directional);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);   // Faces wrap in the shader
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+            glTexStorage3D(GL_TEXTURE_3D, directionalLevels, GL_RGBA8,
+                AnisotropicVoxelMips::FACE_COUNT * directionalResolution, directionalResolution, directionalResolution);
+            for (int level = 0; level < directionalLevels; level++) {
+                glClearTexImage(cascade.directional, level, GL_RGBA, GL_FLOAT, nullptr);
+            }
+            cascade.valid = false;
+        }
+    }
 
-        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8,
-            m_resolution, m_resolution, m_resolution,
-            0, GL_RGBA, GL_FLOAT, nullptr);
+    void Voxelizer::deleteCascades() {
+        for (auto& cascade : m_cascades) {
+            glDeleteTextures(1, &cascade.texture);
+            glDeleteTextures(1, &cascade.directional);
+        }
+        m_cascades.clear();
+    }
 
-        glGenerateMipmap(GL_TEXTURE_3D);
+    void Voxelizer::setCascadeCount(int count) {
+        count = std::clamp(count, 1, MAX_CASCADES);
+        if (count == getCascadeCount()) return;
+        deleteCascades();
+        initializeCascades(count);
+        m_fullUpdatePending = true;
+        m_cascadeVersion++;
+        m_voxelDataNeedsUpdate = true;
     }
 
     void Voxelizer::initializeVisualization() {
@@ -147,14 +217,202 @@ namespace Engine {
         glBindVertexArray(0);
     }
 
-    // This function was moved to the constructor
+    void Voxelizer::setupVoxelInstances() {
+        // Fixed-size instance buffer: written by the extraction shader or uploaded by the CPU path
+        glGenBuffers(1, &m_voxelInstanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_voxelInstanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, MAX_DEBUG_VOXELS * 8 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+
+        glBindVertexArray(m_cubeVAO);
+
+        // Position attribute (location 2)
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+        glVertexAttribDivisor(2, 1); // This makes it instanced
+
+        // Color attribute (location 3)
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+        glVertexAttribDivisor(3, 1); // This makes it instanced
+
+        // Mipmap level attribute (location 4)
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(7 * sizeof(float)));
+        glVertexAttribDivisor(4, 1); // This makes it instanced
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // Indirect draw command: 36 cube vertices, instance count filled by the extraction
+        GLuint command[4] = { 36, 0, 0, 0 };
+        glGenBuffers(1, &m_voxelIndirectBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_voxelIndirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), command, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
 
-    void Voxelizer::update(const glm::vec3& cameraPos, const std::vector<Model>& models) {
-        // Clear voxel texture
-        glClearTexImage(m_voxelTexture, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glm::mat4 Voxelizer::getModelMatrix(const Model& model) {
+        glm::mat4 modelMatrix = glm::mat4(1.0f);
+        modelMatrix = glm::translate(modelMatrix, model.position);
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.x), glm::vec3(1, 0, 0));
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.y), glm::vec3(0, 1, 0));
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.z), glm::vec3(0, 0, 1));
+        modelMatrix = glm::scale(modelMatrix, model.scale);
+        return modelMatrix;
+    }
 
-        // Bind voxel texture for writing
-        glBindImageTexture(0, m_voxelTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA8);
+    Voxelizer::ModelState Voxelizer::captureModelState(const Model& model, const ModelState* previous) {
+        ModelState state;
+        state.transform = getModelMatrix(model);
+        state.material = { model.color.r, model.color.g, model.color.b,
+                           model.specularColor.r, model.specularColor.g, model.specularColor.b,
+                           model.diffuseReflectivity, model.specularReflectivity, model.specularDiffusion,
+                           model.emissive, model.refractiveIndex, model.transparency, 0.0f, 0.0f };
+        state.visible = model.visible;
+        state.meshData = model.getMeshes().data();
+        state.meshes.reserve(model.getMeshes().size());
+        for (const auto& mesh : model.getMeshes()) {
+            state.meshes.emplace_back(mesh.VAO, static_cast<uint32_t>(mesh.indices.size()), mesh.visible ? 1u : 0u,
+                                      mesh.textures.empty() ? 0u : mesh.textures[0].id);
+        }
+
+        // Vertex bounds only need a pass over the vertices when the geometry changed
+        if (previous && previous->meshData == state.meshData && previous->meshes == state.meshes) {
+            state.localMin = previous->localMin;
+            state.localMax = previous->localMax;
+        } else {
+            glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+            for (const auto& mesh : model.getMeshes()) {
+                for (const auto& vertex : mesh.vertices) {
+                    boundsMin = glm::min(boundsMin, vertex.position);
+                    boundsMax = glm::max(boundsMax, vertex.position);
+                }
+            }
+            state.localMin = boundsMin;
+            state.localMax = boundsMax;
+        }
+
+        state.worldMin = glm::vec3(FLT_MAX);
+        state.worldMax = glm::vec3(-FLT_MAX);
+        if (state.localMin.x <= state.localMax.x) {
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec3 local((corner & 1) ? state.localMax.x : state.localMin.x,
+                                (corner & 2) ? state.localMax.y : state.localMin.y,
+                                (corner & 4) ? state.localMax.z : state.localMin.z);
+                glm::vec3 world = glm::vec3(state.transform * glm::vec4(local, 1.0f));
+                state.worldMin = glm::min(state.worldMin, world);
+                state.worldMax = glm::max(state.worldMax, world);
+            }
+        }
+        return state;
+    }
+
+    void Voxelizer::update(const glm::vec3& cameraPos, const std::vector<Model>& models, const std::vector<PointCloud>& pointClouds) {
+        m_lastUpdateVoxelized = false;
+
+        bool lightsChanged = m_lights.size() != m_voxelizedLights.size();
+        for (size_t i = 0; !lightsChanged && i < m_lights.size(); i++) {
+            lightsChanged = m_lights[i].position != m_voxelizedLights[i].position || m_lights[i].color != m_voxelizedLights[i].color;
+        }
+        bool fullUpdate = m_fullUpdatePending || lightsChanged || m_state != m_voxelizedState;
+
+        // World region to re-voxelize: old and new bounds of every changed model (and of removed ones)
+        glm::vec3 dirtyMin(FLT_MAX), dirtyMax(-FLT_MAX);
+        auto addDirtyBounds = [&](const ModelState& state) {
+            if (!state.visible || state.worldMin.x > state.worldMax.x) return;
+            dirtyMin = glm::min(dirtyMin, state.worldMin);
+            dirtyMax = glm::max(dirtyMax, state.worldMax);
+        };
+        std::vector<ModelState> states(models.size());
+        for (size_t i = 0; i < models.size(); i++) {
+            const ModelState* previous = i < m_modelStates.size() ? &m_modelStates[i] : nullptr;
+            states[i] = captureModelState(models[i], previous);
+            if (!previous || !states[i].sameInputs(*previous)) {
+                if (previous) addDirtyBounds(*previous);
+                addDirtyBounds(states[i]);
+            }
+        }
+        for (size_t i = models.size(); i < m_modelStates.size(); i++) {
+            addDirtyBounds(m_modelStates[i]);
+        }
+        m_modelStates = std::move(states);
+
+        // Point clouds that moved or were edited; changed lights invalidate every splat. Leaves
+        // whose points streamed in are redone without counting as a scene change.
+        glm::vec3 streamedMin(FLT_MAX), streamedMax(-FLT_MAX);
+        bool splatPoints = m_voxelizePointClouds && m_splatShader;
+        if (splatPoints) {
+            if (lightsChanged) {
+                std::vector<CPUVoxelizer::Light> lights;
+                for (const auto& light : m_lights) {
+                    lights.push_back({ light.position, light.color });
+                }
+                m_pointSplatter.setLights(lights);
+            }
+            m_pointSplatter.syncClouds(pointClouds, dirtyMin, dirtyMax, streamedMin, streamedMax);
+        } else {
+            m_pointSplatter.clear();
+        }
+
+        // The sparse volume is baked for a static scene; streaming only refines the cascades and
+        // the bake keeps the splats it was made with until it is rebuilt
+        if (hasSparseVolume() && (lightsChanged || dirtyMin.x <= dirtyMax.x)) {
+            std::cout << "Scene changed, dropping the sparse voxel volume" << std::endl;
+            clearSparseVolume();
+        }
+        dirtyMin = glm::min(dirtyMin, streamedMin);
+        dirtyMax = glm::max(dirtyMax, streamedMax);
+
+        // Writes at coarser debug levels land on multiples of the level's stride, so windows and
+        // regions stay aligned to it
+        int stride = 1 << m_state;
+        int snap = std::max(CASCADE_SNAP, stride);
+        auto alignDown = [](const glm::ivec3& v, int step) {
+            return glm::ivec3(glm::floor(glm::vec3(v) / static_cast<float>(step))) * step;
+        };
+
+        // Regions per cascade: the whole window, or the slabs the window moved into plus the
+        // voxels covered by changed models
+        std::vector<std::vector<VoxelRegion>> cascadeRegions(m_cascades.size());
+        std::vector<glm::ivec3> origins(m_cascades.size());
+        bool anyRegion = false;
+        for (size_t c = 0; c < m_cascades.size(); c++) {
+            const Cascade& cascade = m_cascades[c];
+            float voxelSize = getCascadeVoxelSize(static_cast<int>(c));
+            glm::ivec3 origin = glm::ivec3(glm::floor((cameraPos / voxelSize - m_resolution * 0.5f) / static_cast<float>(snap))) * snap;
+            origins[c] = origin;
+            VoxelRegion window = { origin, origin + m_resolution - 1 };
+            auto& regions = cascadeRegions[c];
+
+            glm::ivec3 delta = origin - cascade.origin;
+            if (fullUpdate || !cascade.valid || glm::any(glm::greaterThanEqual(glm::abs(delta), glm::ivec3(m_resolution)))) {
+                regions.push_back(window);
+            } else {
+                for (int axis = 0; axis < 3; axis++) {
+                    if (delta[axis] == 0) continue;
+                    VoxelRegion slab = window;
+                    if (delta[axis] > 0) slab.min[axis] = cascade.origin[axis] + m_resolution;
+                    else slab.max[axis] = cascade.origin[axis] - 1;
+                    regions.push_back(slab);
+                }
+
+                // Voxel box of the dirty region, one voxel wider for the multisampled coverage
+                if (dirtyMin.x <= dirtyMax.x) {
+                    VoxelRegion dirty;
+                    dirty.min = glm::max(alignDown(glm::ivec3(glm::floor(dirtyMin / voxelSize)) - 1, stride), window.min);
+                    dirty.max = glm::min(alignDown(glm::ivec3(glm::floor(dirtyMax / voxelSize)) + 1, stride) + stride - 1, window.max);
+                    if (!glm::any(glm::greaterThan(dirty.min, dirty.max))) regions.push_back(dirty);  // Else outside the window
+                }
+            }
+            anyRegion = anyRegion || !regions.empty();
+        }
+        if (!anyRegion) return;
+
+        m_fullUpdatePending = false;
+        m_voxelizedLights = m_lights;
+        m_voxelizedState = m_state;
+        m_lastUpdateVoxelized = true;
 
         // Use standard resolution viewport
         int voxelizationRes = m_resolution;
@@ -187,22 +445,99 @@ namespace Engine {
 
         // Pass the current mipmap level to the shader
         m_voxelShader->setInt("mipmapLevel", m_state);
+        m_pointSplatter.resetStats();
+
+        for (size_t c = 0; c < m_cascades.size(); c++) {
+            Cascade& cascade = m_cascades[c];
+            if (cascadeRegions[c].empty()) continue;
+            cascade.origin = origins[c];
+            cascade.valid = true;
+
+            // Clear each region; models are rasterized again where they overlap it
+            for (const auto& region : cascadeRegions[c]) {
+                clearRegion(cascade, region);
+                voxelizeRegion(cascade, static_cast<int>(c), region, models);
+                glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+                if (splatPoints) {
+                    splatRegion(cascade, static_cast<int>(c), region, pointClouds);
+                    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+                }
+            }
+            if (splatPoints) {
+                m_pointSplatter.evict(static_cast<int>(c), cascade.origin, cascade.origin + m_resolution - 1);
+            }
 
-        // CRITICAL: Pass the actual grid size to the shader
-        m_voxelShader->setFloat("gridSize", m_voxelGridSize);
+            // Mips only over the re-voxelized regions
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            generateCascadeMips(cascade, cascadeRegions[c]);
+        }
+
+        // Mark voxel data as needing update for visualization
+        m_cascadeVersion++;
+        m_voxelDataNeedsUpdate = true;
+
+        // Reset state
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        
+        // Disable MSAA
+        glDisable(GL_MULTISAMPLE);
+        glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+
+            glDisable(GL_SAMPLE_SHADING);
+        
+    }
+
+    void Voxelizer::clearRegion(const Cascade& cascade, const VoxelRegion& region) const {
+        // Texel ranges of the region per axis; a range crossing the wrap splits in two
+        int starts[3][2], sizes[3][2], counts[3];
+        for (int axis = 0; axis < 3; axis++) {
+            int size = region.max[axis] - region.min[axis] + 1;
+            int start = ((region.min[axis] % m_resolution) + m_resolution) % m_resolution;
+            starts[axis][0] = start;
+            sizes[axis][0] = std::min(size, m_resolution - start);
+            starts[axis][1] = 0;
+            sizes[axis][1] = size - sizes[axis][0];
+            counts[axis] = sizes[axis][1] > 0 ? 2 : 1;
+        }
+
+        for (int x = 0; x < counts[0]; x++) {
+            for (int y = 0; y < counts[1]; y++) {
+                for (int z = 0; z < counts[2]; z++) {
+                    glClearTexSubImage(cascade.texture, 0, starts[0][x], starts[1][y], starts[2][z],
+                                       sizes[0][x], sizes[1][y], sizes[2][z], GL_RGBA, GL_FLOAT, nullptr);
+                }
+            }
+        }
+    }
+
+    void Voxelizer::voxelizeRegion(const Cascade& cascade, int cascadeIdx, const VoxelRegion& region, const std::vector<Model>& models) {
+        // Bind voxel texture for writing
+        glBindImageTexture(0, cascade.texture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA8);
+
+        // Project the cascade window onto the viewport
+        float voxelSize = getCascadeVoxelSize(cascadeIdx);
+        m_voxelShader->setFloat("gridSize", getCascadeExtent(cascadeIdx));
+        m_voxelShader->setVec3("gridCenter", (glm::vec3(cascade.origin) + m_resolution * 0.5f) * voxelSize);
+        m_voxelShader->setFloat("voxelSize", voxelSize);
+
+        // Fragments outside the cleared region would double-write voxels that were kept
+        m_voxelShader->setVec3("regionMin", glm::vec3(region.min));
+        m_voxelShader->setVec3("regionMax", glm::vec3(region.max));
+        glm::vec3 regionWorldMin = glm::vec3(region.min) * voxelSize;
+        glm::vec3 regionWorldMax = glm::vec3(region.max + 1) * voxelSize;
+
+        // Voxelize each model that overlaps the region
+        for (size_t modelIdx = 0; modelIdx < models.size(); modelIdx++) {
+            const Model& model = models[modelIdx];
+            const ModelState& state = m_modelStates[modelIdx];
 
-        // Voxelize each model
-        for (const auto& model : models) {
             // Skip invisible models
             if (!model.visible) continue;
+            if (glm::any(glm::greaterThan(state.worldMin, regionWorldMax)) || glm::any(glm::lessThan(state.worldMax, regionWorldMin))) continue;
 
             // Create model matrix
-            glm::mat4 modelMatrix = glm::mat4(1.0f);
-            modelMatrix = glm::translate(modelMatrix, model.position);
-            modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.x), glm::vec3(1, 0, 0));
-            modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.y), glm::vec3(0, 1, 0));
-            modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.z), glm::vec3(0, 0, 1));
-            modelMatrix = glm::scale(modelMatrix, model.scale);
+            const glm::mat4& modelMatrix = state.transform;
 
             // CRITICAL: Always use a fixed scaling factor
             // This ensures objects are voxelized at the correct scale regardless of grid size
@@ -258,188 +593,544 @@ namespace Engine {
                 glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
             }
         }
+    }
 
-        // Generate mipmaps for 3D texture
-        glBindTexture(GL_TEXTURE_3D, m_voxelTexture);
-        glGenerateMipmap(GL_TEXTURE_3D);
 
-        // Mark voxel data as needing update for visualization
+    void Voxelizer::splatRegion(const Cascade& cascade, int cascadeIdx, const VoxelRegion& region, const std::vector<PointCloud>& pointClouds) {
+        m_regionSplats.clear();
+        m_pointSplatter.collect(pointClouds, cascadeIdx, getCascadeVoxelSize(cascadeIdx), region.min, region.max, m_regionSplats);
+        if (m_regionSplats.empty()) return;
+
+        // Grow the splat buffer geometrically; it is reused across regions and updates
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_splatBuffer);
+        if (m_regionSplats.size() > m_splatBufferCapacity) {
+            m_splatBufferCapacity = std::max(m_regionSplats.size(), m_splatBufferCapacity * 2);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, m_splatBufferCapacity * sizeof(PointCloudVoxelSplatter::Splat), nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_regionSplats.size() * sizeof(PointCloudVoxelSplatter::Splat), m_regionSplats.data());
+        GLint previousBinding = 0;
+        glGetIntegeri_v(GL_SHADER_STORAGE_BUFFER_BINDING, 0, &previousBinding);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_splatBuffer);
+
+        glBindImageTexture(0, cascade.texture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA8);
+        m_splatShader->use();
+        m_splatShader->setInt("splatCount", static_cast<int>(m_regionSplats.size()));
+        m_splatShader->setInt("mipmapLevel", m_state);
+        m_splatShader->setIVec3("regionMin", region.min);
+        m_splatShader->setIVec3("regionMax", region.max);
+        glDispatchCompute(static_cast<GLuint>((m_regionSplats.size() + 63) / 64), 1, 1);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLuint>(previousBinding));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // The following regions set uniforms on the voxelization program
+        m_voxelShader->use();
+    }
+
+    void Voxelizer::generateCascadeMips(const Cascade& cascade, const std::vector<VoxelRegion>& regions) {
+        if (!m_mipShader) {
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            glBindTexture(GL_TEXTURE_3D, cascade.texture);
+            glGenerateMipmap(GL_TEXTURE_3D);
+            return;
+        }
+
+        m_mipShader->use();
+        int levelCount = static_cast<int>(std::log2(m_resolution));
+        for (int level = 1; level <= levelCount; level++) {
+            int levelResolution = m_resolution >> level;
+
+            // Level 1 reads no directional source; directional level 0 is bound so the unit is valid
+            glBindImageTexture(0, cascade.texture, level - 1, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA8);
+            glBindImageTexture(1, cascade.directional, std::max(level - 2, 0), GL_TRUE, 0, GL_READ_ONLY, GL_RGBA8);
+            glBindImageTexture(2, cascade.texture, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
+            glBindImageTexture(3, cascade.directional, level - 1, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
+            m_mipShader->setInt("levelResolution", levelResolution);
+            m_mipShader->setBool("fromIsotropic", level == 1);
+
+            for (const auto& region : regions) {
+                // Blocks of this level covering the region; a window never needs more than one wrap
+                float blockSize = static_cast<float>(1 << level);
+                glm::ivec3 blockMin = glm::ivec3(glm::floor(glm::vec3(region.min) / blockSize));
+                glm::ivec3 blockMax = glm::ivec3(glm::floor(glm::vec3(region.max) / blockSize));
+                glm::ivec3 blockCount = glm::min(blockMax - blockMin + 1, glm::ivec3(levelResolution));
+                m_mipShader->setIVec3("blockMin", blockMin);
+                m_mipShader->setIVec3("blockCount", blockCount);
+                glDispatchCompute((blockCount.x + 3) / 4, (blockCount.y + 3) / 4, (blockCount.z + 3) / 4);
+            }
+
+            // The next level reads what this one wrote
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+        for (int unit = 0; unit < 4; unit++) {
+            glBindImageTexture(unit, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+        }
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+        // update() keeps setting uniforms on the voxelization program
+        m_voxelShader->use();
+    }
+
+    void Voxelizer::generateMipmaps() {
+        for (const auto& cascade : m_cascades) {
+            VoxelRegion window = { cascade.origin, cascade.origin + m_resolution - 1 };
+            generateCascadeMips(cascade, { window });
+        }
+    }
+
+    void Voxelizer::fillCPUVoxelizer(CPUVoxelizer& cpuVoxelizer, const std::vector<Model>& models) const {
+        cpuVoxelizer.clear();
+
+        std::vector<CPUVoxelizer::Light> lights;
+        for (const auto& light : m_lights) {
+            lights.push_back({ light.position, light.color });
+        }
+        cpuVoxelizer.setLights(lights);
+
+        for (const auto& model : models) {
+            if (!model.visible) continue;
+
+            CPUVoxelizer::Material material;
+            material.diffuseColor = model.color;
+            material.emissivity = model.emissive;
+            material.transparency = model.transparency;
+            uint32_t materialIdx = cpuVoxelizer.getMaterialCount();
+            cpuVoxelizer.addMaterial(material);
+
+            // Same transforms as voxelization.vert
+            glm::mat4 modelMatrix = getModelMatrix(model);
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
+            for (const auto& mesh : model.getMeshes()) {
+                if (!mesh.visible) continue;
+                for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                    const Vertex& a = mesh.vertices[mesh.indices[i]];
+                    const Vertex& b = mesh.vertices[mesh.indices[i + 1]];
+                    const Vertex& c = mesh.vertices[mesh.indices[i + 2]];
+                    CPUVoxelizer::Triangle triangle;
+                    triangle.v0 = glm::vec3(modelMatrix * glm::vec4(a.position, 1.0f));
+                    triangle.v1 = glm::vec3(modelMatrix * glm::vec4(b.position, 1.0f));
+                    triangle.v2 = glm::vec3(modelMatrix * glm::vec4(c.position, 1.0f));
+                    triangle.n0 = normalMatrix * a.normal;
+                    triangle.n1 = normalMatrix * b.normal;
+                    triangle.n2 = normalMatrix * c.normal;
+                    triangle.material = materialIdx;
+                    cpuVoxelizer.addTriangle(triangle);
+                }
+            }
+        }
+    }
+
+    CPUVoxelizer::Window Voxelizer::getCascadeWindow(int cascade) const {
+        CPUVoxelizer::Window window;
+        window.origin = m_cascades[cascade].origin;
+        window.resolution = m_resolution;
+        window.voxelSize = getCascadeVoxelSize(cascade);
+        return window;
+    }
+
+    CPUVoxelizer::Volume Voxelizer::readCascade(int cascade) const {
+        CPUVoxelizer::Volume volume;
+        volume.window = getCascadeWindow(cascade);
+
+        glBindTexture(GL_TEXTURE_3D, m_cascades[cascade].texture);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        for (int levelResolution = m_resolution, level = 0; levelResolution >= 1; levelResolution /= 2, level++) {
+            volume.levels.emplace_back(static_cast<size_t>(levelResolution) * levelResolution * levelResolution);
+            glGetTexImage(GL_TEXTURE_3D, level, GL_RGBA, GL_UNSIGNED_BYTE, volume.levels.back().data());
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        return volume;
+    }
+
+    AnisotropicVoxelMips::Levels Voxelizer::readCascadeDirectional(int cascade) const {
+        AnisotropicVoxelMips::Levels directional = AnisotropicVoxelMips::allocateDirectional(m_resolution);
+
+        glBindTexture(GL_TEXTURE_3D, m_cascades[cascade].directional);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        for (size_t level = 0; level < directional.size(); level++) {
+            glGetTexImage(GL_TEXTURE_3D, static_cast<GLint>(level), GL_RGBA, GL_UNSIGNED_BYTE, directional[level].data());
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        return directional;
+    }
+
+    void Voxelizer::uploadCascade(int cascade, const CPUVoxelizer::Volume& volume, const std::vector<PointCloud>& pointClouds) {
+        if (cascade >= getCascadeCount() || volume.window.resolution != m_resolution) {
+            std::cerr << "CPU voxelization does not match cascade " << cascade << ", not uploaded" << std::endl;
+            return;
+        }
+
+        glBindTexture(GL_TEXTURE_3D, m_cascades[cascade].texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t level = 0; level < volume.levels.size(); level++) {
+            int levelResolution = volume.getLevelResolution(static_cast<int>(level));
+            glTexSubImage3D(GL_TEXTURE_3D, static_cast<GLint>(level), 0, 0, 0, levelResolution, levelResolution, levelResolution,
+                            GL_RGBA, GL_UNSIGNED_BYTE, volume.levels[level].data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        // The window now holds the uploaded origin; later camera moves update it toroidally
+        m_cascades[cascade].origin = volume.window.origin;
+        m_cascades[cascade].valid = true;
+
+        // The upload replaced the point splats the cache holds as written, so splat them again
+        VoxelRegion window = { volume.window.origin, volume.window.origin + m_resolution - 1 };
+        bool splatPoints = m_voxelizePointClouds && m_splatShader;
+        if (splatPoints) {
+            splatRegion(m_cascades[cascade], cascade, window, pointClouds);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+
+        // The directional mips follow the uploaded level 0, the isotropic ones the splats
+        if (m_mipShader || splatPoints) {
+            generateCascadeMips(m_cascades[cascade], { window });
+        }
+        if (cascade == 0) m_cascadeVersion++;
         m_voxelDataNeedsUpdate = true;
+    }
 
-        // Reset state
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_CULL_FACE);
-        
-        // Disable MSAA
-        glDisable(GL_MULTISAMPLE);
-        glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+    std::vector<PointCloudVoxelSplatter::Splat> Voxelizer::collectCascadeSplats(int cascade, const std::vector<PointCloud>& pointClouds) {
+        std::vector<PointCloudVoxelSplatter::Splat> splats;
+        if (!m_voxelizePointClouds || !m_splatShader) return splats;
 
-            glDisable(GL_SAMPLE_SHADING);
-        
+        glm::ivec3 origin = m_cascades[cascade].origin;
+        m_pointSplatter.collect(pointClouds, cascade, getCascadeVoxelSize(cascade), origin, origin + m_resolution - 1, splats);
+        return splats;
     }
 
+    bool Voxelizer::buildSparseVolume(const std::vector<Model>& models, const std::vector<PointCloud>& pointClouds,
+                                      int resolution, CPUVoxelizer::Stats* stats) {
+        if (resolution < m_resolution || resolution % SparseVoxelVolume::BRICK_SIZE != 0) {
+            std::cerr << "Sparse volume resolution must be a multiple of " << SparseVoxelVolume::BRICK_SIZE
+                      << " and at least the cascade resolution" << std::endl;
+            return false;
+        }
 
-    void Voxelizer::renderDebugVisualization(const glm::vec3& cameraPos, const glm::mat4& projection, const glm::mat4& view) {
-        if (!showDebugVisualization) return;
-        
-        // Always render as voxel cubes (ray-cast visualization removed)
-        renderVoxelsAsCubes(cameraPos, projection, view);
+        // Cascade 0's window at the finer resolution
+        CPUVoxelizer::Window window;
+        window.origin = m_cascades[0].origin * (resolution / m_resolution);
+        window.resolution = resolution;
+        window.voxelSize = getCascadeExtent(0) / resolution;
+
+        CPUVoxelizer cpuVoxelizer;
+        fillCPUVoxelizer(cpuVoxelizer, models);
+        cpuVoxelizer.voxelizeSparse(window, m_sparseVolume, stats);
+
+        // Point clouds at the sparse voxel size (cached in the slot after the cascades)
+        if (m_voxelizePointClouds) {
+            std::vector<PointCloudVoxelSplatter::Splat> splats;
+            m_pointSplatter.collect(pointClouds, MAX_CASCADES, window.voxelSize, window.origin, window.origin + resolution - 1, splats);
+            for (const auto& splat : splats) {
+                glm::ivec3 voxel = splat.voxel - window.origin;
+                glm::ivec3 local = voxel % SparseVoxelVolume::BRICK_SIZE;
+                uint32_t brick = m_sparseVolume.allocateBrick(voxel / SparseVoxelVolume::BRICK_SIZE);
+                glm::u8vec4 color(splat.color & 0xFF, (splat.color >> 8) & 0xFF, (splat.color >> 16) & 0xFF, splat.color >> 24);
+                glm::u8vec4& texel = m_sparseVolume.getBrickTexels(brick)[(local.z * SparseVoxelVolume::BRICK_SIZE + local.y) * SparseVoxelVolume::BRICK_SIZE + local.x];
+                texel = glm::max(texel, color);
+            }
+            if (!splats.empty()) m_sparseVolume.generateMips();
+        }
+        uploadSparseVolume();
+
+        std::cout << "Sparse voxel volume: " << m_sparseVolume.getBrickCount() << " bricks, "
+                  << m_sparseVolume.getMemoryBytes() / (1024 * 1024) << " MB (dense "
+                  << m_sparseVolume.getDenseMemoryBytes() / (1024 * 1024) << " MB)" << std::endl;
+        m_voxelDataNeedsUpdate = true;
+        return true;
     }
 
-    void Voxelizer::updateVisibleVoxels(const glm::vec3& cameraPos) {
-        // Clear previous visible voxels
-        m_visibleVoxels.clear();
+    void Voxelizer::clearSparseVolume() {
+        deleteSparseTextures();
+        m_sparseVolume.reset(glm::ivec3(0), 0, 1.0f);
+        m_voxelDataNeedsUpdate = true;
+    }
 
-        // Bind the 3D texture
-        glBindTexture(GL_TEXTURE_3D, m_voxelTexture);
+    void Voxelizer::deleteSparseTextures() {
+        if (m_sparseBrickMap) glDeleteTextures(1, &m_sparseBrickMap);
+        for (GLuint& atlas : m_sparseAtlases) {
+            if (atlas) glDeleteTextures(1, &atlas);
+            atlas = 0;
+        }
+        if (m_sparseCoarse) glDeleteTextures(1, &m_sparseCoarse);
+        m_sparseBrickMap = 0;
+        m_sparseCoarse = 0;
+        m_sparseGPUBytes = 0;
+    }
 
-        // Implement proper distance-based multi-level sampling with constant density
-        // Calculate effective resolution based on grid size to maintain constant voxel density
-        float baseGridSize = 10.0f; // Reference grid size
-        float densityScale = m_voxelGridSize / baseGridSize; // How much more/less dense we need
-        
-        int maxMipLevels = static_cast<int>(std::log2(m_resolution)) + 1;
-        
-        for (int level = 0; level < maxMipLevels; level++) {
-            int levelResolution = m_resolution >> level;
-            if (levelResolution < 1) break;
-            
-            // Get texture data for this mipmap level
-            std::vector<glm::vec4> voxelData(levelResolution * levelResolution * levelResolution);
-            glGetTexImage(GL_TEXTURE_3D, level, GL_RGBA, GL_FLOAT, voxelData.data());
-            
-            int stride = 1 << level;
-            
-            // Calculate sampling density to maintain constant voxel density
-            // Larger grid size = need more samples to maintain density
-            int samplingStride = std::max(1, static_cast<int>(baseGridSize / m_voxelGridSize));
-            int effectiveSamples = levelResolution * samplingStride;
-            
-            // Loop through voxels with density-adjusted sampling
-            for (int x = 0; x < effectiveSamples; x += samplingStride) {
-                for (int y = 0; y < effectiveSamples; y += samplingStride) {
-                    for (int z = 0; z < effectiveSamples; z += samplingStride) {
-                        // Map back to texture coordinates
-                        int tx = std::min(x / samplingStride, levelResolution - 1);
-                        int ty = std::min(y / samplingStride, levelResolution - 1);
-                        int tz = std::min(z / samplingStride, levelResolution - 1);
-                        // Calculate index using texture coordinates
-                        int index = (tz * levelResolution * levelResolution) + (ty * levelResolution) + tx;
-
-                        // Check if this voxel has any color data
-                        glm::vec4 voxelColor = voxelData[index];
-                        if (voxelColor.a > 0.001f || (voxelColor.r + voxelColor.g + voxelColor.b) > 0.001f) {
-                            // Calculate normalized position based on virtual sampling position
-                            float nx = ((float)x + 0.5f) / (float)effectiveSamples;
-                            float ny = ((float)y + 0.5f) / (float)effectiveSamples;
-                            float nz = ((float)z + 0.5f) / (float)effectiveSamples;
-
-                            // Convert back to world space using the SAME mapping as voxelization shader
-                            // This must match the voxelization.frag: normalizedPos = (worldPos + halfGrid) / gridSize
-                            float halfGrid = m_voxelGridSize * 0.5f;
-                            glm::vec3 position(
-                                (nx * m_voxelGridSize) - halfGrid,
-                                (ny * m_voxelGridSize) - halfGrid,
-                                (nz * m_voxelGridSize) - halfGrid
-                            );
-
-                            // Calculate distance from camera
-                            float distanceFromCamera = glm::length(position - cameraPos);
-                            
-                            // In debug mode, use a fixed mipmap level instead of distance-based LOD
-                            bool shouldShowVoxel;
-                            if (showDebugVisualization) {
-                                // In debug mode, only show voxels from the current debug state (m_state)
-                                shouldShowVoxel = (level == m_state);
-                            } else {
-                                // Normal mode: use distance-based LOD selection
-                                int appropriateLOD = calculateMipmapLevel(distanceFromCamera);
-                                shouldShowVoxel = (appropriateLOD == level);
-                            }
-                            
-                            // Only show voxel if it meets the LOD criteria
-                            if (shouldShowVoxel) {
-                                // Add to visible voxels with LOD information
-                                VoxelData voxel;
-                                voxel.position = position;
-                                voxel.color = voxelColor;
-                                voxel.mipmapLevel = level;
-                                m_visibleVoxels.push_back(voxel);
+    void Voxelizer::uploadSparseVolume() {
+        deleteSparseTextures();
+        const SparseVoxelVolume& volume = m_sparseVolume;
+        int bricksPerAxis = volume.getBricksPerAxis();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        // Brick map: pool index per brick, EMPTY_BRICK where nothing is allocated
+        glGenTextures(1, &m_sparseBrickMap);
+        glBindTexture(GL_TEXTURE_3D, m_sparseBrickMap);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_R32UI, bricksPerAxis, bricksPerAxis, bricksPerAxis, 0,
+                     GL_RED_INTEGER, GL_UNSIGNED_INT, volume.getBrickMap().data());
+        m_sparseGPUBytes += volume.getBrickMap().size() * sizeof(uint32_t);
+
+        // Brick atlases for the in-brick levels below one texel per brick. Brick i sits in slot
+        // (i % A, (i / A) % A, i / A^2), padded by a one texel apron copied from its neighbours so
+        // hardware trilinear filtering never reads across slots
+        const int slotsPerAxis = SPARSE_ATLAS_BRICKS;
+        uint32_t brickCount = std::max(volume.getBrickCount(), 1u);
+        int atlasLayers = static_cast<int>((brickCount + slotsPerAxis * slotsPerAxis - 1) / (slotsPerAxis * slotsPerAxis));
+        for (int level = 0; level < SparseVoxelVolume::BRICK_LEVELS - 1; level++) {
+            int brickTexels = SparseVoxelVolume::BRICK_SIZE >> level;
+            int padded = brickTexels + 2;
+            glm::ivec3 atlasSize(slotsPerAxis * padded, slotsPerAxis * padded, atlasLayers * padded);
+            std::vector<glm::u8vec4> texels(static_cast<size_t>(atlasSize.x) * atlasSize.y * atlasSize.z, glm::u8vec4(0));
+
+            ThreadPool::getInstance().parallelFor(0, volume.getBrickCount(), 0, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) {
+                    glm::ivec3 slot(index % slotsPerAxis, (index / slotsPerAxis) % slotsPerAxis, index / (slotsPerAxis * slotsPerAxis));
+                    glm::ivec3 first = volume.getBrickCoord(static_cast<uint32_t>(index)) * brickTexels - 1;
+                    for (int z = 0; z < padded; z++) {
+                        for (int y = 0; y < padded; y++) {
+                            for (int x = 0; x < padded; x++) {
+                                glm::ivec3 texel = slot * padded + glm::ivec3(x, y, z);
+                                texels[(static_cast<size_t>(texel.z) * atlasSize.y + texel.y) * atlasSize.x + texel.x] =
+                                    volume.fetch(first + glm::ivec3(x, y, z), level);
                             }
                         }
                     }
                 }
-            }
-        }
+            });
 
-        // Allow more voxels to be displayed for better scene coverage
-        const size_t maxVoxels = 200000;
-        if (m_visibleVoxels.size() > maxVoxels) {
-            std::random_device rd;
-            std::mt19937 g(rd());
-            std::shuffle(m_visibleVoxels.begin(), m_visibleVoxels.end(), g);
-            m_visibleVoxels.resize(maxVoxels);
+            glGenTextures(1, &m_sparseAtlases[level]);
+            glBindTexture(GL_TEXTURE_3D, m_sparseAtlases[level]);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 0);
+            glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, atlasSize.x, atlasSize.y, atlasSize.z, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+            m_sparseGPUBytes += texels.size() * sizeof(glm::u8vec4);
         }
 
-        // Update the instance VBO with the new voxel data
-        if (!m_visibleVoxels.empty()) {
-            glBindBuffer(GL_ARRAY_BUFFER, m_voxelInstanceVBO);
-
-            // Create a buffer for position, color, and mipmap level data
-            std::vector<float> instanceData;
-            instanceData.reserve(m_visibleVoxels.size() * 8); // 3 for position, 4 for color, 1 for mipmap level
+        // Coarse levels (one texel per brick and up) as one mipmapped texture
+        const auto& coarseLevels = volume.getCoarseLevels();
+        glGenTextures(1, &m_sparseCoarse);
+        glBindTexture(GL_TEXTURE_3D, m_sparseCoarse);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(coarseLevels.size()) - 1);
+        for (size_t level = 0; level < coarseLevels.size(); level++) {
+            int size = bricksPerAxis >> level;
+            glTexImage3D(GL_TEXTURE_3D, static_cast<GLint>(level), GL_RGBA8, size, size, size, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, coarseLevels[level].data());
+            m_sparseGPUBytes += coarseLevels[level].size() * sizeof(glm::u8vec4);
+        }
 
-            for (const auto& voxel : m_visibleVoxels) {
-                // Position
-                instanceData.push_back(voxel.position.x);
-                instanceData.push_back(voxel.position.y);
-                instanceData.push_back(voxel.position.z);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_3D, 0);
+    }
 
-                // Color
-                instanceData.push_back(voxel.color.r);
-                instanceData.push_back(voxel.color.g);
-                instanceData.push_back(voxel.color.b);
-                instanceData.push_back(voxel.color.a);
+    void Voxelizer::renderDebugVisualization(const glm::vec3& cameraPos, const glm::mat4& projection, const glm::mat4& view) {
+        if (!showDebugVisualization) return;
+        
+        // Always render as voxel cubes (ray-cast visualization removed)
+        renderVoxelsAsCubes(cameraPos, projection, view);
+    }
 
-                // Mipmap level (as float for GPU upload)
-                instanceData.push_back(static_cast<float>(voxel.mipmapLevel));
+    void Voxelizer::updateVisibleVoxels(const glm::vec3& cameraPos) {
+        m_voxelInstancesOnGPU = false;
+        m_visibleVoxelCount = 0;
+
+        // The sparse volume lives in CPU memory, so it needs no readback
+        if (hasSparseVolume() && useSparseVolume) {
+            std::vector<float>& instances = m_uploadInstances;
+            instances.clear();
+            collectSparseVoxels(instances);
+            uploadVoxelInstances(instances);
+        }
+        else {
+            int level = std::min(m_state, static_cast<int>(std::log2(m_resolution)));
+            if (gpuVoxelExtraction && m_voxelExtractShader) {
+                extractVoxelsGPU(level);
+            } else {
+                extractVoxelsCPU(level);
             }
+        }
 
-            // Upload instance data
-            glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(float), instanceData.data(), GL_DYNAMIC_DRAW);
+        m_voxelDataNeedsUpdate = false;
+    }
 
-            // Set up the VAO for the cube with instance data
-            glBindVertexArray(m_cubeVAO);
+    void Voxelizer::extractVoxelsGPU(int level) {
+        const Cascade& cascade = m_cascades[0];
+        int levelResolution = m_resolution >> level;
+        int stride = 1 << level;
+
+        // Reset the instance count; the shader appends and counts
+        GLuint command[4] = { 36, 0, 0, 0 };
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_voxelIndirectBuffer);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), command);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        // Bindings 0 and 1 belong to the radiance renderer's scene buffers between passes
+        GLint previousBindings[2] = { 0, 0 };
+        glGetIntegeri_v(GL_SHADER_STORAGE_BUFFER_BINDING, 0, &previousBindings[0]);
+        glGetIntegeri_v(GL_SHADER_STORAGE_BUFFER_BINDING, 1, &previousBindings[1]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_voxelInstanceVBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_voxelIndirectBuffer);
+
+        m_voxelExtractShader->use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_3D, cascade.texture);
+        m_voxelExtractShader->setInt("voxelTexture", 0);
+        m_voxelExtractShader->setInt("level", level);
+        m_voxelExtractShader->setInt("levelResolution", levelResolution);
+        m_voxelExtractShader->setIVec3("firstBlock", glm::ivec3(glm::floor(glm::vec3(cascade.origin) / static_cast<float>(stride))));
+        m_voxelExtractShader->setFloat("blockSize", getCascadeVoxelSize(0) * stride);
+        glUniform1ui(glGetUniformLocation(m_voxelExtractShader->getID(), "maxInstances"), static_cast<GLuint>(MAX_DEBUG_VOXELS));
+
+        GLuint groups = static_cast<GLuint>((levelResolution + 7) / 8);
+        glDispatchCompute(groups, groups, groups);
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLuint>(previousBindings[0]));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, static_cast<GLuint>(previousBindings[1]));
+        m_voxelInstancesOnGPU = true;
+    }
 
-            // Position attribute (location 2)
-            glEnableVertexAttribArray(2);
-            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-            glVertexAttribDivisor(2, 1); // This makes it instanced
+    void Voxelizer::extractVoxelsCPU(int level) {
+        const Cascade& cascade = m_cascades[0];
+        int levelResolution = m_resolution >> level;
+        int stride = 1 << level;
+
+        // Levels are re-read only when cascade 0 was written since their last extraction
+        m_extractedLevels.resize(static_cast<int>(std::log2(m_resolution)) + 1);
+        ExtractedLevel& extracted = m_extractedLevels[level];
+        if (extracted.version != m_cascadeVersion) {
+            m_levelReadback.resize(static_cast<size_t>(levelResolution) * levelResolution * levelResolution);
+            glBindTexture(GL_TEXTURE_3D, cascade.texture);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glGetTexImage(GL_TEXTURE_3D, level, GL_RGBA, GL_UNSIGNED_BYTE, m_levelReadback.data());
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+            // Texel t of this level holds the block of 'stride' voxels b of the window with
+            // b = t (mod levelResolution)
+            glm::ivec3 firstBlock = glm::ivec3(glm::floor(glm::vec3(cascade.origin) / static_cast<float>(stride)));
+            float blockSize = getCascadeVoxelSize(0) * stride;
+
+            // Scan z slices in parallel into reused per-slice buffers, then concatenate in order
+            m_sliceInstances.resize(std::max<size_t>(m_sliceInstances.size(), levelResolution));
+            ThreadPool::getInstance().parallelFor(0, levelResolution, 0, [&](size_t begin, size_t end) {
+                for (size_t z = begin; z < end; z++) {
+                    std::vector<float>& slice = m_sliceInstances[z];
+                    slice.clear();
+                    for (int y = 0; y < levelResolution; y++) {
+                        for (int x = 0; x < levelResolution; x++) {
+                            glm::ivec3 block = firstBlock + glm::ivec3(x, y, static_cast<int>(z));
+                            glm::ivec3 texel = ((block % levelResolution) + levelResolution) % levelResolution;
+                            const glm::u8vec4& texelColor = m_levelReadback[(static_cast<size_t>(texel.z) * levelResolution + texel.y) * levelResolution + texel.x];
+                            if (texelColor.a == 0 && texelColor.r + texelColor.g + texelColor.b == 0) continue;
+
+                            // Block center in world space (same mapping as voxelization.frag)
+                            glm::vec3 position = (glm::vec3(block) + 0.5f) * blockSize;
+                            glm::vec4 color = glm::vec4(texelColor) / 255.0f;
+                            slice.insert(slice.end(), { position.x, position.y, position.z, color.r, color.g, color.b, color.a, static_cast<float>(level) });
+                        }
+                    }
+                }
+            });
 
-            // Color attribute (location 3)
-            glEnableVertexAttribArray(3);
-            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-            glVertexAttribDivisor(3, 1); // This makes it instanced
+            extracted.instances.clear();
+            for (int z = 0; z < levelResolution; z++) {
+                extracted.instances.insert(extracted.instances.end(), m_sliceInstances[z].begin(), m_sliceInstances[z].end());
+            }
+            extracted.version = m_cascadeVersion;
+        }
 
-            // Mipmap level attribute (location 4)
-            glEnableVertexAttribArray(4);
-            glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(7 * sizeof(float)));
-            glVertexAttribDivisor(4, 1); // This makes it instanced
+        uploadVoxelInstances(extracted.instances);
+    }
 
-            glBindVertexArray(0);
+    void Voxelizer::uploadVoxelInstances(const std::vector<float>& instances) {
+        const float* data = instances.data();
+        size_t count = instances.size() / 8;
+
+        // Over the limit keep every n-th voxel so the whole volume stays covered
+        std::vector<float> decimated;
+        if (count > MAX_DEBUG_VOXELS) {
+            size_t step = (count + MAX_DEBUG_VOXELS - 1) / MAX_DEBUG_VOXELS;
+            decimated.reserve((count / step + 1) * 8);
+            for (size_t i = 0; i < count; i += step) {
+                decimated.insert(decimated.end(), instances.begin() + i * 8, instances.begin() + (i + 1) * 8);
+            }
+            data = decimated.data();
+            count = decimated.size() / 8;
         }
 
-        m_voxelDataNeedsUpdate = false;
+        if (count > 0) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_voxelInstanceVBO);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, count * 8 * sizeof(float), data);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        m_visibleVoxelCount = count;
+    }
+
+    void Voxelizer::collectSparseVoxels(std::vector<float>& instances) const {
+        // Only allocated bricks are visited below one texel per brick; coarser levels are dense
+        // but small (one texel per brick and up)
+        const SparseVoxelVolume& volume = m_sparseVolume;
+        int level = std::min(m_state, volume.getLevelCount() - 1);
+        float blockSize = volume.getVoxelSize() * static_cast<float>(1 << level);
+        glm::vec3 windowMin = getSparseMin();
+
+        auto addVoxel = [&](const glm::ivec3& block, const glm::u8vec4& texel) {
+            if (texel.a == 0 && texel.r + texel.g + texel.b == 0) return;
+            glm::vec3 position = windowMin + (glm::vec3(block) + 0.5f) * blockSize;
+            glm::vec4 color = glm::vec4(texel) / 255.0f;
+            instances.insert(instances.end(), { position.x, position.y, position.z, color.r, color.g, color.b, color.a, static_cast<float>(level) });
+        };
+
+        if (level < SparseVoxelVolume::BRICK_LEVELS - 1) {
+            int brickTexels = SparseVoxelVolume::BRICK_SIZE >> level;
+            for (uint32_t index = 0; index < volume.getBrickCount(); index++) {
+                const glm::u8vec4* texels = volume.getBrickTexels(index, level);
+                glm::ivec3 first = volume.getBrickCoord(index) * brickTexels;
+                for (int z = 0; z < brickTexels; z++) {
+                    for (int y = 0; y < brickTexels; y++) {
+                        for (int x = 0; x < brickTexels; x++) {
+                            addVoxel(first + glm::ivec3(x, y, z), texels[(z * brickTexels + y) * brickTexels + x]);
+                        }
+                    }
+                }
+            }
+        }
+        else {
+            const auto& coarse = volume.getCoarseLevels()[level - (SparseVoxelVolume::BRICK_LEVELS - 1)];
+            int size = volume.getResolution() >> level;
+            for (int z = 0; z < size; z++) {
+                for (int y = 0; y < size; y++) {
+                    for (int x = 0; x < size; x++) {
+                        addVoxel(glm::ivec3(x, y, z), coarse[(static_cast<size_t>(z) * size + y) * size + x]);
+                    }
+                }
+            }
+        }
     }
 
     void Voxelizer::renderVoxelsAsCubes(const glm::vec3& cameraPos, const glm::mat4& projection, const glm::mat4& view) {
         // Update voxel data if needed
-        if (m_voxelDataNeedsUpdate || m_visibleVoxels.empty()) {
+        if (m_voxelDataNeedsUpdate) {
             updateVisibleVoxels(cameraPos);
         }
 
-        // Skip rendering if no visible voxels
-        if (m_visibleVoxels.empty()) {
+        // Skip rendering if no visible voxels (the GPU count is only known to the indirect draw)
+        if (!m_voxelInstancesOnGPU && m_visibleVoxelCount == 0) {
             return;
         }
 
@@ -476,7 +1167,13 @@ namespace Engine {
 
         // Render all voxel instances
         glBindVertexArray(m_cubeVAO);
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, m_visibleVoxels.size());
+        if (m_voxelInstancesOnGPU) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_voxelIndirectBuffer);
+            glDrawArraysIndirect(GL_TRIANGLES, nullptr);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        } else {
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, static_cast<GLsizei>(m_visibleVoxelCount));
+        }
 
         // Reset state
         glBindVertexArray(0);
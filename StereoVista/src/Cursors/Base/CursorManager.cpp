@@ -1,6 +1,7 @@
 #include "Cursors/Base/CursorManager.h"
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <cmath>
 #include <imgui.h>
 
 extern Camera camera;
@@ -18,6 +19,8 @@ namespace Cursor {
         m_showOrbitCenter(false),
         m_orbitCenterColor(0.0f, 1.0f, 0.0f, 0.7f),
         m_orbitCenterSphereRadius(0.2f),
+        m_cpuPickingEnabled(true),
+        m_pickTolerancePixels(3.0f),
         m_windowWidth(1920),
         m_windowHeight(1080),
         m_lastX(0.0f),
@@ -79,26 +82,55 @@ namespace Cursor {
         m_windowWidth = windowWidth;
         m_windowHeight = windowHeight;
 
-        // Read depth at cursor position
-        float depth = 0.0;
-        glReadPixels(m_lastX, (float)m_windowHeight - m_lastY, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
-
-        // Convert cursor position to world space
         glm::mat4 vpInv = glm::inverse(projection * view);
-        glm::vec4 ndc = glm::vec4(
-            (m_lastX / (float)m_windowWidth) * 2.0 - 1.0,
-            1.0 - (m_lastY / (float)m_windowHeight) * 2.0,
-            depth * 2.0 - 1.0,
-            1.0
-        );
-        auto worldPosH = vpInv * ndc;
-        auto worldPos = worldPosH / worldPosH.w;
-        auto isHit = depth != 1.0;
+        float ndcX = (m_lastX / (float)m_windowWidth) * 2.0f - 1.0f;
+        float ndcY = 1.0f - (m_lastY / (float)m_windowHeight) * 2.0f;
+
+        bool isHit = false;
+        glm::vec3 worldPos(0.0f);
+        bool depthReadbackNeeded = true;
+
+        // Cast a picking ray on the CPU first
+        if (m_cpuPickingEnabled && m_sceneRaycaster) {
+            glm::vec4 nearWorld = vpInv * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+            glm::vec4 farWorld = vpInv * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+            glm::vec3 rayOrigin = glm::vec3(nearWorld) / nearWorld.w;
+            glm::vec3 rayDirection = glm::normalize(glm::vec3(farWorld) / farWorld.w - rayOrigin);
+
+            // Convert the pixel tolerance into a cone half angle using the vertical field of view
+            float fovY = 2.0f * std::atan(1.0f / projection[1][1]);
+            float angularTolerance = m_pickTolerancePixels * fovY / (float)m_windowHeight;
+
+            RaycastResult result = m_sceneRaycaster(rayOrigin, rayDirection, angularTolerance);
+            depthReadbackNeeded = result.depthReadbackNeeded;
+            if (result.hit) {
+                isHit = true;
+                worldPos = result.position;
+            }
+        }
+
+        if (depthReadbackNeeded) {
+            // Read depth at cursor position
+            float depth = 0.0;
+            glReadPixels(m_lastX, (float)m_windowHeight - m_lastY, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
+
+            if (depth != 1.0) {
+                // Convert cursor position to world space
+                glm::vec4 worldPosH = vpInv * glm::vec4(ndcX, ndcY, depth * 2.0f - 1.0f, 1.0f);
+                glm::vec3 depthPos = glm::vec3(worldPosH / worldPosH.w);
+
+                // Keep whichever hit is closer to the camera
+                if (!isHit || glm::distance(depthPos, camera.Position) < glm::distance(worldPos, camera.Position)) {
+                    worldPos = depthPos;
+                }
+                isHit = true;
+            }
+        }
 
         // Update cursor properties based on whether it hit geometry
         if (isHit && (m_sphereCursor->isVisible() || m_fragmentCursor->isVisible() || m_planeCursor->isVisible())) {
             m_cursorPositionValid = true;
-            m_cursorPosition = glm::vec3(worldPos);
+            m_cursorPosition = worldPos;
 
             m_sphereCursor->setPosition(m_cursorPosition);
             m_sphereCursor->setPositionValid(true);
@@ -0,0 +1,142 @@
+#include "../../headers/Engine/AnisotropicVoxelMips.h"
+#include "../../headers/Engine/ThreadPool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+namespace Engine {
+
+    namespace {
+        int floorDiv(int value, int divisor) {
+            return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+        }
+
+        int wrap(int value, int resolution) {
+            return value - resolution * floorDiv(value, resolution);
+        }
+
+        glm::vec4 toFloat(const glm::u8vec4& texel) {
+            return glm::vec4(texel) / 255.0f;
+        }
+
+        glm::u8vec4 toUnorm(const glm::vec4& value) {
+            return glm::u8vec4(glm::round(glm::clamp(value, 0.0f, 1.0f) * 255.0f));
+        }
+    }
+
+    AnisotropicVoxelMips::Levels AnisotropicVoxelMips::allocateDirectional(int resolution) {
+        Levels directional;
+        for (int levelResolution = resolution / 2; levelResolution >= 1; levelResolution /= 2) {
+            directional.emplace_back(static_cast<size_t>(FACE_COUNT) * levelResolution * levelResolution * levelResolution);
+        }
+        return directional;
+    }
+
+    void AnisotropicVoxelMips::build(CPUVoxelizer::Volume& volume, Levels& directional) {
+        glm::ivec3 origin = volume.window.origin;
+        update(volume, directional, { { origin, origin + volume.window.resolution - 1 } });
+    }
+
+    void AnisotropicVoxelMips::update(CPUVoxelizer::Volume& volume, Levels& directional, const std::vector<Region>& regions) {
+        int resolution = volume.window.resolution;
+        if (volume.levels.empty()) return;
+
+        // Levels outside the regions are kept, so only a missing chain is allocated
+        if (static_cast<int>(volume.levels.size()) != static_cast<int>(std::log2(resolution)) + 1) {
+            volume.levels.resize(1);
+            for (int levelResolution = resolution / 2; levelResolution >= 1; levelResolution /= 2) {
+                volume.levels.emplace_back(static_cast<size_t>(levelResolution) * levelResolution * levelResolution);
+            }
+        }
+        if (directional.size() != volume.levels.size() - 1) directional = allocateDirectional(resolution);
+
+        for (int level = 1; level < static_cast<int>(volume.levels.size()); level++) {
+            int levelResolution = resolution >> level;
+            int parentResolution = levelResolution * 2;
+            const auto& isoParent = volume.levels[level - 1];
+            auto& isoTarget = volume.levels[level];
+            const std::vector<glm::u8vec4>* dirParent = level > 1 ? &directional[level - 2] : nullptr;
+            auto& dirTarget = directional[level - 1];
+
+            for (const auto& region : regions) {
+                // Blocks of this level covering the region; a window never needs more than one wrap
+                glm::ivec3 blockMin, blockCount;
+                for (int axis = 0; axis < 3; axis++) {
+                    blockMin[axis] = floorDiv(region.min[axis], 1 << level);
+                    int blockMax = floorDiv(region.max[axis], 1 << level);
+                    blockCount[axis] = std::min(blockMax - blockMin[axis] + 1, levelResolution);
+                }
+                if (glm::any(glm::lessThanEqual(blockCount, glm::ivec3(0)))) continue;
+
+                ThreadPool::getInstance().parallelFor(0, static_cast<size_t>(blockCount.z), 1, [&](size_t zBegin, size_t zEnd) {
+                    for (int oz = static_cast<int>(zBegin); oz < static_cast<int>(zEnd); oz++) {
+                        for (int oy = 0; oy < blockCount.y; oy++) {
+                            for (int ox = 0; ox < blockCount.x; ox++) {
+                                glm::ivec3 block = blockMin + glm::ivec3(ox, oy, oz);
+                                glm::ivec3 target(wrap(block.x, levelResolution), wrap(block.y, levelResolution), wrap(block.z, levelResolution));
+
+                                // Children (x in bit 0, y in bit 1, z in bit 2) in parent texel layout
+                                glm::ivec3 children[8];
+                                glm::vec4 isoSum(0.0f);
+                                for (int corner = 0; corner < 8; corner++) {
+                                    glm::ivec3 child = 2 * block + glm::ivec3(corner & 1, (corner >> 1) & 1, corner >> 2);
+                                    children[corner] = glm::ivec3(wrap(child.x, parentResolution), wrap(child.y, parentResolution), wrap(child.z, parentResolution));
+                                    isoSum += glm::vec4(isoParent[(static_cast<size_t>(children[corner].z) * parentResolution + children[corner].y) * parentResolution + children[corner].x]);
+                                }
+                                isoTarget[(static_cast<size_t>(target.z) * levelResolution + target.y) * levelResolution + target.x] = glm::u8vec4(glm::round(isoSum / 8.0f));
+
+                                for (int face = 0; face < FACE_COUNT; face++) {
+                                    glm::vec4 values[8];
+                                    for (int corner = 0; corner < 8; corner++) {
+                                        const glm::ivec3& c = children[corner];
+                                        values[corner] = dirParent
+                                            ? toFloat((*dirParent)[(static_cast<size_t>(c.z) * parentResolution + c.y) * (FACE_COUNT * parentResolution) + face * parentResolution + c.x])
+                                            : toFloat(isoParent[(static_cast<size_t>(c.z) * parentResolution + c.y) * parentResolution + c.x]);
+                                    }
+
+                                    // Four columns along the face's axis; the front child is the one a
+                                    // cone travelling in the face's direction meets first
+                                    int axis = face / 2;
+                                    bool positive = face % 2 == 0;
+                                    int otherA = (axis + 1) % 3, otherB = (axis + 2) % 3;
+                                    glm::vec4 sum(0.0f);
+                                    for (int column = 0; column < 4; column++) {
+                                        int low = ((column & 1) << otherA) | ((column >> 1) << otherB);
+                                        int high = low | (1 << axis);
+                                        sum += positive ? composite(values[low], values[high]) : composite(values[high], values[low]);
+                                    }
+                                    dirTarget[(static_cast<size_t>(target.z) * levelResolution + target.y) * (FACE_COUNT * levelResolution) + face * levelResolution + target.x] = toUnorm(sum * 0.25f);
+                                }
+                            }
+                        }
+                    }
+                });
+            }
+        }
+    }
+
+    AnisotropicVoxelMips::Difference AnisotropicVoxelMips::compare(const CPUVoxelizer::Volume& firstVolume, const Levels& firstDirectional,
+                                                                   const CPUVoxelizer::Volume& secondVolume, const Levels& secondDirectional) {
+        Difference difference;
+        auto compareLevels = [&](const std::vector<glm::u8vec4>& a, const std::vector<glm::u8vec4>& b, int& maxDifference) {
+            if (a.size() != b.size()) return;
+            for (size_t i = 0; i < a.size(); i++) {
+                int texelDifference = 0;
+                for (int channel = 0; channel < 4; channel++) {
+                    texelDifference = std::max(texelDifference, std::abs(static_cast<int>(a[i][channel]) - static_cast<int>(b[i][channel])));
+                }
+                maxDifference = std::max(maxDifference, texelDifference);
+                if (texelDifference > 1) difference.differingTexels++;
+            }
+        };
+
+        for (size_t level = 1; level < firstVolume.levels.size() && level < secondVolume.levels.size(); level++) {
+            compareLevels(firstVolume.levels[level], secondVolume.levels[level], difference.maxIsotropic);
+        }
+        for (size_t level = 0; level < firstDirectional.size() && level < secondDirectional.size(); level++) {
+            compareLevels(firstDirectional[level], secondDirectional[level], difference.maxDirectional);
+        }
+        return difference;
+    }
+
+}
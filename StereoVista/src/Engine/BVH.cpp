@@ -6,237 +6,1107 @@
 #include <numeric>
 #include <iostream>
 #include <climits>
+#include <chrono>
+#include <memory>
+#include <mutex>
 
 namespace Engine {
 
-    void BVHBuilder::build(const std::vector<BVHTriangle>& inputTriangles) {
+    namespace {
+        // Bin of a centroid coordinate; matches between binning and partitioning
+        inline uint32_t binIndex(float centroid, float boundsMin, float scale, uint32_t binCount) {
+            int bin = static_cast<int>((centroid - boundsMin) * scale);
+            if (bin < 0) bin = 0;
+            if (bin >= static_cast<int>(binCount)) bin = static_cast<int>(binCount) - 1;
+            return static_cast<uint32_t>(bin);
+        }
+
+        inline float binScale(const AABB& centroidBounds, int axis, uint32_t binCount) {
+            float extent = centroidBounds.maxBounds[axis] - centroidBounds.minBounds[axis];
+            return extent > 0.0f ? binCount / extent : 0.0f;
+        }
+
+        // Spread the lower 10 bits of v so two zero bits separate each of them
+        inline uint32_t expandBits(uint32_t v) {
+            v = (v * 0x00010001u) & 0xFF0000FFu;
+            v = (v * 0x00000101u) & 0x0F00F00Fu;
+            v = (v * 0x00000011u) & 0xC30C30C3u;
+            v = (v * 0x00000005u) & 0x49249249u;
+            return v;
+        }
+
+        using Clock = std::chrono::high_resolution_clock;
+
+        // Milliseconds since 'start', which then moves to now (consecutive build phases)
+        inline double lapMs(Clock::time_point& start) {
+            Clock::time_point now = Clock::now();
+            double ms = std::chrono::duration<double, std::milli>(now - start).count();
+            start = now;
+            return ms;
+        }
+
+        // 30-bit Morton code of a point on a 1024^3 grid over the centroid bounds
+        inline uint32_t mortonCode(const glm::vec3& point, const glm::vec3& boundsMin, const glm::vec3& scale) {
+            glm::vec3 cell = glm::clamp((point - boundsMin) * scale, 0.0f, 1023.0f);
+            return (expandBits(static_cast<uint32_t>(cell.x)) << 2) |
+                   (expandBits(static_cast<uint32_t>(cell.y)) << 1) |
+                   expandBits(static_cast<uint32_t>(cell.z));
+        }
+    }
+
+    void BVHBuilder::build(std::vector<BVHTriangle> inputTriangles) {
         if (inputTriangles.empty()) {
             return;
         }
-        
+
+        auto buildStart = std::chrono::high_resolution_clock::now();
+        auto phaseStart = buildStart;
+        lastBuildPhases = BuildPhaseTimes();
+        restoredFromCache = false;
+        ThreadPool& pool = ThreadPool::getInstance();
+
         // Initialize data structures
-        triangles = inputTriangles;
+        triangles = std::move(inputTriangles);
+        uint32_t triangleCount = static_cast<uint32_t>(triangles.size());
+        inputTriangleCount = triangleCount;
+        spatialSplitCount = 0;
+        primRefs.resize(triangleCount);
+
+        // Gather compact bounds/centroids and the root bounds in one parallel pass
+        struct RootBounds { AABB bounds, centroidBounds; };
+        size_t grain = std::max<size_t>(4096, triangleCount / ((pool.getThreadCount() + 1) * 4));
+        std::vector<RootBounds> chunkBounds((triangleCount + grain - 1) / grain);
+        pool.parallelFor(0, triangleCount, grain, [&](size_t begin, size_t end) {
+            RootBounds& local = chunkBounds[begin / grain];
+            for (size_t i = begin; i < end; i++) {
+                primRefs[i].bounds = triangles[i].bounds;
+                primRefs[i].centroid = triangles[i].centroid;
+                primRefs[i].triangleIdx = static_cast<uint32_t>(i);
+                local.bounds.expand(triangles[i].bounds);
+                local.centroidBounds.expand(triangles[i].centroid);
+            }
+        });
+
+        AABB rootBounds, rootCentroidBounds;
+        for (const auto& chunk : chunkBounds) {
+            rootBounds.expand(chunk.bounds);
+            rootCentroidBounds.expand(chunk.centroidBounds);
+        }
+        lastBuildPhases.prepareMs = lapMs(phaseStart);
+
+        if (settings.mode == BuildMode::SpatialSplits) {
+            buildSpatial(rootBounds);
+        } else if (settings.mode == BuildMode::LBVH) {
+            buildLinear(rootCentroidBounds);
+        } else {
+            buildTree(rootBounds, rootCentroidBounds);
+        }
+        phaseStart = std::chrono::high_resolution_clock::now();
+        reorderTriangles();
+        lastBuildPhases.finalizeMs += lapMs(phaseStart);
+
+        lastBuildTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - buildStart).count();
+
+        std::cout << "BVH built with " << nodes.size() << " nodes for " << inputTriangleCount << " triangles in "
+                  << lastBuildTimeMs << " ms (" << getLastBuildMTrisPerSecond() << " Mtris/s)";
+        if (settings.mode == BuildMode::SpatialSplits) {
+            std::cout << ", " << spatialSplitCount << " spatial splits, " << triangles.size() << " references";
+        }
+        std::cout << std::endl;
+    }
+
+    void BVHBuilder::build(const std::vector<AABB>& primitiveBounds) {
+        triangles.clear();
+        inputTriangleCount = 0;
+        spatialSplitCount = 0;
+        lastBuildPhases = BuildPhaseTimes();
+        restoredFromCache = false;
+        if (primitiveBounds.empty()) {
+            nodes.clear();
+            primitiveIndices.clear();
+            return;
+        }
+
+        auto buildStart = std::chrono::high_resolution_clock::now();
+        auto phaseStart = buildStart;
+
+        primRefs.resize(primitiveBounds.size());
+        AABB rootBounds, rootCentroidBounds;
+        for (size_t i = 0; i < primitiveBounds.size(); i++) {
+            primRefs[i].bounds = primitiveBounds[i];
+            primRefs[i].centroid = primitiveBounds[i].getCenter();
+            primRefs[i].triangleIdx = static_cast<uint32_t>(i);
+            rootBounds.expand(primitiveBounds[i]);
+            rootCentroidBounds.expand(primRefs[i].centroid);
+        }
+        lastBuildPhases.prepareMs = lapMs(phaseStart);
+
+        if (settings.mode == BuildMode::LBVH) {
+            buildLinear(rootCentroidBounds);
+        } else {
+            buildTree(rootBounds, rootCentroidBounds);
+        }
+
+        lastBuildTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - buildStart).count();
+    }
+
+    bool BVHBuilder::restore(const std::vector<BVHTriangle>& inputTriangles, const BVHNode* cachedNodes, uint32_t nodeCount,
+                             const uint32_t* order, uint32_t referenceCount, uint32_t rootNode) {
+        auto restoreStart = std::chrono::high_resolution_clock::now();
+        triangles.clear();
         nodes.clear();
-        triangleIndices.clear();
-        
-        // Estimate node count (typically ~2x triangle count for binary tree)
-        nodes.reserve(triangles.size() * 2);
-        triangleIndices.resize(triangles.size());
-        
-        // Initialize triangle indices array
-        std::iota(triangleIndices.begin(), triangleIndices.end(), 0);
-        
+        primitiveIndices.clear();
+        inputTriangleCount = 0;
+        spatialSplitCount = 0;
+        lastBuildPhases = BuildPhaseTimes();
+        restoredFromCache = false;
+
+        // Child and triangle ranges must stay inside the arrays
+        if (nodeCount == 0 || rootNode >= nodeCount || referenceCount < inputTriangles.size()) return false;
+        for (uint32_t i = 0; i < nodeCount; i++) {
+            const BVHNode& node = cachedNodes[i];
+            if (node.isLeaf() ? static_cast<uint64_t>(node.leftFirst) + node.triCount > referenceCount
+                              : static_cast<uint64_t>(node.leftFirst) + 1 >= nodeCount) {
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < referenceCount; i++) {
+            if (order[i] >= inputTriangles.size()) return false;
+        }
+
+        nodes.assign(cachedNodes, cachedNodes + nodeCount);
+        rootNodeIdx = rootNode;
+        nodesUsed = nodeCount;
+        inputTriangleCount = static_cast<uint32_t>(inputTriangles.size());
+
+        triangles.resize(referenceCount);
+        ThreadPool::getInstance().parallelFor(0, referenceCount, 64 * 1024, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                triangles[i] = inputTriangles[order[i]];
+            }
+        });
+
+        lastBuildTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - restoreStart).count();
+        restoredFromCache = true;
+        return true;
+    }
+
+    void BVHBuilder::buildTree(const AABB& rootBounds, const AABB& rootCentroidBounds) {
+        ThreadPool& pool = ThreadPool::getInstance();
+        uint32_t primCount = static_cast<uint32_t>(primRefs.size());
+
+        // A binary tree with at least one primitive per leaf has at most 2n - 1 nodes (+1 unused slot)
+        nodes.assign(static_cast<size_t>(primCount) * 2, BVHNode());
+        primitiveIndices.resize(primCount);
+        scratchRefs.resize(primCount);
+
         // Reset counters
         rootNodeIdx = 0;
         nodesUsed = 1;
-        
+
         // Create root node
-        nodes.emplace_back();
-        
-        // Calculate root bounds
-        AABB rootBounds = calculateBounds(0, static_cast<uint32_t>(triangles.size()));
         nodes[rootNodeIdx].setBounds(rootBounds);
         nodes[rootNodeIdx].leftFirst = 0;  // First triangle index
-        nodes[rootNodeIdx].triCount = static_cast<uint32_t>(triangles.size());
-        
-        // Start recursive subdivision
-        subdivide(rootNodeIdx);
-        
-        std::cout << "BVH built with " << nodesUsed << " nodes for " << triangles.size() << " triangles" << std::endl;
+        nodes[rootNodeIdx].triCount = primCount;
+
+        // Top levels split with parallel binning, lower subtrees run as pool tasks
+        auto phaseStart = std::chrono::high_resolution_clock::now();
+        {
+            TaskGroup tasks(pool);
+            subdivide(rootNodeIdx, rootCentroidBounds, 0, &tasks);
+            tasks.wait();
+        }
+        lastBuildPhases.hierarchyMs = lapMs(phaseStart);
+
+        nodes.resize(nodesUsed.load());
+
+        // Leaf ranges index the partitioned references
+        pool.parallelFor(0, primCount, 64 * 1024, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                primitiveIndices[i] = primRefs[i].triangleIdx;
+            }
+        });
+
+        // Build scratch data is not needed for traversal
+        primRefs.clear();
+        primRefs.shrink_to_fit();
+        scratchRefs.clear();
+        scratchRefs.shrink_to_fit();
+        lastBuildPhases.finalizeMs = lapMs(phaseStart);
+    }
+
+    void BVHBuilder::reorderTriangles() {
+        // Neighbouring leaves end up contiguous in memory and the GPU needs no index buffer
+        std::vector<BVHTriangle> ordered(primitiveIndices.size());
+        ThreadPool::getInstance().parallelFor(0, ordered.size(), 64 * 1024, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                ordered[i] = triangles[primitiveIndices[i]];
+            }
+        });
+        triangles = std::move(ordered);
+
+        primitiveIndices.clear();
+        primitiveIndices.shrink_to_fit();
     }
 
-    void BVHBuilder::subdivide(uint32_t nodeIdx, uint32_t depth) {
+    void BVHBuilder::subdivide(uint32_t nodeIdx, const AABB& centroidBounds, uint32_t depth, TaskGroup* tasks) {
         BVHNode& node = nodes[nodeIdx];
-        
+
         // Stop subdivision if we have few triangles or reached max depth
-        if (node.triCount <= MAX_TRIANGLES_PER_LEAF || depth >= 20) { // Limit depth to 20 for GPU efficiency
+        if (node.triCount <= MAX_TRIANGLES_PER_LEAF || depth >= MAX_DEPTH) {
             return;
         }
-        
-        // Calculate node bounds
-        AABB nodeBounds = calculateBounds(node.leftFirst, node.triCount);
-        
-        // Find the best split using SAH
-        SplitResult split = findBestSplit(node.leftFirst, node.triCount, nodeBounds);
-        
+
+        // Find the best split using binned SAH (node bounds are already set by the parent)
+        AABB nodeBounds = node.getBounds();
+        BinSet bins;
+        binTriangles(primRefs, node.leftFirst, node.triCount, centroidBounds, bins);
+        SplitResult split = findBestSplit(bins, nodeBounds);
+
         // If no good split found, make it a leaf
-        if (split.leftCount == 0 || split.leftCount == node.triCount) {
+        if (split.axis < 0 || split.leftCount == 0 || split.leftCount == node.triCount) {
             return;
         }
-        
+
         // Calculate cost of not splitting (making this a leaf)
         float leafCost = node.triCount * INTERSECTION_COST;
-        
+
         // If split cost is not better than leaf cost, don't split
         // Add small epsilon to avoid splitting when gains are minimal
         if (split.cost >= leafCost * 0.95f) {
             return;
         }
-        
+
         // Partition triangles based on the split
-        uint32_t leftCount = partition(node.leftFirst, node.triCount, split.axis, split.position);
-        
+        AABB leftCentroidBounds, rightCentroidBounds;
+        uint32_t leftCount = partition(node.leftFirst, node.triCount, split.axis, split.bin, centroidBounds,
+                                       leftCentroidBounds, rightCentroidBounds);
+
         // Ensure we actually got a valid partition
         if (leftCount == 0 || leftCount == node.triCount) {
             return;
         }
-        
-        // Create child nodes
-        uint32_t leftChildIdx = nodesUsed++;
-        uint32_t rightChildIdx = nodesUsed++;
-        
-        // Ensure we have space for new nodes
-        if (nodes.size() <= rightChildIdx) {
-            nodes.resize(rightChildIdx + 1);
-        }
-        
-        // Set up left child
+
+        // Create child nodes (siblings stay adjacent)
+        uint32_t leftChildIdx = nodesUsed.fetch_add(2);
+        uint32_t rightChildIdx = leftChildIdx + 1;
+
+        // Set up children; their bounds come straight from the bins
         nodes[leftChildIdx].leftFirst = node.leftFirst;
         nodes[leftChildIdx].triCount = leftCount;
-        nodes[leftChildIdx].setBounds(calculateBounds(nodes[leftChildIdx].leftFirst, nodes[leftChildIdx].triCount));
-        
-        // Set up right child  
+        nodes[leftChildIdx].setBounds(split.leftBounds);
+
         nodes[rightChildIdx].leftFirst = node.leftFirst + leftCount;
         nodes[rightChildIdx].triCount = node.triCount - leftCount;
-        nodes[rightChildIdx].setBounds(calculateBounds(nodes[rightChildIdx].leftFirst, nodes[rightChildIdx].triCount));
-        
+        nodes[rightChildIdx].setBounds(split.rightBounds);
+
         // Convert current node to interior node
         node.leftFirst = leftChildIdx;
         node.triCount = 0;  // Mark as interior node
-        
-        // Recursively subdivide children
-        subdivide(leftChildIdx, depth + 1);
-        subdivide(rightChildIdx, depth + 1);
+
+        // Recursively subdivide children; large left subtrees go to another thread
+        if (tasks && leftCount >= SUBTREE_TASK_THRESHOLD) {
+            tasks->run([this, leftChildIdx, leftCentroidBounds, depth, tasks]() {
+                subdivide(leftChildIdx, leftCentroidBounds, depth + 1, tasks);
+            });
+        } else {
+            subdivide(leftChildIdx, leftCentroidBounds, depth + 1, tasks);
+        }
+        subdivide(rightChildIdx, rightCentroidBounds, depth + 1, tasks);
     }
 
-    AABB BVHBuilder::calculateBounds(uint32_t first, uint32_t count) {
-        AABB bounds;
-        if (count == 0 || first >= triangleIndices.size()) {
-            return bounds; // Return empty bounds for invalid input
+    void BVHBuilder::binTriangles(const std::vector<PrimRef>& refs, uint32_t first, uint32_t count,
+                                  const AABB& centroidBounds, BinSet& bins) {
+        float scales[3];
+        for (int axis = 0; axis < 3; axis++) {
+            scales[axis] = binScale(centroidBounds, axis, SAH_BINS);
+        }
+
+        auto binRange = [&](size_t begin, size_t end, BinSet& target) {
+            for (size_t i = begin; i < end; i++) {
+                const AABB& bounds = refs[i].bounds;
+                const glm::vec3& centroid = refs[i].centroid;
+
+                for (int axis = 0; axis < 3; axis++) {
+                    SAHBin& bin = target[axis][binIndex(centroid[axis], centroidBounds.minBounds[axis], scales[axis], SAH_BINS)];
+                    bin.count++;
+                    bin.bounds.minBounds = glm::min(bin.bounds.minBounds, bounds.minBounds);
+                    bin.bounds.maxBounds = glm::max(bin.bounds.maxBounds, bounds.maxBounds);
+                }
+            }
+        };
+
+        if (count < PARALLEL_SPLIT_THRESHOLD) {
+            binRange(first, first + count, bins);
+            return;
         }
-        
-        for (uint32_t i = 0; i < count && (first + i) < triangleIndices.size(); i++) {
-            uint32_t triIdx = triangleIndices[first + i];
-            if (triIdx < triangles.size()) {
-                const BVHTriangle& tri = triangles[triIdx];
-                bounds.expand(tri.bounds);
+
+        // Per-chunk bins merged afterwards
+        ThreadPool& pool = ThreadPool::getInstance();
+        size_t grain = std::max<size_t>(8192, count / ((pool.getThreadCount() + 1) * 2));
+        std::vector<BinSet> chunkBins((count + grain - 1) / grain);
+        pool.parallelFor(first, first + count, grain, [&](size_t begin, size_t end) {
+            binRange(begin, end, chunkBins[(begin - first) / grain]);
+        });
+
+        for (const auto& chunk : chunkBins) {
+            for (int axis = 0; axis < 3; axis++) {
+                for (uint32_t b = 0; b < SAH_BINS; b++) {
+                    bins[axis][b].count += chunk[axis][b].count;
+                    bins[axis][b].bounds.expand(chunk[axis][b].bounds);
+                }
             }
         }
-        return bounds;
     }
 
-    BVHBuilder::SplitResult BVHBuilder::findBestSplit(uint32_t first, uint32_t count, const AABB& nodeBounds) {
+    BVHBuilder::SplitResult BVHBuilder::findBestSplit(const BinSet& bins, const AABB& nodeBounds) {
         SplitResult bestSplit;
-        bestSplit.cost = FLT_MAX;
-        bestSplit.axis = -1;
-        bestSplit.position = 0.0f;
-        bestSplit.leftCount = 0;
-        
-        // Try each axis
+
         for (int axis = 0; axis < 3; axis++) {
-            float boundsMin = nodeBounds.minBounds[axis];
-            float boundsMax = nodeBounds.maxBounds[axis];
-            
-            if (boundsMin == boundsMax) continue; // No extent in this axis
-            
-            // Use binned SAH for efficiency
-            struct Bin {
-                AABB bounds;
-                uint32_t count = 0;
-            };
-            
-            std::array<Bin, SAH_BINS> bins;
-            
-            // Populate bins
-            float scale = SAH_BINS / (boundsMax - boundsMin);
-            for (uint32_t i = 0; i < count; i++) {
-                const BVHTriangle& tri = triangles[triangleIndices[first + i]];
-                float centroid = tri.centroid[axis];
-                
-                int binIdx = static_cast<int>((centroid - boundsMin) * scale);
-                if (binIdx < 0) binIdx = 0;
-                if (binIdx >= static_cast<int>(SAH_BINS)) binIdx = static_cast<int>(SAH_BINS - 1);
-                
-                bins[binIdx].count++;
-                bins[binIdx].bounds.expand(tri.bounds);
-            }
-            
-            // Evaluate split candidates
-            for (int splitBin = 1; splitBin < SAH_BINS; splitBin++) {
-                AABB leftBounds, rightBounds;
-                uint32_t leftCount = 0, rightCount = 0;
-                
-                // Accumulate left side
-                for (int i = 0; i < splitBin; i++) {
-                    leftBounds.expand(bins[i].bounds);
-                    leftCount += bins[i].count;
-                }
-                
-                // Accumulate right side
-                for (int i = splitBin; i < SAH_BINS; i++) {
-                    rightBounds.expand(bins[i].bounds);
-                    rightCount += bins[i].count;
-                }
-                
+            const auto& axisBins = bins[axis];
+
+            // Suffix sweep: right side of every split plane
+            std::array<AABB, SAH_BINS> rightBounds;
+            std::array<uint32_t, SAH_BINS> rightCounts;
+            AABB accumulated;
+            uint32_t accumulatedCount = 0;
+            for (int b = SAH_BINS - 1; b > 0; b--) {
+                accumulated.expand(axisBins[b].bounds);
+                accumulatedCount += axisBins[b].count;
+                rightBounds[b] = accumulated;
+                rightCounts[b] = accumulatedCount;
+            }
+
+            // Prefix sweep: evaluate each plane while growing the left side
+            AABB leftBounds;
+            uint32_t leftCount = 0;
+            for (uint32_t splitBin = 1; splitBin < SAH_BINS; splitBin++) {
+                leftBounds.expand(axisBins[splitBin - 1].bounds);
+                leftCount += axisBins[splitBin - 1].count;
+
                 // Skip if one side is empty
-                if (leftCount == 0 || rightCount == 0) continue;
-                
-                // Calculate split cost
-                float cost = evaluateSAH(leftCount, rightCount, leftBounds, rightBounds, nodeBounds);
-                
+                if (leftCount == 0 || rightCounts[splitBin] == 0) continue;
+
+                float cost = evaluateSAH(leftCount, rightCounts[splitBin], leftBounds, rightBounds[splitBin], nodeBounds);
                 if (cost < bestSplit.cost) {
                     bestSplit.cost = cost;
                     bestSplit.axis = axis;
+                    bestSplit.bin = splitBin;
                     bestSplit.leftCount = leftCount;
-                    bestSplit.position = boundsMin + (splitBin / float(SAH_BINS)) * (boundsMax - boundsMin);
+                    bestSplit.leftBounds = leftBounds;
+                    bestSplit.rightBounds = rightBounds[splitBin];
                 }
             }
         }
-        
+
         return bestSplit;
     }
 
-    float BVHBuilder::evaluateSAH(uint32_t leftCount, uint32_t rightCount, 
-                                  const AABB& leftBounds, const AABB& rightBounds, 
+    float BVHBuilder::evaluateSAH(uint32_t leftCount, uint32_t rightCount,
+                                  const AABB& leftBounds, const AABB& rightBounds,
                                   const AABB& nodeBounds) {
         float parentArea = nodeBounds.getSurfaceArea();
         if (parentArea <= 0.0f) return FLT_MAX;
-        
+
         float leftArea = leftBounds.getSurfaceArea();
         float rightArea = rightBounds.getSurfaceArea();
-        
+
         float leftProb = leftArea / parentArea;
         float rightProb = rightArea / parentArea;
-        
+
         return TRAVERSAL_COST + (leftProb * leftCount + rightProb * rightCount) * INTERSECTION_COST;
     }
 
-    uint32_t BVHBuilder::partition(uint32_t first, uint32_t count, int axis, float splitPos) {
+    uint32_t BVHBuilder::partition(uint32_t first, uint32_t count, int axis, uint32_t splitBin, const AABB& centroidBounds,
+                                   AABB& leftCentroidBounds, AABB& rightCentroidBounds) {
         if (count == 0) return 0;
-        
-        uint32_t left = first;
-        uint32_t right = first + count - 1;
-        
-        while (left <= right && right != UINT32_MAX) { // Prevent overflow
-            // Find triangle on left that should be on right
-            while (left <= right && triangles[triangleIndices[left]].centroid[axis] < splitPos) {
-                left++;
+
+        float boundsMin = centroidBounds.minBounds[axis];
+        float scale = binScale(centroidBounds, axis, SAH_BINS);
+        auto goesLeft = [&](const PrimRef& ref) {
+            return binIndex(ref.centroid[axis], boundsMin, scale, SAH_BINS) < splitBin;
+        };
+
+        auto expandCentroid = [](AABB& target, const PrimRef& ref) {
+            target.minBounds = glm::min(target.minBounds, ref.centroid);
+            target.maxBounds = glm::max(target.maxBounds, ref.centroid);
+        };
+
+        if (count < PARALLEL_SPLIT_THRESHOLD) {
+            uint32_t i = first;
+            uint32_t j = first + count;
+            while (i < j) {
+                if (goesLeft(primRefs[i])) {
+                    expandCentroid(leftCentroidBounds, primRefs[i]);
+                    i++;
+                } else {
+                    expandCentroid(rightCentroidBounds, primRefs[i]);
+                    std::swap(primRefs[i], primRefs[--j]);
+                }
+            }
+            return i - first;
+        }
+
+        // Parallel stable partition: count per chunk, prefix sums, scatter into scratch, copy back
+        ThreadPool& pool = ThreadPool::getInstance();
+        size_t grain = std::max<size_t>(8192, count / ((pool.getThreadCount() + 1) * 2));
+        size_t chunkCount = (count + grain - 1) / grain;
+        std::vector<uint32_t> chunkLeft(chunkCount, 0);
+        std::vector<AABB> chunkLeftCentroids(chunkCount), chunkRightCentroids(chunkCount);
+
+        pool.parallelFor(first, first + count, grain, [&](size_t begin, size_t end) {
+            size_t chunk = (begin - first) / grain;
+            uint32_t left = 0;
+            for (size_t i = begin; i < end; i++) {
+                if (goesLeft(primRefs[i])) {
+                    expandCentroid(chunkLeftCentroids[chunk], primRefs[i]);
+                    left++;
+                } else {
+                    expandCentroid(chunkRightCentroids[chunk], primRefs[i]);
+                }
+            }
+            chunkLeft[chunk] = left;
+        });
+
+        std::vector<uint32_t> leftOffset(chunkCount), rightOffset(chunkCount);
+        uint32_t totalLeft = std::accumulate(chunkLeft.begin(), chunkLeft.end(), 0u);
+        uint32_t leftRunning = 0, rightRunning = totalLeft;
+        for (size_t c = 0; c < chunkCount; c++) {
+            leftCentroidBounds.expand(chunkLeftCentroids[c]);
+            rightCentroidBounds.expand(chunkRightCentroids[c]);
+            leftOffset[c] = leftRunning;
+            rightOffset[c] = rightRunning;
+            size_t chunkSize = std::min(grain, count - c * grain);
+            leftRunning += chunkLeft[c];
+            rightRunning += static_cast<uint32_t>(chunkSize) - chunkLeft[c];
+        }
+
+        pool.parallelFor(first, first + count, grain, [&](size_t begin, size_t end) {
+            size_t chunk = (begin - first) / grain;
+            uint32_t leftPos = first + leftOffset[chunk];
+            uint32_t rightPos = first + rightOffset[chunk];
+            for (size_t i = begin; i < end; i++) {
+                scratchRefs[goesLeft(primRefs[i]) ? leftPos++ : rightPos++] = primRefs[i];
             }
-            
-            // Find triangle on right that should be on left
-            while (left <= right && triangles[triangleIndices[right]].centroid[axis] >= splitPos) {
-                right--;
+        });
+
+        pool.parallelFor(first, first + count, grain, [&](size_t begin, size_t end) {
+            std::copy(scratchRefs.begin() + begin, scratchRefs.begin() + end, primRefs.begin() + begin);
+        });
+
+        return totalLeft;
+    }
+
+    void BVHBuilder::buildSpatial(const AABB& rootBounds) {
+        uint32_t primCount = static_cast<uint32_t>(primRefs.size());
+
+        // Split references may grow the primitive count by the budget; leave room for their nodes
+        spatialReferencesLeft = static_cast<int64_t>(primCount * std::max(0.0f, settings.spatialSplitBudget));
+        rootSurfaceArea = rootBounds.getSurfaceArea();
+        nodes.assign((static_cast<size_t>(primCount) + spatialReferencesLeft) * 2, BVHNode());
+
+        rootNodeIdx = 0;
+        nodesUsed = 1;
+        nodes[rootNodeIdx].setBounds(rootBounds);
+
+        leafRefs.clear();
+        leafRefs.reserve(primCount + spatialReferencesLeft.load());
+        auto phaseStart = std::chrono::high_resolution_clock::now();
+        {
+            TaskGroup tasks(ThreadPool::getInstance());
+            subdivideSpatial(rootNodeIdx, std::move(primRefs), 0, &tasks);
+            tasks.wait();
+        }
+        lastBuildPhases.hierarchyMs = lapMs(phaseStart);
+
+        nodes.resize(std::min<size_t>(nodesUsed.load(), nodes.size()));
+
+        // Leaves finish in task order; lay their references out depth-first so neighbouring
+        // leaves stay close in memory
+        primitiveIndices.clear();
+        primitiveIndices.reserve(leafRefs.size());
+        std::vector<uint32_t> stack = { rootNodeIdx };
+        while (!stack.empty()) {
+            BVHNode& node = nodes[stack.back()];
+            stack.pop_back();
+            if (node.isLeaf()) {
+                uint32_t first = node.leftFirst;
+                node.leftFirst = static_cast<uint32_t>(primitiveIndices.size());
+                for (uint32_t i = 0; i < node.triCount; i++) {
+                    primitiveIndices.push_back(leafRefs[first + i].triangleIdx);
+                }
+            } else {
+                stack.push_back(node.leftFirst + 1);
+                stack.push_back(node.leftFirst);
             }
-            
-            // Swap if we found a pair
-            if (left < right) {
-                std::swap(triangleIndices[left], triangleIndices[right]);
-                left++;
-                right--;
+        }
+
+        leafRefs.clear();
+        leafRefs.shrink_to_fit();
+        primRefs.clear();
+        primRefs.shrink_to_fit();
+        scratchRefs.clear();
+        scratchRefs.shrink_to_fit();
+        lastBuildPhases.finalizeMs = lapMs(phaseStart);
+    }
+
+    void BVHBuilder::subdivideSpatial(uint32_t nodeIdx, std::vector<PrimRef> refs, uint32_t depth, TaskGroup* tasks) {
+        uint32_t count = static_cast<uint32_t>(refs.size());
+        AABB nodeBounds = nodes[nodeIdx].getBounds();
+
+        auto makeLeaf = [&]() {
+            std::lock_guard<std::mutex> lock(leafMutex);
+            nodes[nodeIdx].leftFirst = static_cast<uint32_t>(leafRefs.size());
+            nodes[nodeIdx].triCount = count;
+            leafRefs.insert(leafRefs.end(), refs.begin(), refs.end());
+        };
+
+        if (count <= MAX_TRIANGLES_PER_LEAF || depth >= MAX_DEPTH) {
+            makeLeaf();
+            return;
+        }
+
+        // Object split candidate, as in the binned builder
+        AABB centroidBounds;
+        for (const auto& ref : refs) {
+            centroidBounds.minBounds = glm::min(centroidBounds.minBounds, ref.centroid);
+            centroidBounds.maxBounds = glm::max(centroidBounds.maxBounds, ref.centroid);
+        }
+        BinSet bins;
+        binTriangles(refs, 0, count, centroidBounds, bins);
+        SplitResult objectSplit = findBestSplit(bins, nodeBounds);
+
+        // Spatial split candidate where the object split children overlap (or no object split exists)
+        SpatialSplitResult spatialSplit;
+        if (spatialReferencesLeft.load() > 0) {
+            bool trySpatial = objectSplit.axis < 0;
+            if (!trySpatial) {
+                AABB overlap = objectSplit.leftBounds.intersection(objectSplit.rightBounds);
+                trySpatial = overlap.isValid() && overlap.getSurfaceArea() > SPATIAL_SPLIT_ALPHA * rootSurfaceArea;
             }
+            if (trySpatial) {
+                spatialSplit = findSpatialSplit(refs, nodeBounds);
+                int64_t duplicates = static_cast<int64_t>(spatialSplit.leftCount) + spatialSplit.rightCount - count;
+                if (duplicates > spatialReferencesLeft.load()) {
+                    spatialSplit = SpatialSplitResult();
+                }
+            }
+        }
+
+        bool useSpatial = spatialSplit.axis >= 0 && spatialSplit.cost < objectSplit.cost;
+        float bestCost = useSpatial ? spatialSplit.cost : objectSplit.cost;
+        if ((!useSpatial && (objectSplit.axis < 0 || objectSplit.leftCount == 0 || objectSplit.leftCount == count)) ||
+            bestCost >= count * INTERSECTION_COST * 0.95f) {
+            makeLeaf();
+            return;
         }
-        
-        return left - first;
+
+        std::vector<PrimRef> leftRefs, rightRefs;
+        if (!useSpatial) {
+            float boundsMin = centroidBounds.minBounds[objectSplit.axis];
+            float scale = binScale(centroidBounds, objectSplit.axis, SAH_BINS);
+            for (const auto& ref : refs) {
+                bool left = binIndex(ref.centroid[objectSplit.axis], boundsMin, scale, SAH_BINS) < objectSplit.bin;
+                (left ? leftRefs : rightRefs).push_back(ref);
+            }
+        } else {
+            int axis = spatialSplit.axis;
+            float position = spatialSplit.position;
+            float leftArea = spatialSplit.leftBounds.getSurfaceArea();
+            float rightArea = spatialSplit.rightBounds.getSurfaceArea();
+            float leftCount = static_cast<float>(spatialSplit.leftCount);
+            float rightCount = static_cast<float>(spatialSplit.rightCount);
+
+            for (const auto& ref : refs) {
+                if (ref.bounds.maxBounds[axis] <= position) {
+                    leftRefs.push_back(ref);
+                    continue;
+                }
+                if (ref.bounds.minBounds[axis] >= position) {
+                    rightRefs.push_back(ref);
+                    continue;
+                }
+
+                // Reference unsplitting: keep the whole triangle on one side when that is cheaper
+                AABB leftWithRef = spatialSplit.leftBounds;
+                leftWithRef.expand(ref.bounds);
+                AABB rightWithRef = spatialSplit.rightBounds;
+                rightWithRef.expand(ref.bounds);
+                float splitCost = leftArea * leftCount + rightArea * rightCount;
+                float leftOnlyCost = leftWithRef.getSurfaceArea() * leftCount + rightArea * (rightCount - 1.0f);
+                float rightOnlyCost = leftArea * (leftCount - 1.0f) + rightWithRef.getSurfaceArea() * rightCount;
+
+                PrimRef leftPart = ref, rightPart = ref;
+                leftPart.bounds = clipTriangle(ref.triangleIdx, axis, ref.bounds.minBounds[axis], position, ref.bounds);
+                rightPart.bounds = clipTriangle(ref.triangleIdx, axis, position, ref.bounds.maxBounds[axis], ref.bounds);
+
+                if (leftOnlyCost < splitCost && leftOnlyCost <= rightOnlyCost) {
+                    leftRefs.push_back(ref);
+                } else if (rightOnlyCost < splitCost) {
+                    rightRefs.push_back(ref);
+                } else if (!leftPart.bounds.isValid()) {
+                    rightRefs.push_back(ref);
+                } else if (!rightPart.bounds.isValid()) {
+                    leftRefs.push_back(ref);
+                } else {
+                    leftPart.centroid = leftPart.bounds.getCenter();
+                    rightPart.centroid = rightPart.bounds.getCenter();
+                    leftRefs.push_back(leftPart);
+                    rightRefs.push_back(rightPart);
+                }
+            }
+
+            int64_t duplicates = static_cast<int64_t>(leftRefs.size() + rightRefs.size()) - count;
+            spatialReferencesLeft -= duplicates;
+            spatialSplitCount++;
+        }
+
+        if (leftRefs.empty() || rightRefs.empty()) {
+            makeLeaf();
+            return;
+        }
+
+        // Concurrent splits may overdraw the budget slightly; never run past the node storage
+        uint32_t leftChildIdx = nodesUsed.fetch_add(2);
+        uint32_t rightChildIdx = leftChildIdx + 1;
+        if (rightChildIdx >= nodes.size()) {
+            makeLeaf();
+            return;
+        }
+
+        // Child bounds from the (possibly clipped) references
+        AABB leftBounds, rightBounds;
+        for (const auto& ref : leftRefs) leftBounds.expand(ref.bounds);
+        for (const auto& ref : rightRefs) rightBounds.expand(ref.bounds);
+
+        nodes[leftChildIdx].setBounds(leftBounds);
+        nodes[rightChildIdx].setBounds(rightBounds);
+        nodes[nodeIdx].leftFirst = leftChildIdx;
+        nodes[nodeIdx].triCount = 0;
+
+        // The parent list is no longer needed while the children recurse
+        refs.clear();
+        refs.shrink_to_fit();
+
+        if (tasks && leftRefs.size() >= SUBTREE_TASK_THRESHOLD) {
+            // Shared ownership keeps the lambda copyable for the task queue
+            auto taskRefs = std::make_shared<std::vector<PrimRef>>(std::move(leftRefs));
+            tasks->run([this, leftChildIdx, taskRefs, depth, tasks]() {
+                subdivideSpatial(leftChildIdx, std::move(*taskRefs), depth + 1, tasks);
+            });
+        } else {
+            subdivideSpatial(leftChildIdx, std::move(leftRefs), depth + 1, tasks);
+        }
+        subdivideSpatial(rightChildIdx, std::move(rightRefs), depth + 1, tasks);
+    }
+
+    BVHBuilder::SpatialSplitResult BVHBuilder::findSpatialSplit(const std::vector<PrimRef>& refs, const AABB& nodeBounds) {
+        SpatialSplitResult bestSplit;
+
+        for (int axis = 0; axis < 3; axis++) {
+            float boundsMin = nodeBounds.minBounds[axis];
+            float extent = nodeBounds.maxBounds[axis] - boundsMin;
+            if (extent <= 0.0f) continue;
+
+            float binWidth = extent / SAH_BINS;
+            float scale = SAH_BINS / extent;
+            std::array<SpatialBin, SAH_BINS> bins;
+
+            // Chop every reference into the bins it spans
+            for (const auto& ref : refs) {
+                uint32_t firstBin = binIndex(ref.bounds.minBounds[axis], boundsMin, scale, SAH_BINS);
+                uint32_t lastBin = std::max(firstBin, binIndex(ref.bounds.maxBounds[axis], boundsMin, scale, SAH_BINS));
+                bins[firstBin].enter++;
+                bins[lastBin].exit++;
+
+                if (firstBin == lastBin) {
+                    bins[firstBin].bounds.expand(ref.bounds);
+                    continue;
+                }
+                for (uint32_t b = firstBin; b <= lastBin; b++) {
+                    float lower = b > firstBin ? boundsMin + b * binWidth : ref.bounds.minBounds[axis];
+                    float upper = b < lastBin ? boundsMin + (b + 1) * binWidth : ref.bounds.maxBounds[axis];
+                    AABB clipped = clipTriangle(ref.triangleIdx, axis, lower, upper, ref.bounds);
+                    if (clipped.isValid()) {
+                        bins[b].bounds.expand(clipped);
+                    }
+                }
+            }
+
+            // Same prefix/suffix sweep as the object splits
+            std::array<AABB, SAH_BINS> rightBounds;
+            std::array<uint32_t, SAH_BINS> rightCounts;
+            AABB accumulated;
+            uint32_t accumulatedCount = 0;
+            for (int b = SAH_BINS - 1; b > 0; b--) {
+                accumulated.expand(bins[b].bounds);
+                accumulatedCount += bins[b].exit;
+                rightBounds[b] = accumulated;
+                rightCounts[b] = accumulatedCount;
+            }
+
+            AABB leftBounds;
+            uint32_t leftCount = 0;
+            for (uint32_t splitBin = 1; splitBin < SAH_BINS; splitBin++) {
+                leftBounds.expand(bins[splitBin - 1].bounds);
+                leftCount += bins[splitBin - 1].enter;
+                if (leftCount == 0 || rightCounts[splitBin] == 0) continue;
+
+                float cost = evaluateSAH(leftCount, rightCounts[splitBin], leftBounds, rightBounds[splitBin], nodeBounds);
+                if (cost < bestSplit.cost) {
+                    bestSplit.cost = cost;
+                    bestSplit.axis = axis;
+                    bestSplit.position = boundsMin + splitBin * binWidth;
+                    bestSplit.leftCount = leftCount;
+                    bestSplit.rightCount = rightCounts[splitBin];
+                    bestSplit.leftBounds = leftBounds;
+                    bestSplit.rightBounds = rightBounds[splitBin];
+                }
+            }
+        }
+
+        return bestSplit;
+    }
+
+    AABB BVHBuilder::clipTriangle(uint32_t triangleIdx, int axis, float lower, float upper, const AABB& refBounds) const {
+        const BVHTriangle& tri = triangles[triangleIdx];
+        const glm::vec3* vertices[3] = { &tri.v0, &tri.v1, &tri.v2 };
+
+        // Vertices inside the slab plus edge crossings of both planes bound the clipped polygon
+        AABB result;
+        for (int i = 0; i < 3; i++) {
+            const glm::vec3& a = *vertices[i];
+            const glm::vec3& b = *vertices[(i + 1) % 3];
+            if (a[axis] >= lower && a[axis] <= upper) {
+                result.expand(a);
+            }
+
+            float planes[2] = { lower, upper };
+            for (float plane : planes) {
+                if ((a[axis] < plane) != (b[axis] < plane)) {
+                    float t = (plane - a[axis]) / (b[axis] - a[axis]);
+                    glm::vec3 point = a + (b - a) * t;
+                    point[axis] = plane;
+                    result.expand(point);
+                }
+            }
+        }
+
+        // Earlier clips of the reference still apply
+        if (!result.isValid()) return result;
+        return result.intersection(refBounds);
+    }
+
+    void BVHBuilder::buildLinear(const AABB& rootCentroidBounds) {
+        ThreadPool& pool = ThreadPool::getInstance();
+        uint32_t primCount = static_cast<uint32_t>(primRefs.size());
+
+        auto phaseStart = std::chrono::high_resolution_clock::now();
+        sortMortonCodes(rootCentroidBounds);
+        lastBuildPhases.sortMs = lapMs(phaseStart);
+
+        nodes.assign(static_cast<size_t>(primCount) * 2, BVHNode());
+        nodeParents.assign(nodes.size(), 0);
+        rootNodeIdx = 0;
+        nodesUsed = 1;
+        nodes[rootNodeIdx].leftFirst = 0;
+        nodes[rootNodeIdx].triCount = primCount;
+
+        {
+            TaskGroup tasks(pool);
+            subdivideLinear(rootNodeIdx, 0, &tasks);
+            tasks.wait();
+        }
+
+        lastBuildPhases.hierarchyMs = lapMs(phaseStart);
+
+        nodes.resize(nodesUsed.load());
+        computeLinearBounds();
+        lastBuildPhases.refitMs = lapMs(phaseStart);
+
+        primitiveIndices.resize(primCount);
+        pool.parallelFor(0, primCount, 64 * 1024, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                primitiveIndices[i] = primRefs[i].triangleIdx;
+            }
+        });
+
+        primRefs.clear();
+        primRefs.shrink_to_fit();
+        scratchRefs.clear();
+        scratchRefs.shrink_to_fit();
+        mortonCodes.clear();
+        mortonCodes.shrink_to_fit();
+        nodeParents.clear();
+        nodeParents.shrink_to_fit();
+        lastBuildPhases.finalizeMs = lapMs(phaseStart);
+    }
+
+    void BVHBuilder::sortMortonCodes(const AABB& centroidBounds) {
+        ThreadPool& pool = ThreadPool::getInstance();
+        size_t primCount = primRefs.size();
+        size_t grain = std::max<size_t>(16 * 1024, primCount / ((pool.getThreadCount() + 1) * 4));
+        size_t chunkCount = (primCount + grain - 1) / grain;
+
+        // Keys are code << 32 | reference, so the sorted keys also give the permutation
+        glm::vec3 extent = centroidBounds.getSize();
+        glm::vec3 scale(extent.x > 0.0f ? 1024.0f / extent.x : 0.0f,
+                        extent.y > 0.0f ? 1024.0f / extent.y : 0.0f,
+                        extent.z > 0.0f ? 1024.0f / extent.z : 0.0f);
+        std::vector<uint64_t> keys(primCount);
+        std::vector<uint64_t> sortedKeys(primCount);
+        pool.parallelFor(0, primCount, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                uint64_t code = mortonCode(primRefs[i].centroid, centroidBounds.minBounds, scale);
+                keys[i] = (code << 32) | i;
+            }
+        });
+
+        // LSD radix sort over the 30 code bits, 8 bits per pass. Each chunk counts its digits,
+        // the prefix over (digit, chunk) gives every chunk its own output ranges, so the scatter
+        // runs in parallel and stays stable.
+        std::vector<std::array<uint32_t, 256>> offsets(chunkCount);
+        for (uint32_t shift = 32; shift < 64; shift += 8) {
+            pool.parallelFor(0, primCount, grain, [&](size_t begin, size_t end) {
+                std::array<uint32_t, 256>& histogram = offsets[begin / grain];
+                histogram.fill(0);
+                for (size_t i = begin; i < end; i++) {
+                    histogram[(keys[i] >> shift) & 0xFF]++;
+                }
+            });
+
+            // Digits shared by every key leave the order unchanged
+            bool allSame = false;
+            uint32_t sum = 0;
+            for (uint32_t digit = 0; digit < 256; digit++) {
+                uint32_t digitTotal = 0;
+                for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+                    uint32_t count = offsets[chunk][digit];
+                    offsets[chunk][digit] = sum;
+                    sum += count;
+                    digitTotal += count;
+                }
+                if (digitTotal == primCount) allSame = true;
+            }
+            if (allSame) continue;
+
+            pool.parallelFor(0, primCount, grain, [&](size_t begin, size_t end) {
+                std::array<uint32_t, 256>& offset = offsets[begin / grain];
+                for (size_t i = begin; i < end; i++) {
+                    sortedKeys[offset[(keys[i] >> shift) & 0xFF]++] = keys[i];
+                }
+            });
+            keys.swap(sortedKeys);
+        }
+
+        // References in code order
+        mortonCodes.resize(primCount);
+        scratchRefs.resize(primCount);
+        pool.parallelFor(0, primCount, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                mortonCodes[i] = static_cast<uint32_t>(keys[i] >> 32);
+                scratchRefs[i] = primRefs[static_cast<uint32_t>(keys[i])];
+            }
+        });
+        primRefs.swap(scratchRefs);
+    }
+
+    void BVHBuilder::subdivideLinear(uint32_t nodeIdx, uint32_t depth, TaskGroup* tasks) {
+        BVHNode& node = nodes[nodeIdx];
+        if (node.triCount <= MAX_TRIANGLES_PER_LEAF || depth >= MAX_DEPTH) {
+            return;
+        }
+
+        // The codes of the range share every bit above the highest differing one; the split is
+        // where that bit turns on. Duplicate codes are split in the middle.
+        uint32_t first = node.leftFirst;
+        uint32_t count = node.triCount;
+        uint32_t difference = mortonCodes[first] ^ mortonCodes[first + count - 1];
+        uint32_t leftCount = count / 2;
+        if (difference != 0) {
+            uint32_t highestBit = 1u << 31;
+            while (!(difference & highestBit)) highestBit >>= 1;
+            const uint32_t* begin = mortonCodes.data() + first;
+            const uint32_t* split = std::partition_point(begin, begin + count, [highestBit](uint32_t code) {
+                return (code & highestBit) == 0;
+            });
+            leftCount = static_cast<uint32_t>(split - begin);
+        }
+
+        uint32_t leftChildIdx = nodesUsed.fetch_add(2);
+        uint32_t rightChildIdx = leftChildIdx + 1;
+        nodes[leftChildIdx].leftFirst = first;
+        nodes[leftChildIdx].triCount = leftCount;
+        nodes[rightChildIdx].leftFirst = first + leftCount;
+        nodes[rightChildIdx].triCount = count - leftCount;
+        nodeParents[leftChildIdx] = nodeIdx;
+        nodeParents[rightChildIdx] = nodeIdx;
+
+        node.leftFirst = leftChildIdx;
+        node.triCount = 0;
+
+        if (tasks && leftCount >= SUBTREE_TASK_THRESHOLD) {
+            tasks->run([this, leftChildIdx, depth, tasks]() {
+                subdivideLinear(leftChildIdx, depth + 1, tasks);
+            });
+        } else {
+            subdivideLinear(leftChildIdx, depth + 1, tasks);
+        }
+        subdivideLinear(rightChildIdx, depth + 1, tasks);
+    }
+
+    void BVHBuilder::computeLinearBounds() {
+        // Leaves compute their bounds and walk up; the second child to arrive at a parent
+        // merges both children and continues, the first one stops there
+        size_t nodeCount = nodes.size();
+        std::unique_ptr<std::atomic<uint32_t>[]> arrivals(new std::atomic<uint32_t>[nodeCount]());
+
+        ThreadPool::getInstance().parallelFor(0, nodeCount, 16 * 1024, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                if (!nodes[i].isLeaf()) continue;
+
+                AABB bounds;
+                for (uint32_t j = 0; j < nodes[i].triCount; j++) {
+                    bounds.expand(primRefs[nodes[i].leftFirst + j].bounds);
+                }
+                nodes[i].setBounds(bounds);
+
+                uint32_t nodeIdx = static_cast<uint32_t>(i);
+                while (nodeIdx != rootNodeIdx) {
+                    uint32_t parentIdx = nodeParents[nodeIdx];
+                    if (arrivals[parentIdx].fetch_add(1, std::memory_order_acq_rel) == 0) break;
+
+                    BVHNode& parent = nodes[parentIdx];
+                    AABB merged = nodes[parent.leftFirst].getBounds();
+                    merged.expand(nodes[parent.leftFirst + 1].getBounds());
+                    parent.setBounds(merged);
+                    nodeIdx = parentIdx;
+                }
+            }
+        });
+    }
+
+    float BVHBuilder::computeSAHCost() const {
+        if (nodes.empty()) return 0.0f;
+
+        float rootArea = nodes[rootNodeIdx].getBounds().getSurfaceArea();
+        if (rootArea <= 0.0f) return 0.0f;
+
+        double cost = 0.0;
+        for (const auto& node : nodes) {
+            float area = node.getBounds().getSurfaceArea();
+            cost += node.isLeaf() ? area * node.triCount * INTERSECTION_COST : area * TRAVERSAL_COST;
+        }
+        return static_cast<float>(cost / rootArea);
+    }
+
+    bool BVHBuilder::intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const BVHTriangle& tri, float& t) {
+        const float EPSILON = 0.0000001f;
+        glm::vec3 edge1 = tri.v1 - tri.v0;
+        glm::vec3 edge2 = tri.v2 - tri.v0;
+        glm::vec3 h = glm::cross(direction, edge2);
+        float a = glm::dot(edge1, h);
+        if (std::abs(a) < EPSILON) return false;
+
+        float f = 1.0f / a;
+        glm::vec3 s = origin - tri.v0;
+        float u = f * glm::dot(s, h);
+        if (u < 0.0f || u > 1.0f) return false;
+
+        glm::vec3 q = glm::cross(s, edge1);
+        float v = f * glm::dot(direction, q);
+        if (v < 0.0f || u + v > 1.0f) return false;
+
+        t = f * glm::dot(edge2, q);
+        return t > EPSILON;
+    }
+
+    float BVHBuilder::intersectAABB(const glm::vec3& origin, const glm::vec3& invDirection,
+                                    const glm::vec3& minBounds, const glm::vec3& maxBounds) {
+        glm::vec3 t0 = (minBounds - origin) * invDirection;
+        glm::vec3 t1 = (maxBounds - origin) * invDirection;
+        glm::vec3 tSmall = glm::min(t0, t1);
+        glm::vec3 tLarge = glm::max(t0, t1);
+        float tNear = std::max(std::max(tSmall.x, tSmall.y), tSmall.z);
+        float tFar = std::min(std::min(tLarge.x, tLarge.y), tLarge.z);
+        if (tFar < tNear || tFar <= 0.0f) return FLT_MAX;
+        return std::max(tNear, 0.0f);
+    }
+
+    bool BVHBuilder::intersect(const glm::vec3& origin, const glm::vec3& direction, float& tHit, uint32_t& triangleIdx,
+                               BVHTraversalStats* stats) const {
+        if (nodes.empty()) return false;
+
+        glm::vec3 invDirection = 1.0f / direction;
+        bool hit = false;
+
+        uint32_t stack[64];
+        int stackIndex = 0;
+        stack[stackIndex++] = rootNodeIdx;
+
+        while (stackIndex > 0) {
+            const BVHNode& node = nodes[stack[--stackIndex]];
+            if (stats) stats->nodesVisited++;
+
+            if (node.isLeaf()) {
+                for (uint32_t i = 0; i < node.triCount; i++) {
+                    uint32_t triIdx = node.leftFirst + i;
+                    float t;
+                    if (stats) stats->triangleTests++;
+                    if (intersectTriangle(origin, direction, triangles[triIdx], t) && t < tHit) {
+                        tHit = t;
+                        triangleIdx = triIdx;
+                        hit = true;
+                    }
+                }
+                continue;
+            }
+
+            // Closer child on top of the stack
+            uint32_t childA = node.leftFirst;
+            uint32_t childB = node.leftFirst + 1;
+            float distA = intersectAABB(origin, invDirection, nodes[childA].minBounds, nodes[childA].maxBounds);
+            float distB = intersectAABB(origin, invDirection, nodes[childB].minBounds, nodes[childB].maxBounds);
+            if (distA > distB) {
+                std::swap(distA, distB);
+                std::swap(childA, childB);
+            }
+            if (distB < tHit && stackIndex < 64) stack[stackIndex++] = childB;
+            if (distA < tHit && stackIndex < 64) stack[stackIndex++] = childA;
+        }
+
+        return hit;
+    }
+
+    bool BVHBuilder::intersectAny(const glm::vec3& origin, const glm::vec3& direction, float tMax) const {
+        if (nodes.empty()) return false;
+
+        glm::vec3 invDirection = 1.0f / direction;
+
+        uint32_t stack[64];
+        int stackIndex = 0;
+        stack[stackIndex++] = rootNodeIdx;
+
+        while (stackIndex > 0) {
+            const BVHNode& node = nodes[stack[--stackIndex]];
+
+            if (node.isLeaf()) {
+                for (uint32_t i = 0; i < node.triCount; i++) {
+                    float t;
+                    if (intersectTriangle(origin, direction, triangles[node.leftFirst + i], t) && t < tMax) {
+                        return true;
+                    }
+                }
+                continue;
+            }
+
+            for (uint32_t child = node.leftFirst; child < node.leftFirst + 2; child++) {
+                float dist = intersectAABB(origin, invDirection, nodes[child].minBounds, nodes[child].maxBounds);
+                if (dist < tMax && stackIndex < 64) stack[stackIndex++] = child;
+            }
+        }
+
+        return false;
     }
 
-} // namespace Engine
\ No newline at end of file
+} // namespace Engine
@@ -0,0 +1,197 @@
+#include "../../headers/Engine/BVHCache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Engine {
+
+    namespace {
+
+        // Read-only mapping of a whole file
+        class MappedFile {
+        public:
+            explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+                file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+                if (file == INVALID_HANDLE_VALUE) return;
+                LARGE_INTEGER fileSize;
+                if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return;
+                mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (!mapping) return;
+                data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (data) size = static_cast<size_t>(fileSize.QuadPart);
+#else
+                descriptor = open(path.c_str(), O_RDONLY);
+                if (descriptor < 0) return;
+                struct stat info;
+                if (fstat(descriptor, &info) != 0 || info.st_size == 0) return;
+                void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (mapped == MAP_FAILED) return;
+                data = mapped;
+                size = static_cast<size_t>(info.st_size);
+#endif
+            }
+
+            ~MappedFile() {
+#ifdef _WIN32
+                if (data) UnmapViewOfFile(data);
+                if (mapping) CloseHandle(mapping);
+                if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+                if (data) munmap(const_cast<void*>(data), size);
+                if (descriptor >= 0) close(descriptor);
+#endif
+            }
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            const unsigned char* bytes() const { return static_cast<const unsigned char*>(data); }
+            size_t getSize() const { return size; }
+
+        private:
+            const void* data = nullptr;
+            size_t size = 0;
+#ifdef _WIN32
+            HANDLE file = INVALID_HANDLE_VALUE;
+            HANDLE mapping = nullptr;
+#else
+            int descriptor = -1;
+#endif
+        };
+
+        // 64-bit FNV-1a style mix over 32-bit words (geometry hashes run over millions of floats)
+        constexpr uint64_t HASH_OFFSET = 0xCBF29CE484222325ull;
+        constexpr uint64_t HASH_PRIME = 0x100000001B3ull;
+
+        inline void hashWord(uint64_t& hash, uint32_t word) {
+            hash = (hash ^ word) * HASH_PRIME;
+        }
+
+        inline void hashVec3(uint64_t& hash, const glm::vec3& v) {
+            uint32_t words[3];
+            std::memcpy(words, &v, sizeof(words));
+            hashWord(hash, words[0]);
+            hashWord(hash, words[1]);
+            hashWord(hash, words[2]);
+        }
+    }
+
+    uint64_t BVHCache::hashTriangles(const std::vector<BVHTriangle>& triangles, const BVHBuilder::BuildSettings& settings) {
+        uint64_t hash = HASH_OFFSET;
+        hashWord(hash, FORMAT_VERSION);
+        hashWord(hash, static_cast<uint32_t>(settings.mode));
+        uint32_t budgetBits;
+        std::memcpy(&budgetBits, &settings.spatialSplitBudget, sizeof(budgetBits));
+        hashWord(hash, settings.mode == BVHBuilder::BuildMode::SpatialSplits ? budgetBits : 0u);
+        hashWord(hash, static_cast<uint32_t>(triangles.size()));
+
+        for (const auto& tri : triangles) {
+            hashVec3(hash, tri.v0);
+            hashVec3(hash, tri.v1);
+            hashVec3(hash, tri.v2);
+        }
+        return hash;
+    }
+
+    std::string BVHCache::getCachePath(const std::string& directory, uint64_t hash) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bvh", static_cast<unsigned long long>(hash));
+        return (std::filesystem::path(directory) / name).string();
+    }
+
+    bool BVHCache::load(const std::string& path, uint64_t hash, const std::vector<BVHTriangle>& triangles, BVHBuilder& builder) {
+        if (!std::filesystem::exists(path)) return false;
+
+        auto loadStart = std::chrono::high_resolution_clock::now();
+        MappedFile file(path);
+        if (file.getSize() < sizeof(FileHeader)) return false;
+
+        FileHeader header;
+        std::memcpy(&header, file.bytes(), sizeof(header));
+        size_t expectedSize = sizeof(FileHeader) + static_cast<size_t>(header.nodeCount) * sizeof(BVHNode) +
+                              static_cast<size_t>(header.referenceCount) * sizeof(uint32_t);
+        if (std::memcmp(header.magic, "SVBH", 4) != 0 || header.version != FORMAT_VERSION || header.hash != hash ||
+            header.inputTriangleCount != triangles.size() || file.getSize() != expectedSize) {
+            std::cerr << "Ignoring stale BVH cache file: " << path << std::endl;
+            return false;
+        }
+
+        // Nodes and permutation follow the header at 4-byte aligned offsets of the mapping
+        const unsigned char* payload = file.bytes() + sizeof(FileHeader);
+        const BVHNode* nodes = reinterpret_cast<const BVHNode*>(payload);
+        const uint32_t* order = reinterpret_cast<const uint32_t*>(payload + static_cast<size_t>(header.nodeCount) * sizeof(BVHNode));
+        if (!builder.restore(triangles, nodes, header.nodeCount, order, header.referenceCount, header.rootNode)) {
+            std::cerr << "Ignoring corrupt BVH cache file: " << path << std::endl;
+            return false;
+        }
+
+        double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+        std::cout << "Loaded cached BVH with " << header.nodeCount << " nodes for " << header.inputTriangleCount
+                  << " triangles in " << loadMs << " ms" << std::endl;
+        return true;
+    }
+
+    bool BVHCache::save(const std::string& path, uint64_t hash, const BVHBuilder& builder) {
+        const auto& nodes = builder.getNodes();
+        const auto& triangles = builder.getTriangles();
+        if (nodes.empty() || triangles.empty()) return false;
+
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+        FileHeader header = {};
+        std::memcpy(header.magic, "SVBH", 4);
+        header.version = FORMAT_VERSION;
+        header.hash = hash;
+        header.inputTriangleCount = builder.getInputTriangleCount();
+        header.nodeCount = static_cast<uint32_t>(nodes.size());
+        header.referenceCount = static_cast<uint32_t>(triangles.size());
+        header.rootNode = builder.getRootNodeIndex();
+
+        std::vector<uint32_t> order(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i++) {
+            order[i] = static_cast<uint32_t>(triangles[i].materialId);
+        }
+
+        // Written to a temporary name first so a crash never leaves a truncated cache file
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                std::cerr << "Failed to write BVH cache file: " << path << std::endl;
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(BVHNode));
+            out.write(reinterpret_cast<const char*>(order.data()), order.size() * sizeof(uint32_t));
+            if (!out) {
+                std::cerr << "Failed to write BVH cache file: " << path << std::endl;
+                return false;
+            }
+        }
+        std::filesystem::rename(tempPath, path, error);
+        if (error) {
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,215 @@
+#include "../../headers/Engine/BVHStats.h"
+#include <json.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+
+namespace Engine {
+
+    namespace {
+        json traversalToJson(const BVHStats::Traversal& traversal) {
+            json j;
+            j["rays"] = traversal.rayCount;
+            j["hits"] = traversal.hitCount;
+            j["nodesPerRay"] = traversal.nodesPerRay;
+            j["testsPerRay"] = traversal.testsPerRay;
+            j["instancesPerRay"] = traversal.instancesPerRay;
+            j["maxNodes"] = traversal.maxNodes;
+            j["maxTests"] = traversal.maxTests;
+            j["timeMs"] = traversal.timeMs;
+            return j;
+        }
+
+        json phasesToJson(const BVHBuilder::BuildPhaseTimes& phases) {
+            json j;
+            j["prepareMs"] = phases.prepareMs;
+            j["sortMs"] = phases.sortMs;
+            j["hierarchyMs"] = phases.hierarchyMs;
+            j["refitMs"] = phases.refitMs;
+            j["finalizeMs"] = phases.finalizeMs;
+            return j;
+        }
+
+        json statsToJson(const BVHStats& stats) {
+            json j;
+            j["mode"] = BVHStats::getBuildModeName(stats.mode);
+            j["primitives"] = stats.primitiveCount;
+            j["references"] = stats.referenceCount;
+            j["sahCost"] = stats.sahCost;
+            j["nodes"] = stats.nodeCount;
+            j["leaves"] = stats.leafCount;
+            j["maxDepth"] = stats.maxDepth;
+            j["averageLeafDepth"] = stats.averageLeafDepth;
+            j["averageLeafSize"] = stats.averageLeafSize;
+            j["depthHistogram"] = stats.depthHistogram;
+            j["leafSizeHistogram"] = stats.leafSizeHistogram;
+            j["overlap"]["overlappingNodes"] = stats.overlappingNodes;
+            j["overlap"]["averageRatio"] = stats.averageOverlapRatio;
+            j["overlap"]["cost"] = stats.overlapCost;
+            j["memory"]["nodeBytes"] = stats.nodeBytes;
+            j["memory"]["triangleBytes"] = stats.triangleBytes;
+            j["memory"]["gpuTriangleBytes"] = stats.gpuTriangleBytes;
+            j["memory"]["indexBytes"] = stats.indexBytes;
+            j["build"] = phasesToJson(stats.buildPhases);
+            j["build"]["totalMs"] = stats.buildMs;
+            j["build"]["restored"] = stats.restored;
+            if (stats.traversal.rayCount > 0) {
+                j["traversal"] = traversalToJson(stats.traversal);
+            }
+            return j;
+        }
+    }
+
+    BVHStats BVHStats::analyze(const BVHBuilder& builder) {
+        BVHStats stats;
+        const auto& nodes = builder.getNodes();
+        stats.mode = builder.getBuildSettings().mode;
+        stats.buildMs = builder.getLastBuildTimeMs();
+        stats.buildPhases = builder.getLastBuildPhases();
+        stats.restored = builder.wasRestored();
+        if (nodes.empty()) return stats;
+
+        bool triangleTree = !builder.getTriangles().empty();
+        stats.primitiveCount = triangleTree ? builder.getInputTriangleCount() : static_cast<uint32_t>(builder.getPrimitiveIndices().size());
+        stats.sahCost = builder.computeSAHCost();
+
+        // Depth-first walk from the root; the node array may hold unused slots
+        float rootArea = nodes[builder.getRootNodeIndex()].getBounds().getSurfaceArea();
+        double overlapRatioSum = 0.0;
+        double overlapAreaSum = 0.0;
+        uint64_t leafDepthSum = 0;
+        uint32_t interiorCount = 0;
+        std::vector<std::pair<uint32_t, uint32_t>> stack = { { builder.getRootNodeIndex(), 0u } };
+        while (!stack.empty()) {
+            uint32_t nodeIdx = stack.back().first;
+            uint32_t depth = stack.back().second;
+            stack.pop_back();
+            const BVHNode& node = nodes[nodeIdx];
+            stats.nodeCount++;
+            stats.maxDepth = std::max(stats.maxDepth, depth);
+
+            if (node.isLeaf()) {
+                stats.leafCount++;
+                stats.referenceCount += node.triCount;
+                leafDepthSum += depth;
+                if (stats.depthHistogram.size() <= depth) stats.depthHistogram.resize(depth + 1, 0);
+                stats.depthHistogram[depth]++;
+                if (stats.leafSizeHistogram.size() <= node.triCount) stats.leafSizeHistogram.resize(node.triCount + 1, 0);
+                stats.leafSizeHistogram[node.triCount]++;
+                continue;
+            }
+
+            interiorCount++;
+            AABB overlap = nodes[node.leftFirst].getBounds().intersection(nodes[node.leftFirst + 1].getBounds());
+            float overlapArea = overlap.isValid() ? overlap.getSurfaceArea() : 0.0f;
+            float parentArea = node.getBounds().getSurfaceArea();
+            if (overlapArea > 0.0f) {
+                stats.overlappingNodes++;
+                overlapAreaSum += overlapArea;
+                if (parentArea > 0.0f) overlapRatioSum += overlapArea / parentArea;
+            }
+            stack.push_back({ node.leftFirst + 1, depth + 1 });
+            stack.push_back({ node.leftFirst, depth + 1 });
+        }
+
+        if (stats.leafCount > 0) {
+            stats.averageLeafDepth = static_cast<double>(leafDepthSum) / stats.leafCount;
+            stats.averageLeafSize = static_cast<double>(stats.referenceCount) / stats.leafCount;
+        }
+        if (interiorCount > 0) stats.averageOverlapRatio = overlapRatioSum / interiorCount;
+        if (rootArea > 0.0f) stats.overlapCost = overlapAreaSum / rootArea;
+
+        stats.nodeBytes = nodes.size() * sizeof(BVHNode);
+        if (triangleTree) {
+            size_t referenceCount = builder.getTriangles().size();
+            stats.triangleBytes = referenceCount * sizeof(BVHTriangle);
+            stats.gpuTriangleBytes = referenceCount * (sizeof(GPUTriangleGeometry) + sizeof(GPUTriangleMaterial));
+        } else {
+            stats.indexBytes = builder.getPrimitiveIndices().size() * sizeof(uint32_t);
+        }
+        return stats;
+    }
+
+    BVHStats::Traversal BVHStats::measureTraversal(const BVHBuilder& builder, const std::vector<Ray>& rays) {
+        Traversal traversal;
+        if (builder.getTriangles().empty() || rays.empty()) return traversal;
+
+        auto traceStart = std::chrono::high_resolution_clock::now();
+        uint64_t nodeSum = 0;
+        uint64_t testSum = 0;
+        for (const Ray& ray : rays) {
+            BVHTraversalStats rayStats;
+            float tHit = FLT_MAX;
+            uint32_t triangleIdx;
+            if (builder.intersect(ray.origin, ray.direction, tHit, triangleIdx, &rayStats)) {
+                traversal.hitCount++;
+            }
+            nodeSum += rayStats.nodesVisited;
+            testSum += rayStats.triangleTests;
+            traversal.maxNodes = std::max(traversal.maxNodes, rayStats.nodesVisited);
+            traversal.maxTests = std::max(traversal.maxTests, rayStats.triangleTests);
+        }
+        traversal.timeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - traceStart).count();
+
+        traversal.rayCount = static_cast<uint32_t>(rays.size());
+        traversal.nodesPerRay = static_cast<double>(nodeSum) / rays.size();
+        traversal.testsPerRay = static_cast<double>(testSum) / rays.size();
+        return traversal;
+    }
+
+    std::vector<Ray> BVHStats::cameraRays(const glm::mat4& view, const glm::mat4& projection, uint32_t width, uint32_t height) {
+        std::vector<Ray> rays;
+        if (width == 0 || height == 0) return rays;
+
+        glm::mat4 invViewProj = glm::inverse(projection * view);
+        rays.reserve(static_cast<size_t>(width) * height);
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                glm::vec2 ndc((x + 0.5f) / width * 2.0f - 1.0f, 1.0f - (y + 0.5f) / height * 2.0f);
+                glm::vec4 nearPoint = invViewProj * glm::vec4(ndc, -1.0f, 1.0f);
+                glm::vec4 farPoint = invViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+                glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+                glm::vec3 target = glm::vec3(farPoint) / farPoint.w;
+                rays.push_back({ origin, glm::normalize(target - origin) });
+            }
+        }
+        return rays;
+    }
+
+    const char* BVHStats::getBuildModeName(BVHBuilder::BuildMode mode) {
+        switch (mode) {
+            case BVHBuilder::BuildMode::SpatialSplits: return "SpatialSplits";
+            case BVHBuilder::BuildMode::LBVH: return "LBVH";
+            default: return "BinnedSAH";
+        }
+    }
+
+    std::string SceneBVHStats::toJson() const {
+        json j;
+        j["tlas"] = statsToJson(tlas);
+        j["blas"] = json::array();
+        for (const auto& stats : blas) {
+            j["blas"].push_back(statsToJson(stats));
+        }
+        j["blasTotals"]["triangles"] = blasTriangles;
+        j["blasTotals"]["sahCost"] = blasSAHCost;
+        j["blasTotals"]["build"] = phasesToJson(blasPhases);
+        j["blasTotals"]["build"]["totalMs"] = blasBuildMs;
+        j["totalBytes"] = totalBytes;
+        j["traversal"] = traversalToJson(traversal);
+        return j.dump(4);
+    }
+
+    bool SceneBVHStats::saveJson(const std::string& path) const {
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            std::cerr << "Failed to write BVH statistics: " << path << std::endl;
+            return false;
+        }
+        file << toJson() << std::endl;
+        return true;
+    }
+
+}
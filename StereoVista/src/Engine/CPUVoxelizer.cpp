@@ -0,0 +1,373 @@
+#include "../../headers/Engine/CPUVoxelizer.h"
+#include "../../headers/Engine/ThreadPool.h"
+#include "../../headers/Engine/VoxelLighting.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+namespace Engine {
+
+    namespace {
+
+        double elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        // Barycentric weights of the point of triangle abc closest to p (Ericson, Real-Time Collision Detection 5.1.5)
+        glm::vec3 closestPointWeights(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+            glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+            float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+            if (d1 <= 0.0f && d2 <= 0.0f) return glm::vec3(1.0f, 0.0f, 0.0f);
+
+            glm::vec3 bp = p - b;
+            float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+            if (d3 >= 0.0f && d4 <= d3) return glm::vec3(0.0f, 1.0f, 0.0f);
+
+            float vc = d1 * d4 - d3 * d2;
+            if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+                float v = d1 / (d1 - d3);
+                return glm::vec3(1.0f - v, v, 0.0f);
+            }
+
+            glm::vec3 cp = p - c;
+            float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+            if (d6 >= 0.0f && d5 <= d6) return glm::vec3(0.0f, 0.0f, 1.0f);
+
+            float vb = d5 * d2 - d1 * d6;
+            if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+                float w = d2 / (d2 - d6);
+                return glm::vec3(1.0f - w, 0.0f, w);
+            }
+
+            float va = d3 * d6 - d5 * d4;
+            if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+                float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+                return glm::vec3(0.0f, 1.0f - w, w);
+            }
+
+            float denom = 1.0f / (va + vb + vc);
+            float v = vb * denom, w = vc * denom;
+            return glm::vec3(1.0f - v - w, v, w);
+        }
+
+        // Texel of an absolute voxel in the toroidal layout
+        size_t texelIndex(const glm::ivec3& voxel, int resolution) {
+            glm::ivec3 texel = ((voxel % resolution) + resolution) % resolution;
+            return (static_cast<size_t>(texel.z) * resolution + texel.y) * resolution + texel.x;
+        }
+    }
+
+    size_t CPUVoxelizer::Volume::getOccupiedCount(int level) const {
+        if (level >= static_cast<int>(levels.size())) return 0;
+        return static_cast<size_t>(std::count_if(levels[level].begin(), levels[level].end(),
+                                                 [](const glm::u8vec4& texel) { return texel.a > 0; }));
+    }
+
+    void CPUVoxelizer::clear() {
+        triangles.clear();
+        materials.clear();
+        lights.clear();
+    }
+
+    bool CPUVoxelizer::triangleBoxOverlap(const glm::vec3& boxCenter, const glm::vec3& boxHalfSize,
+                                          const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+        // Akenine-Moeller: box face normals, triangle normal and the 9 edge cross products.
+        // Touching counts as overlap, so the test is conservative.
+        glm::vec3 a = v0 - boxCenter, b = v1 - boxCenter, c = v2 - boxCenter;
+
+        glm::vec3 triMin = glm::min(a, glm::min(b, c));
+        glm::vec3 triMax = glm::max(a, glm::max(b, c));
+        if (glm::any(glm::greaterThan(triMin, boxHalfSize)) || glm::any(glm::lessThan(triMax, -boxHalfSize))) return false;
+
+        glm::vec3 edges[3] = { b - a, c - b, a - c };
+        glm::vec3 normal = glm::cross(edges[0], edges[1]);
+        if (std::abs(glm::dot(normal, a)) > glm::dot(boxHalfSize, glm::abs(normal))) return false;
+
+        for (const glm::vec3& edge : edges) {
+            for (int axis = 0; axis < 3; axis++) {
+                glm::vec3 unit(0.0f);
+                unit[axis] = 1.0f;
+                glm::vec3 separatingAxis = glm::cross(unit, edge);
+                float p0 = glm::dot(a, separatingAxis);
+                float p1 = glm::dot(b, separatingAxis);
+                float p2 = glm::dot(c, separatingAxis);
+                float radius = glm::dot(boxHalfSize, glm::abs(separatingAxis));
+                if (std::min(p0, std::min(p1, p2)) > radius || std::max(p0, std::max(p1, p2)) < -radius) return false;
+            }
+        }
+        return true;
+    }
+
+    glm::vec4 CPUVoxelizer::shade(const Triangle& triangle, const glm::vec3& voxelCenter) const {
+        // The shader lights each fragment; here the triangle point closest to the voxel center stands in
+        glm::vec3 weights = closestPointWeights(voxelCenter, triangle.v0, triangle.v1, triangle.v2);
+        glm::vec3 position = weights.x * triangle.v0 + weights.y * triangle.v1 + weights.z * triangle.v2;
+        glm::vec3 normal = weights.x * triangle.n0 + weights.y * triangle.n1 + weights.z * triangle.n2;
+        float normalLength = glm::length(normal);
+        normal = normalLength > 0.0f ? normal / normalLength
+                                     : glm::normalize(glm::cross(triangle.v1 - triangle.v0, triangle.v2 - triangle.v0));
+
+        Material material = triangle.material < materials.size() ? materials[triangle.material] : Material();
+        glm::vec3 baseColor = material.diffuseColor;
+
+        glm::vec3 diffuse(0.0f);
+        size_t lightCount = std::min(lights.size(), VoxelLighting::MAX_LIGHTS);
+        for (size_t i = 0; i < lightCount; i++) {
+            glm::vec3 toLight = lights[i].position - position;
+            float distance = glm::length(toLight);
+            glm::vec3 lightDir = distance > 0.0f ? toLight / distance : glm::vec3(0.0f);
+            float diff = std::max(glm::dot(normal, lightDir), 0.0f);
+            diffuse += diff * VoxelLighting::POINT_LIGHT_INTENSITY * VoxelLighting::attenuate(distance) * lights[i].color;
+        }
+        diffuse *= baseColor;
+
+        glm::vec3 finalColor = VoxelLighting::AMBIENT_STRENGTH * baseColor + diffuse + material.emissivity * baseColor;
+        return glm::vec4(glm::clamp(finalColor, glm::vec3(0.0f), glm::vec3(1.0f)), 1.0f - material.transparency);
+    }
+
+    bool CPUVoxelizer::getTriangleVoxelBox(const Triangle& triangle, const Window& window, glm::ivec3& boxMin, glm::ivec3& boxMax) {
+        glm::vec3 windowMin = glm::vec3(window.origin) * window.voxelSize;
+        glm::vec3 triMin = glm::min(triangle.v0, glm::min(triangle.v1, triangle.v2));
+        glm::vec3 triMax = glm::max(triangle.v0, glm::max(triangle.v1, triangle.v2));
+        boxMin = glm::ivec3(glm::floor((triMin - windowMin) / window.voxelSize));
+        boxMax = glm::ivec3(glm::floor((triMax - windowMin) / window.voxelSize));
+        if (glm::any(glm::lessThan(boxMax, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(boxMin, glm::ivec3(window.resolution)))) return false;
+        boxMin = glm::max(boxMin, glm::ivec3(0));
+        boxMax = glm::min(boxMax, glm::ivec3(window.resolution - 1));
+        return true;
+    }
+
+    CPUVoxelizer::BrickBins CPUVoxelizer::binTriangles(const Window& window, Stats& stats) const {
+        ThreadPool& pool = ThreadPool::getInstance();
+        auto binStart = std::chrono::high_resolution_clock::now();
+
+        BrickBins bins;
+        bins.bricksPerAxis = (window.resolution + BRICK_SIZE - 1) / BRICK_SIZE;
+        size_t brickCount = static_cast<size_t>(bins.bricksPerAxis) * bins.bricksPerAxis * bins.bricksPerAxis;
+        glm::vec3 windowMin = glm::vec3(window.origin) * window.voxelSize;
+        glm::vec3 brickHalfSize = glm::vec3(BRICK_SIZE * 0.5f) * window.voxelSize;
+
+        // (brick, triangle) references per chunk of triangles
+        const size_t chunkSize = 1024;
+        size_t chunkCount = (triangles.size() + chunkSize - 1) / chunkSize;
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> chunkReferences(chunkCount);
+        std::atomic<uint32_t> trianglesInWindow{ 0 };
+
+        pool.parallelFor(0, chunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+            for (size_t chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+                auto& references = chunkReferences[chunk];
+                uint32_t inWindow = 0;
+                size_t triEnd = std::min(triangles.size(), (chunk + 1) * chunkSize);
+                for (size_t triIdx = chunk * chunkSize; triIdx < triEnd; triIdx++) {
+                    const Triangle& triangle = triangles[triIdx];
+                    glm::ivec3 boxMin, boxMax;
+                    if (!getTriangleVoxelBox(triangle, window, boxMin, boxMax)) continue;
+
+                    size_t referencesBefore = references.size();
+                    glm::ivec3 brickMin = boxMin / BRICK_SIZE, brickMax = boxMax / BRICK_SIZE;
+                    for (int z = brickMin.z; z <= brickMax.z; z++) {
+                        for (int y = brickMin.y; y <= brickMax.y; y++) {
+                            for (int x = brickMin.x; x <= brickMax.x; x++) {
+                                glm::vec3 brickCenter = windowMin + glm::vec3(x, y, z) * (BRICK_SIZE * window.voxelSize) + brickHalfSize;
+                                if (!triangleBoxOverlap(brickCenter, brickHalfSize, triangle.v0, triangle.v1, triangle.v2)) continue;
+                                uint32_t brick = static_cast<uint32_t>((z * bins.bricksPerAxis + y) * bins.bricksPerAxis + x);
+                                references.emplace_back(brick, static_cast<uint32_t>(triIdx));
+                            }
+                        }
+                    }
+                    if (references.size() > referencesBefore) inWindow++;
+                }
+                trianglesInWindow += inWindow;
+            }
+        });
+
+        // Counting sort of the references by brick
+        bins.brickStart.assign(brickCount + 1, 0);
+        for (const auto& references : chunkReferences) {
+            for (const auto& reference : references) bins.brickStart[reference.first + 1]++;
+        }
+        for (size_t brick = 0; brick < brickCount; brick++) bins.brickStart[brick + 1] += bins.brickStart[brick];
+        bins.brickTriangles.resize(bins.brickStart.back());
+        {
+            std::vector<uint32_t> cursor(bins.brickStart.begin(), bins.brickStart.end() - 1);
+            for (const auto& references : chunkReferences) {
+                for (const auto& reference : references) bins.brickTriangles[cursor[reference.first]++] = reference.second;
+            }
+        }
+        for (size_t brick = 0; brick < brickCount; brick++) {
+            if (bins.brickStart[brick + 1] > bins.brickStart[brick]) bins.occupiedBricks.push_back(static_cast<uint32_t>(brick));
+        }
+
+        stats.binMs = elapsedMs(binStart);
+        stats.triangles = trianglesInWindow;
+        stats.bricks = static_cast<uint32_t>(bins.occupiedBricks.size());
+        stats.brickReferences = bins.brickTriangles.size();
+        stats.threads = pool.getThreadCount() + 1;
+        return bins;
+    }
+
+    void CPUVoxelizer::voxelizeBrick(const Window& window, const BrickBins& bins, uint32_t brick, glm::u8vec4* texels) const {
+        glm::vec3 windowMin = glm::vec3(window.origin) * window.voxelSize;
+        glm::vec3 voxelHalfSize(window.voxelSize * 0.5f);
+        glm::ivec3 brickCoord(brick % bins.bricksPerAxis, (brick / bins.bricksPerAxis) % bins.bricksPerAxis,
+                              brick / (bins.bricksPerAxis * bins.bricksPerAxis));
+        glm::ivec3 brickMin = brickCoord * BRICK_SIZE;
+        glm::ivec3 brickMax = glm::min(brickMin + BRICK_SIZE, glm::ivec3(window.resolution)) - 1;
+
+        for (uint32_t ref = bins.brickStart[brick]; ref < bins.brickStart[brick + 1]; ref++) {
+            const Triangle& triangle = triangles[bins.brickTriangles[ref]];
+            glm::ivec3 boxMin, boxMax;
+            getTriangleVoxelBox(triangle, window, boxMin, boxMax);
+            boxMin = glm::max(boxMin, brickMin);
+            boxMax = glm::min(boxMax, brickMax);
+
+            for (int z = boxMin.z; z <= boxMax.z; z++) {
+                for (int y = boxMin.y; y <= boxMax.y; y++) {
+                    for (int x = boxMin.x; x <= boxMax.x; x++) {
+                        glm::vec3 voxelCenter = windowMin + (glm::vec3(x, y, z) + 0.5f) * window.voxelSize;
+                        if (!triangleBoxOverlap(voxelCenter, voxelHalfSize, triangle.v0, triangle.v1, triangle.v2)) continue;
+
+                        // RGBA8 store with max blending, as in the shader
+                        glm::vec4 color = shade(triangle, voxelCenter);
+                        glm::u8vec4 texel = glm::u8vec4(glm::round(glm::clamp(color, 0.0f, 1.0f) * 255.0f));
+                        glm::ivec3 local = glm::ivec3(x, y, z) - brickMin;
+                        glm::u8vec4& stored = texels[(local.z * BRICK_SIZE + local.y) * BRICK_SIZE + local.x];
+                        stored = glm::max(stored, texel);
+                    }
+                }
+            }
+        }
+    }
+
+    CPUVoxelizer::Volume CPUVoxelizer::voxelize(const Window& window, Stats* stats) const {
+        Stats localStats;
+        Volume volume;
+        volume.window = window;
+        int resolution = window.resolution;
+        volume.levels.emplace_back(static_cast<size_t>(resolution) * resolution * resolution, glm::u8vec4(0));
+
+        BrickBins bins = binTriangles(window, localStats);
+
+        // Bricks are disjoint voxel sets, so they need no synchronization
+        auto voxelizeStart = std::chrono::high_resolution_clock::now();
+        auto& level0 = volume.levels[0];
+        ThreadPool::getInstance().parallelFor(0, bins.occupiedBricks.size(), 1, [&](size_t begin, size_t end) {
+            glm::u8vec4 texels[BRICK_SIZE * BRICK_SIZE * BRICK_SIZE];
+            for (size_t i = begin; i < end; i++) {
+                uint32_t brick = bins.occupiedBricks[i];
+                std::fill(std::begin(texels), std::end(texels), glm::u8vec4(0));
+                voxelizeBrick(window, bins, brick, texels);
+
+                // Scatter into the toroidal texture layout
+                glm::ivec3 brickMin = glm::ivec3(brick % bins.bricksPerAxis, (brick / bins.bricksPerAxis) % bins.bricksPerAxis,
+                                                 brick / (bins.bricksPerAxis * bins.bricksPerAxis)) * BRICK_SIZE;
+                glm::ivec3 brickEnd = glm::min(brickMin + BRICK_SIZE, glm::ivec3(resolution));
+                for (int z = brickMin.z; z < brickEnd.z; z++) {
+                    for (int y = brickMin.y; y < brickEnd.y; y++) {
+                        for (int x = brickMin.x; x < brickEnd.x; x++) {
+                            glm::ivec3 local = glm::ivec3(x, y, z) - brickMin;
+                            level0[texelIndex(window.origin + glm::ivec3(x, y, z), resolution)] = texels[(local.z * BRICK_SIZE + local.y) * BRICK_SIZE + local.x];
+                        }
+                    }
+                }
+            }
+        });
+        localStats.voxelizeMs = elapsedMs(voxelizeStart);
+
+        auto mipStart = std::chrono::high_resolution_clock::now();
+        generateMips(volume);
+        localStats.mipMs = elapsedMs(mipStart);
+
+        if (stats) *stats = localStats;
+        return volume;
+    }
+
+    void CPUVoxelizer::voxelizeSparse(const Window& window, SparseVoxelVolume& volume, Stats* stats) const {
+        Stats localStats;
+        volume.reset(window.origin, window.resolution, window.voxelSize);
+
+        BrickBins bins = binTriangles(window, localStats);
+
+        // A triangle overlapping a brick overlaps at least one of its voxels, so every binned
+        // brick ends up occupied and can be allocated up front
+        auto voxelizeStart = std::chrono::high_resolution_clock::now();
+        std::vector<uint32_t> poolIndices(bins.occupiedBricks.size());
+        for (size_t i = 0; i < bins.occupiedBricks.size(); i++) {
+            uint32_t brick = bins.occupiedBricks[i];
+            poolIndices[i] = volume.allocateBrick(glm::ivec3(brick % bins.bricksPerAxis, (brick / bins.bricksPerAxis) % bins.bricksPerAxis,
+                                                             brick / (bins.bricksPerAxis * bins.bricksPerAxis)));
+        }
+        ThreadPool::getInstance().parallelFor(0, bins.occupiedBricks.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                voxelizeBrick(window, bins, bins.occupiedBricks[i], volume.getBrickTexels(poolIndices[i]));
+            }
+        });
+        localStats.voxelizeMs = elapsedMs(voxelizeStart);
+
+        auto mipStart = std::chrono::high_resolution_clock::now();
+        volume.generateMips();
+        localStats.mipMs = elapsedMs(mipStart);
+
+        if (stats) *stats = localStats;
+    }
+
+    void CPUVoxelizer::generateMips(Volume& volume) {
+        // 2x2x2 box filter over texels like glGenerateMipmap; the toroidal layout keeps voxel blocks
+        // aligned since the resolution is a power of two
+        volume.levels.resize(1);
+        int levelResolution = volume.window.resolution;
+        while (levelResolution > 1) {
+            int parentResolution = levelResolution;
+            levelResolution /= 2;
+            const auto& parent = volume.levels.back();
+            std::vector<glm::u8vec4> level(static_cast<size_t>(levelResolution) * levelResolution * levelResolution);
+
+            ThreadPool::getInstance().parallelFor(0, static_cast<size_t>(levelResolution), 1, [&](size_t zBegin, size_t zEnd) {
+                for (int z = static_cast<int>(zBegin); z < static_cast<int>(zEnd); z++) {
+                    for (int y = 0; y < levelResolution; y++) {
+                        for (int x = 0; x < levelResolution; x++) {
+                            glm::vec4 sum(0.0f);
+                            for (int corner = 0; corner < 8; corner++) {
+                                int px = 2 * x + (corner & 1), py = 2 * y + ((corner >> 1) & 1), pz = 2 * z + (corner >> 2);
+                                sum += glm::vec4(parent[(static_cast<size_t>(pz) * parentResolution + py) * parentResolution + px]);
+                            }
+                            level[(static_cast<size_t>(z) * levelResolution + y) * levelResolution + x] = glm::u8vec4(glm::round(sum / 8.0f));
+                        }
+                    }
+                }
+            });
+            volume.levels.push_back(std::move(level));
+        }
+    }
+
+    CPUVoxelizer::Comparison CPUVoxelizer::compare(const Volume& first, const Volume& second) {
+        Comparison comparison;
+        if (first.levels.empty() || second.levels.empty() || first.levels[0].size() != second.levels[0].size()) return comparison;
+
+        uint64_t differenceSum = 0;
+        const auto& a = first.levels[0];
+        const auto& b = second.levels[0];
+        for (size_t i = 0; i < a.size(); i++) {
+            bool inFirst = a[i].a > 0, inSecond = b[i].a > 0;
+            if (inFirst && inSecond) {
+                comparison.occupiedInBoth++;
+                int difference = 0;
+                for (int channel = 0; channel < 4; channel++) {
+                    difference = std::max(difference, std::abs(static_cast<int>(a[i][channel]) - static_cast<int>(b[i][channel])));
+                }
+                comparison.maxColorDifference = std::max(comparison.maxColorDifference, difference);
+                differenceSum += difference;
+            } else if (inFirst) {
+                comparison.onlyInFirst++;
+            } else if (inSecond) {
+                comparison.onlyInSecond++;
+            }
+        }
+        if (comparison.occupiedInBoth > 0) {
+            comparison.averageColorDifference = static_cast<double>(differenceSum) / comparison.occupiedInBoth;
+        }
+        return comparison;
+    }
+
+}
@@ -1,7 +1,12 @@
 #include "../../headers/Engine/OctreePointCloudManager.h"
+#include "../../headers/Engine/ThreadPool.h"
+#include "../../headers/Engine/PointCloudCodec.h"
 #include <iostream>
 #include <algorithm>
 #include <random>
+#include <limits>
+#include <cmath>
+#include <emmintrin.h>
 
 namespace Engine {
 
@@ -11,7 +16,7 @@ namespace Engine {
     std::mutex OctreePointCloudManager::s_queueMutex;
     std::condition_variable OctreePointCloudManager::s_queueCondition;
     std::atomic<bool> OctreePointCloudManager::s_shutdownRequested{false};
-    std::vector<std::future<bool>> OctreePointCloudManager::s_completedTasks;
+    std::unordered_map<PointCloudOctreeNode*, std::shared_future<bool>> OctreePointCloudManager::s_pendingLoads;
     std::mutex OctreePointCloudManager::s_completedMutex;
     std::mutex OctreePointCloudManager::s_hdf5Mutex;
 
@@ -60,10 +65,10 @@ namespace Engine {
             if (hasTask && task.node) {
                 try {
                     // Perform the actual disk loading
-                    loadNodeFromHDF5(task.node, task.node->diskFilePath);
-                    task.node->isLoaded = true;
-                    task.node->memoryUsage = task.node->points.size() * sizeof(PointCloudPoint);
+                    // Published last, so readers that see isLoaded also see the points
+                    loadNodeData(task.node);
                     markNodeAccessed(task.node);
+                    task.node->isLoaded = true;
                     
                     task.promise.set_value(true);
                 } catch (const std::exception& e) {
@@ -73,32 +78,46 @@ namespace Engine {
         }
     }
 
-    void OctreePointCloudManager::requestAsyncLoad(PointCloudOctreeNode* node, const std::string& cacheDirectory) {
+    std::shared_future<bool> OctreePointCloudManager::requestAsyncLoad(PointCloudOctreeNode* node, const std::string& cacheDirectory) {
         if (!node || !node->isOnDisk || node->isLoaded || s_workerThreads.empty()) {
-            return;
+            return std::shared_future<bool>();
+        }
+        
+        {
+            // Reuse the in-flight load if this node is already queued. A finished entry for a node
+            // that is not loaded is stale (it failed, or the node was evicted since), so load again.
+            std::lock_guard<std::mutex> lock(s_completedMutex);
+            auto pending = s_pendingLoads.find(node);
+            if (pending != s_pendingLoads.end()) {
+                if (pending->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    return pending->second;
+                }
+                s_pendingLoads.erase(pending);
+            }
         }
         
         if (node->diskFilePath.empty() || !std::filesystem::exists(node->diskFilePath)) {
-            return;
+            return std::shared_future<bool>();
         }
         
         OctreePointCloudManager::LoadingTask task;
         task.node = node;
         task.cacheDirectory = cacheDirectory;
         
-        auto future = task.promise.get_future();
+        std::shared_future<bool> future = task.promise.get_future().share();
         
         {
-            std::lock_guard<std::mutex> lock(s_queueMutex);
-            s_loadingQueue.push(std::move(task));
+            std::lock_guard<std::mutex> lock(s_completedMutex);
+            s_pendingLoads[node] = future;
         }
         
         {
-            std::lock_guard<std::mutex> lock(s_completedMutex);
-            s_completedTasks.push_back(std::move(future));
+            std::lock_guard<std::mutex> lock(s_queueMutex);
+            s_loadingQueue.push(std::move(task));
         }
         
         s_queueCondition.notify_one();
+        return future;
     }
 
     void OctreePointCloudManager::processCompletedLoads() {
@@ -109,11 +128,10 @@ namespace Engine {
         
         std::lock_guard<std::mutex> lock(s_completedMutex);
         
-        auto it = s_completedTasks.begin();
-        while (it != s_completedTasks.end()) {
-            if (it->wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-                bool success = it->get();
-                it = s_completedTasks.erase(it);
+        auto it = s_pendingLoads.begin();
+        while (it != s_pendingLoads.end()) {
+            if (it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                it = s_pendingLoads.erase(it);
             } else {
                 ++it;
             }
@@ -129,8 +147,8 @@ namespace Engine {
         size_t rawPointsMemoryMB = (pointCloud.points.size() * sizeof(PointCloudPoint)) / (1024 * 1024);
         if (rawPointsMemoryMB > pointCloud.chunkCache.maxMemoryMB * 0.9f) {
             // For very large point clouds, we need extremely aggressive memory management
-            // Reduce max points per node to create more, smaller chunks
-            pointCloud.maxPointsPerNode = std::min(pointCloud.maxPointsPerNode, size_t(1000));
+            // Reduce the leaf size to create more, smaller chunks
+            pointCloud.maxLeafBytes = std::min(pointCloud.maxLeafBytes, size_t(1000) * sizeof(PointCloudPoint));
         }
 
         // Calculate bounds
@@ -144,11 +162,8 @@ namespace Engine {
         createCacheDirectory(pointCloud.chunkCache.cacheDirectory);
 
         // Initialize build context
-        BuildContext context;
-        context.nextNodeId = 1;
-        context.cacheDirectory = pointCloud.chunkCache.cacheDirectory;
-        context.maxPointsPerNode = pointCloud.maxPointsPerNode;
-        context.maxDepth = pointCloud.maxOctreeDepth;
+        pointCloud.nextNodeId = 1;
+        BuildContext context = makeBuildContext(pointCloud);
 
         // Create root node
         pointCloud.octreeRoot = std::make_unique<PointCloudOctreeNode>();
@@ -173,6 +188,10 @@ namespace Engine {
             pointCloud
         );
 
+        pointCloud.nextNodeId = context.nextNodeId;
+
+        printLeafHistogram(computeLeafHistogram(pointCloud), pointCloud.name);
+
         // Final memory check and cleanup after build
         ensureMemoryLimit(pointCloud);
         
@@ -193,6 +212,14 @@ namespace Engine {
     ) {
         node->totalPointCount = pointIndices.size();
         
+        glm::vec3 pointsMin(std::numeric_limits<float>::max());
+        glm::vec3 pointsMax(-std::numeric_limits<float>::max());
+        for (size_t idx : pointIndices) {
+            pointsMin = glm::min(pointsMin, points[idx].position);
+            pointsMax = glm::max(pointsMax, points[idx].position);
+        }
+        node->spacing = estimatePointSpacing(pointsMin, pointsMax, pointIndices.size());
+        
         // Check memory usage before processing this node
         size_t currentMemoryMB = getMemoryUsage(pointCloud) / (1024 * 1024);
         if (currentMemoryMB > pointCloud.chunkCache.maxMemoryMB * 0.8f) { // Use 80% threshold
@@ -201,7 +228,7 @@ namespace Engine {
         }
         
         // Check if we should create a leaf node
-        if (pointIndices.size() <= context.maxPointsPerNode || depth >= context.maxDepth) {
+        if (!shouldSplitNode(pointIndices.size(), bounds, node->spacing, depth, context)) {
             // Create leaf node
             node->isLeaf = true;
             node->points.reserve(pointIndices.size());
@@ -212,13 +239,14 @@ namespace Engine {
             
             // Generate LOD levels for this node
             generateLODForNode(node);
+            generateLODSamples(node);
             
             // Calculate memory usage
             node->memoryUsage = node->points.size() * sizeof(PointCloudPoint);
             node->isLoaded = true;
             
             // Save ALL nodes to disk IMMEDIATELY during build
-            saveToDisk(node, context.cacheDirectory);
+            saveToDisk(node, context.cacheDirectory, context.codec);
             
             // ALWAYS unload from memory after saving during build to prevent overflow
             if (node->isOnDisk) {
@@ -273,6 +301,101 @@ namespace Engine {
                 }
             }
         }
+        
+        // Internal nodes keep a subset of their children's samples
+        updateInternalNode(node);
+    }
+
+    float OctreePointCloudManager::estimatePointSpacing(const glm::vec3& pointsMin, const glm::vec3& pointsMax, size_t pointCount) {
+        if (pointCount < 2) return 0.0f;
+
+        // Scans are mostly surfaces: spread the points over the two largest extents of their bounds.
+        // For volumetric data this underestimates the spacing, which only allows more splits.
+        glm::vec3 extent = glm::max(pointsMax - pointsMin, glm::vec3(0.0f));
+        float largest = std::max({ extent.x, extent.y, extent.z });
+        float smallest = std::min({ extent.x, extent.y, extent.z });
+        float middle = extent.x + extent.y + extent.z - largest - smallest;
+        float area = largest * std::max(middle, largest * 1e-3f);
+        return std::sqrt(area / static_cast<float>(pointCount));
+    }
+
+    bool OctreePointCloudManager::shouldSplitNode(size_t pointCount, const glm::vec3& bounds, float spacing,
+                                                  int depth, const BuildContext& context) {
+        if (pointCount <= context.maxLeafPoints || depth >= context.maxDepth) {
+            return false;
+        }
+
+        // Children narrower than the local spacing (or float precision) would not separate the points
+        float childSize = std::max({ bounds.x, bounds.y, bounds.z });
+        return childSize > std::max(spacing, context.minCellSize);
+    }
+
+    void OctreePointCloudManager::updateInternalNode(PointCloudOctreeNode* node) {
+        node->totalPointCount = 0;
+        node->spacing = std::numeric_limits<float>::max();
+        for (auto& child : node->children) {
+            if (child && child->totalPointCount > 0) {
+                node->totalPointCount += child->totalPointCount;
+                node->spacing = std::min(node->spacing, child->spacing);
+            }
+        }
+        if (node->totalPointCount == 0) {
+            node->spacing = 0.0f;
+        }
+        generateLODSamples(node);
+    }
+
+    OctreeLeafHistogram OctreePointCloudManager::computeLeafHistogram(const PointCloud& pointCloud) {
+        OctreeLeafHistogram histogram;
+        if (!pointCloud.octreeRoot) {
+            return histogram;
+        }
+
+        size_t totalBytes = 0;
+        std::vector<const PointCloudOctreeNode*> stack = { pointCloud.octreeRoot.get() };
+        while (!stack.empty()) {
+            const PointCloudOctreeNode* node = stack.back();
+            stack.pop_back();
+
+            if (!node->isLeaf) {
+                for (const auto& child : node->children) {
+                    if (child) stack.push_back(child.get());
+                }
+                continue;
+            }
+            if (node->totalPointCount == 0) continue;
+
+            size_t bytes = node->totalPointCount * sizeof(PointCloudPoint);
+            int bucket = 0;
+            while (bucket + 1 < OctreeLeafHistogram::BUCKET_COUNT &&
+                   bytes >= (OctreeLeafHistogram::FIRST_BUCKET_BYTES << (bucket + 1))) {
+                bucket++;
+            }
+            histogram.leafCounts[bucket]++;
+
+            histogram.leafCount++;
+            histogram.minLeafBytes = histogram.leafCount == 1 ? bytes : std::min(histogram.minLeafBytes, bytes);
+            histogram.maxLeafBytes = std::max(histogram.maxLeafBytes, bytes);
+            histogram.maxDepth = std::max(histogram.maxDepth, node->depth);
+            totalBytes += bytes;
+        }
+
+        if (histogram.leafCount > 0) {
+            histogram.meanLeafBytes = static_cast<double>(totalBytes) / histogram.leafCount;
+        }
+        return histogram;
+    }
+
+    void OctreePointCloudManager::printLeafHistogram(const OctreeLeafHistogram& histogram, const std::string& name) {
+        std::cout << "Octree leaves for " << name << ": " << histogram.leafCount << " leaves, depth " << histogram.maxDepth
+                  << ", size " << histogram.minLeafBytes / 1024 << "-" << histogram.maxLeafBytes / 1024
+                  << " KB (mean " << static_cast<size_t>(histogram.meanLeafBytes / 1024) << " KB)" << std::endl;
+
+        for (int i = 0; i < OctreeLeafHistogram::BUCKET_COUNT; i++) {
+            if (histogram.leafCounts[i] == 0) continue;
+            std::cout << "  " << (i == 0 ? 0 : (OctreeLeafHistogram::FIRST_BUCKET_BYTES << i) / 1024) << " KB+: "
+                      << histogram.leafCounts[i] << std::endl;
+        }
     }
 
     void OctreePointCloudManager::generateLODForNode(PointCloudOctreeNode* node) {
@@ -333,6 +456,31 @@ namespace Engine {
         }
     }
 
+    void OctreePointCloudManager::generateLODSamples(PointCloudOctreeNode* node) {
+        std::vector<PointCloudPoint> source;
+        const std::vector<PointCloudPoint>* candidates = &node->points;
+        
+        if (!node->isLeaf) {
+            for (auto& child : node->children) {
+                if (child) {
+                    source.insert(source.end(), child->lodSamples.begin(), child->lodSamples.end());
+                }
+            }
+            candidates = &source;
+        }
+        
+        node->lodSamples.clear();
+        if (candidates->empty()) return;
+        
+        // Evenly strided subset so the samples cover the whole node
+        size_t sampleCount = std::min(candidates->size(), LOD_SAMPLES_PER_NODE);
+        double stride = static_cast<double>(candidates->size()) / sampleCount;
+        node->lodSamples.reserve(sampleCount);
+        for (size_t i = 0; i < sampleCount; i++) {
+            node->lodSamples.push_back((*candidates)[static_cast<size_t>(i * stride)]);
+        }
+    }
+
     void OctreePointCloudManager::createVBOsForNode(PointCloudOctreeNode* node) {
         if (node->vbosGenerated || node->points.empty()) return;
 
@@ -695,15 +843,26 @@ namespace Engine {
         node->lastAccessed = std::chrono::steady_clock::now();
     }
 
-    void OctreePointCloudManager::saveToDisk(PointCloudOctreeNode* node, const std::string& cacheDir) {
+    void OctreePointCloudManager::saveToDisk(PointCloudOctreeNode* node, const std::string& cacheDir, NodeCodecType codec) {
         if (node->points.empty()) return;
 
         try {
-            std::string filePath = getNodeFilePath(cacheDir, node->nodeId);
-            saveNodeToHDF5(node, filePath);
+            std::string filePath = getNodeFilePath(cacheDir, node->nodeId, codec);
+            if (codec == NodeCodecType::Raw) {
+                saveNodeToHDF5(node, filePath);
+            } else if (!NodeCodec::writeFile(filePath, codec, node->points)) {
+                throw std::runtime_error("could not write " + filePath);
+            }
+            
+            // A rewrite with a different codec leaves the old file behind
+            if (node->isOnDisk && node->diskFilePath != filePath) {
+                std::error_code ec;
+                std::filesystem::remove(node->diskFilePath, ec);
+            }
             
             node->isOnDisk = true;
             node->diskFilePath = filePath;
+            node->diskCodec = codec;
             
             // Can unload from memory after saving to disk
             // node->points.clear(); // Uncomment to free memory immediately
@@ -725,7 +884,7 @@ namespace Engine {
 
         try {
             std::cout << "[DEBUG] Loading node " << node->nodeId << " from file: " << node->diskFilePath << std::endl;
-            loadNodeFromHDF5(node, node->diskFilePath);
+            loadNodeData(node);
             node->isLoaded = true;
             markNodeAccessed(node);
             std::cout << "[DEBUG] Successfully loaded node " << node->nodeId << " from disk with " << node->points.size() << " points" << std::endl;
@@ -743,8 +902,18 @@ namespace Engine {
         }
     }
 
-    std::string OctreePointCloudManager::getNodeFilePath(const std::string& cacheDir, uint64_t nodeId) {
-        return cacheDir + "/node_" + std::to_string(nodeId) + ".h5";
+    std::string OctreePointCloudManager::getNodeFilePath(const std::string& cacheDir, uint64_t nodeId, NodeCodecType codec) {
+        return cacheDir + "/node_" + std::to_string(nodeId) + (codec == NodeCodecType::Raw ? ".h5" : ".pcn");
+    }
+
+    void OctreePointCloudManager::loadNodeData(PointCloudOctreeNode* node) {
+        if (node->diskCodec == NodeCodecType::Raw) {
+            loadNodeFromHDF5(node, node->diskFilePath);
+        } else if (!NodeCodec::readFile(node->diskFilePath, node->points)) {
+            // Same contract as the HDF5 path - leave the node empty on failure
+            node->points.clear();
+        }
+        node->memoryUsage = node->points.size() * sizeof(PointCloudPoint);
     }
 
     void OctreePointCloudManager::saveNodeToHDF5(const PointCloudOctreeNode* node, const std::string& filePath) {
@@ -814,6 +983,44 @@ namespace Engine {
         }
     }
 
+    std::vector<NodeCodecBenchmark> OctreePointCloudManager::benchmarkCodecs(PointCloud& pointCloud, size_t maxLeaves) {
+        if (!pointCloud.octreeRoot || maxLeaves == 0) {
+            return {};
+        }
+
+        std::vector<PointCloudOctreeNode*> leaves;
+        collectCandidateLeaves(pointCloud.octreeRoot.get(), [](const PointCloudOctreeNode*) { return true; }, leaves);
+
+        // Spread the sample over the whole cloud
+        std::vector<std::vector<PointCloudPoint>> blocks;
+        double stride = std::max(1.0, static_cast<double>(leaves.size()) / maxLeaves);
+        for (double i = 0.0; i < leaves.size() && blocks.size() < maxLeaves; i += stride) {
+            PointCloudOctreeNode* leaf = leaves[static_cast<size_t>(i)];
+            if (leaf->isLoaded && !leaf->points.empty()) {
+                blocks.push_back(leaf->points);
+            } else if (leaf->isOnDisk) {
+                // Read into a scratch node so the leaf's own state is untouched
+                PointCloudOctreeNode scratch;
+                scratch.diskFilePath = leaf->diskFilePath;
+                scratch.diskCodec = leaf->diskCodec;
+                loadNodeData(&scratch);
+                if (!scratch.points.empty()) {
+                    blocks.push_back(std::move(scratch.points));
+                }
+            }
+        }
+
+        std::vector<NodeCodecBenchmark> results = benchmarkNodeCodecs(blocks);
+
+        std::cout << "Node codec benchmark (" << blocks.size() << " leaves):" << std::endl;
+        for (const auto& result : results) {
+            std::cout << "  " << result.name << ": ratio " << result.ratio
+                      << ", encode " << result.encodeMBps << " MB/s"
+                      << ", decode " << result.decodeGBps << " GB/s" << std::endl;
+        }
+        return results;
+    }
+
     void OctreePointCloudManager::unloadOldestNodes(PointCloud& pointCloud, size_t targetMemoryMB) {
         size_t targetMemoryBytes = targetMemoryMB * 1024 * 1024;
         size_t currentMemory = getMemoryUsage(pointCloud);
@@ -841,7 +1048,7 @@ namespace Engine {
             if (node->isLoaded) {
                 // Save to disk first if not already saved
                 if (!node->isOnDisk) {
-                    saveToDisk(node, pointCloud.chunkCache.cacheDirectory);
+                    saveToDisk(node, pointCloud.chunkCache.cacheDirectory, pointCloud.chunkCache.codec);
                 }
                 
                 // Clean up VBOs
@@ -861,6 +1068,915 @@ namespace Engine {
         std::cout << "Memory after cleanup: " << (getMemoryUsage(pointCloud) / (1024 * 1024)) << "MB" << std::endl;
     }
 
+    // ---- Spatial queries ----
+
+    namespace {
+        // Tests every point of the given leaves on the shared pool (one task per leaf)
+        template<typename PointTest>
+        void scanLeavesParallel(const std::vector<PointCloudOctreeNode*>& leaves, PointQueryResult& result, const PointTest& test) {
+            std::vector<std::vector<PointQueryHit>> leafHits(leaves.size());
+
+            ThreadPool::getInstance().parallelFor(0, leaves.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    const PointCloudOctreeNode* leaf = leaves[i];
+                    auto& hits = leafHits[i];
+                    for (const auto& point : leaf->points) {
+                        float distance;
+                        if (test(point, distance)) {
+                            hits.push_back({ point, distance, leaf->nodeId });
+                        }
+                    }
+                }
+            });
+
+            size_t totalHits = result.hits.size();
+            for (const auto& hits : leafHits) {
+                totalHits += hits.size();
+            }
+            result.hits.reserve(totalHits);
+            for (const auto& hits : leafHits) {
+                result.hits.insert(result.hits.end(), hits.begin(), hits.end());
+            }
+            result.nodesVisited += leaves.size();
+        }
+
+        bool closerHit(const PointQueryHit& a, const PointQueryHit& b) {
+            return a.distance < b.distance;
+        }
+
+        // Sorts front to back and applies the result cap
+        void finalizeHits(PointQueryResult& result, size_t maxResults, bool alwaysSort) {
+            if (maxResults > 0 && result.hits.size() > maxResults) {
+                std::partial_sort(result.hits.begin(), result.hits.begin() + maxResults, result.hits.end(), closerHit);
+                result.hits.resize(maxResults);
+            } else if (alwaysSort) {
+                std::sort(result.hits.begin(), result.hits.end(), closerHit);
+            }
+        }
+
+        float boxDistanceSquared(const PointCloudOctreeNode* node, const glm::vec3& point) {
+            glm::vec3 closest = glm::clamp(point, node->center - node->bounds, node->center + node->bounds);
+            glm::vec3 delta = point - closest;
+            return glm::dot(delta, delta);
+        }
+    }
+
+    void OctreePointCloudManager::collectCandidateLeaves(PointCloudOctreeNode* node, const NodeFilter& filter,
+                                                        std::vector<PointCloudOctreeNode*>& leaves) {
+        if (!node || node->totalPointCount == 0 || !filter(node)) {
+            return;
+        }
+
+        if (node->isLeaf) {
+            leaves.push_back(node);
+            return;
+        }
+
+        for (auto& child : node->children) {
+            if (child) {
+                collectCandidateLeaves(child.get(), filter, leaves);
+            }
+        }
+    }
+
+    void OctreePointCloudManager::ensureLeavesResident(PointCloud& pointCloud, std::vector<PointCloudOctreeNode*>& leaves,
+                                                       const PointQueryOptions& options, PointQueryResult& result) {
+        bool waitForAll = options.latencyBudgetMs <= 0.0f;
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::microseconds(static_cast<long long>(std::max(0.0f, options.latencyBudgetMs) * 1000.0f));
+
+        std::vector<char> resident(leaves.size(), 0);
+        std::vector<std::pair<size_t, std::shared_future<bool>>> pendingLoads;
+
+        for (size_t i = 0; i < leaves.size(); ++i) {
+            PointCloudOctreeNode* leaf = leaves[i];
+            if (leaf->isLoaded) {
+                resident[i] = 1;
+                continue;
+            }
+            if (!leaf->isOnDisk || !options.loadMissingNodes) {
+                continue;
+            }
+
+            std::shared_future<bool> future = requestAsyncLoad(leaf, pointCloud.chunkCache.cacheDirectory);
+            if (future.valid()) {
+                pendingLoads.emplace_back(i, future);
+            } else if (s_workerThreads.empty()) {
+                // Async system not running - load on the calling thread instead; a missing or
+                // corrupt cache file leaves the leaf out (the result is reported incomplete)
+                try {
+                    loadNodeData(leaf);
+                    leaf->isLoaded = true;
+                    resident[i] = 1;
+                } catch (const std::exception& e) {
+                    std::cerr << "Failed to load octree node " << leaf->nodeId << " for query: " << e.what() << std::endl;
+                } catch (...) {
+                    // HDF5 exceptions do not derive from std::exception
+                    std::cerr << "Failed to load octree node " << leaf->nodeId << " for query" << std::endl;
+                }
+                if (!resident[i]) {
+                    leaf->points.clear();
+                    leaf->memoryUsage = 0;
+                }
+            }
+        }
+
+        // Wait for the loader threads, but never past the latency budget
+        for (auto& [index, future] : pendingLoads) {
+            bool ready = waitForAll ||
+                future.wait_until(deadline) == std::future_status::ready;
+            // The leaf may have been evicted again since its load finished
+            if (ready && future.get() && leaves[index]->isLoaded) {
+                resident[index] = 1;
+            }
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < leaves.size(); ++i) {
+            if (resident[i]) {
+                markNodeAccessed(leaves[i]);
+                leaves[kept++] = leaves[i];
+            }
+        }
+
+        result.nodesSkipped += leaves.size() - kept;
+        if (kept < leaves.size()) {
+            result.complete = false;
+        }
+        leaves.resize(kept);
+    }
+
+    bool OctreePointCloudManager::rayIntersectsBox(const glm::vec3& origin, const glm::vec3& invDirection,
+                                                  const glm::vec3& boxMin, const glm::vec3& boxMax,
+                                                  float maxDistance, float& tEnter, float& tExit) {
+        // Near and far planes come from the sign bit (as in SimdBVH), and invDirection is finite
+        // (safeInverse), so a zero component with the origin on a slab plane yields 0, not NaN
+        tEnter = 0.0f;
+        tExit = maxDistance;
+        for (int axis = 0; axis < 3; axis++) {
+            bool negative = std::signbit(invDirection[axis]);
+            float nearPlane = negative ? boxMax[axis] : boxMin[axis];
+            float farPlane = negative ? boxMin[axis] : boxMax[axis];
+            tEnter = std::max(tEnter, (nearPlane - origin[axis]) * invDirection[axis]);
+            tExit = std::min(tExit, (farPlane - origin[axis]) * invDirection[axis]);
+        }
+        return tEnter <= tExit;
+    }
+
+    glm::vec3 OctreePointCloudManager::safeInverse(const glm::vec3& direction) {
+        glm::vec3 inverse;
+        for (int axis = 0; axis < 3; axis++) {
+            float d = direction[axis];
+            inverse[axis] = 1.0f / (std::abs(d) > 1e-20f ? d : std::copysign(1e-20f, d));
+        }
+        return inverse;
+    }
+
+    PointQueryResult OctreePointCloudManager::queryBox(PointCloud& pointCloud, const glm::vec3& boxMin, const glm::vec3& boxMax,
+                                                       const PointQueryOptions& options) {
+        PointQueryResult result;
+        if (!pointCloud.octreeRoot) {
+            return result;
+        }
+
+        std::vector<PointCloudOctreeNode*> leaves;
+        collectCandidateLeaves(pointCloud.octreeRoot.get(), [&](const PointCloudOctreeNode* node) {
+            glm::vec3 nodeMin = node->center - node->bounds;
+            glm::vec3 nodeMax = node->center + node->bounds;
+            return glm::all(glm::lessThanEqual(nodeMin, boxMax)) && glm::all(glm::greaterThanEqual(nodeMax, boxMin));
+        }, leaves);
+
+        ensureLeavesResident(pointCloud, leaves, options, result);
+
+        glm::vec3 boxCenter = (boxMin + boxMax) * 0.5f;
+        scanLeavesParallel(leaves, result, [&](const PointCloudPoint& point, float& distance) {
+            if (glm::any(glm::lessThan(point.position, boxMin)) || glm::any(glm::greaterThan(point.position, boxMax))) {
+                return false;
+            }
+            distance = glm::length(point.position - boxCenter);
+            return true;
+        });
+
+        finalizeHits(result, options.maxResults, false);
+        return result;
+    }
+
+    PointQueryResult OctreePointCloudManager::queryRadius(PointCloud& pointCloud, const glm::vec3& center, float radius,
+                                                          const PointQueryOptions& options) {
+        PointQueryResult result;
+        if (!pointCloud.octreeRoot || radius < 0.0f) {
+            return result;
+        }
+
+        float radiusSquared = radius * radius;
+
+        std::vector<PointCloudOctreeNode*> leaves;
+        collectCandidateLeaves(pointCloud.octreeRoot.get(), [&](const PointCloudOctreeNode* node) {
+            return boxDistanceSquared(node, center) <= radiusSquared;
+        }, leaves);
+
+        ensureLeavesResident(pointCloud, leaves, options, result);
+
+        scanLeavesParallel(leaves, result, [&](const PointCloudPoint& point, float& distance) {
+            glm::vec3 delta = point.position - center;
+            float distanceSquared = glm::dot(delta, delta);
+            if (distanceSquared > radiusSquared) {
+                return false;
+            }
+            distance = std::sqrt(distanceSquared);
+            return true;
+        });
+
+        finalizeHits(result, options.maxResults, false);
+        return result;
+    }
+
+    PointQueryResult OctreePointCloudManager::queryKNearest(PointCloud& pointCloud, const glm::vec3& center, size_t k,
+                                                            const PointQueryOptions& options) {
+        PointQueryResult result;
+        if (!pointCloud.octreeRoot || k == 0) {
+            return result;
+        }
+
+        // Best-first traversal ordered by squared box distance. Leaves are gathered into batches
+        // that are loaded and scanned in parallel; the running k-th distance prunes the frontier.
+        using FrontierEntry = std::pair<float, PointCloudOctreeNode*>;
+        auto fartherFirst = [](const FrontierEntry& a, const FrontierEntry& b) { return a.first > b.first; };
+        std::priority_queue<FrontierEntry, std::vector<FrontierEntry>, decltype(fartherFirst)> frontier(fartherFirst);
+        frontier.push({ boxDistanceSquared(pointCloud.octreeRoot.get(), center), pointCloud.octreeRoot.get() });
+
+        // Max-heap of the best k hits found so far (distance holds the squared distance until the end)
+        std::vector<PointQueryHit> best;
+        best.reserve(k);
+
+        auto kthDistance = [&]() {
+            return best.size() < k ? std::numeric_limits<float>::max() : best.front().distance;
+        };
+
+        const size_t batchSize = std::max<size_t>(4, ThreadPool::getInstance().getThreadCount() * 2);
+        std::vector<PointCloudOctreeNode*> batch;
+
+        auto processBatch = [&]() {
+            ensureLeavesResident(pointCloud, batch, options, result);
+
+            float bound = kthDistance();
+            std::vector<std::vector<PointQueryHit>> leafBest(batch.size());
+
+            ThreadPool::getInstance().parallelFor(0, batch.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    const PointCloudOctreeNode* leaf = batch[i];
+                    auto& candidates = leafBest[i];
+                    for (const auto& point : leaf->points) {
+                        glm::vec3 delta = point.position - center;
+                        float distanceSquared = glm::dot(delta, delta);
+                        if (distanceSquared <= bound) {
+                            candidates.push_back({ point, distanceSquared, leaf->nodeId });
+                        }
+                    }
+                    if (candidates.size() > k) {
+                        std::nth_element(candidates.begin(), candidates.begin() + k, candidates.end(), closerHit);
+                        candidates.resize(k);
+                    }
+                }
+            });
+
+            for (const auto& candidates : leafBest) {
+                for (const auto& hit : candidates) {
+                    if (best.size() < k) {
+                        best.push_back(hit);
+                        std::push_heap(best.begin(), best.end(), closerHit);
+                    } else if (hit.distance < best.front().distance) {
+                        std::pop_heap(best.begin(), best.end(), closerHit);
+                        best.back() = hit;
+                        std::push_heap(best.begin(), best.end(), closerHit);
+                    }
+                }
+            }
+
+            result.nodesVisited += batch.size();
+            batch.clear();
+        };
+
+        while (!frontier.empty()) {
+            auto [distanceSquared, node] = frontier.top();
+            if (distanceSquared > kthDistance()) {
+                break;
+            }
+            frontier.pop();
+
+            if (!node->isLeaf) {
+                for (auto& child : node->children) {
+                    if (child && child->totalPointCount > 0) {
+                        frontier.push({ boxDistanceSquared(child.get(), center), child.get() });
+                    }
+                }
+                continue;
+            }
+
+            batch.push_back(node);
+            if (batch.size() >= batchSize) {
+                processBatch();
+            }
+        }
+
+        if (!batch.empty()) {
+            processBatch();
+        }
+
+        std::sort_heap(best.begin(), best.end(), closerHit);
+        for (auto& hit : best) {
+            hit.distance = std::sqrt(hit.distance);
+        }
+        result.hits = std::move(best);
+        return result;
+    }
+
+    PointQueryResult OctreePointCloudManager::queryRay(PointCloud& pointCloud, const glm::vec3& origin, const glm::vec3& direction,
+                                                       float maxDistance, float coneHalfAngle, float baseRadius,
+                                                       const PointQueryOptions& options) {
+        PointQueryResult result;
+        if (!pointCloud.octreeRoot || glm::length(direction) <= 0.0f) {
+            return result;
+        }
+
+        glm::vec3 rayDirection = glm::normalize(direction);
+        glm::vec3 invDirection = safeInverse(rayDirection);
+        float coneSlope = std::tan(std::clamp(coneHalfAngle, 0.0f, 1.5f));
+        auto radiusAt = [&](float t) { return baseRadius + t * coneSlope; };
+
+        std::vector<PointCloudOctreeNode*> leaves;
+        collectCandidateLeaves(pointCloud.octreeRoot.get(), [&](const PointCloudOctreeNode* node) {
+            float tEnter, tExit;
+            glm::vec3 looseMargin(radiusAt(maxDistance));
+            if (!rayIntersectsBox(origin, invDirection, node->center - node->bounds - looseMargin,
+                                  node->center + node->bounds + looseMargin, maxDistance, tEnter, tExit)) {
+                return false;
+            }
+            // The cone cannot be wider inside this box than at the loose exit point
+            glm::vec3 tightMargin(radiusAt(tExit));
+            return rayIntersectsBox(origin, invDirection, node->center - node->bounds - tightMargin,
+                                    node->center + node->bounds + tightMargin, maxDistance, tEnter, tExit);
+        }, leaves);
+
+        ensureLeavesResident(pointCloud, leaves, options, result);
+
+        scanLeavesParallel(leaves, result, [&](const PointCloudPoint& point, float& distance) {
+            glm::vec3 toPoint = point.position - origin;
+            float t = glm::dot(toPoint, rayDirection);
+            if (t < 0.0f || t > maxDistance) {
+                return false;
+            }
+            glm::vec3 perpendicular = toPoint - rayDirection * t;
+            float radius = radiusAt(t);
+            if (glm::dot(perpendicular, perpendicular) > radius * radius) {
+                return false;
+            }
+            distance = t;
+            return true;
+        });
+
+        finalizeHits(result, options.maxResults, true);
+        return result;
+    }
+
+    // ---- Picking ----
+
+    glm::mat4 OctreePointCloudManager::getModelMatrix(const PointCloud& pointCloud) {
+        glm::mat4 modelMatrix = glm::mat4(1.0f);
+        modelMatrix = glm::translate(modelMatrix, pointCloud.position);
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(pointCloud.rotation.x), glm::vec3(1, 0, 0));
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(pointCloud.rotation.y), glm::vec3(0, 1, 0));
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(pointCloud.rotation.z), glm::vec3(0, 0, 1));
+        modelMatrix = glm::scale(modelMatrix, pointCloud.scale);
+        return modelMatrix;
+    }
+
+    PointPickResult OctreePointCloudManager::pickPoint(const PointCloud& pointCloud, const glm::vec3& rayOrigin,
+                                                       const glm::vec3& rayDirection, float angularTolerance, float maxDistance) {
+        PointPickResult result;
+        if (!pointCloud.octreeRoot || glm::length(rayDirection) <= 0.0f) {
+            return result;
+        }
+
+        // Move the ray into octree space; the cone angle is kept as-is (exact for uniform scale)
+        glm::mat4 modelMatrix = getModelMatrix(pointCloud);
+        glm::mat4 invModelMatrix = glm::inverse(modelMatrix);
+        glm::vec3 localOrigin = glm::vec3(invModelMatrix * glm::vec4(rayOrigin, 1.0f));
+        glm::vec3 localFar = glm::vec3(invModelMatrix * glm::vec4(rayOrigin + glm::normalize(rayDirection) * maxDistance, 1.0f));
+
+        PickRay ray;
+        ray.origin = localOrigin;
+        ray.direction = localFar - localOrigin;
+        ray.maxDistance = glm::length(ray.direction);
+        if (ray.maxDistance <= 0.0f) {
+            return result;
+        }
+        ray.direction /= ray.maxDistance;
+        ray.invDirection = safeInverse(ray.direction);
+        ray.coneSlope = std::tan(std::clamp(angularTolerance, 0.0f, 1.5f));
+
+        PickState state;
+        state.bestT = ray.maxDistance;
+        state.nodeId = 0;
+        state.fromLODSamples = false;
+
+        pickNodeRecursive(pointCloud.octreeRoot.get(), ray, state);
+
+        if (state.nodeId != 0) {
+            result.hit = true;
+            result.position = glm::vec3(modelMatrix * glm::vec4(state.bestPoint.position, 1.0f));
+            result.distance = glm::length(result.position - rayOrigin);
+            result.nodeId = state.nodeId;
+            result.fromLODSamples = state.fromLODSamples;
+        }
+        return result;
+    }
+
+    void OctreePointCloudManager::pickNodeRecursive(const PointCloudOctreeNode* node, const PickRay& ray, PickState& state) {
+        if (node->isLeaf) {
+            // Resident leaves are tested point by point, everything else through its samples
+            bool useFullData = node->isLoaded && !node->points.empty();
+            const std::vector<PointCloudPoint>& points = useFullData ? node->points : node->lodSamples;
+            if (pickPointsInCone(points, ray, state)) {
+                state.nodeId = node->nodeId;
+                state.fromLODSamples = !useFullData;
+            }
+            return;
+        }
+
+        // Visit children front to back so the first hit prunes the rest
+        std::array<std::pair<float, const PointCloudOctreeNode*>, 8> order;
+        int childCount = 0;
+        for (const auto& child : node->children) {
+            if (!child || child->totalPointCount == 0) continue;
+
+            float tEnter, tExit;
+            glm::vec3 margin(ray.coneSlope * state.bestT);
+            if (rayIntersectsBox(ray.origin, ray.invDirection, child->center - child->bounds - margin,
+                                 child->center + child->bounds + margin, state.bestT, tEnter, tExit)) {
+                order[childCount++] = { tEnter, child.get() };
+            }
+        }
+
+        std::sort(order.begin(), order.begin() + childCount,
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        for (int i = 0; i < childCount; i++) {
+            if (order[i].first > state.bestT) break;
+            pickNodeRecursive(order[i].second, ray, state);
+        }
+    }
+
+    bool OctreePointCloudManager::pickPointsInCone(const std::vector<PointCloudPoint>& points, const PickRay& ray, PickState& state) {
+        bool found = false;
+        size_t count = points.size();
+        size_t i = 0;
+
+        // SSE: test four points per iteration (positions gathered from the AoS layout)
+        const __m128 originX = _mm_set1_ps(ray.origin.x);
+        const __m128 originY = _mm_set1_ps(ray.origin.y);
+        const __m128 originZ = _mm_set1_ps(ray.origin.z);
+        const __m128 dirX = _mm_set1_ps(ray.direction.x);
+        const __m128 dirY = _mm_set1_ps(ray.direction.y);
+        const __m128 dirZ = _mm_set1_ps(ray.direction.z);
+        const __m128 slope = _mm_set1_ps(ray.coneSlope);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (; i + 4 <= count; i += 4) {
+            const PointCloudPoint* p = &points[i];
+            __m128 dx = _mm_sub_ps(_mm_set_ps(p[3].position.x, p[2].position.x, p[1].position.x, p[0].position.x), originX);
+            __m128 dy = _mm_sub_ps(_mm_set_ps(p[3].position.y, p[2].position.y, p[1].position.y, p[0].position.y), originY);
+            __m128 dz = _mm_sub_ps(_mm_set_ps(p[3].position.z, p[2].position.z, p[1].position.z, p[0].position.z), originZ);
+
+            __m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dirX), _mm_mul_ps(dy, dirY)), _mm_mul_ps(dz, dirZ));
+
+            __m128 px = _mm_sub_ps(dx, _mm_mul_ps(dirX, t));
+            __m128 py = _mm_sub_ps(dy, _mm_mul_ps(dirY, t));
+            __m128 pz = _mm_sub_ps(dz, _mm_mul_ps(dirZ, t));
+            __m128 perpSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), _mm_mul_ps(pz, pz));
+
+            __m128 radius = _mm_mul_ps(t, slope);
+            __m128 inside = _mm_and_ps(_mm_cmple_ps(perpSquared, _mm_mul_ps(radius, radius)),
+                            _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmplt_ps(t, _mm_set1_ps(state.bestT))));
+
+            int mask = _mm_movemask_ps(inside);
+            if (mask == 0) continue;
+
+            alignas(16) float tValues[4];
+            _mm_store_ps(tValues, t);
+            for (int lane = 0; lane < 4; lane++) {
+                if ((mask & (1 << lane)) && tValues[lane] < state.bestT) {
+                    state.bestT = tValues[lane];
+                    state.bestPoint = p[lane];
+                    found = true;
+                }
+            }
+        }
+
+        for (; i < count; i++) {
+            glm::vec3 toPoint = points[i].position - ray.origin;
+            float t = glm::dot(toPoint, ray.direction);
+            if (t < 0.0f || t >= state.bestT) continue;
+
+            glm::vec3 perpendicular = toPoint - ray.direction * t;
+            float radius = t * ray.coneSlope;
+            if (glm::dot(perpendicular, perpendicular) <= radius * radius) {
+                state.bestT = t;
+                state.bestPoint = points[i];
+                found = true;
+            }
+        }
+
+        return found;
+    }
+
+    // ---- Incremental updates ----
+
+    OctreePointCloudManager::BuildContext OctreePointCloudManager::makeBuildContext(const PointCloud& pointCloud) {
+        BuildContext context;
+        context.nextNodeId = pointCloud.nextNodeId;
+        context.cacheDirectory = pointCloud.chunkCache.cacheDirectory;
+        context.maxLeafPoints = std::max<size_t>(1, pointCloud.maxLeafBytes / sizeof(PointCloudPoint));
+        context.maxDepth = pointCloud.maxOctreeDepth;
+        context.codec = pointCloud.chunkCache.codec;
+
+        // Below this cell size float positions stop being distinguishable
+        float magnitude = std::max({ pointCloud.octreeSize, std::abs(pointCloud.octreeCenter.x),
+                                     std::abs(pointCloud.octreeCenter.y), std::abs(pointCloud.octreeCenter.z) });
+        context.minCellSize = magnitude * 1e-6f;
+        return context;
+    }
+
+    void OctreePointCloudManager::waitForPendingLoad(PointCloudOctreeNode* node) {
+        std::shared_future<bool> pending;
+        {
+            std::lock_guard<std::mutex> lock(s_completedMutex);
+            auto it = s_pendingLoads.find(node);
+            if (it != s_pendingLoads.end()) {
+                pending = it->second;
+            }
+        }
+
+        if (pending.valid()) {
+            pending.wait();
+
+            // Drop the entry now so a node allocated at the same address never sees it
+            std::lock_guard<std::mutex> lock(s_completedMutex);
+            s_pendingLoads.erase(node);
+        }
+    }
+
+    bool OctreePointCloudManager::ensureNodeResident(PointCloudOctreeNode* node) {
+        waitForPendingLoad(node);
+
+        if (!node->isLoaded && node->isOnDisk) {
+            loadNodeData(node);
+            if (node->points.size() != node->totalPointCount) {
+                std::cerr << "Failed to load node " << node->nodeId << " for update" << std::endl;
+                node->points.clear();
+                return false;
+            }
+            node->isLoaded = true;
+        }
+
+        markNodeAccessed(node);
+        return true;
+    }
+
+    void OctreePointCloudManager::discardNodeData(PointCloudOctreeNode* node) {
+        waitForPendingLoad(node);
+        node->cleanup();
+
+        if (node->isOnDisk && !node->diskFilePath.empty()) {
+            std::error_code ec;
+            std::filesystem::remove(node->diskFilePath, ec);
+        }
+
+        node->points.clear();
+        node->points.shrink_to_fit();
+        node->isOnDisk = false;
+        node->diskFilePath.clear();
+        node->isLoaded = false;
+        node->memoryUsage = 0;
+
+        for (auto& child : node->children) {
+            if (child) {
+                discardNodeData(child.get());
+            }
+        }
+    }
+
+    void OctreePointCloudManager::rewriteLeaf(PointCloudOctreeNode* node, const std::string& cacheDirectory, NodeCodecType codec) {
+        // Old VBOs hold stale subsamples; they are recreated on the next LOD update
+        node->cleanup();
+
+        node->totalPointCount = node->points.size();
+        if (!node->points.empty()) {
+            glm::vec3 pointsMin = node->points[0].position;
+            glm::vec3 pointsMax = node->points[0].position;
+            for (const auto& point : node->points) {
+                pointsMin = glm::min(pointsMin, point.position);
+                pointsMax = glm::max(pointsMax, point.position);
+            }
+            node->spacing = estimatePointSpacing(pointsMin, pointsMax, node->points.size());
+        }
+        generateLODForNode(node);
+        generateLODSamples(node);
+
+        node->memoryUsage = node->points.size() * sizeof(PointCloudPoint);
+        node->isLoaded = true;
+        markNodeAccessed(node);
+
+        // Overwrites the node's cache file
+        saveToDisk(node, cacheDirectory, codec);
+    }
+
+    void OctreePointCloudManager::growRootToFit(PointCloud& pointCloud, const glm::vec3& pointsMin, const glm::vec3& pointsMax) {
+        PointCloudOctreeNode* root = pointCloud.octreeRoot.get();
+
+        // An empty root can simply be moved over the new points
+        if (root->isLeaf && root->totalPointCount == 0) {
+            discardNodeData(root);
+            glm::vec3 extent = pointsMax - pointsMin;
+            float size = std::max({ extent.x, extent.y, extent.z, 0.001f }) * 1.1f;
+            root->center = (pointsMin + pointsMax) * 0.5f;
+            root->bounds = glm::vec3(size * 0.5f);
+        }
+
+        // Double the root towards the new points; the old root becomes one octant of the new one
+        for (int iteration = 0; iteration < 32; iteration++) {
+            PointCloudOctreeNode* current = pointCloud.octreeRoot.get();
+            glm::vec3 rootMin = current->center - current->bounds;
+            glm::vec3 rootMax = current->center + current->bounds;
+            if (glm::all(glm::greaterThanEqual(pointsMin, rootMin)) && glm::all(glm::lessThan(pointsMax, rootMax))) {
+                break;
+            }
+
+            glm::vec3 newCenter = current->center;
+            for (int axis = 0; axis < 3; axis++) {
+                newCenter[axis] += (pointsMin[axis] < rootMin[axis]) ? -current->bounds[axis] : current->bounds[axis];
+            }
+
+            auto newRoot = std::make_unique<PointCloudOctreeNode>();
+            newRoot->nodeId = pointCloud.nextNodeId++;
+            newRoot->depth = 0;
+            newRoot->center = newCenter;
+            newRoot->bounds = current->bounds * 2.0f;
+            newRoot->isLeaf = false;
+            newRoot->totalPointCount = current->totalPointCount;
+
+            int childIndex = OctreeBounds::getChildIndex(current->center, newCenter);
+            newRoot->children[childIndex] = std::move(pointCloud.octreeRoot);
+
+            // Shift depths below the new root; the depth limit moves with them so leaf resolution is kept
+            std::vector<PointCloudOctreeNode*> stack = { newRoot->children[childIndex].get() };
+            while (!stack.empty()) {
+                PointCloudOctreeNode* node = stack.back();
+                stack.pop_back();
+                node->depth++;
+                for (auto& child : node->children) {
+                    if (child) stack.push_back(child.get());
+                }
+            }
+            pointCloud.maxOctreeDepth++;
+
+            updateInternalNode(newRoot.get());
+            pointCloud.octreeRoot = std::move(newRoot);
+        }
+
+        pointCloud.octreeCenter = pointCloud.octreeRoot->center;
+        pointCloud.octreeSize = pointCloud.octreeRoot->bounds.x * 2.0f;
+    }
+
+    void OctreePointCloudManager::insertIntoNode(PointCloudOctreeNode* node, std::vector<PointCloudPoint>& points,
+                                                 BuildContext& context, PointCloud& pointCloud) {
+        if (points.empty()) return;
+
+        if (node->isLeaf) {
+            if (!ensureNodeResident(node)) {
+                std::cerr << "Dropped " << points.size() << " points routed to node " << node->nodeId << std::endl;
+                return;
+            }
+
+            node->points.insert(node->points.end(), points.begin(), points.end());
+            points.clear();
+
+            if (node->points.size() > context.maxLeafPoints) {
+                // Rebuild this subtree from the leaf's points (the split policy decides how far to go)
+                std::vector<PointCloudPoint> nodePoints = std::move(node->points);
+                discardNodeData(node);
+                node->lodSamples.clear();
+
+                std::vector<size_t> indices(nodePoints.size());
+                std::iota(indices.begin(), indices.end(), 0);
+                buildOctreeRecursive(node, nodePoints, indices, node->center, node->bounds,
+                                     node->depth, context, pointCloud);
+            } else {
+                rewriteLeaf(node, context.cacheDirectory, context.codec);
+            }
+            return;
+        }
+
+        // Route the batch to the children, creating octants that were empty so far
+        std::array<std::vector<PointCloudPoint>, 8> childPoints;
+        for (const auto& point : points) {
+            childPoints[OctreeBounds::getChildIndex(point.position, node->center)].push_back(point);
+        }
+        points.clear();
+        points.shrink_to_fit();
+
+        for (int i = 0; i < 8; i++) {
+            if (childPoints[i].empty()) continue;
+
+            if (!node->children[i]) {
+                glm::vec3 childCenter, childBounds;
+                OctreeBounds::getChildBounds(node->center, node->bounds, i, childCenter, childBounds);
+
+                node->children[i] = std::make_unique<PointCloudOctreeNode>();
+                node->children[i]->nodeId = context.nextNodeId++;
+                node->children[i]->depth = node->depth + 1;
+                node->children[i]->center = childCenter;
+                node->children[i]->bounds = childBounds;
+            }
+
+            insertIntoNode(node->children[i].get(), childPoints[i], context, pointCloud);
+        }
+
+        updateInternalNode(node);
+    }
+
+    void OctreePointCloudManager::collapseIntoLeaf(PointCloudOctreeNode* node, PointCloud& pointCloud) {
+        // Gather the remaining points of all descendant leaves
+        std::vector<PointCloudPoint> points;
+        points.reserve(node->totalPointCount);
+
+        std::vector<PointCloudOctreeNode*> stack = { node };
+        while (!stack.empty()) {
+            PointCloudOctreeNode* current = stack.back();
+            stack.pop_back();
+
+            if (current->isLeaf) {
+                if (current != node && current->totalPointCount > 0) {
+                    if (!ensureNodeResident(current)) {
+                        return; // Keep the subtree rather than lose points
+                    }
+                    points.insert(points.end(), current->points.begin(), current->points.end());
+                }
+                continue;
+            }
+
+            for (auto& child : current->children) {
+                if (child) stack.push_back(child.get());
+            }
+        }
+
+        for (auto& child : node->children) {
+            if (child) {
+                discardNodeData(child.get());
+                child.reset();
+            }
+        }
+
+        node->isLeaf = true;
+        node->points = std::move(points);
+        if (node->points.empty()) {
+            node->totalPointCount = 0;
+            node->lodSamples.clear();
+            return;
+        }
+        rewriteLeaf(node, pointCloud.chunkCache.cacheDirectory, pointCloud.chunkCache.codec);
+    }
+
+    size_t OctreePointCloudManager::removeFromNode(PointCloudOctreeNode* node, const NodeFilter& nodeFilter,
+                                                   const PointFilter& pointFilter, PointCloud& pointCloud) {
+        if (!node || node->totalPointCount == 0 || !nodeFilter(node)) {
+            return 0;
+        }
+
+        if (node->isLeaf) {
+            if (!ensureNodeResident(node)) {
+                return 0;
+            }
+
+            auto newEnd = std::remove_if(node->points.begin(), node->points.end(), pointFilter);
+            size_t removed = static_cast<size_t>(node->points.end() - newEnd);
+            if (removed == 0) {
+                return 0;
+            }
+            node->points.erase(newEnd, node->points.end());
+
+            if (node->points.empty()) {
+                discardNodeData(node);
+                node->totalPointCount = 0;
+                node->lodSamples.clear();
+            } else {
+                rewriteLeaf(node, pointCloud.chunkCache.cacheDirectory, pointCloud.chunkCache.codec);
+            }
+            return removed;
+        }
+
+        size_t removed = 0;
+        for (auto& child : node->children) {
+            if (!child) continue;
+
+            removed += removeFromNode(child.get(), nodeFilter, pointFilter, pointCloud);
+            if (child->totalPointCount == 0) {
+                discardNodeData(child.get());
+                child.reset();
+            }
+        }
+
+        if (removed == 0) {
+            return 0;
+        }
+
+        updateInternalNode(node);
+
+        // Merge small subtrees back into a single leaf
+        if (node->totalPointCount * sizeof(PointCloudPoint) <= pointCloud.maxLeafBytes) {
+            collapseIntoLeaf(node, pointCloud);
+        }
+        return removed;
+    }
+
+    size_t OctreePointCloudManager::removePoints(PointCloud& pointCloud, const NodeFilter& nodeFilter, const PointFilter& pointFilter) {
+        if (!pointCloud.octreeRoot) {
+            return 0;
+        }
+
+        size_t removed = removeFromNode(pointCloud.octreeRoot.get(), nodeFilter, pointFilter, pointCloud);
+        if (removed > 0) {
+            std::cout << "Removed " << removed << " points from " << pointCloud.name << std::endl;
+
+            ensureMemoryLimit(pointCloud);
+            if (pointCloud.visualizeOctree) {
+                generateOctreeVisualization(pointCloud, pointCloud.visualizeDepth);
+            }
+        }
+        return removed;
+    }
+
+    void OctreePointCloudManager::insertPoints(PointCloud& pointCloud, const std::vector<PointCloudPoint>& points) {
+        if (points.empty()) {
+            return;
+        }
+
+        // Nothing built yet - take the regular path
+        if (!pointCloud.octreeRoot) {
+            pointCloud.points = points;
+            buildOctree(pointCloud);
+            return;
+        }
+
+        glm::vec3 pointsMin = points[0].position;
+        glm::vec3 pointsMax = points[0].position;
+        for (const auto& point : points) {
+            pointsMin = glm::min(pointsMin, point.position);
+            pointsMax = glm::max(pointsMax, point.position);
+        }
+        pointCloud.octreeBoundsMin = glm::min(pointCloud.octreeBoundsMin, pointsMin);
+        pointCloud.octreeBoundsMax = glm::max(pointCloud.octreeBoundsMax, pointsMax);
+
+        createCacheDirectory(pointCloud.chunkCache.cacheDirectory);
+        growRootToFit(pointCloud, pointsMin, pointsMax);
+
+        BuildContext context = makeBuildContext(pointCloud);
+        std::vector<PointCloudPoint> batch = points;
+        insertIntoNode(pointCloud.octreeRoot.get(), batch, context, pointCloud);
+        pointCloud.nextNodeId = context.nextNodeId;
+
+        std::cout << "Inserted " << points.size() << " points into " << pointCloud.name << std::endl;
+
+        ensureMemoryLimit(pointCloud);
+        if (pointCloud.visualizeOctree) {
+            generateOctreeVisualization(pointCloud, pointCloud.visualizeDepth);
+        }
+    }
+
+    size_t OctreePointCloudManager::removePointsInBox(PointCloud& pointCloud, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+        return removePoints(pointCloud,
+            [&](const PointCloudOctreeNode* node) {
+                return glm::all(glm::lessThanEqual(node->center - node->bounds, boxMax)) &&
+                       glm::all(glm::greaterThanEqual(node->center + node->bounds, boxMin));
+            },
+            [&](const PointCloudPoint& point) {
+                return glm::all(glm::greaterThanEqual(point.position, boxMin)) &&
+                       glm::all(glm::lessThanEqual(point.position, boxMax));
+            });
+    }
+
+    size_t OctreePointCloudManager::removePointsInRadius(PointCloud& pointCloud, const glm::vec3& center, float radius) {
+        float radiusSquared = radius * radius;
+        return removePoints(pointCloud,
+            [&](const PointCloudOctreeNode* node) {
+                return boxDistanceSquared(node, center) <= radiusSquared;
+            },
+            [&](const PointCloudPoint& point) {
+                glm::vec3 delta = point.position - center;
+                return glm::dot(delta, delta) <= radiusSquared;
+            });
+    }
+
     // OctreeBounds utility functions
     void OctreeBounds::calculateBounds(const std::vector<PointCloudPoint>& points, 
                                      glm::vec3& min, glm::vec3& max, glm::vec3& center, float& size) {
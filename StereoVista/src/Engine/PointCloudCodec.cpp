@@ -0,0 +1,532 @@
+#include "../../headers/Engine/PointCloudCodec.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace Engine {
+
+    namespace {
+        constexpr size_t PACK_BLOCK_SIZE = 128;
+        constexpr size_t STREAM_PADDING = 8;        // Lets the decoder always read 64-bit windows
+        constexpr uint32_t POSITION_BITS = 20;
+        constexpr uint32_t POSITION_LEVELS = (1u << POSITION_BITS) - 1;
+        constexpr char FILE_MAGIC[4] = { 'P', 'C', 'N', '1' };
+
+        struct NodeFileHeader {
+            char magic[4];
+            uint8_t codec;
+            uint8_t reserved[3];
+            uint64_t pointCount;
+            uint64_t payloadSize;
+        };
+        static_assert(sizeof(NodeFileHeader) == 24, "Node file header must stay 24 bytes");
+
+        // Quantization parameters stored in front of the bit-packed streams
+        struct DeltaBitpackHeader {
+            float origin[3];
+            float step[3];
+            float intensityMin;
+            float intensityStep;
+        };
+
+        inline uint32_t zigzagEncode(int32_t value) {
+            return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+        }
+
+        inline int32_t zigzagDecode(uint32_t value) {
+            return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+        }
+
+        inline uint32_t bitWidth(uint32_t value) {
+            uint32_t width = 0;
+            while (value) {
+                width++;
+                value >>= 1;
+            }
+            return width;
+        }
+
+        inline uint64_t spreadBits3(uint32_t value) {
+            uint64_t x = value & 0x1fffff;
+            x = (x | x << 32) & 0x1f00000000ffffULL;
+            x = (x | x << 16) & 0x1f0000ff0000ffULL;
+            x = (x | x << 8) & 0x100f00f00f00f00fULL;
+            x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+            x = (x | x << 2) & 0x1249249249249249ULL;
+            return x;
+        }
+
+        // One bit width per block of 128 values, values stored LSB first
+        void packStream(const uint32_t* values, size_t count, std::vector<uint8_t>& out) {
+            for (size_t blockStart = 0; blockStart < count; blockStart += PACK_BLOCK_SIZE) {
+                size_t blockCount = std::min(PACK_BLOCK_SIZE, count - blockStart);
+
+                uint32_t combined = 0;
+                for (size_t i = 0; i < blockCount; i++) {
+                    combined |= values[blockStart + i];
+                }
+                uint32_t width = bitWidth(combined);
+                out.push_back(static_cast<uint8_t>(width));
+                if (width == 0) continue;
+
+                size_t start = out.size();
+                out.resize(start + (blockCount * width + 7) / 8, 0);
+                for (size_t i = 0; i < blockCount; i++) {
+                    size_t bit = i * width;
+                    uint64_t shifted = static_cast<uint64_t>(values[blockStart + i]) << (bit & 7);
+                    for (size_t byte = start + (bit >> 3); shifted != 0; byte++) {
+                        out[byte] |= static_cast<uint8_t>(shifted & 0xff);
+                        shifted >>= 8;
+                    }
+                }
+            }
+        }
+
+        // Returns false on malformed input. Needs STREAM_PADDING readable bytes after the last block.
+        bool unpackStream(const uint8_t* data, size_t size, size_t& offset, size_t count, uint32_t* out) {
+            for (size_t blockStart = 0; blockStart < count; blockStart += PACK_BLOCK_SIZE) {
+                size_t blockCount = std::min(PACK_BLOCK_SIZE, count - blockStart);
+                if (offset >= size) return false;
+
+                uint32_t width = data[offset++];
+                if (width > 32) return false;
+                if (width == 0) {
+                    std::fill(out + blockStart, out + blockStart + blockCount, 0u);
+                    continue;
+                }
+
+                size_t bytes = (blockCount * width + 7) / 8;
+                if (offset + bytes + STREAM_PADDING > size) return false;
+
+                const uint8_t* block = data + offset;
+                const uint64_t mask = (uint64_t(1) << width) - 1;
+                for (size_t i = 0; i < blockCount; i++) {
+                    size_t bit = i * width;
+                    uint64_t window;
+                    std::memcpy(&window, block + (bit >> 3), sizeof(window));
+                    out[blockStart + i] = static_cast<uint32_t>((window >> (bit & 7)) & mask);
+                }
+                offset += bytes;
+            }
+            return true;
+        }
+
+        // Byte-oriented LZ77 (LZ4-style sequences: token, literals, 16-bit offset, match length)
+        constexpr size_t LZ_MIN_MATCH = 4;
+        constexpr size_t LZ_MAX_OFFSET = 65535;
+        constexpr uint32_t LZ_HASH_BITS = 14;
+
+        void writeLength(size_t length, std::vector<uint8_t>& out) {
+            while (length >= 255) {
+                out.push_back(255);
+                length -= 255;
+            }
+            out.push_back(static_cast<uint8_t>(length));
+        }
+
+        void lzCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+            std::vector<int64_t> table(size_t(1) << LZ_HASH_BITS, -1);
+            size_t anchor = 0;
+            size_t pos = 0;
+
+            while (pos + LZ_MIN_MATCH <= size) {
+                uint32_t sequence;
+                std::memcpy(&sequence, src + pos, sizeof(sequence));
+                uint32_t hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+                int64_t candidate = table[hash];
+                table[hash] = static_cast<int64_t>(pos);
+
+                if (candidate < 0 || pos - candidate > LZ_MAX_OFFSET ||
+                    std::memcmp(src + candidate, src + pos, LZ_MIN_MATCH) != 0) {
+                    pos++;
+                    continue;
+                }
+
+                size_t matchLength = LZ_MIN_MATCH;
+                while (pos + matchLength < size && src[candidate + matchLength] == src[pos + matchLength]) {
+                    matchLength++;
+                }
+
+                size_t literalLength = pos - anchor;
+                size_t extraMatch = matchLength - LZ_MIN_MATCH;
+                out.push_back(static_cast<uint8_t>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(extraMatch, 15)));
+                if (literalLength >= 15) writeLength(literalLength - 15, out);
+                out.insert(out.end(), src + anchor, src + pos);
+
+                size_t offset = pos - candidate;
+                out.push_back(static_cast<uint8_t>(offset & 0xff));
+                out.push_back(static_cast<uint8_t>(offset >> 8));
+                if (extraMatch >= 15) writeLength(extraMatch - 15, out);
+
+                pos += matchLength;
+                anchor = pos;
+            }
+
+            // Final sequence carries the remaining literals and no match
+            size_t literalLength = size - anchor;
+            out.push_back(static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4));
+            if (literalLength >= 15) writeLength(literalLength - 15, out);
+            out.insert(out.end(), src + anchor, src + size);
+        }
+
+        bool lzDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize) {
+            size_t in = 0;
+            size_t out = 0;
+
+            auto readLength = [&](size_t& length) {
+                uint8_t value;
+                do {
+                    if (in >= size) return false;
+                    value = src[in++];
+                    length += value;
+                } while (value == 255);
+                return true;
+            };
+
+            while (true) {
+                if (in >= size) return false;
+                uint8_t token = src[in++];
+
+                size_t literalLength = token >> 4;
+                if (literalLength == 15 && !readLength(literalLength)) return false;
+                if (in + literalLength > size || out + literalLength > dstSize) return false;
+                std::memcpy(dst + out, src + in, literalLength);
+                in += literalLength;
+                out += literalLength;
+
+                if (in == size) {
+                    return out == dstSize;
+                }
+
+                if (in + 2 > size) return false;
+                size_t offset = src[in] | (static_cast<size_t>(src[in + 1]) << 8);
+                in += 2;
+                if (offset == 0 || offset > out) return false;
+
+                size_t matchLength = token & 15;
+                if (matchLength == 15 && !readLength(matchLength)) return false;
+                matchLength += LZ_MIN_MATCH;
+                if (out + matchLength > dstSize) return false;
+
+                if (offset >= matchLength) {
+                    std::memcpy(dst + out, dst + out - offset, matchLength);
+                } else {
+                    // Overlapping match repeats the last 'offset' bytes
+                    for (size_t i = 0; i < matchLength; i++) {
+                        dst[out + i] = dst[out + i - offset];
+                    }
+                }
+                out += matchLength;
+            }
+        }
+
+        class RawCodec : public NodeCodec {
+        public:
+            NodeCodecType getType() const override { return NodeCodecType::Raw; }
+            const char* getName() const override { return "Raw"; }
+
+            void encode(const std::vector<PointCloudPoint>& points, std::vector<uint8_t>& out) const override {
+                out.resize(points.size() * sizeof(PointCloudPoint));
+                if (!points.empty()) {
+                    std::memcpy(out.data(), points.data(), out.size());
+                }
+            }
+
+            bool decode(const uint8_t* data, size_t size, size_t pointCount, std::vector<PointCloudPoint>& points) const override {
+                if (size != pointCount * sizeof(PointCloudPoint)) return false;
+                points.resize(pointCount);
+                if (pointCount > 0) {
+                    std::memcpy(points.data(), data, size);
+                }
+                return true;
+            }
+        };
+
+        class DeltaBitpackCodec : public NodeCodec {
+        public:
+            NodeCodecType getType() const override { return NodeCodecType::DeltaBitpack; }
+            const char* getName() const override { return "Delta + Bitpack"; }
+
+            void encode(const std::vector<PointCloudPoint>& points, std::vector<uint8_t>& out) const override {
+                out.clear();
+                size_t count = points.size();
+
+                DeltaBitpackHeader header = {};
+                glm::vec3 minPos(0.0f), maxPos(0.0f);
+                float minIntensity = 0.0f, maxIntensity = 0.0f;
+                if (count > 0) {
+                    minPos = maxPos = points[0].position;
+                    minIntensity = maxIntensity = points[0].intensity;
+                    for (const auto& point : points) {
+                        minPos = glm::min(minPos, point.position);
+                        maxPos = glm::max(maxPos, point.position);
+                        minIntensity = std::min(minIntensity, point.intensity);
+                        maxIntensity = std::max(maxIntensity, point.intensity);
+                    }
+                }
+
+                glm::vec3 step = (maxPos - minPos) / static_cast<float>(POSITION_LEVELS);
+                for (int axis = 0; axis < 3; axis++) {
+                    header.origin[axis] = minPos[axis];
+                    header.step[axis] = step[axis];
+                }
+                header.intensityMin = minIntensity;
+                header.intensityStep = (maxIntensity - minIntensity) / 65535.0f;
+
+                // Quantize, then sort along the Morton curve so neighbouring points have small deltas
+                std::vector<glm::uvec3> quantized(count);
+                std::vector<std::pair<uint64_t, uint32_t>> order(count);
+                for (size_t i = 0; i < count; i++) {
+                    for (int axis = 0; axis < 3; axis++) {
+                        float q = step[axis] > 0.0f ? (points[i].position[axis] - minPos[axis]) / step[axis] : 0.0f;
+                        quantized[i][axis] = static_cast<uint32_t>(std::clamp(q + 0.5f, 0.0f, static_cast<float>(POSITION_LEVELS)));
+                    }
+                    uint64_t morton = spreadBits3(quantized[i].x) | (spreadBits3(quantized[i].y) << 1) | (spreadBits3(quantized[i].z) << 2);
+                    order[i] = { morton, static_cast<uint32_t>(i) };
+                }
+                std::sort(order.begin(), order.end());
+
+                out.resize(sizeof(header));
+                std::memcpy(out.data(), &header, sizeof(header));
+
+                std::vector<uint32_t> stream(count);
+
+                // Positions: per-axis deltas in Morton order
+                for (int axis = 0; axis < 3; axis++) {
+                    int32_t previous = 0;
+                    for (size_t i = 0; i < count; i++) {
+                        int32_t value = static_cast<int32_t>(quantized[order[i].second][axis]);
+                        stream[i] = zigzagEncode(value - previous);
+                        previous = value;
+                    }
+                    packStream(stream.data(), count, out);
+                }
+
+                // Colours: 8-bit, predicted from the previous point (wrapping delta)
+                for (int channel = 0; channel < 3; channel++) {
+                    uint8_t previous = 0;
+                    for (size_t i = 0; i < count; i++) {
+                        float c = std::clamp(points[order[i].second].color[channel], 0.0f, 1.0f);
+                        uint8_t value = static_cast<uint8_t>(c * 255.0f + 0.5f);
+                        stream[i] = zigzagEncode(static_cast<int8_t>(static_cast<uint8_t>(value - previous)));
+                        previous = value;
+                    }
+                    packStream(stream.data(), count, out);
+                }
+
+                // Intensity: 16-bit over the block range
+                int32_t previousIntensity = 0;
+                for (size_t i = 0; i < count; i++) {
+                    float q = header.intensityStep > 0.0f ? (points[order[i].second].intensity - minIntensity) / header.intensityStep : 0.0f;
+                    int32_t value = static_cast<int32_t>(std::clamp(q + 0.5f, 0.0f, 65535.0f));
+                    stream[i] = zigzagEncode(value - previousIntensity);
+                    previousIntensity = value;
+                }
+                packStream(stream.data(), count, out);
+
+                out.resize(out.size() + STREAM_PADDING, 0);
+            }
+
+            bool decode(const uint8_t* data, size_t size, size_t pointCount, std::vector<PointCloudPoint>& points) const override {
+                if (size < sizeof(DeltaBitpackHeader) + STREAM_PADDING) return false;
+
+                // Every stream stores at least one width byte per block; checked before allocating
+                if ((pointCount + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE > size) return false;
+
+                DeltaBitpackHeader header;
+                std::memcpy(&header, data, sizeof(header));
+                size_t offset = sizeof(header);
+
+                points.resize(pointCount);
+                std::vector<uint32_t> stream(pointCount);
+
+                for (int axis = 0; axis < 3; axis++) {
+                    if (!unpackStream(data, size, offset, pointCount, stream.data())) return false;
+                    int32_t value = 0;
+                    for (size_t i = 0; i < pointCount; i++) {
+                        value += zigzagDecode(stream[i]);
+                        points[i].position[axis] = header.origin[axis] + static_cast<float>(value) * header.step[axis];
+                    }
+                }
+
+                for (int channel = 0; channel < 3; channel++) {
+                    if (!unpackStream(data, size, offset, pointCount, stream.data())) return false;
+                    uint8_t value = 0;
+                    for (size_t i = 0; i < pointCount; i++) {
+                        value = static_cast<uint8_t>(value + zigzagDecode(stream[i]));
+                        points[i].color[channel] = value * (1.0f / 255.0f);
+                    }
+                }
+
+                if (!unpackStream(data, size, offset, pointCount, stream.data())) return false;
+                int32_t intensity = 0;
+                for (size_t i = 0; i < pointCount; i++) {
+                    intensity += zigzagDecode(stream[i]);
+                    points[i].intensity = header.intensityMin + static_cast<float>(intensity) * header.intensityStep;
+                }
+
+                return offset + STREAM_PADDING == size;
+            }
+        };
+
+        // Delta + bitpack followed by the LZ stage; payload starts with the bit-packed size
+        class DeltaBitpackLZCodec : public NodeCodec {
+        public:
+            NodeCodecType getType() const override { return NodeCodecType::DeltaBitpackLZ; }
+            const char* getName() const override { return "Delta + Bitpack + LZ"; }
+
+            void encode(const std::vector<PointCloudPoint>& points, std::vector<uint8_t>& out) const override {
+                std::vector<uint8_t> packed;
+                m_inner.encode(points, packed);
+
+                uint64_t packedSize = packed.size();
+                out.resize(sizeof(packedSize));
+                std::memcpy(out.data(), &packedSize, sizeof(packedSize));
+                lzCompress(packed.data(), packed.size(), out);
+            }
+
+            bool decode(const uint8_t* data, size_t size, size_t pointCount, std::vector<PointCloudPoint>& points) const override {
+                uint64_t packedSize;
+                if (size < sizeof(packedSize)) return false;
+                std::memcpy(&packedSize, data, sizeof(packedSize));
+
+                // Guard against corrupt sizes before allocating
+                size_t maxPackedSize = sizeof(DeltaBitpackHeader) + STREAM_PADDING + pointCount * 32 + (pointCount / PACK_BLOCK_SIZE + 1) * 7;
+                if (packedSize > maxPackedSize) return false;
+
+                // A length byte of 255 is the most one input byte can expand to
+                if (packedSize > (size - sizeof(packedSize)) * 255 + 15 + LZ_MIN_MATCH) return false;
+
+                std::vector<uint8_t> packed(static_cast<size_t>(packedSize));
+                if (!lzDecompress(data + sizeof(packedSize), size - sizeof(packedSize), packed.data(), packed.size())) {
+                    return false;
+                }
+                return m_inner.decode(packed.data(), packed.size(), pointCount, points);
+            }
+
+        private:
+            DeltaBitpackCodec m_inner;
+        };
+    }
+
+    const NodeCodec* NodeCodec::get(NodeCodecType type) {
+        static const RawCodec rawCodec;
+        static const DeltaBitpackCodec deltaBitpackCodec;
+        static const DeltaBitpackLZCodec deltaBitpackLZCodec;
+
+        switch (type) {
+        case NodeCodecType::Raw: return &rawCodec;
+        case NodeCodecType::DeltaBitpack: return &deltaBitpackCodec;
+        case NodeCodecType::DeltaBitpackLZ: return &deltaBitpackLZCodec;
+        }
+        return nullptr;
+    }
+
+    bool NodeCodec::writeFile(const std::string& filePath, NodeCodecType type, const std::vector<PointCloudPoint>& points) {
+        const NodeCodec* codec = get(type);
+        if (!codec) return false;
+
+        std::vector<uint8_t> payload;
+        codec->encode(points, payload);
+
+        NodeFileHeader header = {};
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+        header.codec = static_cast<uint8_t>(type);
+        header.pointCount = points.size();
+        header.payloadSize = payload.size();
+
+        std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+        return static_cast<bool>(file);
+    }
+
+    bool NodeCodec::readFile(const std::string& filePath, std::vector<PointCloudPoint>& points) {
+        std::ifstream file(filePath, std::ios::binary);
+        if (!file) return false;
+
+        NodeFileHeader header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0) {
+            return false;
+        }
+
+        const NodeCodec* codec = get(static_cast<NodeCodecType>(header.codec));
+        if (!codec) return false;
+
+        // Sizes come from the file; a truncated or corrupt header must not drive the allocation
+        std::streamoff payloadStart = file.tellg();
+        file.seekg(0, std::ios::end);
+        std::streamoff fileSize = file.tellg();
+        file.seekg(payloadStart);
+        if (payloadStart < 0 || fileSize < payloadStart ||
+            header.payloadSize != static_cast<uint64_t>(fileSize - payloadStart)) {
+            std::cerr << "Corrupt node file " << filePath << ": payload size " << header.payloadSize
+                      << " does not match the file" << std::endl;
+            return false;
+        }
+
+        std::vector<uint8_t> payload(static_cast<size_t>(header.payloadSize));
+        if (!file.read(reinterpret_cast<char*>(payload.data()), payload.size())) {
+            return false;
+        }
+
+        if (!codec->decode(payload.data(), payload.size(), static_cast<size_t>(header.pointCount), points)) {
+            points.clear();
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<NodeCodecBenchmark> benchmarkNodeCodecs(const std::vector<std::vector<PointCloudPoint>>& blocks, int iterations) {
+        std::vector<NodeCodecBenchmark> results;
+        iterations = std::max(iterations, 1);
+
+        const NodeCodecType types[] = { NodeCodecType::Raw, NodeCodecType::DeltaBitpack, NodeCodecType::DeltaBitpackLZ };
+        for (NodeCodecType type : types) {
+            const NodeCodec* codec = NodeCodec::get(type);
+
+            NodeCodecBenchmark result;
+            result.type = type;
+            result.name = codec->getName();
+
+            std::vector<std::vector<uint8_t>> encoded(blocks.size());
+            auto encodeStart = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < blocks.size(); i++) {
+                codec->encode(blocks[i], encoded[i]);
+                result.rawBytes += blocks[i].size() * sizeof(PointCloudPoint);
+                result.encodedBytes += encoded[i].size();
+            }
+            double encodeSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - encodeStart).count();
+
+            std::vector<PointCloudPoint> decoded;
+            auto decodeStart = std::chrono::high_resolution_clock::now();
+            for (int iteration = 0; iteration < iterations; iteration++) {
+                for (size_t i = 0; i < blocks.size(); i++) {
+                    if (!codec->decode(encoded[i].data(), encoded[i].size(), blocks[i].size(), decoded)) {
+                        std::cerr << "Codec " << result.name << " failed to decode block " << i << std::endl;
+                    }
+                }
+            }
+            double decodeSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - decodeStart).count();
+
+            if (result.encodedBytes > 0) {
+                result.ratio = static_cast<double>(result.rawBytes) / result.encodedBytes;
+            }
+            if (encodeSeconds > 0.0) {
+                result.encodeMBps = result.rawBytes / encodeSeconds / (1024.0 * 1024.0);
+            }
+            if (decodeSeconds > 0.0) {
+                result.decodeGBps = static_cast<double>(result.rawBytes) * iterations / decodeSeconds / 1e9;
+            }
+            results.push_back(result);
+        }
+
+        return results;
+    }
+
+}
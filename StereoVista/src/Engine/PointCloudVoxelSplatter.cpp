@@ -0,0 +1,318 @@
+#include "../../headers/Engine/PointCloudVoxelSplatter.h"
+#include "../../headers/Engine/OctreePointCloudManager.h"
+#include "../../headers/Engine/ThreadPool.h"
+#include "../../headers/Engine/VoxelLighting.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace Engine {
+
+    namespace {
+
+        // Mean of max(cos, 0) over the half space facing the light, standing in for N.L
+        constexpr float MEAN_COSINE = 0.5f;
+
+        // Leaves keep about this many points per voxel (surface scans: (voxel / spacing)^2 per voxel)
+        constexpr float POINTS_PER_VOXEL = 4.0f;
+
+        bool boxesOverlap(const glm::vec3& aMin, const glm::vec3& aMax, const glm::vec3& bMin, const glm::vec3& bMax) {
+            return !glm::any(glm::greaterThan(aMin, bMax)) && !glm::any(glm::lessThan(aMax, bMin));
+        }
+
+        uint32_t packColor(const glm::vec4& color) {
+            glm::u8vec4 bytes = glm::u8vec4(glm::round(glm::clamp(color, 0.0f, 1.0f) * 255.0f));
+            return static_cast<uint32_t>(bytes.r) | (static_cast<uint32_t>(bytes.g) << 8) |
+                   (static_cast<uint32_t>(bytes.b) << 16) | (static_cast<uint32_t>(bytes.a) << 24);
+        }
+    }
+
+    void PointCloudVoxelSplatter::setLights(const std::vector<CPUVoxelizer::Light>& sceneLights) {
+        lights = sceneLights;
+        for (auto& cloud : clouds) {
+            cloud.cascades.clear();
+        }
+    }
+
+    void PointCloudVoxelSplatter::clear() {
+        clouds.clear();
+        stats = Stats();
+    }
+
+    void PointCloudVoxelSplatter::resetStats() {
+        size_t cachedNodes = stats.cachedNodes;
+        stats = Stats();
+        stats.cachedNodes = cachedNodes;
+    }
+
+    void PointCloudVoxelSplatter::getNodeWorldBounds(const PointCloudOctreeNode* node, const glm::mat4& transform,
+                                                     glm::vec3& worldMin, glm::vec3& worldMax) {
+        worldMin = glm::vec3(FLT_MAX);
+        worldMax = glm::vec3(-FLT_MAX);
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 sign((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f);
+            glm::vec3 world = glm::vec3(transform * glm::vec4(node->center + sign * node->bounds, 1.0f));
+            worldMin = glm::min(worldMin, world);
+            worldMax = glm::max(worldMax, world);
+        }
+    }
+
+    PointCloudVoxelSplatter::CloudState PointCloudVoxelSplatter::captureCloudState(const PointCloud& pointCloud) {
+        CloudState state;
+        state.filePath = pointCloud.filePath;
+        state.transform = OctreePointCloudManager::getModelMatrix(pointCloud);
+        state.visible = pointCloud.visible && pointCloud.octreeRoot && pointCloud.octreeRoot->totalPointCount > 0;
+        state.nextNodeId = pointCloud.nextNodeId;
+        if (pointCloud.octreeRoot) {
+            state.pointCount = pointCloud.octreeRoot->totalPointCount;
+            getNodeWorldBounds(pointCloud.octreeRoot.get(), state.transform, state.worldMin, state.worldMax);
+        }
+        return state;
+    }
+
+    void PointCloudVoxelSplatter::findLoadedLeaves(const PointCloudOctreeNode* node, const std::unordered_set<uint64_t>& nodeIds,
+                                                   std::unordered_set<uint64_t>& loaded) {
+        if (!node || loaded.size() == nodeIds.size()) return;
+        if (node->isLeaf) {
+            if (nodeIds.count(node->nodeId) && node->isLoaded) loaded.insert(node->nodeId);
+            return;
+        }
+        for (const auto& child : node->children) {
+            findLoadedLeaves(child.get(), nodeIds, loaded);
+        }
+    }
+
+    void PointCloudVoxelSplatter::syncClouds(const std::vector<PointCloud>& pointClouds, glm::vec3& dirtyMin, glm::vec3& dirtyMax,
+                                             glm::vec3& streamedMin, glm::vec3& streamedMax) {
+        auto addDirtyBounds = [&](const glm::vec3& worldMin, const glm::vec3& worldMax) {
+            dirtyMin = glm::min(dirtyMin, worldMin);
+            dirtyMax = glm::max(dirtyMax, worldMax);
+        };
+
+        std::vector<CloudState> states(pointClouds.size());
+        for (size_t i = 0; i < pointClouds.size(); i++) {
+            states[i] = captureCloudState(pointClouds[i]);
+            if (i < clouds.size() && states[i].sameInputs(clouds[i])) {
+                states[i].cascades = std::move(clouds[i].cascades);
+                continue;
+            }
+            if (i < clouds.size() && clouds[i].visible) addDirtyBounds(clouds[i].worldMin, clouds[i].worldMax);
+            if (states[i].visible) addDirtyBounds(states[i].worldMin, states[i].worldMax);
+        }
+        for (size_t i = pointClouds.size(); i < clouds.size(); i++) {
+            if (clouds[i].visible) addDirtyBounds(clouds[i].worldMin, clouds[i].worldMax);
+        }
+
+        // Leaves splatted from their LOD samples are redone once their points are resident. The
+        // cache only holds node ids; the leaves are looked up in the current tree, whose loaded
+        // flag is published by the loader threads after the points are written.
+        std::unordered_set<uint64_t> incomplete, loaded;
+        for (size_t i = 0; i < states.size(); i++) {
+            incomplete.clear();
+            for (const auto& cache : states[i].cascades) {
+                for (const auto& entry : cache.nodes) {
+                    if (!entry.second.complete) incomplete.insert(entry.first);
+                }
+            }
+            if (incomplete.empty()) continue;
+
+            loaded.clear();
+            findLoadedLeaves(pointClouds[i].octreeRoot.get(), incomplete, loaded);
+            for (auto& cache : states[i].cascades) {
+                for (auto it = cache.nodes.begin(); it != cache.nodes.end();) {
+                    if (!it->second.complete && loaded.count(it->first)) {
+                        streamedMin = glm::min(streamedMin, it->second.worldMin);
+                        streamedMax = glm::max(streamedMax, it->second.worldMax);
+                        it = cache.nodes.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+        }
+
+        clouds = std::move(states);
+    }
+
+    void PointCloudVoxelSplatter::selectNodes(const PointCloudOctreeNode* node, const glm::mat4& transform, float scale, float voxelSize,
+                                              const glm::vec3& regionWorldMin, const glm::vec3& regionWorldMax,
+                                              std::vector<const PointCloudOctreeNode*>& selected) const {
+        if (!node || node->totalPointCount == 0) return;
+
+        glm::vec3 worldMin, worldMax;
+        getNodeWorldBounds(node, transform, worldMin, worldMax);
+        if (!boxesOverlap(worldMin, worldMax, regionWorldMin, regionWorldMax)) return;
+
+        // Internal nodes stand in with their LOD samples once those are about a voxel apart
+        if (!node->isLeaf && !node->lodSamples.empty()) {
+            float cellSize = 2.0f * std::max({ node->bounds.x, node->bounds.y, node->bounds.z }) * scale;
+            float sampleSpacing = cellSize / std::sqrt(static_cast<float>(node->lodSamples.size()));
+            if (sampleSpacing <= voxelSize) {
+                selected.push_back(node);
+                return;
+            }
+        }
+
+        if (node->isLeaf) {
+            selected.push_back(node);
+            return;
+        }
+        for (const auto& child : node->children) {
+            selectNodes(child.get(), transform, scale, voxelSize, regionWorldMin, regionWorldMax, selected);
+        }
+    }
+
+    glm::vec3 PointCloudVoxelSplatter::shade(const glm::vec3& position, const glm::vec3& color) const {
+        glm::vec3 diffuse(0.0f);
+        size_t lightCount = std::min(lights.size(), VoxelLighting::MAX_LIGHTS);
+        for (size_t i = 0; i < lightCount; i++) {
+            float distance = glm::length(lights[i].position - position);
+            diffuse += MEAN_COSINE * VoxelLighting::POINT_LIGHT_INTENSITY * VoxelLighting::attenuate(distance) * lights[i].color;
+        }
+        return glm::clamp(VoxelLighting::AMBIENT_STRENGTH * color + diffuse * color, glm::vec3(0.0f), glm::vec3(1.0f));
+    }
+
+    void PointCloudVoxelSplatter::splatNode(const PointCloudOctreeNode* node, const glm::mat4& transform, float scale,
+                                            float voxelSize, NodeSplats& result) const {
+        getNodeWorldBounds(node, transform, result.worldMin, result.worldMax);
+        result.voxelMin = glm::ivec3(glm::floor(result.worldMin / voxelSize));
+        result.voxelMax = glm::ivec3(glm::floor(result.worldMax / voxelSize));
+
+        // Leaves use their points thinned to a few per voxel; unloaded leaves and internal nodes
+        // use the resident LOD samples
+        const std::vector<PointCloudPoint>* samples = &node->lodSamples;
+        size_t stride = 1;
+        result.complete = true;
+        if (node->isLeaf) {
+            if (node->isLoaded && !node->points.empty()) {
+                samples = &node->points;
+                float spacing = node->spacing * scale;
+                if (spacing > 0.0f) {
+                    float pointsPerVoxel = (voxelSize / spacing) * (voxelSize / spacing);
+                    stride = std::max<size_t>(1, static_cast<size_t>(pointsPerVoxel / POINTS_PER_VOXEL));
+                }
+            } else {
+                result.complete = false;
+            }
+        }
+
+        // Bin the samples by voxel, then average each run
+        struct VoxelSample {
+            glm::ivec3 voxel;
+            glm::vec3 color;
+        };
+        std::vector<VoxelSample> binned;
+        binned.reserve(samples->size() / stride + 1);
+        for (size_t i = 0; i < samples->size(); i += stride) {
+            const PointCloudPoint& point = (*samples)[i];
+            glm::vec3 world = glm::vec3(transform * glm::vec4(point.position, 1.0f));
+            binned.push_back({ glm::ivec3(glm::floor(world / voxelSize)), shade(world, point.color) });
+        }
+        std::sort(binned.begin(), binned.end(), [](const VoxelSample& a, const VoxelSample& b) {
+            if (a.voxel.z != b.voxel.z) return a.voxel.z < b.voxel.z;
+            if (a.voxel.y != b.voxel.y) return a.voxel.y < b.voxel.y;
+            return a.voxel.x < b.voxel.x;
+        });
+
+        result.splats.clear();
+        for (size_t begin = 0; begin < binned.size();) {
+            size_t end = begin;
+            glm::vec3 sum(0.0f);
+            while (end < binned.size() && binned[end].voxel == binned[begin].voxel) {
+                sum += binned[end].color;
+                end++;
+            }
+            result.splats.push_back({ binned[begin].voxel, packColor(glm::vec4(sum / static_cast<float>(end - begin), 1.0f)) });
+            begin = end;
+        }
+    }
+
+    void PointCloudVoxelSplatter::collect(const std::vector<PointCloud>& pointClouds, int cascade, float voxelSize,
+                                          const glm::ivec3& regionMin, const glm::ivec3& regionMax, std::vector<Splat>& splats) {
+        auto start = std::chrono::high_resolution_clock::now();
+        glm::vec3 regionWorldMin = glm::vec3(regionMin) * voxelSize;
+        glm::vec3 regionWorldMax = glm::vec3(regionMax + 1) * voxelSize;
+
+        std::vector<const PointCloudOctreeNode*> selected;
+        for (size_t i = 0; i < pointClouds.size() && i < clouds.size(); i++) {
+            CloudState& state = clouds[i];
+            if (!state.visible) continue;
+
+            if (state.cascades.size() <= static_cast<size_t>(cascade)) state.cascades.resize(cascade + 1);
+            CascadeCache& cache = state.cascades[cascade];
+            if (cache.voxelSize != voxelSize) {
+                cache.nodes.clear();
+                cache.voxelSize = voxelSize;
+            }
+
+            glm::vec3 cloudScale = glm::abs(pointClouds[i].scale);
+            float scale = std::max({ cloudScale.x, cloudScale.y, cloudScale.z });
+            selected.clear();
+            selectNodes(pointClouds[i].octreeRoot.get(), state.transform, scale, voxelSize, regionWorldMin, regionWorldMax, selected);
+
+            // Entries are created here so the parallel splatting only fills them
+            std::vector<std::pair<const PointCloudOctreeNode*, NodeSplats*>> missing;
+            for (const PointCloudOctreeNode* node : selected) {
+                auto inserted = cache.nodes.try_emplace(node->nodeId);
+                if (inserted.second) missing.push_back({ node, &inserted.first->second });
+            }
+            ThreadPool::getInstance().parallelFor(0, missing.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t m = begin; m < end; m++) {
+                    splatNode(missing[m].first, state.transform, scale, voxelSize, *missing[m].second);
+                }
+            });
+
+            stats.nodesSelected += selected.size();
+            stats.nodesSplatted += missing.size();
+            for (const auto& entry : missing) {
+                stats.pointsRead += entry.second->complete && entry.first->isLeaf
+                                        ? entry.first->points.size() : entry.first->lodSamples.size();
+            }
+
+            for (const PointCloudOctreeNode* node : selected) {
+                const NodeSplats& entry = cache.nodes[node->nodeId];
+                for (const Splat& splat : entry.splats) {
+                    if (glm::any(glm::lessThan(splat.voxel, regionMin)) || glm::any(glm::greaterThan(splat.voxel, regionMax))) continue;
+                    splats.push_back(splat);
+                    stats.splats++;
+                }
+            }
+        }
+
+        stats.splatMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    void PointCloudVoxelSplatter::blendSplats(CPUVoxelizer::Volume& volume, const std::vector<Splat>& splats) {
+        if (volume.levels.empty()) return;
+        int resolution = volume.window.resolution;
+        glm::ivec3 windowMax = volume.window.origin + resolution - 1;
+        auto& level0 = volume.levels[0];
+        for (const Splat& splat : splats) {
+            if (glm::any(glm::lessThan(splat.voxel, volume.window.origin)) || glm::any(glm::greaterThan(splat.voxel, windowMax))) continue;
+
+            // Toroidal texture layout, as in the cascades
+            glm::ivec3 texel = ((splat.voxel % resolution) + resolution) % resolution;
+            glm::u8vec4& stored = level0[(static_cast<size_t>(texel.z) * resolution + texel.y) * resolution + texel.x];
+            glm::u8vec4 color(splat.color & 0xFF, (splat.color >> 8) & 0xFF, (splat.color >> 16) & 0xFF, splat.color >> 24);
+            stored = glm::max(stored, color);
+        }
+    }
+
+    void PointCloudVoxelSplatter::evict(int cascade, const glm::ivec3& windowMin, const glm::ivec3& windowMax) {
+        stats.cachedNodes = 0;
+        for (auto& state : clouds) {
+            if (static_cast<size_t>(cascade) < state.cascades.size()) {
+                auto& nodes = state.cascades[cascade].nodes;
+                for (auto it = nodes.begin(); it != nodes.end();) {
+                    bool outside = glm::any(glm::greaterThan(it->second.voxelMin, windowMax)) ||
+                                   glm::any(glm::lessThan(it->second.voxelMax, windowMin));
+                    it = outside ? nodes.erase(it) : std::next(it);
+                }
+            }
+            for (const auto& cache : state.cascades) {
+                stats.cachedNodes += cache.nodes.size();
+            }
+        }
+    }
+
+}
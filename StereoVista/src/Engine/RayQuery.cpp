@@ -0,0 +1,384 @@
+#include "../../headers/Engine/RayQuery.h"
+#include "../../headers/Engine/SceneBVH.h"
+#include "../../headers/Engine/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+
+namespace Engine {
+
+    ModelRayBVH::Signature ModelRayBVH::makeSignature(const Model& model) {
+        Signature signature;
+        signature.geometryId = model.geometryId;
+        signature.meshCount = model.getMeshes().size();
+        for (const auto& mesh : model.getMeshes()) {
+            signature.vertexCount += mesh.vertices.size();
+            signature.triangleCount += static_cast<uint32_t>(mesh.indices.size() / 3);
+        }
+        return signature;
+    }
+
+    ModelRayBVH::Source ModelRayBVH::makeSource(const Model& model, bool copyPositions) {
+        Source source;
+        source.name = model.name;
+        source.signature = makeSignature(model);
+        source.meshTriangleOffsets.reserve(model.getMeshes().size());
+        uint32_t triangleCount = 0;
+        for (const auto& mesh : model.getMeshes()) {
+            source.meshTriangleOffsets.push_back(triangleCount);
+            triangleCount += static_cast<uint32_t>(mesh.indices.size() / 3);
+        }
+        if (!copyPositions) return source;
+
+        source.positions.resize(static_cast<size_t>(triangleCount) * 3);
+        for (size_t meshIdx = 0; meshIdx < model.getMeshes().size(); meshIdx++) {
+            const auto& vertices = model.getMeshes()[meshIdx].vertices;
+            const auto& indices = model.getMeshes()[meshIdx].indices;
+            glm::vec3* positions = source.positions.data() + static_cast<size_t>(source.meshTriangleOffsets[meshIdx]) * 3;
+            ThreadPool::getInstance().parallelFor(0, indices.size() / 3, 64 * 1024, [&](size_t begin, size_t end) {
+                for (size_t i = begin * 3; i < end * 3; i++) {
+                    positions[i] = vertices[indices[i]].position;
+                }
+            });
+        }
+        return source;
+    }
+
+    std::shared_ptr<ModelRayBVH> ModelRayBVH::build(Source source, std::shared_ptr<const BVHBuilder> shared) {
+        auto bvh = std::make_shared<ModelRayBVH>();
+        bvh->signature = source.signature;
+        bvh->meshTriangleOffsets = std::move(source.meshTriangleOffsets);
+        bvh->triangleCount = source.signature.triangleCount;
+        if (bvh->triangleCount == 0) {
+            bvh->builder = std::make_shared<BVHBuilder>();
+            return bvh;
+        }
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        if (shared) {
+            // The SceneBVH BLAS stores the same triangles with their mesh-order index in materialId
+            bvh->builder = std::move(shared);
+        }
+        else {
+            // Model-space triangles in mesh order; materialId keeps the mesh-order index so a
+            // leaf-order hit maps back to its mesh and triangle
+            std::vector<BVHTriangle> triangles;
+            triangles.reserve(bvh->triangleCount);
+            for (size_t i = 0; i + 2 < source.positions.size(); i += 3) {
+                triangles.emplace_back(source.positions[i], source.positions[i + 1], source.positions[i + 2],
+                                       glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, 0.0f, static_cast<int>(triangles.size()));
+            }
+            std::vector<glm::vec3>().swap(source.positions);
+
+            auto builder = std::make_shared<BVHBuilder>();
+            builder->build(std::move(triangles));
+            bvh->builder = std::move(builder);
+        }
+        bvh->simd.build(*bvh->builder);
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        std::cout << (shared ? "Shared BLAS as ray query BVH for model '" : "Built ray query BVH for model '") << source.name
+                  << "' (" << bvh->triangleCount << " triangles) in "
+                  << std::chrono::duration<double, std::milli>(endTime - startTime).count() << " ms, "
+                  << getSimdLevelName(bvh->simd.getLevel()) << " kernels" << std::endl;
+        return bvh;
+    }
+
+    std::shared_future<std::shared_ptr<ModelRayBVH>> ModelRayBVH::buildAsync(const Model& model, std::shared_ptr<const BVHBuilder> shared) {
+        auto promise = std::make_shared<std::promise<std::shared_ptr<ModelRayBVH>>>();
+        std::shared_future<std::shared_ptr<ModelRayBVH>> future = promise->get_future().share();
+
+        // Snapshot on this thread; the build itself runs on a pool worker
+        auto source = std::make_shared<Source>(makeSource(model, !shared));
+        std::string name = model.name;
+        ThreadPool::getInstance().submit([promise, source, shared, name]() {
+            // A failed build (e.g. out of memory) yields no BVH; the model scans until the retry succeeds
+            try {
+                promise->set_value(build(std::move(*source), shared));
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Failed to build ray query BVH for model '" << name << "': " << e.what() << std::endl;
+                promise->set_value(nullptr);
+            }
+        });
+        return future;
+    }
+
+    bool ModelRayBVH::matches(const Model& model) const {
+        return signature == makeSignature(model);
+    }
+
+    void ModelRayBVH::resolveHit(uint32_t leafIdx, const glm::vec3& origin, const glm::vec3& direction, float t, RayHit& hit) const {
+        const BVHTriangle& tri = builder->getTriangles()[leafIdx];
+        uint32_t triangleIdx = static_cast<uint32_t>(tri.materialId);
+        auto meshIt = std::upper_bound(meshTriangleOffsets.begin(), meshTriangleOffsets.end(), triangleIdx) - 1;
+
+        // Barycentrics of the hit point (same terms as the Möller-Trumbore test)
+        glm::vec3 edge1 = tri.v1 - tri.v0;
+        glm::vec3 edge2 = tri.v2 - tri.v0;
+        glm::vec3 h = glm::cross(direction, edge2);
+        float f = 1.0f / glm::dot(edge1, h);
+        glm::vec3 s = origin - tri.v0;
+        glm::vec3 q = glm::cross(s, edge1);
+
+        hit.mesh = static_cast<int>(meshIt - meshTriangleOffsets.begin());
+        hit.triangle = triangleIdx - *meshIt;
+        hit.t = t;
+        hit.barycentrics = glm::vec2(f * glm::dot(s, h), f * glm::dot(direction, q));
+    }
+
+    bool ModelRayBVH::closestHit(const glm::vec3& origin, const glm::vec3& direction, float maxT, RayHit& hit) const {
+        float t = maxT;
+        uint32_t leafIdx = 0;
+        if (!simd.intersect(origin, direction, t, leafIdx)) return false;
+        resolveHit(leafIdx, origin, direction, t, hit);
+        return true;
+    }
+
+    bool ModelRayBVH::anyHit(const glm::vec3& origin, const glm::vec3& direction, float maxT) const {
+        return simd.intersectAny(origin, direction, maxT);
+    }
+
+    uint32_t ModelRayBVH::closestHitPacket(const glm::vec3* origins, const glm::vec3* directions, uint32_t count, RayHit* hits) const {
+        count = std::min(count, SimdBVH::MAX_PACKET);
+        float tHit[SimdBVH::MAX_PACKET];
+        uint32_t leafIdx[SimdBVH::MAX_PACKET];
+        for (uint32_t i = 0; i < count; i++) {
+            tHit[i] = hits[i].t;
+        }
+        simd.intersectPacket(origins, directions, count, tHit, leafIdx);
+
+        uint32_t hitMask = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (leafIdx[i] == SimdBVH::INVALID_TRIANGLE) continue;
+            resolveHit(leafIdx[i], origins[i], directions[i], tHit[i], hits[i]);
+            hitMask |= 1u << i;
+        }
+        return hitMask;
+    }
+
+    namespace {
+        const SceneBVH* s_sceneBVH = nullptr;
+
+        // Möller-Trumbore test (as BVHBuilder::intersectTriangle) that also returns the barycentrics
+        bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& v0,
+                               const glm::vec3& v1, const glm::vec3& v2, float& t, glm::vec2& barycentrics) {
+            const float EPSILON = 0.0000001f;
+            glm::vec3 edge1 = v1 - v0;
+            glm::vec3 edge2 = v2 - v0;
+            glm::vec3 h = glm::cross(direction, edge2);
+            float a = glm::dot(edge1, h);
+            if (std::abs(a) < EPSILON) return false;
+
+            float f = 1.0f / a;
+            glm::vec3 s = origin - v0;
+            float u = f * glm::dot(s, h);
+            if (u < 0.0f || u > 1.0f) return false;
+
+            glm::vec3 q = glm::cross(s, edge1);
+            float v = f * glm::dot(direction, q);
+            if (v < 0.0f || u + v > 1.0f) return false;
+
+            t = f * glm::dot(edge2, q);
+            barycentrics = glm::vec2(u, v);
+            return t > EPSILON;
+        }
+
+        // Closest hits of up to SimdBVH::MAX_PACKET model-space rays by testing every triangle of
+        // the model, the path queries take while its BVH is building. hits[i].t holds the max
+        // distance on input, returns a bit mask of the rays that hit.
+        uint32_t scanClosestHits(const Model& model, const glm::vec3* origins, const glm::vec3* directions, uint32_t count, RayHit* hits) {
+            count = std::min(count, SimdBVH::MAX_PACKET);
+            uint32_t hitMask = 0;
+            std::mutex hitMutex;
+
+            for (size_t meshIdx = 0; meshIdx < model.getMeshes().size(); meshIdx++) {
+                const auto& vertices = model.getMeshes()[meshIdx].vertices;
+                const auto& indices = model.getMeshes()[meshIdx].indices;
+                ThreadPool::getInstance().parallelFor(0, indices.size() / 3, 64 * 1024, [&](size_t begin, size_t end) {
+                    // Each chunk tests all rays against its triangles, then merges its closest hits
+                    RayHit local[SimdBVH::MAX_PACKET];
+                    uint32_t localMask = 0;
+                    for (uint32_t r = 0; r < count; r++) {
+                        local[r].t = hits[r].t;
+                    }
+                    for (size_t triangle = begin; triangle < end; triangle++) {
+                        const glm::vec3& v0 = vertices[indices[triangle * 3]].position;
+                        const glm::vec3& v1 = vertices[indices[triangle * 3 + 1]].position;
+                        const glm::vec3& v2 = vertices[indices[triangle * 3 + 2]].position;
+                        for (uint32_t r = 0; r < count; r++) {
+                            float t;
+                            glm::vec2 barycentrics;
+                            if (intersectTriangle(origins[r], directions[r], v0, v1, v2, t, barycentrics) && t < local[r].t) {
+                                local[r].mesh = static_cast<int>(meshIdx);
+                                local[r].triangle = static_cast<uint32_t>(triangle);
+                                local[r].t = t;
+                                local[r].barycentrics = barycentrics;
+                                localMask |= 1u << r;
+                            }
+                        }
+                    }
+
+                    std::lock_guard<std::mutex> lock(hitMutex);
+                    for (uint32_t r = 0; r < count; r++) {
+                        if ((localMask & (1u << r)) && local[r].t < hits[r].t) {
+                            hits[r] = local[r];
+                            hitMask |= 1u << r;
+                        }
+                    }
+                });
+            }
+            return hitMask;
+        }
+    }
+
+    void RayQuery::setSceneBVH(const SceneBVH* scene) {
+        s_sceneBVH = scene;
+    }
+
+    const ModelRayBVH* RayQuery::prepare(Model& model) {
+        // Adopt a finished background build; one made for geometry that changed meanwhile is dropped
+        if (model.rayBVHBuild.valid() && model.rayBVHBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            // A failed build (already reported) yields nullptr; clearing it lets the build below retry
+            std::shared_ptr<ModelRayBVH> built = model.rayBVHBuild.get();
+            model.rayBVHBuild = {};
+            if (built && built->matches(model)) model.rayBVH = std::move(built);
+        }
+        if (model.rayBVH && !model.rayBVH->matches(model)) model.rayBVH.reset();
+
+        // A BVH with its own tree is replaced once the SceneBVH holds a BLAS of the same geometry
+        std::shared_ptr<const BVHBuilder> shared = s_sceneBVH ? s_sceneBVH->findBLAS(model) : nullptr;
+        bool stale = !model.rayBVH || (shared && !model.rayBVH->sharesBuilder(shared.get()));
+        if (stale && !model.rayBVHBuild.valid()) {
+            model.rayBVHBuild = ModelRayBVH::buildAsync(model, std::move(shared));
+        }
+        return model.rayBVH.get();
+    }
+
+    bool RayQuery::prepare(std::vector<Model>& models) {
+        bool ready = true;
+        for (auto& model : models) {
+            if (!prepare(model) && model.visible) ready = false;
+        }
+        return ready;
+    }
+
+    bool RayQuery::closestHit(Model& model, int modelIndex, const Ray& ray, RayHit& hit, float maxDistance) {
+        if (!model.visible) return false;
+        const ModelRayBVH* bvh = prepare(model);
+        if (bvh && bvh->getTriangleCount() == 0) return false;
+
+        // The ray is moved into model space without renormalizing, so t is the same in both spaces
+        glm::mat4 invModelMatrix = glm::inverse(SceneBVH::getModelMatrix(model));
+        glm::vec3 localOrigin = glm::vec3(invModelMatrix * glm::vec4(ray.origin, 1.0f));
+        glm::vec3 localDirection = glm::vec3(invModelMatrix * glm::vec4(ray.direction, 0.0f));
+
+        RayHit candidate;
+        candidate.t = std::min(maxDistance, hit.t);
+        bool found = bvh ? bvh->closestHit(localOrigin, localDirection, candidate.t, candidate)
+                         : scanClosestHits(model, &localOrigin, &localDirection, 1, &candidate) != 0;
+        if (!found) return false;
+
+        candidate.model = modelIndex;
+        candidate.position = ray.origin + ray.direction * candidate.t;
+        hit = candidate;
+        return true;
+    }
+
+    void RayQuery::closestHitPacket(Model& model, int modelIndex, const Ray* rays, uint32_t count, RayHit* hits, float maxDistance) {
+        if (!model.visible) return;
+        const ModelRayBVH* bvh = prepare(model);
+        if (bvh && bvh->getTriangleCount() == 0) return;
+
+        count = std::min(count, SimdBVH::MAX_PACKET);
+        glm::mat4 invModelMatrix = glm::inverse(SceneBVH::getModelMatrix(model));
+        glm::vec3 localOrigins[SimdBVH::MAX_PACKET];
+        glm::vec3 localDirections[SimdBVH::MAX_PACKET];
+        RayHit candidates[SimdBVH::MAX_PACKET];
+        for (uint32_t i = 0; i < count; i++) {
+            localOrigins[i] = glm::vec3(invModelMatrix * glm::vec4(rays[i].origin, 1.0f));
+            localDirections[i] = glm::vec3(invModelMatrix * glm::vec4(rays[i].direction, 0.0f));
+            candidates[i].t = std::min(maxDistance, hits[i].t);
+        }
+
+        uint32_t hitMask = bvh ? bvh->closestHitPacket(localOrigins, localDirections, count, candidates)
+                               : scanClosestHits(model, localOrigins, localDirections, count, candidates);
+        for (uint32_t i = 0; i < count; i++) {
+            if (!(hitMask & (1u << i))) continue;
+            candidates[i].model = modelIndex;
+            candidates[i].position = rays[i].origin + rays[i].direction * candidates[i].t;
+            hits[i] = candidates[i];
+        }
+    }
+
+    void RayQuery::raycastPacket(std::vector<Model>& models, const Ray* rays, uint32_t count, RayHit* hits, float maxDistance) {
+        for (uint32_t i = 0; i < count; i++) {
+            hits[i] = RayHit();
+        }
+        for (size_t i = 0; i < models.size(); i++) {
+            closestHitPacket(models[i], static_cast<int>(i), rays, count, hits, maxDistance);
+        }
+    }
+
+    SimdBVH::Benchmark RayQuery::benchmark(std::vector<Model>& models, uint32_t raysPerModel) {
+        // Per-model results are combined as total rays over total time for each kernel
+        SimdBVH::Benchmark total;
+        double binarySeconds = 0.0, scalarSeconds = 0.0, sse2Seconds = 0.0, avx2Seconds = 0.0, packetSeconds = 0.0;
+        auto seconds = [](uint32_t rays, double rate) { return rate > 0.0 ? rays / rate : 0.0; };
+
+        for (auto& model : models) {
+            const ModelRayBVH* bvh = prepare(model);
+            if (!bvh || bvh->getTriangleCount() == 0) continue;
+
+            SimdBVH::Benchmark result = SimdBVH::benchmark(bvh->getBuilder(), raysPerModel);
+            total.rayCount += result.rayCount;
+            total.mismatches += result.mismatches;
+            binarySeconds += seconds(result.rayCount, result.binaryRaysPerSecond);
+            scalarSeconds += seconds(result.rayCount, result.scalarRaysPerSecond);
+            sse2Seconds += seconds(result.rayCount, result.sse2RaysPerSecond);
+            avx2Seconds += seconds(result.rayCount, result.avx2RaysPerSecond);
+            packetSeconds += seconds(result.rayCount, result.packetRaysPerSecond);
+        }
+
+        auto rate = [&](double time) { return time > 0.0 ? total.rayCount / time : 0.0; };
+        total.binaryRaysPerSecond = rate(binarySeconds);
+        total.scalarRaysPerSecond = rate(scalarSeconds);
+        total.sse2RaysPerSecond = rate(sse2Seconds);
+        total.avx2RaysPerSecond = rate(avx2Seconds);
+        total.packetRaysPerSecond = rate(packetSeconds);
+        return total;
+    }
+
+    RayHit RayQuery::raycast(std::vector<Model>& models, const Ray& ray, float maxDistance) {
+        RayHit hit;
+        for (size_t i = 0; i < models.size(); i++) {
+            closestHit(models[i], static_cast<int>(i), ray, hit, maxDistance);
+        }
+        return hit;
+    }
+
+    bool RayQuery::anyHit(std::vector<Model>& models, const Ray& ray, float maxDistance) {
+        for (auto& model : models) {
+            if (!model.visible) continue;
+            const ModelRayBVH* bvh = prepare(model);
+            if (bvh && bvh->getTriangleCount() == 0) continue;
+
+            glm::mat4 invModelMatrix = glm::inverse(SceneBVH::getModelMatrix(model));
+            glm::vec3 localOrigin = glm::vec3(invModelMatrix * glm::vec4(ray.origin, 1.0f));
+            glm::vec3 localDirection = glm::vec3(invModelMatrix * glm::vec4(ray.direction, 0.0f));
+            if (bvh) {
+                if (bvh->anyHit(localOrigin, localDirection, maxDistance)) return true;
+            }
+            else {
+                // No early out while scanning, the closest hit answers occlusion as well
+                RayHit hit;
+                hit.t = maxDistance;
+                if (scanClosestHits(model, &localOrigin, &localDirection, 1, &hit)) return true;
+            }
+        }
+        return false;
+    }
+
+}
@@ -0,0 +1,278 @@
+#include "../../headers/Engine/ReferenceChecks.h"
+#include "../../headers/Engine/ReferenceRenderer.h"
+#include "../../headers/Engine/CPUVoxelizer.h"
+#include "../../headers/Engine/AnisotropicVoxelMips.h"
+#include "../../headers/Engine/SceneBVH.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace Engine {
+
+    namespace {
+
+        // Ground plane, a cube and a sphere, lit by one point light
+        std::vector<Model> createTestScene() {
+            std::vector<Model> models;
+            models.push_back(createPlane(glm::vec3(0.8f), 8.0f, 0.0f));
+            models.back().position = glm::vec3(0.0f, -0.5f, 0.0f);
+            models.back().scale = glm::vec3(4.0f);
+
+            models.push_back(createCube(glm::vec3(0.9f, 0.3f, 0.2f), 32.0f, 0.0f));
+            models.back().position = glm::vec3(-0.8f, 0.0f, 0.0f);
+            models.back().rotation = glm::vec3(0.0f, 30.0f, 0.0f);
+
+            models.push_back(createSphere(glm::vec3(0.2f, 0.5f, 0.9f), 64.0f, 0.5f));
+            models.back().position = glm::vec3(0.8f, 0.1f, 0.3f);
+            models.back().scale = glm::vec3(0.6f);
+            return models;
+        }
+
+        const glm::vec3 LIGHT_POSITION(0.5f, 2.0f, 1.5f);
+        const glm::vec3 LIGHT_COLOR(1.0f, 0.95f, 0.9f);
+
+        // Pixels whose largest channel difference exceeds one 8-bit step
+        size_t countDifferingPixels(const ReferenceRenderer::Image& a, const ReferenceRenderer::Image& b) {
+            size_t count = 0;
+            for (size_t i = 0; i < a.pixels.size() && i < b.pixels.size(); i++) {
+                glm::vec3 d = glm::abs(a.pixels[i] - b.pixels[i]);
+                if (std::max(std::max(d.r, d.g), d.b) > 1.0f / 255.0f) count++;
+            }
+            return count;
+        }
+
+        bool checkReferenceRenderer(const std::vector<Model>& models) {
+            ReferenceRenderer::Settings settings;
+            settings.maxBounces = 2;
+            settings.samplesPerPixel = 2;
+
+            ReferenceRenderer::Lighting lighting;
+            PointLight light;
+            light.position = LIGHT_POSITION;
+            light.color = LIGHT_COLOR;
+            light.intensity = 1.0f;
+            light.lightSpaceMatrix = glm::mat4(1.0f);
+            lighting.pointLights.push_back(light);
+            lighting.background = glm::vec3(0.3f, 0.4f, 0.5f);
+
+            ReferenceRenderer::View view;
+            view.width = 160;
+            view.height = 120;
+            view.view = glm::lookAt(glm::vec3(0.0f, 1.2f, 3.5f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            view.projection = glm::perspective(glm::radians(45.0f), static_cast<float>(view.width) / view.height, 0.1f, 100.0f);
+
+            SceneBVH scene;
+            scene.update(models);
+            ReferenceRenderer renderer;
+            renderer.setScene(scene);
+
+            ReferenceRenderer::Stats stats;
+            settings.enableBVH = false;
+            ReferenceRenderer::Image linear = renderer.render(view, settings, lighting, &stats);
+            std::cout << "  Linear scan: " << scene.getTriangleCount() << " triangles, " << stats.renderMs << " ms, "
+                      << stats.raysPerSecond * 1e-6 << " Mrays/s" << std::endl;
+
+            bool passed = true;
+            settings.enableBVH = true;
+            for (uint32_t width : { 2u, 4u, 8u }) {
+                scene.setBVHWidth(width);
+                scene.update(models);
+                renderer.setScene(scene);
+                ReferenceRenderer::Image image = renderer.render(view, settings, lighting, &stats);
+
+                float maxDifference = image.maxDifference(linear);
+                size_t differing = countDifferingPixels(image, linear);
+                bool widthPassed = maxDifference >= 0.0f && differing == 0;
+                passed &= widthPassed;
+                std::cout << "  BVH" << width << " vs linear scan: max difference " << maxDifference << ", " << differing << " of "
+                          << image.pixels.size() << " pixels off, " << stats.renderMs << " ms, " << stats.raysPerSecond * 1e-6
+                          << " Mrays/s" << (widthPassed ? "" : "  FAILED") << std::endl;
+            }
+            return passed;
+        }
+
+        // Same inputs as Voxelizer::fillCPUVoxelizer
+        void fillVoxelizer(CPUVoxelizer& voxelizer, const std::vector<Model>& models) {
+            voxelizer.setLights({ { LIGHT_POSITION, LIGHT_COLOR } });
+            for (const auto& model : models) {
+                CPUVoxelizer::Material material;
+                material.diffuseColor = model.color;
+                material.emissivity = model.emissive;
+                material.transparency = model.transparency;
+                uint32_t materialIdx = voxelizer.getMaterialCount();
+                voxelizer.addMaterial(material);
+
+                glm::mat4 modelMatrix = SceneBVH::getModelMatrix(model);
+                glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
+                for (const auto& mesh : model.getMeshes()) {
+                    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                        const Vertex& a = mesh.vertices[mesh.indices[i]];
+                        const Vertex& b = mesh.vertices[mesh.indices[i + 1]];
+                        const Vertex& c = mesh.vertices[mesh.indices[i + 2]];
+                        CPUVoxelizer::Triangle triangle;
+                        triangle.v0 = glm::vec3(modelMatrix * glm::vec4(a.position, 1.0f));
+                        triangle.v1 = glm::vec3(modelMatrix * glm::vec4(b.position, 1.0f));
+                        triangle.v2 = glm::vec3(modelMatrix * glm::vec4(c.position, 1.0f));
+                        triangle.n0 = normalMatrix * a.normal;
+                        triangle.n1 = normalMatrix * b.normal;
+                        triangle.n2 = normalMatrix * c.normal;
+                        triangle.material = materialIdx;
+                        voxelizer.addTriangle(triangle);
+                    }
+                }
+            }
+        }
+
+        size_t texelIndex(const glm::ivec3& voxel, int resolution) {
+            glm::ivec3 texel = ((voxel % resolution) + resolution) % resolution;
+            return (static_cast<size_t>(texel.z) * resolution + texel.y) * resolution + texel.x;
+        }
+
+        bool checkCPUVoxelizer(const std::vector<Model>& models, const CPUVoxelizer::Window& window, CPUVoxelizer::Volume& volume) {
+            CPUVoxelizer voxelizer;
+            fillVoxelizer(voxelizer, models);
+
+            CPUVoxelizer::Stats stats;
+            volume = voxelizer.voxelize(window, &stats);
+            std::cout << "  " << stats.triangles << " triangles in " << stats.bricks << " bricks: " << stats.binMs << " ms bin, "
+                      << stats.voxelizeMs << " ms voxelize, " << volume.getOccupiedCount() << " voxels" << std::endl;
+
+            // Coverage by testing every triangle against every voxel of its bounding box. Cells are
+            // half open like the voxelizer's, so a triangle that only touches the lower face of its
+            // box does not reach into the voxel below.
+            int resolution = window.resolution;
+            std::vector<uint8_t> covered(static_cast<size_t>(resolution) * resolution * resolution, 0);
+            glm::vec3 windowMin = glm::vec3(window.origin) * window.voxelSize;
+            glm::vec3 voxelHalfSize(window.voxelSize * 0.5f);
+            for (const auto& model : models) {
+                glm::mat4 modelMatrix = SceneBVH::getModelMatrix(model);
+                for (const auto& mesh : model.getMeshes()) {
+                    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                        glm::vec3 v0 = glm::vec3(modelMatrix * glm::vec4(mesh.vertices[mesh.indices[i]].position, 1.0f));
+                        glm::vec3 v1 = glm::vec3(modelMatrix * glm::vec4(mesh.vertices[mesh.indices[i + 1]].position, 1.0f));
+                        glm::vec3 v2 = glm::vec3(modelMatrix * glm::vec4(mesh.vertices[mesh.indices[i + 2]].position, 1.0f));
+                        glm::ivec3 boxMin = glm::ivec3(glm::floor((glm::min(glm::min(v0, v1), v2) - windowMin) / window.voxelSize));
+                        glm::ivec3 boxMax = glm::ivec3(glm::floor((glm::max(glm::max(v0, v1), v2) - windowMin) / window.voxelSize));
+                        boxMin = glm::max(boxMin, glm::ivec3(0));
+                        boxMax = glm::min(boxMax, glm::ivec3(resolution - 1));
+                        for (int z = boxMin.z; z <= boxMax.z; z++) {
+                            for (int y = boxMin.y; y <= boxMax.y; y++) {
+                                for (int x = boxMin.x; x <= boxMax.x; x++) {
+                                    glm::vec3 voxelCenter = windowMin + (glm::vec3(x, y, z) + 0.5f) * window.voxelSize;
+                                    if (CPUVoxelizer::triangleBoxOverlap(voxelCenter, voxelHalfSize, v0, v1, v2)) {
+                                        covered[texelIndex(window.origin + glm::ivec3(x, y, z), resolution)] = 1;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            size_t missing = 0, extra = 0;
+            for (size_t i = 0; i < covered.size(); i++) {
+                bool occupied = volume.levels[0][i].a > 0;
+                if (covered[i] && !occupied) missing++;
+                if (!covered[i] && occupied) extra++;
+            }
+            bool coveragePassed = missing == 0 && extra == 0;
+            std::cout << "  Coverage vs brute force: " << missing << " voxels missing, " << extra << " extra"
+                      << (coveragePassed ? "" : "  FAILED") << std::endl;
+
+            // The sparse path voxelizes the same bricks into window-relative storage
+            SparseVoxelVolume sparse;
+            voxelizer.voxelizeSparse(window, sparse);
+            size_t differing = 0;
+            int maxDifference = 0;
+            for (int z = 0; z < resolution; z++) {
+                for (int y = 0; y < resolution; y++) {
+                    for (int x = 0; x < resolution; x++) {
+                        glm::u8vec4 dense = volume.levels[0][texelIndex(window.origin + glm::ivec3(x, y, z), resolution)];
+                        glm::u8vec4 brick = sparse.fetch(glm::ivec3(x, y, z));
+                        int texelDifference = 0;
+                        for (int channel = 0; channel < 4; channel++) {
+                            texelDifference = std::max(texelDifference, std::abs(static_cast<int>(dense[channel]) - static_cast<int>(brick[channel])));
+                        }
+                        maxDifference = std::max(maxDifference, texelDifference);
+                        if (texelDifference > 0) differing++;
+                    }
+                }
+            }
+            bool sparsePassed = differing == 0;
+            std::cout << "  Dense vs sparse (" << sparse.getBrickCount() << " bricks): " << differing << " voxels differ, max channel difference "
+                      << maxDifference << (sparsePassed ? "" : "  FAILED") << std::endl;
+            return coveragePassed && sparsePassed;
+        }
+
+        bool checkAnisotropicMips(CPUVoxelizer::Volume volume) {
+            AnisotropicVoxelMips::Levels directional;
+            AnisotropicVoxelMips::build(volume, directional);
+
+            // Edit level 0 in a few boxes (one across the window edge, so it wraps in the toroidal
+            // layout) and update the mips over just those regions
+            const CPUVoxelizer::Window& window = volume.window;
+            std::mt19937 rng(1234);
+            std::uniform_int_distribution<int> coordinate(0, window.resolution - 1);
+            std::uniform_int_distribution<int> extent(1, window.resolution / 4);
+            std::uniform_int_distribution<int> channel(0, 255);
+            std::vector<AnisotropicVoxelMips::Region> regions;
+            for (int i = 0; i < 4; i++) {
+                glm::ivec3 min(coordinate(rng), coordinate(rng), coordinate(rng));
+                if (i == 0) min.x = window.resolution - 3;
+                glm::ivec3 max = glm::min(min + glm::ivec3(extent(rng), extent(rng), extent(rng)), glm::ivec3(window.resolution - 1));
+                regions.push_back({ window.origin + min, window.origin + max });
+            }
+            for (const auto& region : regions) {
+                for (int z = region.min.z; z <= region.max.z; z++) {
+                    for (int y = region.min.y; y <= region.max.y; y++) {
+                        for (int x = region.min.x; x <= region.max.x; x++) {
+                            // Half the voxels cleared, half set to random colors
+                            glm::u8vec4 texel(0);
+                            if (channel(rng) & 1) texel = glm::u8vec4(channel(rng), channel(rng), channel(rng), channel(rng) | 1);
+                            volume.levels[0][texelIndex(glm::ivec3(x, y, z), window.resolution)] = texel;
+                        }
+                    }
+                }
+            }
+            AnisotropicVoxelMips::update(volume, directional, regions);
+
+            CPUVoxelizer::Volume rebuilt;
+            rebuilt.window = window;
+            rebuilt.levels.push_back(volume.levels[0]);
+            AnisotropicVoxelMips::Levels rebuiltDirectional;
+            AnisotropicVoxelMips::build(rebuilt, rebuiltDirectional);
+
+            AnisotropicVoxelMips::Difference difference = AnisotropicVoxelMips::compare(volume, directional, rebuilt, rebuiltDirectional);
+            bool passed = difference.maxIsotropic == 0 && difference.maxDirectional == 0;
+            std::cout << "  Update over " << regions.size() << " edited regions vs rebuild: max difference " << difference.maxIsotropic
+                      << " isotropic, " << difference.maxDirectional << " directional, " << difference.differingTexels << " texels off"
+                      << (passed ? "" : "  FAILED") << std::endl;
+            return passed;
+        }
+    }
+
+    int runReferenceChecks() {
+        std::vector<Model> models = createTestScene();
+        bool passed = true;
+
+        std::cout << "ReferenceRenderer" << std::endl;
+        passed &= checkReferenceRenderer(models);
+
+        CPUVoxelizer::Window window;
+        window.resolution = 64;
+        window.voxelSize = 5.0f / window.resolution;
+        window.origin = glm::ivec3(-window.resolution / 2);
+
+        std::cout << "CPUVoxelizer" << std::endl;
+        CPUVoxelizer::Volume volume;
+        passed &= checkCPUVoxelizer(models, window, volume);
+
+        std::cout << "AnisotropicVoxelMips" << std::endl;
+        passed &= checkAnisotropicMips(std::move(volume));
+
+        std::cout << "Reference checks " << (passed ? "passed" : "FAILED") << std::endl;
+        return passed ? 0 : 1;
+    }
+
+}
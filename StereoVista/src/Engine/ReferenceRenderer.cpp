@@ -0,0 +1,661 @@
+#include "../../headers/Engine/ReferenceRenderer.h"
+#include "../../headers/Engine/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace Engine {
+
+    namespace {
+
+        // Primary rays have no distance limit; misses in rayBoundingBoxDistance return exactly this,
+        // so node culling keeps working
+        constexpr float PRIMARY_MAX_DISTANCE = 1.0e30f;
+
+        // ---- RNG (PCG, same constants as the shader) ----
+
+        uint32_t nextRandom(uint32_t& state) {
+            state = state * 747796405u + 2891336453u;
+            uint32_t result = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+            result = (result >> 22u) ^ result;
+            return result;
+        }
+
+        float randomValue(uint32_t& state) {
+            return static_cast<float>(nextRandom(state)) / 4294967295.0f;
+        }
+
+        // GLSL uint(float) is undefined outside [0, 2^32); GPUs saturate, so do the same
+        uint32_t floatToUint(float value) {
+            if (!(value > 0.0f)) return 0u;
+            if (value >= 4294967295.0f) return 0xFFFFFFFFu;
+            return static_cast<uint32_t>(value);
+        }
+
+        float random(const glm::vec2& co, uint32_t& state) {
+            state ^= floatToUint(glm::dot(co, glm::vec2(12.9898f, 78.233f)) * 43758.5453f);
+            return randomValue(state);
+        }
+
+        glm::vec2 random2(const glm::vec2& co, uint32_t& state) {
+            float x = random(co, state);
+            return glm::vec2(x, randomValue(state));
+        }
+
+        glm::vec3 sampleCosineHemisphere(const glm::vec3& normal, const glm::vec2& rand) {
+            float cosTheta = std::sqrt(rand.x);
+            float sinTheta = std::sqrt(1.0f - rand.x);
+            float phi = 2.0f * 3.14159f * rand.y;
+
+            glm::vec3 w = normal;
+            glm::vec3 u = glm::normalize(glm::cross(std::abs(w.x) > 0.1f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0), w));
+            glm::vec3 v = glm::cross(w, u);
+
+            return glm::normalize(u * sinTheta * std::cos(phi) + v * sinTheta * std::sin(phi) + w * cosTheta);
+        }
+
+        float rayBoundingBoxDistance(const glm::vec3& origin, const glm::vec3& invDir, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+            glm::vec3 tMin = (boxMin - origin) * invDir;
+            glm::vec3 tMax = (boxMax - origin) * invDir;
+            glm::vec3 t1 = glm::min(tMin, tMax);
+            glm::vec3 t2 = glm::max(tMin, tMax);
+            float tNear = std::max(std::max(t1.x, t1.y), t1.z);
+            float tFar = std::min(std::min(t2.x, t2.y), t2.z);
+
+            bool hit = tFar >= tNear && tFar > 0.0f;
+            return hit ? (tNear > 0.0f ? tNear : 0.0f) : 1.0e30f;
+        }
+
+        bool rayAABBIntersect(const glm::vec3& origin, const glm::vec3& invDir, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+            glm::vec3 tMin = (boxMin - origin) * invDir;
+            glm::vec3 tMax = (boxMax - origin) * invDir;
+            glm::vec3 t1 = glm::min(tMin, tMax);
+            glm::vec3 t2 = glm::max(tMin, tMax);
+            float tNear = std::max(std::max(t1.x, t1.y), t1.z);
+            float tFar = std::min(std::min(t2.x, t2.y), t2.z);
+            return tFar >= tNear && tFar > 0.0f;
+        }
+
+        glm::vec3 nodeMin(const GPUBVHNode& node) { return glm::vec3(node.minX, node.minY, node.minZ); }
+        glm::vec3 nodeMax(const GPUBVHNode& node) { return glm::vec3(node.maxX, node.maxY, node.maxZ); }
+
+        float uintBitsToFloat(uint32_t bits) {
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+    }
+
+    // ---- ReferenceCubemap ----
+
+    bool ReferenceCubemap::isValid() const {
+        for (const auto& face : faces) {
+            if (face.width <= 0 || face.height <= 0 || face.texels.size() < static_cast<size_t>(face.width) * face.height) return false;
+        }
+        return true;
+    }
+
+    glm::vec3 ReferenceCubemap::sample(const glm::vec3& direction) const {
+        // Face selection and (s, t) as in the GL spec's cube map table
+        glm::vec3 a = glm::abs(direction);
+        int faceIdx;
+        float sc, tc, ma;
+        if (a.x >= a.y && a.x >= a.z) {
+            faceIdx = direction.x >= 0.0f ? 0 : 1;
+            sc = direction.x >= 0.0f ? -direction.z : direction.z;
+            tc = -direction.y;
+            ma = a.x;
+        } else if (a.y >= a.z) {
+            faceIdx = direction.y >= 0.0f ? 2 : 3;
+            sc = direction.x;
+            tc = direction.y >= 0.0f ? direction.z : -direction.z;
+            ma = a.y;
+        } else {
+            faceIdx = direction.z >= 0.0f ? 4 : 5;
+            sc = direction.z >= 0.0f ? direction.x : -direction.x;
+            tc = -direction.y;
+            ma = a.z;
+        }
+        if (ma <= 0.0f) return glm::vec3(0.0f);
+
+        const Face& face = faces[faceIdx];
+        float s = 0.5f * (sc / ma + 1.0f);
+        float t = 0.5f * (tc / ma + 1.0f);
+
+        // Bilinear filtering, clamped to the edge texels
+        float u = s * face.width - 0.5f;
+        float v = t * face.height - 0.5f;
+        int x0 = static_cast<int>(std::floor(u));
+        int y0 = static_cast<int>(std::floor(v));
+        float fx = u - x0;
+        float fy = v - y0;
+        auto texel = [&](int x, int y) {
+            x = std::clamp(x, 0, face.width - 1);
+            y = std::clamp(y, 0, face.height - 1);
+            return face.texels[static_cast<size_t>(y) * face.width + x];
+        };
+        glm::vec3 top = glm::mix(texel(x0, y0), texel(x0 + 1, y0), fx);
+        glm::vec3 bottom = glm::mix(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), fx);
+        return glm::mix(top, bottom, fy);
+    }
+
+    ReferenceCubemap ReferenceCubemap::fromTexture(GLuint texture) {
+        ReferenceCubemap cubemap;
+        if (texture == 0) return cubemap;
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        for (int i = 0; i < 6; i++) {
+            GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + i;
+            Face& face = cubemap.faces[i];
+            glGetTexLevelParameteriv(target, 0, GL_TEXTURE_WIDTH, &face.width);
+            glGetTexLevelParameteriv(target, 0, GL_TEXTURE_HEIGHT, &face.height);
+            if (face.width <= 0 || face.height <= 0) continue;
+
+            face.texels.resize(static_cast<size_t>(face.width) * face.height);
+            glGetTexImage(target, 0, GL_RGB, GL_FLOAT, face.texels.data());
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        return cubemap;
+    }
+
+    // ---- Image ----
+
+    bool ReferenceRenderer::Image::savePPM(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to write reference image: " << path << std::endl;
+            return false;
+        }
+
+        file << "P6\n" << width << " " << height << "\n255\n";
+        std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                glm::vec3 c = glm::clamp(pixels[static_cast<size_t>(y) * width + x], 0.0f, 1.0f);
+                row[x * 3 + 0] = static_cast<unsigned char>(c.r * 255.0f + 0.5f);
+                row[x * 3 + 1] = static_cast<unsigned char>(c.g * 255.0f + 0.5f);
+                row[x * 3 + 2] = static_cast<unsigned char>(c.b * 255.0f + 0.5f);
+            }
+            file.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+        return static_cast<bool>(file);
+    }
+
+    float ReferenceRenderer::Image::maxDifference(const Image& other) const {
+        if (width != other.width || height != other.height) return -1.0f;
+        float maxDiff = 0.0f;
+        for (size_t i = 0; i < pixels.size(); i++) {
+            glm::vec3 d = glm::abs(pixels[i] - other.pixels[i]);
+            maxDiff = std::max(maxDiff, std::max(std::max(d.r, d.g), d.b));
+        }
+        return maxDiff;
+    }
+
+    // ---- Scene ----
+
+    void ReferenceRenderer::setScene(const SceneBVH& scene) {
+        triangles = scene.getTriangleGeometry();
+        materials = scene.getTriangleMaterials();
+        bvhNodes = scene.getBLASNodes();
+        tlasNodes = scene.getGPUTLASNodes();
+        instances = scene.getInstances();
+        bvhWidth = scene.getBVHWidth();
+        wideNodes = bvhWidth > 2 ? scene.getWideNodes() : std::vector<uint32_t>();
+    }
+
+    // ---- Intersection (castRay and helpers of the shader) ----
+
+    ReferenceRenderer::TraceRay ReferenceRenderer::createRay(const glm::vec3& origin, const glm::vec3& direction) {
+        TraceRay ray;
+        ray.origin = origin;
+        ray.direction = direction;
+        ray.invDir = 1.0f / direction;
+        return ray;
+    }
+
+    bool ReferenceRenderer::intersectTriangle(const TraceRay& ray, uint32_t triIdx, float& t) const {
+        const float EPSILON = 0.0000001f;
+        const GPUTriangleGeometry& tri = triangles[triIdx];
+        glm::vec3 v0(tri.v0[0], tri.v0[1], tri.v0[2]);
+        glm::vec3 edge1(tri.edge1[0], tri.edge1[1], tri.edge1[2]);
+        glm::vec3 edge2(tri.edge2[0], tri.edge2[1], tri.edge2[2]);
+
+        glm::vec3 h = glm::cross(ray.direction, edge2);
+        float a = glm::dot(edge1, h);
+        if (std::abs(a) < EPSILON) return false;
+
+        float f = 1.0f / a;
+        glm::vec3 s = ray.origin - v0;
+        float u = f * glm::dot(s, h);
+        if (u < 0.0f || u > 1.0f) return false;
+
+        glm::vec3 q = glm::cross(s, edge1);
+        float v = f * glm::dot(ray.direction, q);
+        if (v < 0.0f || u + v > 1.0f) return false;
+
+        t = f * glm::dot(edge2, q);
+        return t > EPSILON;
+    }
+
+    void ReferenceRenderer::recordHit(HitInfo& result, const TraceRay& worldRay, const GPUInstance& instance, uint32_t triIdx, float t) const {
+        const GPUTriangleMaterial& material = materials[triIdx];
+        glm::vec3 normal(material.normal[0], material.normal[1], material.normal[2]);
+
+        result.hit = true;
+        result.distance = t;
+        result.point = worldRay.origin + worldRay.direction * t;
+        result.normal = glm::normalize(glm::transpose(glm::mat3(instance.worldToLocal)) * normal);
+        result.albedo = glm::vec3(material.color[0], material.color[1], material.color[2]);
+        result.emissiveness = material.color[3];
+        result.shininess = material.normal[3];
+        result.roughness = 1.0f - glm::clamp(material.normal[3] / 256.0f, 0.0f, 1.0f);
+        result.materialId = static_cast<int>(triIdx);
+    }
+
+    void ReferenceRenderer::traverseWideBLAS(const TraceRay& worldRay, const TraceRay& ray, const GPUInstance& instance, HitInfo& result) const {
+        const uint32_t stride = WideBVH::getNodeStride(bvhWidth);
+        const uint32_t planeWords = bvhWidth / 4u;
+        const uint32_t numWideNodes = static_cast<uint32_t>(wideNodes.size() / stride);
+        auto childByte = [&](uint32_t base, uint32_t plane, uint32_t child) {
+            return (wideNodes[base + 4u + plane * planeWords + child / 4u] >> ((child % 4u) * 8u)) & 0xFFu;
+        };
+
+        // SceneBVH only packs wide nodes whose stack bound fits (see WideBVH::getMaxStackDepth)
+        uint32_t stack[WideBVH::TRAVERSAL_STACK_SIZE];
+        int stackIndex = 0;
+        stack[stackIndex++] = instance.rootNode;
+
+        while (stackIndex > 0) {
+            uint32_t nodeIdx = stack[--stackIndex];
+            if (nodeIdx >= numWideNodes) continue;
+
+            // Quantization frame: child bound = origin + q * 2^exponent
+            uint32_t base = nodeIdx * stride;
+            glm::vec3 origin(uintBitsToFloat(wideNodes[base]), uintBitsToFloat(wideNodes[base + 1u]), uintBitsToFloat(wideNodes[base + 2u]));
+            uint32_t header = wideNodes[base + 3u];
+            glm::vec3 scale(uintBitsToFloat((header & 0xFFu) << 23u), uintBitsToFloat(((header >> 8u) & 0xFFu) << 23u),
+                            uintBitsToFloat(((header >> 16u) & 0xFFu) << 23u));
+            uint32_t childCount = header >> 24u;
+            uint32_t childBase = base + 4u + 6u * planeWords;
+
+            float hitDistance[8];
+            uint32_t hitChild[8];
+            int hitCount = 0;
+            for (uint32_t i = 0; i < childCount; i++) {
+                glm::vec3 qlo(childByte(base, 0u, i), childByte(base, 1u, i), childByte(base, 2u, i));
+                glm::vec3 qhi(childByte(base, 3u, i), childByte(base, 4u, i), childByte(base, 5u, i));
+                float dist = rayBoundingBoxDistance(ray.origin, ray.invDir, origin + qlo * scale, origin + qhi * scale);
+                if (dist >= result.distance) continue;
+
+                uint32_t word = wideNodes[childBase + i];
+                if (word & WideBVH::LEAF_FLAG) {
+                    uint32_t first = word & WideBVH::LEAF_FIRST_MASK;
+                    uint32_t count = (word >> WideBVH::LEAF_COUNT_SHIFT) & 0xFu;
+                    for (uint32_t j = 0; j < count; j++) {
+                        uint32_t triIdx = first + j;
+                        if (triIdx >= triangles.size()) continue;
+
+                        float t;
+                        if (intersectTriangle(ray, triIdx, t) && t < result.distance) {
+                            recordHit(result, worldRay, instance, triIdx, t);
+                        }
+                    }
+                } else {
+                    int j = hitCount++;
+                    while (j > 0 && hitDistance[j - 1] < dist) {
+                        hitDistance[j] = hitDistance[j - 1];
+                        hitChild[j] = hitChild[j - 1];
+                        j--;
+                    }
+                    hitDistance[j] = dist;
+                    hitChild[j] = word;
+                }
+            }
+
+            for (int i = 0; i < hitCount && stackIndex < static_cast<int>(WideBVH::TRAVERSAL_STACK_SIZE); i++) {
+                stack[stackIndex++] = hitChild[i];
+            }
+        }
+    }
+
+    void ReferenceRenderer::traverseBLAS(const TraceRay& worldRay, const TraceRay& ray, const GPUInstance& instance, HitInfo& result) const {
+        if (bvhWidth > 2 && !wideNodes.empty()) {
+            traverseWideBLAS(worldRay, ray, instance, result);
+            return;
+        }
+
+        // Same 32-entry stack (and overflow behavior) as the shader
+        uint32_t stack[32];
+        int stackIndex = 0;
+        stack[stackIndex++] = instance.rootNode;
+
+        while (stackIndex > 0) {
+            const GPUBVHNode& node = bvhNodes[stack[--stackIndex]];
+
+            if (node.triCount > 0u) {
+                for (uint32_t i = 0; i < node.triCount; i++) {
+                    uint32_t triIdx = node.leftFirst + i;
+                    if (triIdx >= triangles.size()) continue;
+
+                    float t;
+                    if (intersectTriangle(ray, triIdx, t) && t < result.distance) {
+                        recordHit(result, worldRay, instance, triIdx, t);
+                    }
+                }
+            } else {
+                uint32_t childIndexA = node.leftFirst + 0u;
+                uint32_t childIndexB = node.leftFirst + 1u;
+                if (childIndexA >= bvhNodes.size() || childIndexB >= bvhNodes.size()) continue;
+
+                const GPUBVHNode& childA = bvhNodes[childIndexA];
+                const GPUBVHNode& childB = bvhNodes[childIndexB];
+                bool hitA = rayAABBIntersect(ray.origin, ray.invDir, nodeMin(childA), nodeMax(childA));
+                bool hitB = rayAABBIntersect(ray.origin, ray.invDir, nodeMin(childB), nodeMax(childB));
+
+                if (hitA && hitB) {
+                    float dstA = rayBoundingBoxDistance(ray.origin, ray.invDir, nodeMin(childA), nodeMax(childA));
+                    float dstB = rayBoundingBoxDistance(ray.origin, ray.invDir, nodeMin(childB), nodeMax(childB));
+                    if (dstA <= dstB) {
+                        if (dstB < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexB;
+                        if (dstA < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexA;
+                    } else {
+                        if (dstA < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexA;
+                        if (dstB < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexB;
+                    }
+                } else if (hitA) {
+                    if (stackIndex < 31) stack[stackIndex++] = childIndexA;
+                } else if (hitB) {
+                    if (stackIndex < 31) stack[stackIndex++] = childIndexB;
+                }
+            }
+        }
+    }
+
+    ReferenceRenderer::HitInfo ReferenceRenderer::castRayBVH(const TraceRay& ray, float maxDistance) const {
+        HitInfo result;
+        result.distance = maxDistance;
+        if (tlasNodes.empty() || bvhNodes.empty()) return result;
+
+        uint32_t stack[32];
+        int stackIndex = 0;
+        stack[stackIndex++] = 0u;
+
+        while (stackIndex > 0) {
+            const GPUBVHNode& node = tlasNodes[stack[--stackIndex]];
+            if (rayBoundingBoxDistance(ray.origin, ray.invDir, nodeMin(node), nodeMax(node)) >= result.distance) continue;
+
+            if (node.triCount > 0u) {
+                for (uint32_t i = 0; i < node.triCount; i++) {
+                    uint32_t instanceIdx = node.leftFirst + i;
+                    if (instanceIdx >= instances.size()) continue;
+
+                    const GPUInstance& instance = instances[instanceIdx];
+                    TraceRay localRay = createRay(glm::vec3(instance.worldToLocal * glm::vec4(ray.origin, 1.0f)),
+                                                  glm::vec3(instance.worldToLocal * glm::vec4(ray.direction, 0.0f)));
+                    traverseBLAS(ray, localRay, instance, result);
+                }
+            } else {
+                uint32_t childIndexA = node.leftFirst + 0u;
+                uint32_t childIndexB = node.leftFirst + 1u;
+                if (childIndexA >= tlasNodes.size() || childIndexB >= tlasNodes.size()) continue;
+
+                float dstA = rayBoundingBoxDistance(ray.origin, ray.invDir, nodeMin(tlasNodes[childIndexA]), nodeMax(tlasNodes[childIndexA]));
+                float dstB = rayBoundingBoxDistance(ray.origin, ray.invDir, nodeMin(tlasNodes[childIndexB]), nodeMax(tlasNodes[childIndexB]));
+                if (dstA <= dstB) {
+                    if (dstB < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexB;
+                    if (dstA < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexA;
+                } else {
+                    if (dstA < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexA;
+                    if (dstB < result.distance && stackIndex < 31) stack[stackIndex++] = childIndexB;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    ReferenceRenderer::HitInfo ReferenceRenderer::castRayLinear(const TraceRay& ray, float maxDistance) const {
+        HitInfo hit;
+        hit.distance = maxDistance;
+
+        for (const GPUInstance& instance : instances) {
+            TraceRay localRay = createRay(glm::vec3(instance.worldToLocal * glm::vec4(ray.origin, 1.0f)),
+                                          glm::vec3(instance.worldToLocal * glm::vec4(ray.direction, 0.0f)));
+            uint32_t lastTriangle = std::min(instance.triangleOffset + instance.triangleCount, static_cast<uint32_t>(triangles.size()));
+            for (uint32_t i = instance.triangleOffset; i < lastTriangle; i++) {
+                float t;
+                if (intersectTriangle(localRay, i, t) && t < hit.distance) {
+                    recordHit(hit, ray, instance, i, t);
+                }
+            }
+        }
+
+        return hit;
+    }
+
+    // The shader's ground plane is never enabled by the application, so it is left out here
+    ReferenceRenderer::HitInfo ReferenceRenderer::castRay(const TraceRay& ray, float maxDistance, PathContext& context) const {
+        context.rays++;
+        if (context.settings.enableBVH && !tlasNodes.empty()) {
+            return castRayBVH(ray, maxDistance);
+        }
+        return castRayLinear(ray, maxDistance);
+    }
+
+    // ---- Lighting (same structure and constants as the shader) ----
+
+    bool ReferenceRenderer::isInShadow(const glm::vec3& point, const glm::vec3& normal, const glm::vec3& lightDir, float lightDistance, PathContext& context) const {
+        HitInfo shadowHit = castRay(createRay(point + 0.001f * normal, lightDir), context.settings.rayMaxDistance, context);
+        return shadowHit.hit && shadowHit.distance < lightDistance;
+    }
+
+    glm::vec3 ReferenceRenderer::evaluateDirectLighting(const HitInfo& hit, const glm::vec3& viewDir, PathContext& context) const {
+        glm::vec3 directLight(0.0f);
+        glm::vec3 normal = glm::normalize(hit.normal);
+        const Sun& sun = context.lighting.sun;
+
+        if (sun.enabled) {
+            glm::vec3 lightDir = glm::normalize(-sun.direction);
+            float NdotL = std::max(glm::dot(normal, lightDir), 0.0f);
+            if (NdotL > 0.0f && !isInShadow(hit.point, normal, lightDir, 1000.0f, context)) {
+                glm::vec3 diffuse = hit.albedo * sun.color * sun.intensity * NdotL;
+                glm::vec3 halfVec = glm::normalize(lightDir + viewDir);
+                float NdotH = std::max(glm::dot(normal, halfVec), 0.0f);
+                float specular = std::pow(NdotH, std::max(hit.shininess, 1.0f));
+                directLight += diffuse + sun.color * sun.intensity * specular * 0.2f;
+            }
+        }
+
+        const auto& pointLights = context.lighting.pointLights;
+        for (int i = 0; i < static_cast<int>(pointLights.size()) && i < MAX_POINT_LIGHTS; i++) {
+            glm::vec3 lightVec = pointLights[i].position - hit.point;
+            float lightDistance = glm::length(lightVec);
+            glm::vec3 lightDir = lightVec / lightDistance;
+            float NdotL = std::max(glm::dot(normal, lightDir), 0.0f);
+            if (NdotL > 0.0f && !isInShadow(hit.point, normal, lightDir, lightDistance, context)) {
+                float attenuation = 1.0f / (1.0f + 0.09f * lightDistance + 0.032f * lightDistance * lightDistance);
+                glm::vec3 diffuse = hit.albedo * pointLights[i].color * pointLights[i].intensity * NdotL * attenuation;
+                glm::vec3 halfVec = glm::normalize(lightDir + viewDir);
+                float NdotH = std::max(glm::dot(normal, halfVec), 0.0f);
+                float specular = std::pow(NdotH, std::max(hit.shininess, 1.0f));
+                directLight += diffuse + pointLights[i].color * pointLights[i].intensity * specular * 0.2f * attenuation;
+            }
+        }
+
+        return directLight;
+    }
+
+    glm::vec3 ReferenceRenderer::rayColor(const TraceRay& initialRay, PathContext& context) const {
+        const Settings& settings = context.settings;
+        glm::vec3 finalColor(0.0f);
+        glm::vec3 attenuation(1.0f);
+        TraceRay currentRay = initialRay;
+
+        for (int depth = 0; depth < settings.maxBounces; depth++) {
+            HitInfo hit = castRay(currentRay, settings.rayMaxDistance, context);
+
+            if (!hit.hit || hit.distance > settings.rayMaxDistance) {
+                glm::vec3 unitDirection = glm::normalize(currentRay.direction);
+                float t = 0.5f * (unitDirection.y + 1.0f);
+                glm::vec3 skyColor = (1.0f - t) * glm::vec3(1.0f, 1.0f, 1.0f) + t * glm::vec3(0.5f, 0.7f, 1.0f);
+                finalColor += attenuation * skyColor * settings.skyIntensity;
+                break;
+            }
+
+            if (settings.enableEmissiveLighting && hit.emissiveness > 0.0f) {
+                finalColor += attenuation * hit.albedo * hit.emissiveness * settings.emissiveIntensity;
+            }
+            if (settings.directLighting) {
+                finalColor += attenuation * evaluateDirectLighting(hit, -glm::normalize(currentRay.direction), context);
+            }
+
+            if (!settings.enableIndirectLighting && depth > 0) {
+                break;
+            }
+
+            // Lambertian BRDF with cosine-weighted sampling: the weight reduces to the albedo
+            glm::vec3 conservativeAlbedo = glm::clamp(hit.albedo, 0.0f, 1.0f);
+            attenuation *= conservativeAlbedo * settings.indirectIntensity;
+
+            glm::vec2 seed = glm::vec2(hit.point.x, hit.point.y) + static_cast<float>(depth) * 123.456f;
+            glm::vec2 rand = random2(seed, context.rngState);
+
+            glm::vec3 scatterDir;
+            float brdfWeight = 1.0f;
+            float specularAmount = glm::clamp(hit.shininess / 128.0f, 0.0f, 1.0f);
+            float diffuseAmount = 1.0f - specularAmount;
+
+            if (specularAmount > 0.8f) {
+                glm::vec3 reflectedDir = glm::reflect(currentRay.direction, hit.normal);
+                if (hit.roughness > 0.01f) {
+                    glm::vec3 roughnessOffset = sampleCosineHemisphere(hit.normal, random2(rand, context.rngState)) * hit.roughness;
+                    scatterDir = glm::normalize(reflectedDir + roughnessOffset);
+                } else {
+                    scatterDir = reflectedDir;
+                }
+                brdfWeight = 1.0f;
+            } else if (specularAmount < 0.2f) {
+                scatterDir = sampleCosineHemisphere(hit.normal, rand);
+                brdfWeight = 1.0f;
+            } else {
+                scatterDir = sampleCosineHemisphere(hit.normal, rand);
+                brdfWeight = diffuseAmount + specularAmount * std::max(0.0f, glm::dot(scatterDir, glm::reflect(currentRay.direction, hit.normal)));
+            }
+
+            attenuation *= brdfWeight;
+            currentRay = createRay(hit.point + 0.001f * hit.normal, scatterDir);
+
+            // Russian roulette after a few bounces
+            float maxComponent = std::max(std::max(attenuation.r, attenuation.g), attenuation.b);
+            float survivalProbability = std::min(maxComponent, 0.95f);
+            if (depth >= 3) {
+                glm::vec2 rrSeed = glm::vec2(hit.point.y, hit.point.z) + static_cast<float>(depth) * 456.789f;
+                float rrRandom = random(rrSeed, context.rngState);
+                if (rrRandom > survivalProbability) {
+                    break;
+                }
+                attenuation /= survivalProbability;
+            }
+        }
+
+        return finalColor;
+    }
+
+    glm::vec3 ReferenceRenderer::calculateRadianceLighting(const glm::vec3& worldPos, const glm::vec3& normal, const glm::vec3& materialColor,
+                                                           float emissive, PathContext& context) const {
+        const Settings& settings = context.settings;
+        glm::vec3 color(0.0f);
+
+        for (int i = 0; i < settings.samplesPerPixel; i++) {
+            glm::vec2 seed = glm::vec2(worldPos.x, worldPos.y) + static_cast<float>(i) * 0.1f;
+            glm::vec2 rand = random2(seed, context.rngState);
+            glm::vec3 rayDir = sampleCosineHemisphere(normal, rand);
+            color += materialColor * rayColor(createRay(worldPos + 0.001f * normal, rayDir), context);
+        }
+        color /= static_cast<float>(std::max(settings.samplesPerPixel, 1));
+
+        if (emissive > 0.0f) {
+            color += materialColor * emissive * settings.emissiveIntensity;
+        }
+        return color;
+    }
+
+    glm::vec3 ReferenceRenderer::shadePixel(int x, int y, const View& view, const glm::mat4& invViewProj, PathContext& context) const {
+        // gl_FragCoord of the pixel (origin at the bottom left)
+        float fragX = x + 0.5f;
+        float fragY = (view.height - 1 - y) + 0.5f;
+        uint32_t pixelIndex = static_cast<uint32_t>(static_cast<int>(fragY) * 1920 + static_cast<int>(fragX));
+        context.rngState = pixelIndex + floatToUint(fragX * fragY) * 719393u;
+
+        // Primary ray through the pixel center between the near and far plane
+        glm::vec2 ndc(fragX / view.width * 2.0f - 1.0f, fragY / view.height * 2.0f - 1.0f);
+        glm::vec4 nearPoint = invViewProj * glm::vec4(ndc, -1.0f, 1.0f);
+        glm::vec4 farPoint = invViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+        glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+        glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+        TraceRay primary = createRay(origin, direction);
+        HitInfo hit = castRay(primary, PRIMARY_MAX_DISTANCE, context);
+        if (!hit.hit) {
+            // The skybox is drawn without tone mapping
+            return context.lighting.skybox.isValid() ? context.lighting.skybox.sample(direction) : context.lighting.background;
+        }
+
+        // The hit stands in for the rasterized fragment (face normal, baked material, no textures)
+        glm::vec3 result = calculateRadianceLighting(hit.point, glm::normalize(hit.normal), hit.albedo, hit.emissiveness, context);
+
+        result = result / (result + glm::vec3(1.0f));
+        return glm::pow(result, glm::vec3(1.0f / 2.2f));
+    }
+
+    ReferenceRenderer::Image ReferenceRenderer::render(const View& view, const Settings& settings, const Lighting& lighting, Stats* stats) const {
+        Image image;
+        if (view.width <= 0 || view.height <= 0) return image;
+        image.width = view.width;
+        image.height = view.height;
+        image.pixels.assign(static_cast<size_t>(view.width) * view.height, glm::vec3(0.0f));
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        glm::mat4 invViewProj = glm::inverse(view.projection * view.view);
+
+        uint32_t tileSize = std::max(settings.tileSize, 1u);
+        uint32_t tilesX = (static_cast<uint32_t>(view.width) + tileSize - 1) / tileSize;
+        uint32_t tilesY = (static_cast<uint32_t>(view.height) + tileSize - 1) / tileSize;
+        std::atomic<uint64_t> totalRays{ 0 };
+
+        // One tile per chunk: idle threads keep claiming the next tile until none are left
+        ThreadPool& pool = ThreadPool::getInstance();
+        pool.parallelFor(0, static_cast<size_t>(tilesX) * tilesY, 1, [&](size_t tileBegin, size_t tileEnd) {
+            PathContext context{ settings, lighting, 0u, 0u };
+            for (size_t tile = tileBegin; tile < tileEnd; tile++) {
+                int x0 = static_cast<int>((tile % tilesX) * tileSize);
+                int y0 = static_cast<int>((tile / tilesX) * tileSize);
+                int x1 = std::min(x0 + static_cast<int>(tileSize), view.width);
+                int y1 = std::min(y0 + static_cast<int>(tileSize), view.height);
+                for (int y = y0; y < y1; y++) {
+                    for (int x = x0; x < x1; x++) {
+                        image.pixels[static_cast<size_t>(y) * view.width + x] = shadePixel(x, y, view, invViewProj, context);
+                    }
+                }
+            }
+            totalRays += context.rays;
+        });
+
+        if (stats) {
+            stats->renderMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+            stats->rays = totalRays.load();
+            stats->raysPerSecond = stats->renderMs > 0.0 ? stats->rays / (stats->renderMs * 1e-3) : 0.0;
+            stats->tiles = tilesX * tilesY;
+            stats->threads = pool.getThreadCount() + 1;
+        }
+        return image;
+    }
+
+}
@@ -0,0 +1,577 @@
+#include "../../headers/Engine/SceneBVH.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <cmath>
+#include <unordered_set>
+#include <filesystem>
+#include <chrono>
+
+namespace Engine {
+
+    namespace {
+        GPUBVHNode toGPUNode(const BVHNode& node, uint32_t leftFirst) {
+            GPUBVHNode gpuNode;
+            gpuNode.minX = node.minBounds.x;
+            gpuNode.minY = node.minBounds.y;
+            gpuNode.minZ = node.minBounds.z;
+            gpuNode.leftFirst = leftFirst;
+            gpuNode.maxX = node.maxBounds.x;
+            gpuNode.maxY = node.maxBounds.y;
+            gpuNode.maxZ = node.maxBounds.z;
+            gpuNode.triCount = node.triCount;
+            return gpuNode;
+        }
+
+        AABB transformBounds(const AABB& bounds, const glm::mat4& transform) {
+            AABB result;
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec3 point((corner & 1) ? bounds.maxBounds.x : bounds.minBounds.x,
+                                (corner & 2) ? bounds.maxBounds.y : bounds.minBounds.y,
+                                (corner & 4) ? bounds.maxBounds.z : bounds.minBounds.z);
+                result.expand(glm::vec3(transform * glm::vec4(point, 1.0f)));
+            }
+            return result;
+        }
+
+        void uploadSSBO(GLuint& buffer, GLuint binding, const void* data, size_t size) {
+            if (buffer == 0) {
+                glGenBuffers(1, &buffer);
+            }
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_STATIC_DRAW);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+        }
+    }
+
+    glm::mat4 SceneBVH::getModelMatrix(const Model& model) {
+        glm::mat4 modelMatrix = glm::mat4(1.0f);
+        modelMatrix = glm::translate(modelMatrix, model.position);
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.x), glm::vec3(1, 0, 0));
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.y), glm::vec3(0, 1, 0));
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.z), glm::vec3(0, 0, 1));
+        modelMatrix = glm::scale(modelMatrix, model.scale);
+        return modelMatrix;
+    }
+
+    SceneBVH::GeometryKey SceneBVH::makeKey(const Model& model) {
+        GeometryKey key;
+        key.geometryId = model.geometryId;
+        for (const auto& mesh : model.getMeshes()) {
+            key.triangleCount += static_cast<uint32_t>(mesh.indices.size() / 3);
+        }
+        return key;
+    }
+
+    std::shared_ptr<SceneBVH::BLAS> SceneBVH::buildBLAS(const Model& model) const {
+        auto blas = std::make_shared<BLAS>();
+
+        // Model-space triangles in mesh order; the builder stores them in leaf order and
+        // materialId keeps the mesh-order index
+        std::vector<BVHTriangle> triangles;
+        for (const auto& mesh : model.getMeshes()) {
+            const auto& vertices = mesh.vertices;
+            const auto& indices = mesh.indices;
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                const glm::vec3& v0 = vertices[indices[i]].position;
+                const glm::vec3& v1 = vertices[indices[i + 1]].position;
+                const glm::vec3& v2 = vertices[indices[i + 2]].position;
+                glm::vec3 normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+                triangles.emplace_back(v0, v1, v2, normal, model.color, model.emissive, model.shininess,
+                                       static_cast<int>(triangles.size()));
+            }
+        }
+
+        blas->cacheHash = BVHCache::hashTriangles(triangles, buildSettings);
+        blas->builder.setBuildSettings(buildSettings);
+
+        std::string cachePath = cacheDirectory.empty() ? std::string() : BVHCache::getCachePath(cacheDirectory, blas->cacheHash);
+        if (cachePath.empty() || !BVHCache::load(cachePath, blas->cacheHash, triangles, blas->builder)) {
+            std::cout << "Building BLAS for model '" << model.name << "' (" << triangles.size() << " triangles)..." << std::endl;
+            blas->builder.build(std::move(triangles));
+            if (!cachePath.empty()) {
+                BVHCache::save(cachePath, blas->cacheHash, blas->builder);
+            }
+        }
+        blas->triangleCount = blas->builder.getReferenceCount();
+        blas->localBounds = blas->builder.getNodes()[blas->builder.getRootNodeIndex()].getBounds();
+        return blas;
+    }
+
+    std::shared_ptr<const BVHBuilder> SceneBVH::findBLAS(const Model& model) const {
+        auto it = blasCache.find(makeKey(model));
+        if (it == blasCache.end() || !it->second) return nullptr;
+
+        // Aliases the BLAS, which stays alive as long as the builder is referenced
+        return std::shared_ptr<const BVHBuilder>(it->second, &it->second->builder);
+    }
+
+    void SceneBVH::update(const std::vector<Model>& models) {
+        tlasRebuilt = false;
+        lastRepackedTriangles = 0;
+
+        std::vector<GeometryKey> keys(models.size());
+        for (size_t i = 0; i < models.size(); i++) {
+            keys[i] = makeKey(models[i]);
+        }
+
+        // BLAS are only (re)built for geometry that was not seen before
+        bool blasChanged = keys.size() != modelKeys.size() || !std::equal(keys.begin(), keys.end(), modelKeys.begin());
+        if (blasChanged) {
+            modelBLAS.assign(models.size(), nullptr);
+            std::unordered_set<GeometryKey, GeometryKeyHash> usedKeys;
+            for (size_t i = 0; i < models.size(); i++) {
+                if (keys[i].triangleCount == 0) continue;
+
+                auto it = blasCache.find(keys[i]);
+                if (it == blasCache.end()) {
+                    it = blasCache.emplace(keys[i], buildBLAS(models[i])).first;
+                }
+                modelBLAS[i] = it->second;
+                usedKeys.insert(keys[i]);
+            }
+
+            // Drop BLAS of models that left the scene
+            for (auto it = blasCache.begin(); it != blasCache.end();) {
+                if (usedKeys.count(it->first) == 0) {
+                    it = blasCache.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            modelKeys = std::move(keys);
+        }
+
+        bool layoutChanged = packedWidth != bvhWidth;
+        if (blasChanged || layoutChanged) {
+            packBLAS(blasChanged);
+        }
+
+        packMaterials(models);
+
+        // The TLAS only depends on transforms and is cheap to rebuild
+        bool transformsChanged = modelTransforms.size() != models.size();
+        for (size_t i = 0; i < models.size() && !transformsChanged; i++) {
+            transformsChanged = modelTransforms[i] != getModelMatrix(models[i]);
+        }
+
+        if (blasChanged || layoutChanged || transformsChanged) {
+            buildTLAS(models);
+        }
+    }
+
+    void SceneBVH::setBuildSettings(const BVHBuilder::BuildSettings& settings) {
+        if (settings == buildSettings) return;
+
+        // Every BLAS is rebuilt with the new builder on the next update
+        buildSettings = settings;
+        blasCache.clear();
+        modelKeys.clear();
+
+        // The TLAS is rebuilt whenever a transform changes (every frame while models animate), so
+        // it follows the LBVH choice; spatial splits do not apply to instance bounds
+        BVHBuilder::BuildSettings tlasSettings;
+        tlasSettings.mode = settings.mode == BVHBuilder::BuildMode::LBVH ? BVHBuilder::BuildMode::LBVH
+                                                                          : BVHBuilder::BuildMode::BinnedSAH;
+        tlasBuilder.setBuildSettings(tlasSettings);
+    }
+
+    void SceneBVH::saveCache() const {
+        if (cacheDirectory.empty()) return;
+
+        size_t written = 0;
+        for (const auto& blas : modelBLAS) {
+            if (!blas) continue;
+            std::string path = BVHCache::getCachePath(cacheDirectory, blas->cacheHash);
+            if (std::filesystem::exists(path)) continue;
+            if (BVHCache::save(path, blas->cacheHash, blas->builder)) written++;
+        }
+        std::cout << "Wrote " << written << " BVH cache files to " << cacheDirectory << std::endl;
+    }
+
+    void SceneBVH::setBVHWidth(uint32_t width) {
+        bvhWidth = (width == 4 || width == 8) ? width : 2;
+    }
+
+    void SceneBVH::packBLAS(bool geometryChanged) {
+        gpuNodes.clear();
+        gpuWideNodes.clear();
+        modelRootNodes.assign(modelBLAS.size(), 0);
+        modelTriangleOffsets.assign(modelBLAS.size(), 0);
+        totalTriangles = 0;
+        double weightedSAHCost = 0.0;
+        blasInputTriangles = 0;
+
+        // The shader's wide traversal has a fixed stack: fall back to binary nodes when some BLAS
+        // could overflow it rather than dropping subtrees
+        traversalWidth = bvhWidth;
+        for (size_t i = 0; i < modelBLAS.size() && traversalWidth > 2; i++) {
+            if (!modelBLAS[i]) continue;
+            WideBVH& wide = modelBLAS[i]->wide;
+            if (wide.getWidth() != bvhWidth) {
+                wide.build(modelBLAS[i]->builder, bvhWidth);
+            }
+            if (!wide.fitsTraversalStack()) {
+                std::cerr << "SceneBVH: BVH" << bvhWidth << " of model " << i << " needs "
+                          << wide.getMaxStackDepth() << " stack entries (limit " << WideBVH::TRAVERSAL_STACK_SIZE
+                          << "), using binary BLAS nodes" << std::endl;
+                traversalWidth = 2;
+            }
+        }
+
+        for (size_t i = 0; i < modelBLAS.size(); i++) {
+            modelTriangleOffsets[i] = totalTriangles;
+            if (!modelBLAS[i]) continue;
+
+            const BVHBuilder& builder = modelBLAS[i]->builder;
+            uint32_t nodeOffset = static_cast<uint32_t>(gpuNodes.size());
+            uint32_t triangleOffset = totalTriangles;
+            modelRootNodes[i] = nodeOffset + builder.getRootNodeIndex();
+
+            // Child and triangle references become global indices
+            for (const auto& node : builder.getNodes()) {
+                uint32_t leftFirst = node.isLeaf() ? node.leftFirst + triangleOffset : node.leftFirst + nodeOffset;
+                gpuNodes.push_back(toGPUNode(node, leftFirst));
+            }
+            // Wide leaves address the same triangle ranges as the binary leaves
+            if (traversalWidth > 2) {
+                const WideBVH& wide = modelBLAS[i]->wide;
+                uint32_t wideOffset = static_cast<uint32_t>(gpuWideNodes.size() / wide.getNodeStride());
+                wide.appendTo(gpuWideNodes, wideOffset, triangleOffset);
+                modelRootNodes[i] = wideOffset;
+            } else if (bvhWidth == 2) {
+                modelBLAS[i]->wide.clear();
+            }
+
+            totalTriangles += modelBLAS[i]->triangleCount;
+            blasInputTriangles += builder.getInputTriangleCount();
+            weightedSAHCost += static_cast<double>(builder.computeSAHCost()) * builder.getInputTriangleCount();
+        }
+        blasSAHCost = blasInputTriangles > 0 ? static_cast<float>(weightedSAHCost / blasInputTriangles) : 0.0f;
+
+        blasDirty = true;
+        packedWidth = bvhWidth;
+        if (!geometryChanged) {
+            // Only the node layout changed, the triangle buffers stay valid
+            return;
+        }
+
+        // New layout: the geometry stream is rebuilt and every material re-packed
+        gpuTriangleGeometry.resize(totalTriangles);
+        gpuTriangleMaterials.resize(totalTriangles);
+        modelMaterials.assign(modelBLAS.size(), MaterialState());
+        trianglesReallocated = true;
+
+        ThreadPool& pool = ThreadPool::getInstance();
+        for (size_t i = 0; i < modelBLAS.size(); i++) {
+            if (!modelBLAS[i]) continue;
+
+            // Leaf-ordered model-space triangles with precomputed edges
+            const auto& triangles = modelBLAS[i]->builder.getTriangles();
+            uint32_t offset = modelTriangleOffsets[i];
+            pool.parallelFor(0, triangles.size(), 16 * 1024, [&](size_t begin, size_t end) {
+                for (size_t t = begin; t < end; t++) {
+                    const BVHTriangle& tri = triangles[t];
+                    glm::vec3 edge1 = tri.v1 - tri.v0;
+                    glm::vec3 edge2 = tri.v2 - tri.v0;
+                    GPUTriangleGeometry& gpuTri = gpuTriangleGeometry[offset + t];
+                    gpuTri.v0[0] = tri.v0.x; gpuTri.v0[1] = tri.v0.y; gpuTri.v0[2] = tri.v0.z; gpuTri.v0[3] = 0.0f;
+                    gpuTri.edge1[0] = edge1.x; gpuTri.edge1[1] = edge1.y; gpuTri.edge1[2] = edge1.z; gpuTri.edge1[3] = 0.0f;
+                    gpuTri.edge2[0] = edge2.x; gpuTri.edge2[1] = edge2.y; gpuTri.edge2[2] = edge2.z; gpuTri.edge2[3] = 0.0f;
+                }
+            });
+        }
+    }
+
+    WideBVH::TraversalComparison SceneBVH::measureTraversal(uint32_t width, uint32_t raysPerModel) const {
+        WideBVH::TraversalComparison total;
+        for (const auto& entry : blasCache) {
+            const BLAS& blas = *entry.second;
+            WideBVH collapsed;
+            const WideBVH* wide = &blas.wide;
+            if (blas.wide.getWidth() != width) {
+                collapsed.build(blas.builder, width);
+                wide = &collapsed;
+            }
+
+            WideBVH::TraversalComparison result = wide->compareTraversal(blas.builder, raysPerModel);
+            total.binaryNodesPerRay += result.binaryNodesPerRay * result.rayCount;
+            total.binaryTestsPerRay += result.binaryTestsPerRay * result.rayCount;
+            total.wideNodesPerRay += result.wideNodesPerRay * result.rayCount;
+            total.wideTestsPerRay += result.wideTestsPerRay * result.rayCount;
+            total.mismatches += result.mismatches;
+            total.rayCount += result.rayCount;
+        }
+
+        if (total.rayCount > 0) {
+            total.binaryNodesPerRay /= total.rayCount;
+            total.binaryTestsPerRay /= total.rayCount;
+            total.wideNodesPerRay /= total.rayCount;
+            total.wideTestsPerRay /= total.rayCount;
+        }
+        return total;
+    }
+
+    SceneBVHStats SceneBVH::analyze(const std::vector<Ray>& cameraRays) const {
+        SceneBVHStats stats;
+        if (!isBuilt()) return stats;
+
+        stats.tlas = BVHStats::analyze(tlasBuilder);
+        std::unordered_set<const BLAS*> analyzed;
+        double weightedSAHCost = 0.0;
+        for (const auto& blas : modelBLAS) {
+            if (!blas || !analyzed.insert(blas.get()).second) continue;
+            stats.blas.push_back(BVHStats::analyze(blas->builder));
+            const BVHStats& blasStats = stats.blas.back();
+            stats.blasTriangles += blasStats.primitiveCount;
+            weightedSAHCost += static_cast<double>(blasStats.sahCost) * blasStats.primitiveCount;
+            stats.blasBuildMs += blasStats.buildMs;
+            stats.blasPhases.prepareMs += blasStats.buildPhases.prepareMs;
+            stats.blasPhases.sortMs += blasStats.buildPhases.sortMs;
+            stats.blasPhases.hierarchyMs += blasStats.buildPhases.hierarchyMs;
+            stats.blasPhases.refitMs += blasStats.buildPhases.refitMs;
+            stats.blasPhases.finalizeMs += blasStats.buildPhases.finalizeMs;
+        }
+        if (stats.blasTriangles > 0) stats.blasSAHCost = weightedSAHCost / stats.blasTriangles;
+        stats.totalBytes = gpuNodes.size() * sizeof(GPUBVHNode) + gpuWideNodes.size() * sizeof(uint32_t) +
+                           gpuTLASNodes.size() * sizeof(GPUBVHNode) + gpuInstances.size() * sizeof(GPUInstance) +
+                           gpuTriangleGeometry.size() * sizeof(GPUTriangleGeometry) +
+                           gpuTriangleMaterials.size() * sizeof(GPUTriangleMaterial);
+
+        // TLAS then BLAS with a shared closest distance; rays keep their parameterization in
+        // model space, so a BLAS hit shortens the ray for the remaining instances
+        BVHStats::Traversal& traversal = stats.traversal;
+        if (cameraRays.empty()) return stats;
+        auto traceStart = std::chrono::high_resolution_clock::now();
+        uint64_t nodeSum = 0;
+        uint64_t testSum = 0;
+        uint64_t instanceSum = 0;
+        std::vector<uint32_t> stack;
+        for (const Ray& ray : cameraRays) {
+            glm::vec3 invDirection = 1.0f / ray.direction;
+            float tHit = FLT_MAX;
+            bool hit = false;
+            BVHTraversalStats rayStats;
+            uint32_t instancesEntered = 0;
+
+            stack.assign(1, tlasBuilder.getRootNodeIndex());
+            while (!stack.empty()) {
+                const BVHNode& node = tlasNodes[stack.back()];
+                stack.pop_back();
+                rayStats.nodesVisited++;
+
+                if (node.isLeaf()) {
+                    for (uint32_t i = 0; i < node.triCount; i++) {
+                        uint32_t instanceIdx = node.leftFirst + i;
+                        const GPUInstance& instance = gpuInstances[instanceIdx];
+                        glm::vec3 localOrigin = glm::vec3(instance.worldToLocal * glm::vec4(ray.origin, 1.0f));
+                        glm::vec3 localDirection = glm::vec3(instance.worldToLocal * glm::vec4(ray.direction, 0.0f));
+                        uint32_t triangleIdx;
+                        instancesEntered++;
+                        if (modelBLAS[instanceModels[instanceIdx]]->builder.intersect(localOrigin, localDirection, tHit, triangleIdx, &rayStats)) {
+                            hit = true;
+                        }
+                    }
+                    continue;
+                }
+
+                uint32_t childA = node.leftFirst;
+                uint32_t childB = node.leftFirst + 1;
+                float distA = BVHBuilder::intersectAABB(ray.origin, invDirection, tlasNodes[childA].minBounds, tlasNodes[childA].maxBounds);
+                float distB = BVHBuilder::intersectAABB(ray.origin, invDirection, tlasNodes[childB].minBounds, tlasNodes[childB].maxBounds);
+                if (distA > distB) {
+                    std::swap(distA, distB);
+                    std::swap(childA, childB);
+                }
+                if (distB < tHit) stack.push_back(childB);
+                if (distA < tHit) stack.push_back(childA);
+            }
+
+            if (hit) traversal.hitCount++;
+            nodeSum += rayStats.nodesVisited;
+            testSum += rayStats.triangleTests;
+            instanceSum += instancesEntered;
+            traversal.maxNodes = std::max(traversal.maxNodes, rayStats.nodesVisited);
+            traversal.maxTests = std::max(traversal.maxTests, rayStats.triangleTests);
+        }
+        traversal.timeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - traceStart).count();
+        traversal.rayCount = static_cast<uint32_t>(cameraRays.size());
+        traversal.nodesPerRay = static_cast<double>(nodeSum) / cameraRays.size();
+        traversal.testsPerRay = static_cast<double>(testSum) / cameraRays.size();
+        traversal.instancesPerRay = static_cast<double>(instanceSum) / cameraRays.size();
+        return stats;
+    }
+
+    void SceneBVH::packMaterials(const std::vector<Model>& models) {
+        ThreadPool& pool = ThreadPool::getInstance();
+
+        for (size_t i = 0; i < models.size(); i++) {
+            if (!modelBLAS[i]) continue;
+
+            const Model& model = models[i];
+            MaterialState material;
+            material.color = model.color;
+            material.emissive = model.emissive;
+            material.shininess = model.shininess;
+            if (material == modelMaterials[i]) continue;
+
+            // Same leaf order as the geometry stream
+            const auto& triangles = modelBLAS[i]->builder.getTriangles();
+            uint32_t offset = modelTriangleOffsets[i];
+            pool.parallelFor(0, triangles.size(), 16 * 1024, [&](size_t begin, size_t end) {
+                for (size_t t = begin; t < end; t++) {
+                    const BVHTriangle& tri = triangles[t];
+                    GPUTriangleMaterial& gpuMat = gpuTriangleMaterials[offset + t];
+                    gpuMat.normal[0] = tri.normal.x; gpuMat.normal[1] = tri.normal.y; gpuMat.normal[2] = tri.normal.z;
+                    gpuMat.normal[3] = material.shininess;
+                    gpuMat.color[0] = material.color.x; gpuMat.color[1] = material.color.y; gpuMat.color[2] = material.color.z;
+                    gpuMat.color[3] = material.emissive;
+                }
+            });
+
+            modelMaterials[i] = material;
+            lastRepackedTriangles += static_cast<uint32_t>(triangles.size());
+            if (!trianglesReallocated) {
+                dirtyMaterialRanges.emplace_back(offset, static_cast<uint32_t>(triangles.size()));
+            }
+        }
+    }
+
+    void SceneBVH::buildTLAS(const std::vector<Model>& models) {
+        modelTransforms.resize(models.size());
+
+        std::vector<AABB> instanceBounds;
+        std::vector<GPUInstance> instances;
+        std::vector<uint32_t> instanceModelIndices;
+        for (size_t i = 0; i < models.size(); i++) {
+            modelTransforms[i] = getModelMatrix(models[i]);
+            if (!modelBLAS[i]) continue;
+
+            // Zero scale (e.g. start of the spawn animation) has no inverse and nothing to hit
+            if (std::abs(glm::determinant(modelTransforms[i])) < 1e-12f) continue;
+
+            GPUInstance instance;
+            instance.worldToLocal = glm::inverse(modelTransforms[i]);
+            instance.rootNode = modelRootNodes[i];
+            instance.triangleOffset = modelTriangleOffsets[i];
+            instance.triangleCount = modelBLAS[i]->triangleCount;
+            instance.padding = 0;
+            instances.push_back(instance);
+            instanceModelIndices.push_back(static_cast<uint32_t>(i));
+            instanceBounds.push_back(transformBounds(modelBLAS[i]->localBounds, modelTransforms[i]));
+        }
+
+        tlasBuilder.build(instanceBounds);
+        tlasNodes = tlasBuilder.getNodes();
+
+        // Instances are stored in leaf order so TLAS leaves address them directly
+        const auto& order = tlasBuilder.getPrimitiveIndices();
+        gpuInstances.resize(order.size());
+        instanceModels.resize(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            gpuInstances[i] = instances[order[i]];
+            instanceModels[i] = instanceModelIndices[order[i]];
+        }
+
+        gpuTLASNodes.clear();
+        gpuTLASNodes.reserve(tlasNodes.size());
+        for (const auto& node : tlasNodes) {
+            gpuTLASNodes.push_back(toGPUNode(node, node.leftFirst));
+        }
+
+        tlasDirty = true;
+        tlasRebuilt = true;
+    }
+
+    void SceneBVH::uploadBuffers() {
+        if (trianglesReallocated) {
+            GLuint* buffers[] = { &triangleSSBO, &materialSSBO };
+            const void* data[] = { gpuTriangleGeometry.data(), gpuTriangleMaterials.data() };
+            size_t sizes[] = { gpuTriangleGeometry.size() * sizeof(GPUTriangleGeometry),
+                               gpuTriangleMaterials.size() * sizeof(GPUTriangleMaterial) };
+            for (int i = 0; i < 2; i++) {
+                if (*buffers[i] == 0) {
+                    glGenBuffers(1, buffers[i]);
+                }
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, *buffers[i]);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, sizes[i], data[i], GL_DYNAMIC_DRAW);
+            }
+            trianglesReallocated = false;
+            dirtyMaterialRanges.clear();
+        } else if (!dirtyMaterialRanges.empty()) {
+            // Material edits only touch the model's own sub-range of the cold stream
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialSSBO);
+            for (const auto& range : dirtyMaterialRanges) {
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, range.first * sizeof(GPUTriangleMaterial),
+                                range.second * sizeof(GPUTriangleMaterial), gpuTriangleMaterials.data() + range.first);
+            }
+            dirtyMaterialRanges.clear();
+        }
+
+        if (blasDirty) {
+            uploadSSBO(nodeSSBO, 1, gpuNodes.data(), gpuNodes.size() * sizeof(GPUBVHNode));
+            if (traversalWidth > 2) {
+                // Keep the binding valid even when empty
+                uint32_t empty = 0;
+                uploadSSBO(wideNodeSSBO, 5, gpuWideNodes.empty() ? &empty : gpuWideNodes.data(),
+                           gpuWideNodes.empty() ? sizeof(uint32_t) : gpuWideNodes.size() * sizeof(uint32_t));
+            }
+            std::cout << "BLAS buffers updated: " << gpuNodes.size() << " nodes, "
+                      << totalTriangles << " triangles in leaf order";
+            if (traversalWidth > 2) {
+                std::cout << ", " << getWideNodeCount() << " BVH" << traversalWidth << " nodes";
+            }
+            std::cout << std::endl;
+            blasDirty = false;
+        }
+        if (tlasDirty) {
+            uploadSSBO(tlasNodeSSBO, 3, gpuTLASNodes.data(), gpuTLASNodes.size() * sizeof(GPUBVHNode));
+            uploadSSBO(instanceSSBO, 4, gpuInstances.data(), gpuInstances.size() * sizeof(GPUInstance));
+            tlasDirty = false;
+        }
+
+        bindBuffers();
+    }
+
+    void SceneBVH::bindBuffers() const {
+        // Other passes may reuse the binding points
+        if (triangleSSBO != 0) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, triangleSSBO);
+        if (nodeSSBO != 0) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, nodeSSBO);
+        if (materialSSBO != 0) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, materialSSBO);
+        if (tlasNodeSSBO != 0) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, tlasNodeSSBO);
+        if (instanceSSBO != 0) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, instanceSSBO);
+        if (wideNodeSSBO != 0 && traversalWidth > 2) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, wideNodeSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    void SceneBVH::cleanup() {
+        GLuint* buffers[] = { &triangleSSBO, &materialSSBO, &nodeSSBO, &tlasNodeSSBO, &instanceSSBO, &wideNodeSSBO };
+        for (GLuint* buffer : buffers) {
+            if (*buffer != 0) {
+                glDeleteBuffers(1, buffer);
+                *buffer = 0;
+            }
+        }
+
+        blasCache.clear();
+        modelKeys.clear();
+        modelBLAS.clear();
+        modelTransforms.clear();
+        gpuNodes.clear();
+        gpuWideNodes.clear();
+        tlasNodes.clear();
+        gpuTLASNodes.clear();
+        gpuInstances.clear();
+        instanceModels.clear();
+        gpuTriangleGeometry.clear();
+        gpuTriangleGeometry.shrink_to_fit();
+        gpuTriangleMaterials.clear();
+        gpuTriangleMaterials.shrink_to_fit();
+        dirtyMaterialRanges.clear();
+        modelMaterials.clear();
+        totalTriangles = 0;
+        packedWidth = 0;
+        traversalWidth = 2;
+    }
+
+}
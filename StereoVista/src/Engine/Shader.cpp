@@ -175,4 +175,56 @@ namespace Engine {
     void Shader::setVec4(const std::string& name, glm::vec4 vec) {
         glUniform4fv(glGetUniformLocation(shaderID, name.c_str()), 1, &vec[0]);
     }
+
+    void Shader::setIVec3(const std::string& name, glm::ivec3 vec) {
+        glUniform3iv(glGetUniformLocation(shaderID, name.c_str()), 1, &vec[0]);
+    }
+
+    Shader* loadComputeShader(const std::string& computePath) {
+        std::vector<std::string> searchPaths = {
+            "./shaders/",
+            "./",
+            "assets/shaders/"
+        };
+
+        for (const auto& basePath : searchPaths) {
+            std::ifstream computeFile(basePath + computePath);
+            if (!computeFile.good()) continue;
+
+            std::stringstream computeStream;
+            computeStream << computeFile.rdbuf();
+            std::string computeCode = computeStream.str();
+            const char* cShaderCode = computeCode.c_str();
+
+            int success;
+            char infoLog[512];
+
+            GLuint compute = glCreateShader(GL_COMPUTE_SHADER);
+            glShaderSource(compute, 1, &cShaderCode, NULL);
+            glCompileShader(compute);
+            glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+            if (!success) {
+                glGetShaderInfoLog(compute, 512, NULL, infoLog);
+                std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+                glDeleteShader(compute);
+                throw std::runtime_error("Compute shader compilation failed");
+            }
+
+            GLuint program = glCreateProgram();
+            glAttachShader(program, compute);
+            glLinkProgram(program);
+            glDeleteShader(compute);
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if (!success) {
+                glGetProgramInfoLog(program, 512, NULL, infoLog);
+                std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+                glDeleteProgram(program);
+                throw std::runtime_error("Shader program linking failed");
+            }
+
+            return new Shader(program);
+        }
+
+        throw std::runtime_error("Unable to find shader file " + computePath);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,725 @@
+#include "../../headers/Engine/SimdBVH.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Engine {
+
+    SimdLevel detectSimdLevel() {
+        static const SimdLevel detected = []() {
+            // SSE2 is part of x64; AVX2 needs the CPU bits, FMA and OS support for the YMM state
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            int maxLeaf = info[0];
+            __cpuid(info, 1);
+            bool fma = (info[2] & (1 << 12)) != 0;
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            bool avx2 = false;
+            if (maxLeaf >= 7) {
+                __cpuidex(info, 7, 0);
+                avx2 = (info[1] & (1 << 5)) != 0;
+            }
+            bool ymmState = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+            return (fma && avx && avx2 && ymmState) ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#else
+            __builtin_cpu_init();
+            return (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#endif
+        }();
+        return detected;
+    }
+
+    const char* getSimdLevelName(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::AVX2: return "AVX2";
+            case SimdLevel::SSE2: return "SSE2";
+            default: return "Scalar";
+        }
+    }
+
+    namespace {
+
+        constexpr float TRIANGLE_EPSILON = 0.0000001f;     // Same as BVHBuilder::intersectTriangle
+        constexpr int STACK_SIZE = 512;
+
+        // 1 / direction with zero components replaced by a tiny value, so slab terms never become
+        // 0 * inf (NaN) for rays starting on a bounding plane
+        inline glm::vec3 safeInverse(const glm::vec3& direction) {
+            glm::vec3 inverse;
+            for (int axis = 0; axis < 3; axis++) {
+                float d = direction[axis];
+                inverse[axis] = 1.0f / (std::abs(d) > 1e-20f ? d : std::copysign(1e-20f, d));
+            }
+            return inverse;
+        }
+
+        // Read-only view of the node and triangle streams handed to the kernels
+        struct KernelView {
+            const float* nodes;
+            uint32_t width;
+            uint32_t stride;
+            const float* triangles;
+            size_t planeStride;
+
+            const float* node(uint32_t idx) const { return nodes + static_cast<size_t>(idx) * stride; }
+            const float* plane(int p) const { return triangles + p * planeStride; }
+            uint32_t child(const float* node, uint32_t slot) const {
+                uint32_t word;
+                std::memcpy(&word, node + 6 * width + slot, sizeof(word));
+                return word;
+            }
+        };
+
+        // Traversal stack entry: child word plus entry distance, so entries behind a closer hit are skipped
+        struct StackEntry {
+            uint32_t word;
+            float dist;
+        };
+
+        // Push the hit children far to near, so the nearest is popped first
+        inline void pushSorted(StackEntry* stack, int& stackIndex, StackEntry* hits, int hitCount) {
+            for (int i = 1; i < hitCount; i++) {
+                StackEntry entry = hits[i];
+                int j = i - 1;
+                while (j >= 0 && hits[j].dist < entry.dist) {
+                    hits[j + 1] = hits[j];
+                    j--;
+                }
+                hits[j + 1] = entry;
+            }
+            for (int i = 0; i < hitCount && stackIndex < STACK_SIZE; i++) {
+                stack[stackIndex++] = hits[i];
+            }
+        }
+
+        // ---- Scalar kernels ----
+
+        bool intersectLeafScalar(const KernelView& bvh, uint32_t word, const glm::vec3& origin, const glm::vec3& direction,
+                                 bool anyHit, float& tHit, uint32_t& triangleIdx) {
+            uint32_t first = word & SimdBVH::LEAF_FIRST_MASK;
+            uint32_t count = (word & ~SimdBVH::LEAF_FLAG) >> SimdBVH::LEAF_COUNT_SHIFT;
+            bool hit = false;
+            for (uint32_t i = first; i < first + count; i++) {
+                glm::vec3 v0(bvh.plane(0)[i], bvh.plane(1)[i], bvh.plane(2)[i]);
+                glm::vec3 edge1(bvh.plane(3)[i], bvh.plane(4)[i], bvh.plane(5)[i]);
+                glm::vec3 edge2(bvh.plane(6)[i], bvh.plane(7)[i], bvh.plane(8)[i]);
+
+                glm::vec3 h = glm::cross(direction, edge2);
+                float a = glm::dot(edge1, h);
+                if (std::abs(a) < TRIANGLE_EPSILON) continue;
+                float f = 1.0f / a;
+                glm::vec3 s = origin - v0;
+                float u = f * glm::dot(s, h);
+                if (u < 0.0f || u > 1.0f) continue;
+                glm::vec3 q = glm::cross(s, edge1);
+                float v = f * glm::dot(direction, q);
+                if (v < 0.0f || u + v > 1.0f) continue;
+                float t = f * glm::dot(edge2, q);
+                if (t > TRIANGLE_EPSILON && t < tHit) {
+                    tHit = t;
+                    triangleIdx = i;
+                    hit = true;
+                    if (anyHit) return true;
+                }
+            }
+            return hit;
+        }
+
+        bool traverseScalar(const KernelView& bvh, const glm::vec3& origin, const glm::vec3& direction,
+                            bool anyHit, float& tHit, uint32_t& triangleIdx) {
+            glm::vec3 invDirection = safeInverse(direction);
+            int nearPlane[3], farPlane[3];
+            for (int axis = 0; axis < 3; axis++) {
+                nearPlane[axis] = std::signbit(direction[axis]) ? axis + 3 : axis;
+                farPlane[axis] = std::signbit(direction[axis]) ? axis : axis + 3;
+            }
+
+            StackEntry stack[STACK_SIZE];
+            int stackIndex = 0;
+            stack[stackIndex++] = { 0, 0.0f };
+            bool hit = false;
+
+            while (stackIndex > 0) {
+                StackEntry entry = stack[--stackIndex];
+                if (entry.dist >= tHit) continue;
+
+                if (entry.word & SimdBVH::LEAF_FLAG) {
+                    if (intersectLeafScalar(bvh, entry.word, origin, direction, anyHit, tHit, triangleIdx)) {
+                        hit = true;
+                        if (anyHit) return true;
+                    }
+                    continue;
+                }
+
+                const float* node = bvh.node(entry.word);
+                StackEntry hits[SimdBVH::MAX_WIDTH];
+                int hitCount = 0;
+                for (uint32_t slot = 0; slot < bvh.width; slot++) {
+                    float tNear = 0.0f;
+                    float tFar = tHit;
+                    for (int axis = 0; axis < 3; axis++) {
+                        tNear = std::max(tNear, (node[nearPlane[axis] * bvh.width + slot] - origin[axis]) * invDirection[axis]);
+                        tFar = std::min(tFar, (node[farPlane[axis] * bvh.width + slot] - origin[axis]) * invDirection[axis]);
+                    }
+                    if (tNear <= tFar) {
+                        hits[hitCount++] = { bvh.child(node, slot), tNear };
+                    }
+                }
+                pushSorted(stack, stackIndex, hits, hitCount);
+            }
+            return hit;
+        }
+
+        // ---- SIMD kernels, written once over a lane abstraction ----
+
+        struct SSE2Ops {
+            static constexpr uint32_t W = 4;
+            using V = __m128;
+            static V zero() { return _mm_setzero_ps(); }
+            static V set1(float x) { return _mm_set1_ps(x); }
+            static V load(const float* p) { return _mm_loadu_ps(p); }
+            static void store(float* p, V a) { _mm_storeu_ps(p, a); }
+            static V laneIndex() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+            static V add(V a, V b) { return _mm_add_ps(a, b); }
+            static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+            static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+            static V div(V a, V b) { return _mm_div_ps(a, b); }
+            static V min(V a, V b) { return _mm_min_ps(a, b); }
+            static V max(V a, V b) { return _mm_max_ps(a, b); }
+            static V abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+            static V cmpLE(V a, V b) { return _mm_cmple_ps(a, b); }
+            static V cmpLT(V a, V b) { return _mm_cmplt_ps(a, b); }
+            static V cmpGE(V a, V b) { return _mm_cmpge_ps(a, b); }
+            static V cmpGT(V a, V b) { return _mm_cmpgt_ps(a, b); }
+            static V andMask(V a, V b) { return _mm_and_ps(a, b); }
+            static V select(V mask, V ifTrue, V ifFalse) { return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse)); }
+            static int bits(V mask) { return _mm_movemask_ps(mask); }
+        };
+
+        // MSVC emits AVX2/FMA intrinsics without /arch:AVX2; these only run after detectSimdLevel()
+        struct AVX2Ops {
+            static constexpr uint32_t W = 8;
+            using V = __m256;
+            static V zero() { return _mm256_setzero_ps(); }
+            static V set1(float x) { return _mm256_set1_ps(x); }
+            static V load(const float* p) { return _mm256_loadu_ps(p); }
+            static void store(float* p, V a) { _mm256_storeu_ps(p, a); }
+            static V laneIndex() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+            static V add(V a, V b) { return _mm256_add_ps(a, b); }
+            static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+            static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+            static V div(V a, V b) { return _mm256_div_ps(a, b); }
+            static V min(V a, V b) { return _mm256_min_ps(a, b); }
+            static V max(V a, V b) { return _mm256_max_ps(a, b); }
+            static V abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+            static V cmpLE(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+            static V cmpLT(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+            static V cmpGE(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+            static V cmpGT(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+            static V andMask(V a, V b) { return _mm256_and_ps(a, b); }
+            static V select(V mask, V ifTrue, V ifFalse) { return _mm256_blendv_ps(ifFalse, ifTrue, mask); }
+            static int bits(V mask) { return _mm256_movemask_ps(mask); }
+        };
+
+        // Lane-wise Möller-Trumbore; returns the hit mask (before the tHit test) and t
+        template <typename Ops>
+        typename Ops::V intersectTrianglesSimd(typename Ops::V ox, typename Ops::V oy, typename Ops::V oz,
+                                               typename Ops::V dx, typename Ops::V dy, typename Ops::V dz,
+                                               typename Ops::V v0x, typename Ops::V v0y, typename Ops::V v0z,
+                                               typename Ops::V e1x, typename Ops::V e1y, typename Ops::V e1z,
+                                               typename Ops::V e2x, typename Ops::V e2y, typename Ops::V e2z,
+                                               typename Ops::V& t) {
+            using V = typename Ops::V;
+            V hx = Ops::sub(Ops::mul(dy, e2z), Ops::mul(dz, e2y));
+            V hy = Ops::sub(Ops::mul(dz, e2x), Ops::mul(dx, e2z));
+            V hz = Ops::sub(Ops::mul(dx, e2y), Ops::mul(dy, e2x));
+            V a = Ops::add(Ops::add(Ops::mul(e1x, hx), Ops::mul(e1y, hy)), Ops::mul(e1z, hz));
+            V f = Ops::div(Ops::set1(1.0f), a);
+
+            V sx = Ops::sub(ox, v0x);
+            V sy = Ops::sub(oy, v0y);
+            V sz = Ops::sub(oz, v0z);
+            V u = Ops::mul(f, Ops::add(Ops::add(Ops::mul(sx, hx), Ops::mul(sy, hy)), Ops::mul(sz, hz)));
+
+            V qx = Ops::sub(Ops::mul(sy, e1z), Ops::mul(sz, e1y));
+            V qy = Ops::sub(Ops::mul(sz, e1x), Ops::mul(sx, e1z));
+            V qz = Ops::sub(Ops::mul(sx, e1y), Ops::mul(sy, e1x));
+            V v = Ops::mul(f, Ops::add(Ops::add(Ops::mul(dx, qx), Ops::mul(dy, qy)), Ops::mul(dz, qz)));
+            t = Ops::mul(f, Ops::add(Ops::add(Ops::mul(e2x, qx), Ops::mul(e2y, qy)), Ops::mul(e2z, qz)));
+
+            V zero = Ops::zero();
+            V one = Ops::set1(1.0f);
+            V epsilon = Ops::set1(TRIANGLE_EPSILON);
+            V mask = Ops::cmpGE(Ops::abs(a), epsilon);
+            mask = Ops::andMask(mask, Ops::andMask(Ops::cmpGE(u, zero), Ops::cmpLE(u, one)));
+            mask = Ops::andMask(mask, Ops::andMask(Ops::cmpGE(v, zero), Ops::cmpLE(Ops::add(u, v), one)));
+            return Ops::andMask(mask, Ops::cmpGT(t, epsilon));
+        }
+
+        // Single ray: one slab test per node covers all W children, one triangle test per leaf
+        template <typename Ops>
+        bool traverseSimd(const KernelView& bvh, const glm::vec3& origin, const glm::vec3& direction,
+                          bool anyHit, float& tHit, uint32_t& triangleIdx) {
+            using V = typename Ops::V;
+            constexpr uint32_t W = Ops::W;
+
+            glm::vec3 invDirection = safeInverse(direction);
+            uint32_t nearOffset[3], farOffset[3];
+            for (int axis = 0; axis < 3; axis++) {
+                nearOffset[axis] = (std::signbit(direction[axis]) ? axis + 3 : axis) * W;
+                farOffset[axis] = (std::signbit(direction[axis]) ? axis : axis + 3) * W;
+            }
+
+            V invX = Ops::set1(invDirection.x), invY = Ops::set1(invDirection.y), invZ = Ops::set1(invDirection.z);
+            V ox = Ops::set1(origin.x), oy = Ops::set1(origin.y), oz = Ops::set1(origin.z);
+            V dx = Ops::set1(direction.x), dy = Ops::set1(direction.y), dz = Ops::set1(direction.z);
+            V lanes = Ops::laneIndex();
+            V zero = Ops::zero();
+
+            StackEntry stack[STACK_SIZE];
+            int stackIndex = 0;
+            stack[stackIndex++] = { 0, 0.0f };
+            bool hit = false;
+            alignas(32) float values[W];
+
+            while (stackIndex > 0) {
+                StackEntry entry = stack[--stackIndex];
+                if (entry.dist >= tHit) continue;
+
+                if (entry.word & SimdBVH::LEAF_FLAG) {
+                    uint32_t first = entry.word & SimdBVH::LEAF_FIRST_MASK;
+                    uint32_t count = (entry.word & ~SimdBVH::LEAF_FLAG) >> SimdBVH::LEAF_COUNT_SHIFT;
+                    V t;
+                    V mask = intersectTrianglesSimd<Ops>(ox, oy, oz, dx, dy, dz,
+                        Ops::load(bvh.plane(0) + first), Ops::load(bvh.plane(1) + first), Ops::load(bvh.plane(2) + first),
+                        Ops::load(bvh.plane(3) + first), Ops::load(bvh.plane(4) + first), Ops::load(bvh.plane(5) + first),
+                        Ops::load(bvh.plane(6) + first), Ops::load(bvh.plane(7) + first), Ops::load(bvh.plane(8) + first), t);
+                    mask = Ops::andMask(mask, Ops::cmpLT(lanes, Ops::set1(static_cast<float>(count))));
+                    mask = Ops::andMask(mask, Ops::cmpLT(t, Ops::set1(tHit)));
+                    int hitBits = Ops::bits(mask);
+                    if (hitBits == 0) continue;
+                    if (anyHit) return true;
+
+                    Ops::store(values, t);
+                    for (uint32_t lane = 0; lane < W; lane++) {
+                        if ((hitBits & (1 << lane)) && values[lane] < tHit) {
+                            tHit = values[lane];
+                            triangleIdx = first + lane;
+                        }
+                    }
+                    hit = true;
+                    continue;
+                }
+
+                const float* node = bvh.node(entry.word);
+                V tNear = Ops::max(Ops::max(Ops::mul(Ops::sub(Ops::load(node + nearOffset[0]), ox), invX),
+                                            Ops::mul(Ops::sub(Ops::load(node + nearOffset[1]), oy), invY)),
+                                   Ops::max(Ops::mul(Ops::sub(Ops::load(node + nearOffset[2]), oz), invZ), zero));
+                V tFar = Ops::min(Ops::min(Ops::mul(Ops::sub(Ops::load(node + farOffset[0]), ox), invX),
+                                           Ops::mul(Ops::sub(Ops::load(node + farOffset[1]), oy), invY)),
+                                  Ops::min(Ops::mul(Ops::sub(Ops::load(node + farOffset[2]), oz), invZ), Ops::set1(tHit)));
+                int hitBits = Ops::bits(Ops::cmpLE(tNear, tFar));
+                if (hitBits == 0) continue;
+
+                Ops::store(values, tNear);
+                StackEntry hits[W];
+                int hitCount = 0;
+                for (uint32_t slot = 0; slot < W; slot++) {
+                    if (hitBits & (1 << slot)) {
+                        hits[hitCount++] = { bvh.child(node, slot), values[slot] };
+                    }
+                }
+                pushSorted(stack, stackIndex, hits, hitCount);
+            }
+            return hit;
+        }
+
+        // Packet of up to W coherent rays (one per lane) sharing one traversal
+        template <typename Ops>
+        void traversePacket(const KernelView& bvh, const glm::vec3* origins, const glm::vec3* directions, uint32_t count,
+                            float* tHit, uint32_t* triangleIdx) {
+            using V = typename Ops::V;
+            constexpr uint32_t W = Ops::W;
+
+            // Unused lanes repeat ray 0 with a negative tHit, so they never hit
+            alignas(32) float lanes[10][W];
+            for (uint32_t lane = 0; lane < W; lane++) {
+                uint32_t ray = lane < count ? lane : 0;
+                glm::vec3 invDirection = safeInverse(directions[ray]);
+                for (int axis = 0; axis < 3; axis++) {
+                    lanes[axis][lane] = origins[ray][axis];
+                    lanes[3 + axis][lane] = directions[ray][axis];
+                    lanes[6 + axis][lane] = invDirection[axis];
+                }
+                lanes[9][lane] = lane < count ? tHit[lane] : -1.0f;
+                if (lane < count) triangleIdx[lane] = SimdBVH::INVALID_TRIANGLE;
+            }
+            V ox = Ops::load(lanes[0]), oy = Ops::load(lanes[1]), oz = Ops::load(lanes[2]);
+            V dx = Ops::load(lanes[3]), dy = Ops::load(lanes[4]), dz = Ops::load(lanes[5]);
+            V invX = Ops::load(lanes[6]), invY = Ops::load(lanes[7]), invZ = Ops::load(lanes[8]);
+            V tHitV = Ops::load(lanes[9]);
+            V zero = Ops::zero();
+
+            StackEntry stack[STACK_SIZE];
+            int stackIndex = 0;
+            stack[stackIndex++] = { 0, 0.0f };
+            alignas(32) float values[W];
+
+            while (stackIndex > 0) {
+                StackEntry entry = stack[--stackIndex];
+
+                if (entry.word & SimdBVH::LEAF_FLAG) {
+                    uint32_t first = entry.word & SimdBVH::LEAF_FIRST_MASK;
+                    uint32_t triangleCount = (entry.word & ~SimdBVH::LEAF_FLAG) >> SimdBVH::LEAF_COUNT_SHIFT;
+                    for (uint32_t i = first; i < first + triangleCount; i++) {
+                        V t;
+                        V mask = intersectTrianglesSimd<Ops>(ox, oy, oz, dx, dy, dz,
+                            Ops::set1(bvh.plane(0)[i]), Ops::set1(bvh.plane(1)[i]), Ops::set1(bvh.plane(2)[i]),
+                            Ops::set1(bvh.plane(3)[i]), Ops::set1(bvh.plane(4)[i]), Ops::set1(bvh.plane(5)[i]),
+                            Ops::set1(bvh.plane(6)[i]), Ops::set1(bvh.plane(7)[i]), Ops::set1(bvh.plane(8)[i]), t);
+                        mask = Ops::andMask(mask, Ops::cmpLT(t, tHitV));
+                        int hitBits = Ops::bits(mask);
+                        if (hitBits == 0) continue;
+                        tHitV = Ops::select(mask, t, tHitV);
+                        for (uint32_t lane = 0; lane < count; lane++) {
+                            if (hitBits & (1 << lane)) triangleIdx[lane] = i;
+                        }
+                    }
+                    continue;
+                }
+
+                const float* node = bvh.node(entry.word);
+                StackEntry hits[SimdBVH::MAX_WIDTH];
+                int hitCount = 0;
+                for (uint32_t slot = 0; slot < bvh.width; slot++) {
+                    uint32_t word = bvh.child(node, slot);
+                    if (word == SimdBVH::EMPTY_CHILD) continue;
+
+                    V t0x = Ops::mul(Ops::sub(Ops::set1(node[0 * bvh.width + slot]), ox), invX);
+                    V t0y = Ops::mul(Ops::sub(Ops::set1(node[1 * bvh.width + slot]), oy), invY);
+                    V t0z = Ops::mul(Ops::sub(Ops::set1(node[2 * bvh.width + slot]), oz), invZ);
+                    V t1x = Ops::mul(Ops::sub(Ops::set1(node[3 * bvh.width + slot]), ox), invX);
+                    V t1y = Ops::mul(Ops::sub(Ops::set1(node[4 * bvh.width + slot]), oy), invY);
+                    V t1z = Ops::mul(Ops::sub(Ops::set1(node[5 * bvh.width + slot]), oz), invZ);
+                    V tNear = Ops::max(Ops::max(Ops::min(t0x, t1x), Ops::min(t0y, t1y)), Ops::max(Ops::min(t0z, t1z), zero));
+                    V tFar = Ops::min(Ops::min(Ops::max(t0x, t1x), Ops::max(t0y, t1y)), Ops::min(Ops::max(t0z, t1z), tHitV));
+                    int hitBits = Ops::bits(Ops::cmpLE(tNear, tFar));
+                    if (hitBits == 0) continue;
+
+                    // Order children by the nearest entry over the lanes that hit them
+                    Ops::store(values, tNear);
+                    float nearest = FLT_MAX;
+                    for (uint32_t lane = 0; lane < W; lane++) {
+                        if (hitBits & (1 << lane)) nearest = std::min(nearest, values[lane]);
+                    }
+                    hits[hitCount++] = { word, nearest };
+                }
+                pushSorted(stack, stackIndex, hits, hitCount);
+            }
+
+            Ops::store(values, tHitV);
+            for (uint32_t lane = 0; lane < count; lane++) {
+                tHit[lane] = values[lane];
+            }
+        }
+
+        double raysPerSecond(uint32_t rayCount, std::chrono::high_resolution_clock::time_point start) {
+            double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            return seconds > 0.0 ? rayCount / seconds : 0.0;
+        }
+
+    } // namespace
+
+    void SimdBVH::clear() {
+        level = SimdLevel::Scalar;
+        width = 0;
+        nodeData.clear();
+        triangleData.clear();
+        planeStride = 0;
+    }
+
+    void SimdBVH::build(const BVHBuilder& binary, SimdLevel requestedLevel) {
+        clear();
+        if (binary.getNodes().empty() || binary.getTriangles().empty()) return;
+
+        level = std::min(requestedLevel, detectSimdLevel());
+        width = level == SimdLevel::AVX2 ? 8 : 4;
+
+        // SoA triangle planes in leaf order, padded so full-width loads at any leaf stay in bounds
+        const auto& triangles = binary.getTriangles();
+        planeStride = triangles.size() + MAX_WIDTH;
+        triangleData.assign(planeStride * 9, 0.0f);
+        for (size_t i = 0; i < triangles.size(); i++) {
+            const BVHTriangle& tri = triangles[i];
+            glm::vec3 edge1 = tri.v1 - tri.v0;
+            glm::vec3 edge2 = tri.v2 - tri.v0;
+            for (int axis = 0; axis < 3; axis++) {
+                triangleData[axis * planeStride + i] = tri.v0[axis];
+                triangleData[(3 + axis) * planeStride + i] = edge1[axis];
+                triangleData[(6 + axis) * planeStride + i] = edge2[axis];
+            }
+        }
+
+        buildNode(binary, makeRef(binary, binary.getRootNodeIndex()));
+    }
+
+    SimdBVH::ChildRef SimdBVH::makeRef(const BVHBuilder& binary, uint32_t nodeIdx) const {
+        const BVHNode& node = binary.getNodes()[nodeIdx];
+        ChildRef ref;
+        ref.bounds = node.getBounds();
+        ref.binaryNode = nodeIdx;
+        ref.leaf = node.isLeaf();
+        if (ref.leaf) {
+            ref.first = node.leftFirst;
+            ref.count = node.triCount;
+        }
+        return ref;
+    }
+
+    SimdBVH::ChildRef SimdBVH::makeLeafSlice(const BVHBuilder& binary, uint32_t first, uint32_t count) const {
+        const auto& triangles = binary.getTriangles();
+
+        ChildRef ref;
+        ref.leaf = true;
+        ref.first = first;
+        ref.count = count;
+        for (uint32_t i = 0; i < count; i++) {
+            ref.bounds.expand(triangles[first + i].bounds);
+        }
+        return ref;
+    }
+
+    void SimdBVH::expand(const BVHBuilder& binary, const ChildRef& ref, ChildRef& a, ChildRef& b) const {
+        if (!ref.leaf) {
+            uint32_t left = binary.getNodes()[ref.binaryNode].leftFirst;
+            a = makeRef(binary, left);
+            b = makeRef(binary, left + 1);
+        } else {
+            // Leaves larger than one SIMD batch are sliced (their triangles are contiguous)
+            uint32_t half = ref.count / 2;
+            a = makeLeafSlice(binary, ref.first, half);
+            b = makeLeafSlice(binary, ref.first + half, ref.count - half);
+        }
+    }
+
+    uint32_t SimdBVH::buildNode(const BVHBuilder& binary, const ChildRef& ref) {
+        uint32_t stride = getNodeStride();
+        uint32_t nodeIdx = getNodeCount();
+        nodeData.resize(nodeData.size() + stride);
+
+        // Greedy collapse: open the largest expandable child until the node is full
+        // (a root that is a single small leaf stays one leaf child)
+        std::vector<ChildRef> children(1, ref);
+        while (children.size() < width) {
+            int best = -1;
+            float bestArea = -1.0f;
+            for (size_t i = 0; i < children.size(); i++) {
+                if (!canExpand(children[i])) continue;
+                float area = children[i].bounds.getSurfaceArea();
+                if (area > bestArea) {
+                    bestArea = area;
+                    best = static_cast<int>(i);
+                }
+            }
+            if (best < 0) break;
+
+            ChildRef a, b;
+            expand(binary, children[best], a, b);
+            children[best] = a;
+            children.push_back(b);
+        }
+
+        // Empty slots: inverted bounds and no child
+        size_t base = static_cast<size_t>(nodeIdx) * stride;
+        for (uint32_t slot = 0; slot < width; slot++) {
+            for (int axis = 0; axis < 3; axis++) {
+                nodeData[base + axis * width + slot] = FLT_MAX;
+                nodeData[base + (3 + axis) * width + slot] = -FLT_MAX;
+            }
+            std::memcpy(&nodeData[base + 6 * width + slot], &EMPTY_CHILD, sizeof(uint32_t));
+        }
+
+        for (uint32_t slot = 0; slot < children.size(); slot++) {
+            const ChildRef& child = children[slot];
+            uint32_t childWord;
+            if (canExpand(child)) {
+                childWord = buildNode(binary, child);
+            } else {
+                if (child.first > LEAF_FIRST_MASK) {
+                    std::cerr << "SimdBVH: triangle index " << child.first << " exceeds the leaf encoding" << std::endl;
+                }
+                childWord = LEAF_FLAG | (child.count << LEAF_COUNT_SHIFT) | (child.first & LEAF_FIRST_MASK);
+            }
+
+            // buildNode may have grown nodeData
+            for (int axis = 0; axis < 3; axis++) {
+                nodeData[base + axis * width + slot] = child.bounds.minBounds[axis];
+                nodeData[base + (3 + axis) * width + slot] = child.bounds.maxBounds[axis];
+            }
+            std::memcpy(&nodeData[base + 6 * width + slot], &childWord, sizeof(uint32_t));
+        }
+
+        return nodeIdx;
+    }
+
+    bool SimdBVH::intersect(const glm::vec3& origin, const glm::vec3& direction, float& tHit, uint32_t& triangleIdx) const {
+        if (nodeData.empty()) return false;
+        KernelView view{ nodeData.data(), width, getNodeStride(), triangleData.data(), planeStride };
+        switch (level) {
+            case SimdLevel::AVX2: return traverseSimd<AVX2Ops>(view, origin, direction, false, tHit, triangleIdx);
+            case SimdLevel::SSE2: return traverseSimd<SSE2Ops>(view, origin, direction, false, tHit, triangleIdx);
+            default: return traverseScalar(view, origin, direction, false, tHit, triangleIdx);
+        }
+    }
+
+    bool SimdBVH::intersectAny(const glm::vec3& origin, const glm::vec3& direction, float tMax) const {
+        if (nodeData.empty()) return false;
+        KernelView view{ nodeData.data(), width, getNodeStride(), triangleData.data(), planeStride };
+        uint32_t triangleIdx = 0;
+        switch (level) {
+            case SimdLevel::AVX2: return traverseSimd<AVX2Ops>(view, origin, direction, true, tMax, triangleIdx);
+            case SimdLevel::SSE2: return traverseSimd<SSE2Ops>(view, origin, direction, true, tMax, triangleIdx);
+            default: return traverseScalar(view, origin, direction, true, tMax, triangleIdx);
+        }
+    }
+
+    void SimdBVH::intersectPacket(const glm::vec3* origins, const glm::vec3* directions, uint32_t count,
+                                  float* tHit, uint32_t* triangleIdx) const {
+        count = std::min(count, MAX_PACKET);
+        if (nodeData.empty()) {
+            std::fill(triangleIdx, triangleIdx + count, INVALID_TRIANGLE);
+            return;
+        }
+
+        KernelView view{ nodeData.data(), width, getNodeStride(), triangleData.data(), planeStride };
+        switch (level) {
+            case SimdLevel::AVX2:
+                traversePacket<AVX2Ops>(view, origins, directions, count, tHit, triangleIdx);
+                break;
+            case SimdLevel::SSE2:
+                for (uint32_t first = 0; first < count; first += SSE2Ops::W) {
+                    traversePacket<SSE2Ops>(view, origins + first, directions + first,
+                                            std::min(SSE2Ops::W, count - first), tHit + first, triangleIdx + first);
+                }
+                break;
+            default:
+                for (uint32_t i = 0; i < count; i++) {
+                    triangleIdx[i] = INVALID_TRIANGLE;
+                    traverseScalar(view, origins[i], directions[i], false, tHit[i], triangleIdx[i]);
+                }
+                break;
+        }
+    }
+
+    SimdBVH::Benchmark SimdBVH::benchmark(const BVHBuilder& binary, uint32_t rayCount) {
+        Benchmark result;
+        if (binary.getNodes().empty() || binary.getTriangles().empty()) return result;
+
+        // Pinhole view of the bounds; rays are ordered in 4x2 tiles so every MAX_PACKET
+        // consecutive rays form a coherent packet
+        AABB bounds = binary.getNodes()[binary.getRootNodeIndex()].getBounds();
+        glm::vec3 center = bounds.getCenter();
+        float radius = std::max(glm::length(bounds.getSize()) * 0.5f, 1e-3f);
+        glm::vec3 eye = center + glm::normalize(glm::vec3(0.6f, 0.5f, 0.8f)) * radius * 2.5f;
+        glm::vec3 forward = glm::normalize(center - eye);
+        glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+        glm::vec3 up = glm::cross(right, forward);
+
+        uint32_t side = std::max(8u, (static_cast<uint32_t>(std::sqrt(static_cast<double>(rayCount))) + 7) / 8 * 8);
+        std::vector<glm::vec3> origins(static_cast<size_t>(side) * side, eye);
+        std::vector<glm::vec3> directions;
+        directions.reserve(origins.size());
+        for (uint32_t tileY = 0; tileY < side; tileY += 2) {
+            for (uint32_t tileX = 0; tileX < side; tileX += 4) {
+                for (uint32_t y = tileY; y < tileY + 2; y++) {
+                    for (uint32_t x = tileX; x < tileX + 4; x++) {
+                        float sx = ((x + 0.5f) / side) * 2.0f - 1.0f;
+                        float sy = ((y + 0.5f) / side) * 2.0f - 1.0f;
+                        directions.push_back(glm::normalize(forward + (right * sx + up * sy) * 0.45f));
+                    }
+                }
+            }
+        }
+
+        // One packet of axis-aligned rays with +0 and -0 components (negated vectors and unrotated
+        // matrices produce them); the slab planes must follow the sign bit, not a < 0 test
+        glm::vec3 size = bounds.getSize();
+        for (uint32_t i = 0; i < MAX_PACKET; i++) {
+            float zero = (i & 1) ? -0.0f : 0.0f;
+            float offset = ((i / 2) % 4) * 0.1f - 0.15f;
+            if (i < MAX_PACKET / 2) {
+                origins.push_back(glm::vec3(center.x + offset * size.x, center.y - offset * size.y, bounds.maxBounds.z + radius));
+                directions.push_back(glm::vec3(zero, zero, -1.0f));
+            } else {
+                origins.push_back(glm::vec3(bounds.maxBounds.x + radius, center.y + offset * size.y, center.z + offset * size.z));
+                directions.push_back(glm::vec3(-1.0f, zero, -zero));
+            }
+        }
+        uint32_t count = static_cast<uint32_t>(directions.size());
+        result.rayCount = count;
+
+        std::vector<float> reference(count, FLT_MAX);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t triangleIdx;
+            binary.intersect(origins[i], directions[i], reference[i], triangleIdx);
+        }
+        result.binaryRaysPerSecond = raysPerSecond(count, start);
+
+        auto countMismatch = [&](uint32_t i, float t) {
+            float expected = reference[i];
+            bool expectedHit = expected < FLT_MAX;
+            if ((t < FLT_MAX) != expectedHit || (expectedHit && std::abs(t - expected) > 1e-4f * std::max(1.0f, expected))) {
+                result.mismatches++;
+            }
+        };
+
+        SimdLevel detected = detectSimdLevel();
+        for (SimdLevel kernelLevel : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+            if (kernelLevel > detected) break;
+            SimdBVH bvh;
+            bvh.build(binary, kernelLevel);
+
+            std::vector<float> tHit(count, FLT_MAX);
+            start = std::chrono::high_resolution_clock::now();
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t triangleIdx;
+                bvh.intersect(origins[i], directions[i], tHit[i], triangleIdx);
+            }
+            double rate = raysPerSecond(count, start);
+            for (uint32_t i = 0; i < count; i++) countMismatch(i, tHit[i]);
+
+            if (kernelLevel == SimdLevel::Scalar) result.scalarRaysPerSecond = rate;
+            else if (kernelLevel == SimdLevel::SSE2) result.sse2RaysPerSecond = rate;
+            else result.avx2RaysPerSecond = rate;
+
+            if (kernelLevel == detected) {
+                std::fill(tHit.begin(), tHit.end(), FLT_MAX);
+                std::vector<uint32_t> triangleIdx(count);
+                start = std::chrono::high_resolution_clock::now();
+                for (uint32_t first = 0; first < count; first += MAX_PACKET) {
+                    bvh.intersectPacket(&origins[first], &directions[first], std::min(MAX_PACKET, count - first),
+                                        &tHit[first], &triangleIdx[first]);
+                }
+                result.packetRaysPerSecond = raysPerSecond(count, start);
+                for (uint32_t i = 0; i < count; i++) countMismatch(i, tHit[i]);
+            }
+        }
+
+        std::cout << "CPU ray kernels (" << count << " coherent rays, Mrays/s per core): binary "
+                  << result.binaryRaysPerSecond * 1e-6 << ", scalar " << result.scalarRaysPerSecond * 1e-6
+                  << ", SSE2 " << result.sse2RaysPerSecond * 1e-6 << ", AVX2 " << result.avx2RaysPerSecond * 1e-6
+                  << ", " << getSimdLevelName(detected) << " packets " << result.packetRaysPerSecond * 1e-6
+                  << ", mismatches " << result.mismatches << std::endl;
+        return result;
+    }
+
+}
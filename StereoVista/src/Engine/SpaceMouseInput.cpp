@@ -50,7 +50,7 @@ public:
             {navlib::pivot_visible_k, GetPivotVisible, SetPivotVisible, reinterpret_cast<navlib::param_t>(this)},
             {navlib::pivot_user_k, IsUserPivot, nullptr, reinterpret_cast<navlib::param_t>(this)},
             
-            // Hit testing (dummy implementations)
+            // Hit testing (answered by OnHitTest)
             {navlib::hit_lookfrom_k, nullptr, SetHitLookFrom, reinterpret_cast<navlib::param_t>(this)},
             {navlib::hit_direction_k, nullptr, SetHitDirection, reinterpret_cast<navlib::param_t>(this)},
             {navlib::hit_aperture_k, nullptr, SetHitAperture, reinterpret_cast<navlib::param_t>(this)},
@@ -181,18 +181,45 @@ public:
         return self->IsUserPivotImpl(value);
     }
 
-    // Dummy hit testing functions
-    static long __cdecl SetHitLookFrom(navlib::param_t param, navlib::property_t name, const navlib::value_t* value) { return 0; }
-    static long __cdecl SetHitDirection(navlib::param_t param, navlib::property_t name, const navlib::value_t* value) { return 0; }
-    static long __cdecl SetHitAperture(navlib::param_t param, navlib::property_t name, const navlib::value_t* value) { return 0; }
-    static long __cdecl SetHitSelectionOnly(navlib::param_t param, navlib::property_t name, const navlib::value_t* value) { return 0; }
+    // Hit testing: navlib writes the ray, then reads the look-at point
+    static long __cdecl SetHitLookFrom(navlib::param_t param, navlib::property_t name, const navlib::value_t* value) {
+        NavigationModel* self = reinterpret_cast<NavigationModel*>(param);
+        self->m_hitLookFrom = glm::vec3(value->point.x, value->point.y, value->point.z);
+        return 0;
+    }
+
+    static long __cdecl SetHitDirection(navlib::param_t param, navlib::property_t name, const navlib::value_t* value) {
+        NavigationModel* self = reinterpret_cast<NavigationModel*>(param);
+        self->m_hitDirection = glm::vec3(value->vector.x, value->vector.y, value->vector.z);
+        return 0;
+    }
+
+    static long __cdecl SetHitAperture(navlib::param_t param, navlib::property_t name, const navlib::value_t* value) {
+        NavigationModel* self = reinterpret_cast<NavigationModel*>(param);
+        self->m_hitAperture = static_cast<float>(value->d);
+        return 0;
+    }
+
+    static long __cdecl SetHitSelectionOnly(navlib::param_t param, navlib::property_t name, const navlib::value_t* value) {
+        NavigationModel* self = reinterpret_cast<NavigationModel*>(param);
+        self->m_hitSelectionOnly = value->b != 0;
+        return 0;
+    }
+
     static long __cdecl GetHitLookAt(navlib::param_t param, navlib::property_t name, navlib::value_t* value) {
-        return navlib::make_result_code(navlib::navlib_errc::no_data_available);
+        NavigationModel* self = reinterpret_cast<NavigationModel*>(param);
+        return self->GetHitLookAtImpl(value);
     }
 
     SpaceMouseInput* m_parent;
     navlib::nlHandle_t m_navlibHandle;
     mutable std::mutex m_mutex;
+
+    // Pending hit test ray
+    glm::vec3 m_hitLookFrom = glm::vec3(0.0f);
+    glm::vec3 m_hitDirection = glm::vec3(0.0f, 0.0f, -1.0f);
+    float m_hitAperture = 0.0f;
+    bool m_hitSelectionOnly = false;
     
 public:
     bool m_motionActive;
@@ -396,6 +423,20 @@ private:
         return 0;
     }
 
+    long GetHitLookAtImpl(navlib::value_t* value) {
+        glm::vec3 hitPoint;
+        if (!m_parent->OnHitTest || glm::length(m_hitDirection) == 0.0f ||
+            !m_parent->OnHitTest(m_hitLookFrom, glm::normalize(m_hitDirection), m_hitAperture, m_hitSelectionOnly, hitPoint)) {
+            return navlib::make_result_code(navlib::navlib_errc::no_data_available);
+        }
+
+        value->type = navlib::point_type;
+        value->point.x = hitPoint.x;
+        value->point.y = hitPoint.y;
+        value->point.z = hitPoint.z;
+        return 0;
+    }
+
     long SetPivotPositionImpl(const navlib::value_t* value) {
         return 0; // Accept but ignore
     }
@@ -0,0 +1,127 @@
+#include "../../headers/Engine/SparseVoxelVolume.h"
+#include "../../headers/Engine/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Engine {
+
+    namespace {
+        // 2x2x2 box filter of a cubic texel block (x fastest) into one of half the size
+        void downsample(const glm::u8vec4* source, int sourceSize, glm::u8vec4* target) {
+            int targetSize = sourceSize / 2;
+            for (int z = 0; z < targetSize; z++) {
+                for (int y = 0; y < targetSize; y++) {
+                    for (int x = 0; x < targetSize; x++) {
+                        glm::vec4 sum(0.0f);
+                        for (int corner = 0; corner < 8; corner++) {
+                            int sx = 2 * x + (corner & 1), sy = 2 * y + ((corner >> 1) & 1), sz = 2 * z + (corner >> 2);
+                            sum += glm::vec4(source[(sz * sourceSize + sy) * sourceSize + sx]);
+                        }
+                        target[(z * targetSize + y) * targetSize + x] = glm::u8vec4(glm::round(sum / 8.0f));
+                    }
+                }
+            }
+        }
+    }
+
+    void SparseVoxelVolume::reset(const glm::ivec3& windowOrigin, int windowResolution, float windowVoxelSize) {
+        origin = windowOrigin;
+        resolution = windowResolution;
+        voxelSize = windowVoxelSize;
+        bricksPerAxis = windowResolution / BRICK_SIZE;
+
+        brickMap.assign(static_cast<size_t>(bricksPerAxis) * bricksPerAxis * bricksPerAxis, EMPTY_BRICK);
+        brickCoords.clear();
+        for (auto& pool : brickPools) pool.clear();
+        coarseLevels.clear();
+    }
+
+    int SparseVoxelVolume::getLevelCount() const {
+        return resolution > 0 ? static_cast<int>(std::log2(resolution)) + 1 : 0;
+    }
+
+    uint32_t SparseVoxelVolume::getBrickIndex(const glm::ivec3& brick) const {
+        if (glm::any(glm::lessThan(brick, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(brick, glm::ivec3(bricksPerAxis)))) {
+            return EMPTY_BRICK;
+        }
+        return brickMap[(static_cast<size_t>(brick.z) * bricksPerAxis + brick.y) * bricksPerAxis + brick.x];
+    }
+
+    uint32_t SparseVoxelVolume::allocateBrick(const glm::ivec3& brick) {
+        uint32_t& entry = brickMap[(static_cast<size_t>(brick.z) * bricksPerAxis + brick.y) * bricksPerAxis + brick.x];
+        if (entry != EMPTY_BRICK) return entry;
+
+        entry = static_cast<uint32_t>(brickCoords.size());
+        brickCoords.push_back(brick);
+        for (int level = 0; level < BRICK_LEVELS; level++) {
+            brickPools[level].resize(brickPools[level].size() + getBrickTexelCount(level), glm::u8vec4(0));
+        }
+        return entry;
+    }
+
+    glm::u8vec4* SparseVoxelVolume::getBrickTexels(uint32_t index, int level) {
+        return brickPools[level].data() + static_cast<size_t>(index) * getBrickTexelCount(level);
+    }
+
+    const glm::u8vec4* SparseVoxelVolume::getBrickTexels(uint32_t index, int level) const {
+        return brickPools[level].data() + static_cast<size_t>(index) * getBrickTexelCount(level);
+    }
+
+    glm::u8vec4 SparseVoxelVolume::fetch(const glm::ivec3& voxel, int level) const {
+        int levelResolution = resolution >> level;
+        if (glm::any(glm::lessThan(voxel, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(voxel, glm::ivec3(levelResolution)))) {
+            return glm::u8vec4(0);
+        }
+
+        // Coarse levels are dense
+        if (level >= BRICK_LEVELS - 1) {
+            const auto& coarse = coarseLevels[level - (BRICK_LEVELS - 1)];
+            return coarse[(static_cast<size_t>(voxel.z) * levelResolution + voxel.y) * levelResolution + voxel.x];
+        }
+
+        int brickTexels = BRICK_SIZE >> level;
+        uint32_t index = getBrickIndex(voxel / brickTexels);
+        if (index == EMPTY_BRICK) return glm::u8vec4(0);
+        glm::ivec3 local = voxel % brickTexels;
+        return getBrickTexels(index, level)[(local.z * brickTexels + local.y) * brickTexels + local.x];
+    }
+
+    void SparseVoxelVolume::generateMips() {
+        // In-brick levels, brick by brick
+        ThreadPool::getInstance().parallelFor(0, brickCoords.size(), 0, [&](size_t begin, size_t end) {
+            for (size_t index = begin; index < end; index++) {
+                for (int level = 1; level < BRICK_LEVELS; level++) {
+                    downsample(getBrickTexels(static_cast<uint32_t>(index), level - 1), BRICK_SIZE >> (level - 1),
+                               getBrickTexels(static_cast<uint32_t>(index), level));
+                }
+            }
+        });
+
+        // Coarse levels: the 1^3 level of every brick, then a dense mip chain
+        coarseLevels.clear();
+        coarseLevels.emplace_back(brickMap.size(), glm::u8vec4(0));
+        for (uint32_t index = 0; index < getBrickCount(); index++) {
+            const glm::ivec3& brick = brickCoords[index];
+            coarseLevels[0][(static_cast<size_t>(brick.z) * bricksPerAxis + brick.y) * bricksPerAxis + brick.x] = getBrickTexels(index, BRICK_LEVELS - 1)[0];
+        }
+        for (int size = bricksPerAxis; size > 1; size /= 2) {
+            std::vector<glm::u8vec4> level(static_cast<size_t>(size / 2) * (size / 2) * (size / 2));
+            downsample(coarseLevels.back().data(), size, level.data());
+            coarseLevels.push_back(std::move(level));
+        }
+    }
+
+    size_t SparseVoxelVolume::getMemoryBytes() const {
+        size_t bytes = brickMap.size() * sizeof(uint32_t) + brickCoords.size() * sizeof(glm::ivec3);
+        for (const auto& pool : brickPools) bytes += pool.size() * sizeof(glm::u8vec4);
+        for (const auto& level : coarseLevels) bytes += level.size() * sizeof(glm::u8vec4);
+        return bytes;
+    }
+
+    size_t SparseVoxelVolume::getDenseMemoryBytes() const {
+        size_t texels = 0;
+        for (size_t size = resolution; size >= 1; size /= 2) texels += size * size * size;
+        return texels * sizeof(glm::u8vec4);
+    }
+
+}
@@ -0,0 +1,183 @@
+#include "../../headers/Engine/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+
+namespace Engine {
+
+    ThreadPool::ThreadPool(size_t threadCount) {
+        if (threadCount == 0) {
+            unsigned int hardwareThreads = std::thread::hardware_concurrency();
+            threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+
+        for (size_t i = 0; i < threadCount; ++i) {
+            m_workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+
+        for (auto& worker : m_workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+    }
+
+    ThreadPool& ThreadPool::getInstance() {
+        static ThreadPool instance;
+        return instance;
+    }
+
+    void ThreadPool::submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push(std::move(task));
+        }
+        m_condition.notify_one();
+    }
+
+    bool ThreadPool::runPendingTask() {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_tasks.empty()) {
+                return false;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+        return true;
+    }
+
+    void ThreadPool::workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+
+                if (m_stop && m_tasks.empty()) {
+                    return;
+                }
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+            }
+            task();
+        }
+    }
+
+    void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain,
+                                 const std::function<void(size_t, size_t)>& body) {
+        if (end <= begin) {
+            return;
+        }
+
+        size_t count = end - begin;
+        if (grain == 0) {
+            grain = std::max<size_t>(1, count / ((m_workers.size() + 1) * 4));
+        }
+
+        size_t chunkCount = (count + grain - 1) / grain;
+        if (chunkCount == 1 || m_workers.empty()) {
+            body(begin, end);
+            return;
+        }
+
+        // Shared state outlives this call so helpers that start late find no work and exit
+        struct LoopState {
+            std::function<void(size_t, size_t)> body;
+            size_t begin, end, grain, chunkCount;
+            std::atomic<size_t> nextChunk{ 0 };
+            std::atomic<size_t> remainingChunks{ 0 };
+            std::mutex doneMutex;
+            std::condition_variable doneCondition;
+        };
+
+        auto state = std::make_shared<LoopState>();
+        state->body = body;
+        state->begin = begin;
+        state->end = end;
+        state->grain = grain;
+        state->chunkCount = chunkCount;
+        state->remainingChunks = chunkCount;
+
+        auto runChunks = [](LoopState& s) {
+            while (true) {
+                size_t chunk = s.nextChunk.fetch_add(1);
+                if (chunk >= s.chunkCount) {
+                    return;
+                }
+
+                size_t chunkBegin = s.begin + chunk * s.grain;
+                size_t chunkEnd = std::min(chunkBegin + s.grain, s.end);
+                s.body(chunkBegin, chunkEnd);
+
+                if (s.remainingChunks.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lock(s.doneMutex);
+                    s.doneCondition.notify_all();
+                }
+            }
+        };
+
+        size_t helperCount = std::min(m_workers.size(), chunkCount - 1);
+        for (size_t i = 0; i < helperCount; ++i) {
+            submit([state, runChunks]() { runChunks(*state); });
+        }
+
+        // The calling thread works on the loop too
+        runChunks(*state);
+
+        // Help with other queued work until our last chunk finishes
+        while (state->remainingChunks.load() > 0) {
+            if (runPendingTask()) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(state->doneMutex);
+            state->doneCondition.wait_for(lock, std::chrono::microseconds(200),
+                [&state] { return state->remainingChunks.load() == 0; });
+        }
+    }
+
+    TaskGroup::TaskGroup(ThreadPool& pool)
+        : m_pool(pool), m_state(std::make_shared<State>()) {
+    }
+
+    TaskGroup::~TaskGroup() {
+        wait();
+    }
+
+    void TaskGroup::run(std::function<void()> task) {
+        m_state->pending.fetch_add(1);
+
+        auto state = m_state;
+        m_pool.submit([state, task = std::move(task)]() {
+            task();
+            if (state->pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->condition.notify_all();
+            }
+        });
+    }
+
+    void TaskGroup::wait() {
+        while (m_state->pending.load() > 0) {
+            if (m_pool.runPendingTask()) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_state->mutex);
+            m_state->condition.wait_for(lock, std::chrono::microseconds(200),
+                [this] { return m_state->pending.load() == 0; });
+        }
+    }
+
+}
@@ -0,0 +1,354 @@
+#include "../../headers/Engine/WideBVH.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace Engine {
+
+    namespace {
+        inline uint32_t floatBits(float value) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        inline float bitsToFloat(uint32_t bits) {
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        // Power-of-two scale so that 255 steps cover the extent; returns the biased exponent
+        inline uint32_t quantizationExponent(float extent) {
+            if (!(extent > 0.0f)) return 1;
+            int exponent = static_cast<int>(std::ceil(std::log2(extent * 1.0001f / 255.0f)));
+            while (extent * 1.0001f > 255.0f * std::ldexp(1.0f, exponent)) exponent++;
+            exponent = std::max(-126, std::min(127, exponent));
+            return static_cast<uint32_t>(exponent + 127);
+        }
+    }
+
+    void WideBVH::clear() {
+        width = 0;
+        maxStackDepth = 0;
+        nodeData.clear();
+    }
+
+    void WideBVH::build(const BVHBuilder& binary, uint32_t targetWidth) {
+        clear();
+        if (binary.getNodes().empty() || (targetWidth != 4 && targetWidth != 8)) {
+            return;
+        }
+
+        width = targetWidth;
+        nodeData.reserve(binary.getNodes().size() / 2 * getNodeStride());
+
+        ChildRef root = makeRef(binary, binary.getRootNodeIndex());
+        if (!canExpand(root)) {
+            // Single small leaf: wrap it in a node with one child
+            uint32_t stride = getNodeStride();
+            nodeData.assign(stride, 0);
+            uint32_t exponents[3];
+            for (int axis = 0; axis < 3; axis++) {
+                nodeData[axis] = floatBits(root.bounds.minBounds[axis]);
+                exponents[axis] = quantizationExponent(root.bounds.maxBounds[axis] - root.bounds.minBounds[axis]);
+            }
+            nodeData[3] = exponents[0] | (exponents[1] << 8) | (exponents[2] << 16) | (1u << 24);
+            uint32_t planeWords = width / 4;
+            for (int axis = 0; axis < 3; axis++) {
+                nodeData[4 + (3 + axis) * planeWords] = 255;
+            }
+            nodeData[4 + 6 * planeWords] = LEAF_FLAG | (root.count << LEAF_COUNT_SHIFT) | root.first;
+            maxStackDepth = 1;
+            return;
+        }
+
+        buildNode(binary, root, maxStackDepth);
+
+        std::cout << "BVH" << width << " collapsed: " << getNodeCount() << " nodes from "
+                  << binary.getNodes().size() << " binary nodes ("
+                  << nodeData.size() * sizeof(uint32_t) / 1024 << " KB, stack depth "
+                  << maxStackDepth << ")" << std::endl;
+    }
+
+    WideBVH::ChildRef WideBVH::makeRef(const BVHBuilder& binary, uint32_t nodeIdx) const {
+        const BVHNode& node = binary.getNodes()[nodeIdx];
+        ChildRef ref;
+        ref.bounds = node.getBounds();
+        ref.binaryNode = nodeIdx;
+        ref.leaf = node.isLeaf();
+        if (ref.leaf) {
+            ref.first = node.leftFirst;
+            ref.count = node.triCount;
+        }
+        return ref;
+    }
+
+    WideBVH::ChildRef WideBVH::makeLeafSlice(const BVHBuilder& binary, uint32_t first, uint32_t count) const {
+        const auto& triangles = binary.getTriangles();
+
+        ChildRef ref;
+        ref.leaf = true;
+        ref.first = first;
+        ref.count = count;
+        for (uint32_t i = 0; i < count; i++) {
+            ref.bounds.expand(triangles[first + i].bounds);
+        }
+        return ref;
+    }
+
+    void WideBVH::expand(const BVHBuilder& binary, const ChildRef& ref, ChildRef& a, ChildRef& b) const {
+        if (!ref.leaf) {
+            uint32_t left = binary.getNodes()[ref.binaryNode].leftFirst;
+            a = makeRef(binary, left);
+            b = makeRef(binary, left + 1);
+        } else {
+            // Leaves above the encodable size are sliced (their triangles are contiguous)
+            uint32_t half = ref.count / 2;
+            a = makeLeafSlice(binary, ref.first, half);
+            b = makeLeafSlice(binary, ref.first + half, ref.count - half);
+        }
+    }
+
+    uint32_t WideBVH::buildNode(const BVHBuilder& binary, const ChildRef& ref, uint32_t& stackDepth) {
+        uint32_t stride = getNodeStride();
+        uint32_t nodeIdx = static_cast<uint32_t>(nodeData.size() / stride);
+        nodeData.resize(nodeData.size() + stride, 0);
+
+        // Greedy collapse: open the largest expandable child until the node is full
+        std::vector<ChildRef> children(2);
+        expand(binary, ref, children[0], children[1]);
+        while (children.size() < width) {
+            int best = -1;
+            float bestArea = -1.0f;
+            for (size_t i = 0; i < children.size(); i++) {
+                if (!canExpand(children[i])) continue;
+                float area = children[i].bounds.getSurfaceArea();
+                if (area > bestArea) {
+                    bestArea = area;
+                    best = static_cast<int>(i);
+                }
+            }
+            if (best < 0) break;
+
+            ChildRef a, b;
+            expand(binary, children[best], a, b);
+            children[best] = a;
+            children.push_back(b);
+        }
+
+        // Quantization frame of this node
+        AABB nodeBounds;
+        for (const auto& child : children) {
+            nodeBounds.expand(child.bounds);
+        }
+
+        glm::vec3 origin = nodeBounds.minBounds;
+        glm::vec3 scale;
+        uint32_t exponents[3];
+        for (int axis = 0; axis < 3; axis++) {
+            exponents[axis] = quantizationExponent(nodeBounds.maxBounds[axis] - origin[axis]);
+            scale[axis] = bitsToFloat(exponents[axis] << 23);
+        }
+
+        uint32_t base = nodeIdx * stride;
+        uint32_t planeWords = width / 4;
+        uint32_t childBase = base + 4 + 6 * planeWords;
+        for (int axis = 0; axis < 3; axis++) {
+            nodeData[base + axis] = floatBits(origin[axis]);
+        }
+        nodeData[base + 3] = exponents[0] | (exponents[1] << 8) | (exponents[2] << 16) |
+                             (static_cast<uint32_t>(children.size()) << 24);
+
+        uint32_t internalChildren = 0;
+        uint32_t maxChildDepth = 0;
+        for (uint32_t i = 0; i < children.size(); i++) {
+            const ChildRef& child = children[i];
+
+            // Conservative 8-bit bounds: decoded box always contains the child
+            for (int axis = 0; axis < 3; axis++) {
+                float lo = std::floor((child.bounds.minBounds[axis] - origin[axis]) / scale[axis]);
+                float hi = std::ceil((child.bounds.maxBounds[axis] - origin[axis]) / scale[axis]);
+                uint32_t qlo = static_cast<uint32_t>(std::max(0.0f, std::min(255.0f, lo)));
+                uint32_t qhi = static_cast<uint32_t>(std::max(0.0f, std::min(255.0f, hi)));
+                while (qlo > 0 && origin[axis] + qlo * scale[axis] > child.bounds.minBounds[axis]) qlo--;
+                while (qhi < 255 && origin[axis] + qhi * scale[axis] < child.bounds.maxBounds[axis]) qhi++;
+
+                uint32_t shift = (i % 4) * 8;
+                nodeData[base + 4 + axis * planeWords + i / 4] |= qlo << shift;
+                nodeData[base + 4 + (3 + axis) * planeWords + i / 4] |= qhi << shift;
+            }
+
+            uint32_t childWord;
+            if (canExpand(child)) {
+                uint32_t childDepth = 0;
+                childWord = buildNode(binary, child, childDepth);
+                internalChildren++;
+                maxChildDepth = std::max(maxChildDepth, childDepth);
+            } else {
+                if (child.first > LEAF_FIRST_MASK) {
+                    std::cerr << "WideBVH: triangle index " << child.first << " exceeds the leaf encoding" << std::endl;
+                }
+                childWord = LEAF_FLAG | (child.count << LEAF_COUNT_SHIFT) | (child.first & LEAF_FIRST_MASK);
+            }
+            nodeData[childBase + i] = childWord;
+        }
+
+        // Popping this node pushes its internal children; at worst the subtree with the deepest
+        // stack is visited while all of its siblings are still below it
+        stackDepth = internalChildren > 0 ? internalChildren - 1 + maxChildDepth : 1;
+        return nodeIdx;
+    }
+
+    void WideBVH::appendTo(std::vector<uint32_t>& out, uint32_t nodeOffset, uint32_t triangleOffset) const {
+        uint32_t stride = getNodeStride();
+        uint32_t planeWords = width / 4;
+        size_t outBase = out.size();
+        out.insert(out.end(), nodeData.begin(), nodeData.end());
+
+        for (uint32_t node = 0; node < getNodeCount(); node++) {
+            size_t base = outBase + static_cast<size_t>(node) * stride;
+            uint32_t childCount = out[base + 3] >> 24;
+            for (uint32_t i = 0; i < childCount; i++) {
+                uint32_t& word = out[base + 4 + 6 * planeWords + i];
+                if (word & LEAF_FLAG) {
+                    uint32_t first = (word & LEAF_FIRST_MASK) + triangleOffset;
+                    if (first > LEAF_FIRST_MASK) {
+                        std::cerr << "WideBVH: scene triangle index " << first << " exceeds the leaf encoding" << std::endl;
+                    }
+                    word = (word & ~LEAF_FIRST_MASK) | (first & LEAF_FIRST_MASK);
+                } else {
+                    word += nodeOffset;
+                }
+            }
+        }
+    }
+
+    void WideBVH::decodeChild(uint32_t nodeIdx, uint32_t child, glm::vec3& minBounds, glm::vec3& maxBounds) const {
+        uint32_t base = nodeIdx * getNodeStride();
+        uint32_t planeWords = width / 4;
+        uint32_t shift = (child % 4) * 8;
+        uint32_t header = nodeData[base + 3];
+
+        for (int axis = 0; axis < 3; axis++) {
+            float origin = bitsToFloat(nodeData[base + axis]);
+            float scale = bitsToFloat(((header >> (axis * 8)) & 0xFFu) << 23);
+            uint32_t qlo = (nodeData[base + 4 + axis * planeWords + child / 4] >> shift) & 0xFFu;
+            uint32_t qhi = (nodeData[base + 4 + (3 + axis) * planeWords + child / 4] >> shift) & 0xFFu;
+            minBounds[axis] = origin + qlo * scale;
+            maxBounds[axis] = origin + qhi * scale;
+        }
+    }
+
+    bool WideBVH::intersect(const BVHBuilder& binary, const glm::vec3& origin, const glm::vec3& direction,
+                            float& tHit, uint32_t& triangleIdx, BVHTraversalStats* stats) const {
+        if (nodeData.empty()) return false;
+        if (!fitsTraversalStack()) {
+            return binary.intersect(origin, direction, tHit, triangleIdx, stats);
+        }
+
+        const auto& triangles = binary.getTriangles();
+        glm::vec3 invDirection = 1.0f / direction;
+        uint32_t planeWords = width / 4;
+        bool hit = false;
+
+        auto testLeaf = [&](uint32_t word) {
+            uint32_t first = word & LEAF_FIRST_MASK;
+            uint32_t count = (word >> LEAF_COUNT_SHIFT) & MAX_LEAF_TRIANGLES;
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t triIdx = first + i;
+                float t;
+                if (stats) stats->triangleTests++;
+                if (BVHBuilder::intersectTriangle(origin, direction, triangles[triIdx], t) && t < tHit) {
+                    tHit = t;
+                    triangleIdx = triIdx;
+                    hit = true;
+                }
+            }
+        };
+
+        // Never overflows: the build bounds the depth (maxStackDepth <= TRAVERSAL_STACK_SIZE)
+        uint32_t stack[TRAVERSAL_STACK_SIZE];
+        int stackIndex = 0;
+        stack[stackIndex++] = 0;
+
+        while (stackIndex > 0) {
+            uint32_t nodeIdx = stack[--stackIndex];
+            if (stats) stats->nodesVisited++;
+
+            uint32_t childBase = nodeIdx * getNodeStride() + 4 + 6 * planeWords;
+            uint32_t childCount = nodeData[nodeIdx * getNodeStride() + 3] >> 24;
+
+            // Leaves are tested right away, internal children are pushed far to near
+            float hitDistance[8];
+            uint32_t hitChild[8];
+            int hitCount = 0;
+            for (uint32_t i = 0; i < childCount; i++) {
+                glm::vec3 minBounds, maxBounds;
+                decodeChild(nodeIdx, i, minBounds, maxBounds);
+                float distance = BVHBuilder::intersectAABB(origin, invDirection, minBounds, maxBounds);
+                if (distance >= tHit) continue;
+
+                uint32_t word = nodeData[childBase + i];
+                if (word & LEAF_FLAG) {
+                    testLeaf(word);
+                } else {
+                    int j = hitCount++;
+                    while (j > 0 && hitDistance[j - 1] < distance) {
+                        hitDistance[j] = hitDistance[j - 1];
+                        hitChild[j] = hitChild[j - 1];
+                        j--;
+                    }
+                    hitDistance[j] = distance;
+                    hitChild[j] = word;
+                }
+            }
+
+            for (int i = 0; i < hitCount; i++) {
+                stack[stackIndex++] = hitChild[i];
+            }
+        }
+
+        return hit;
+    }
+
+    WideBVH::TraversalComparison WideBVH::compareTraversal(const BVHBuilder& binary, uint32_t rayCount) const {
+        TraversalComparison result;
+        if (binary.getNodes().empty() || nodeData.empty()) return result;
+
+        AABB bounds = binary.getNodes()[binary.getRootNodeIndex()].getBounds();
+        glm::vec3 center = bounds.getCenter();
+        float radius = glm::length(bounds.getSize()) * 0.5f + 1e-3f;
+
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        BVHTraversalStats binaryStats, wideStats;
+
+        for (uint32_t r = 0; r < rayCount; r++) {
+            // From a random point on the bounding sphere towards a random point inside the bounds
+            glm::vec3 onSphere(unit(rng) * 2.0f - 1.0f, unit(rng) * 2.0f - 1.0f, unit(rng) * 2.0f - 1.0f);
+            if (glm::length(onSphere) < 1e-4f) onSphere = glm::vec3(1.0f, 0.0f, 0.0f);
+            glm::vec3 origin = center + glm::normalize(onSphere) * radius * 2.0f;
+            glm::vec3 target = bounds.minBounds + bounds.getSize() * glm::vec3(unit(rng), unit(rng), unit(rng));
+            glm::vec3 direction = glm::normalize(target - origin);
+
+            float binaryT = FLT_MAX, wideT = FLT_MAX;
+            uint32_t binaryTri = 0, wideTri = 0;
+            bool binaryHit = binary.intersect(origin, direction, binaryT, binaryTri, &binaryStats);
+            bool wideHit = intersect(binary, origin, direction, wideT, wideTri, &wideStats);
+            if (binaryHit != wideHit || (binaryHit && std::abs(binaryT - wideT) > 1e-4f * binaryT)) {
+                result.mismatches++;
+            }
+        }
+
+        result.rayCount = rayCount;
+        result.binaryNodesPerRay = static_cast<double>(binaryStats.nodesVisited) / rayCount;
+        result.binaryTestsPerRay = static_cast<double>(binaryStats.triangleTests) / rayCount;
+        result.wideNodesPerRay = static_cast<double>(wideStats.nodesVisited) / rayCount;
+        result.wideTestsPerRay = static_cast<double>(wideStats.triangleTests) / rayCount;
+        return result;
+    }
+
+}
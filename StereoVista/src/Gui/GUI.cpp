@@ -2,6 +2,10 @@
 #include "Gui/GUITypes.h"
 #include "Engine/Core.h"
 #include "Engine/BVHDebug.h"
+#include "Engine/SceneBVH.h"
+#include "Engine/RayQuery.h"
+#include "Engine/ReferenceRenderer.h"
+#include "Engine/OctreePointCloudManager.h"
 #include <json.h>
 #include <fstream>
 #include <sstream>
@@ -13,6 +17,9 @@
 #include "Engine/SpaceMouseInput.h"
 #include "imgui/imgui_sytle.h"
 #include <utility>
+#include <future>
+#include <chrono>
+#include <random>
 
 using namespace GUI;
 
@@ -52,6 +59,9 @@ extern GUI::ApplicationPreferences::RadianceSettings radianceSettings;
 extern bool enableBVH;
 extern bool showBVHDebug;
 extern Engine::BVHDebugRenderer bvhDebugRenderer;
+extern Engine::SceneBVH sceneBVH;
+extern double radianceSceneUpdateMs;
+extern uint32_t radianceRepackedTriangles;
 
 // Selection state for object interaction
 extern enum class SelectedType {
@@ -64,6 +74,8 @@ extern int currentSelectedIndex;
 extern int currentSelectedMeshIndex;
 
 extern Sun sun;
+extern std::vector<PointLight> pointLights;
+extern GLuint cubemapTexture;
 
 // Skybox configuration
 extern GUI::SkyboxConfig skyboxConfig;
@@ -196,6 +208,7 @@ void renderGUI(bool isLeftEye, ImGuiViewportP* viewport, ImGuiWindowFlags window
                 if (!selection.empty()) {
                     try {
                         currentScene = Engine::loadScene(selection[0], camera);
+                        ::sceneBVH.setCacheDirectory(Engine::getSceneBVHCacheDirectory(selection[0]));
                         // Start spawn animation for all loaded models
                         for (auto& model : currentScene.models) {
                             glm::vec3 targetScale = model.scale;
@@ -215,6 +228,9 @@ void renderGUI(bool isLeftEye, ImGuiViewportP* viewport, ImGuiWindowFlags window
                 if (!destination.empty()) {
                     try {
                         Engine::saveScene(destination, currentScene, camera);
+                        // Store the already built BLAS next to the scene so the next load skips the builds
+                        ::sceneBVH.setCacheDirectory(Engine::getSceneBVHCacheDirectory(destination));
+                        ::sceneBVH.saveCache();
                     }
                     catch (const std::exception& e) {
                         std::cerr << "Failed to save scene: " << e.what() << std::endl;
@@ -919,7 +935,30 @@ void renderSettingsWindow() {
                 if (ImGui::SliderFloat("Grid Dimensions", &gridSize, 1.0f, 50.0f)) {
                     voxelizer->setVoxelGridSize(gridSize);
                 }
-                ImGui::SetItemTooltip("World space area coverage for voxelization (larger = more world captured, more voxels)");
+                ImGui::SetItemTooltip("World space extent of the finest cascade around the camera\n(larger = more world captured per voxel, coarser detail)");
+
+                int cascadeCount = voxelizer->getCascadeCount();
+                if (ImGui::SliderInt("Cascades", &cascadeCount, 1, Engine::Voxelizer::MAX_CASCADES)) {
+                    voxelizer->setCascadeCount(cascadeCount);
+                }
+                ImGui::SetItemTooltip("Nested voxel grids around the camera, each covering twice the extent of the previous one.\nMore cascades reach further for indirect light at a fixed resolution per cascade");
+
+                bool voxelizePointClouds = voxelizer->getVoxelizePointClouds();
+                if (ImGui::Checkbox("Voxelize Point Clouds", &voxelizePointClouds)) {
+                    voxelizer->setVoxelizePointClouds(voxelizePointClouds);
+                }
+                ImGui::SetItemTooltip("Splat point clouds into the voxel volume so scans cast indirect light and shadows on models");
+                if (voxelizePointClouds) {
+                    const auto& splatStats = voxelizer->getPointSplatStats();
+                    ImGui::Text("Point splats: %zu nodes (%zu new, %zu points), %zu voxels, %.1f ms",
+                                splatStats.nodesSelected, splatStats.nodesSplatted, splatStats.pointsRead, splatStats.splats, splatStats.splatMs);
+                    ImGui::Text("Cached nodes: %zu", splatStats.cachedNodes);
+                }
+
+                if (voxelizer->hasAnisotropicMips()) {
+                    ImGui::Checkbox("Anisotropic Mips", &voxelizer->anisotropicMips);
+                    ImGui::SetItemTooltip("Cone traces sample six directional mip chains along their direction,\nso thin walls block light from one side without bleeding through to the other");
+                }
 
                 float voxelSize = preferences.vctSettings.voxelSize;
                 if (ImGui::SliderFloat("VCT Voxel Resolution", &voxelSize, 1.0f / 256.0f, 1.0f / 32.0f, "%.5f")) {
@@ -943,6 +982,13 @@ void renderSettingsWindow() {
                 }
                 ImGui::SetItemTooltip("Visual size of debug voxel cubes (affected by mipmap level)");
 
+                if (voxelizer->hasGPUVoxelExtraction()) {
+                    if (ImGui::Checkbox("GPU Voxel Extraction", &voxelizer->gpuVoxelExtraction)) {
+                        voxelizer->refreshDebugVoxels();
+                    }
+                    ImGui::SetItemTooltip("Extract debug voxels with a compute shader and draw them indirectly\n(off: read the displayed level back and scan it on the CPU)");
+                }
+
                 float opacity = voxelizer->voxelOpacity;
                 if (ImGui::SliderFloat("Voxel Opacity", &opacity, 0.0f, 1.0f)) {
                     voxelizer->voxelOpacity = opacity;
@@ -952,6 +998,146 @@ void renderSettingsWindow() {
                 if (ImGui::SliderFloat("Color Intensity", &colorIntensity, 0.0f, 5.0f)) {
                     voxelizer->voxelColorIntensity = colorIntensity;
                 }
+
+                ImGui::Separator();
+
+                // CPU voxelizer: background voxelization of static scenes and an oracle for the GPU pass
+                ImGui::Text("CPU Voxelizer");
+
+                static std::future<std::vector<Engine::CPUVoxelizer::Volume>> cpuVoxelization;
+                static Engine::CPUVoxelizer::Stats cpuVoxelizerStats;
+                static Engine::CPUVoxelizer::Comparison cpuVoxelizerComparison;
+                static bool cpuVoxelizerCompared = false;
+                static std::future<Engine::CPUVoxelizer::Comparison> cpuComparison;
+                bool cpuVoxelizationRunning = cpuVoxelization.valid();
+                if (cpuVoxelizationRunning && cpuVoxelization.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                    std::vector<Engine::CPUVoxelizer::Volume> volumes = cpuVoxelization.get();
+                    for (size_t cascade = 0; cascade < volumes.size(); cascade++) {
+                        voxelizer->uploadCascade(static_cast<int>(cascade), volumes[cascade], currentScene.pointClouds);
+                    }
+                    std::cout << "Uploaded " << volumes.size() << " CPU voxelized cascades" << std::endl;
+                    cpuVoxelizationRunning = false;
+                }
+                bool cpuComparisonRunning = cpuComparison.valid();
+                if (cpuComparisonRunning && cpuComparison.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                    cpuVoxelizerComparison = cpuComparison.get();
+                    cpuVoxelizerCompared = true;
+                    std::cout << "CPU/GPU voxelization: " << cpuVoxelizerComparison.occupiedInBoth << " voxels in both, "
+                              << cpuVoxelizerComparison.onlyInFirst << " CPU only, " << cpuVoxelizerComparison.onlyInSecond
+                              << " GPU only, max color difference " << cpuVoxelizerComparison.maxColorDifference << std::endl;
+                    cpuComparisonRunning = false;
+                }
+                bool cpuVoxelizerBusy = cpuVoxelizationRunning || cpuComparisonRunning;
+
+                if (cpuVoxelizationRunning) {
+                    ImGui::Text("Voxelizing on CPU...");
+                } else if (ImGui::Button("Voxelize on CPU") && !cpuComparisonRunning) {
+                    // Snapshot on this thread; the voxelization itself runs in the background
+                    auto cpuVoxelizer = std::make_shared<Engine::CPUVoxelizer>();
+                    voxelizer->fillCPUVoxelizer(*cpuVoxelizer, currentScene.models);
+                    std::vector<Engine::CPUVoxelizer::Window> windows;
+                    for (int cascade = 0; cascade < voxelizer->getCascadeCount(); cascade++) {
+                        windows.push_back(voxelizer->getCascadeWindow(cascade));
+                    }
+                    cpuVoxelization = std::async(std::launch::async, [cpuVoxelizer, windows]() {
+                        std::vector<Engine::CPUVoxelizer::Volume> volumes;
+                        for (const auto& window : windows) {
+                            volumes.push_back(cpuVoxelizer->voxelize(window, &cpuVoxelizerStats));
+                        }
+                        return volumes;
+                    });
+                }
+                ImGui::SetItemTooltip("Voxelize the cascades on a background thread and upload them when done\n(for static scenes; the GPU keeps updating changed regions afterwards)");
+
+                ImGui::SameLine();
+                if (cpuComparisonRunning) {
+                    ImGui::Text("Comparing...");
+                } else if (ImGui::Button("Compare with GPU") && !cpuVoxelizationRunning) {
+                    // Read back and snapshot the point splats here; voxelizing and comparing run in the background
+                    auto cpuVoxelizer = std::make_shared<Engine::CPUVoxelizer>();
+                    voxelizer->fillCPUVoxelizer(*cpuVoxelizer, currentScene.models);
+                    Engine::CPUVoxelizer::Window window = voxelizer->getCascadeWindow(0);
+                    auto gpuVolume = std::make_shared<Engine::CPUVoxelizer::Volume>(voxelizer->readCascade(0));
+                    auto splats = std::make_shared<std::vector<Engine::PointCloudVoxelSplatter::Splat>>(
+                        voxelizer->collectCascadeSplats(0, currentScene.pointClouds));
+                    cpuComparison = std::async(std::launch::async, [cpuVoxelizer, window, gpuVolume, splats]() {
+                        Engine::CPUVoxelizer::Volume cpuVolume = cpuVoxelizer->voxelize(window, &cpuVoxelizerStats);
+                        Engine::PointCloudVoxelSplatter::blendSplats(cpuVolume, *splats);
+                        return Engine::CPUVoxelizer::compare(cpuVolume, *gpuVolume);
+                    });
+                }
+                ImGui::SetItemTooltip("Voxelize the finest cascade on the CPU, add the point cloud splats and compare it with the GPU result\n(the CPU coverage is exact, so GPU-only voxels point at rasterization errors)");
+
+                if (cpuVoxelizerStats.threads > 0 && !cpuVoxelizerBusy) {
+                    ImGui::Text("CPU: %.1f ms bin, %.1f ms voxelize, %.1f ms mips on %zu threads", cpuVoxelizerStats.binMs,
+                                cpuVoxelizerStats.voxelizeMs, cpuVoxelizerStats.mipMs, cpuVoxelizerStats.threads);
+                    ImGui::Text("%u triangles in %u bricks (%llu references)", cpuVoxelizerStats.triangles, cpuVoxelizerStats.bricks,
+                                static_cast<unsigned long long>(cpuVoxelizerStats.brickReferences));
+                }
+                if (cpuVoxelizerCompared) {
+                    ImGui::Text("Voxels: %zu both, %zu CPU only, %zu GPU only", cpuVoxelizerComparison.occupiedInBoth,
+                                cpuVoxelizerComparison.onlyInFirst, cpuVoxelizerComparison.onlyInSecond);
+                    ImGui::Text("Color difference: max %d, average %.2f", cpuVoxelizerComparison.maxColorDifference,
+                                cpuVoxelizerComparison.averageColorDifference);
+                }
+
+                if (voxelizer->hasAnisotropicMips()) {
+                    static Engine::AnisotropicVoxelMips::Difference mipDifference;
+                    static bool mipsChecked = false;
+                    if (ImGui::Button("Check Mips on CPU")) {
+                        // Rebuild the finest cascade's mips from its level 0 on the CPU
+                        Engine::CPUVoxelizer::Volume gpuVolume = voxelizer->readCascade(0);
+                        Engine::AnisotropicVoxelMips::Levels gpuDirectional = voxelizer->readCascadeDirectional(0);
+                        Engine::CPUVoxelizer::Volume cpuVolume;
+                        cpuVolume.window = gpuVolume.window;
+                        cpuVolume.levels.push_back(gpuVolume.levels[0]);
+                        Engine::AnisotropicVoxelMips::Levels cpuDirectional;
+                        Engine::AnisotropicVoxelMips::build(cpuVolume, cpuDirectional);
+                        mipDifference = Engine::AnisotropicVoxelMips::compare(cpuVolume, cpuDirectional, gpuVolume, gpuDirectional);
+                        mipsChecked = true;
+                        std::cout << "CPU/GPU mips: max isotropic difference " << mipDifference.maxIsotropic << ", max directional difference "
+                                  << mipDifference.maxDirectional << ", " << mipDifference.differingTexels << " texels off by more than one" << std::endl;
+                    }
+                    ImGui::SetItemTooltip("Rebuild the finest cascade's isotropic and directional mips on the CPU and compare them with the GPU's\n(differences of one are rounding; larger ones point at regions the dirty updates missed)");
+                    if (mipsChecked) {
+                        ImGui::Text("Mips: max difference %d isotropic, %d directional, %zu texels off",
+                                    mipDifference.maxIsotropic, mipDifference.maxDirectional, mipDifference.differingTexels);
+                    }
+                }
+
+                ImGui::Separator();
+
+                // Sparse volume: finer static voxels over the finest cascade, stored as bricks
+                ImGui::Text("Sparse Volume");
+
+                static int sparseResolutionIdx = 1;
+                const char* sparseResolutions[] = { "256", "512" };
+                ImGui::Combo("Sparse Resolution", &sparseResolutionIdx, sparseResolutions, IM_ARRAYSIZE(sparseResolutions));
+
+                if (ImGui::Button("Build Sparse Volume") && !cpuVoxelizerBusy) {
+                    voxelizer->buildSparseVolume(currentScene.models, currentScene.pointClouds, 256 << sparseResolutionIdx, &cpuVoxelizerStats);
+                }
+                ImGui::SetItemTooltip("Voxelize the finest cascade's window on the CPU at a higher resolution,\nstoring only bricks that contain geometry (dropped when the scene changes)");
+
+                if (voxelizer->hasSparseVolume()) {
+                    ImGui::SameLine();
+                    if (ImGui::Button("Clear Sparse Volume")) {
+                        voxelizer->clearSparseVolume();
+                    }
+                }
+
+                if (voxelizer->hasSparseVolume()) {
+                    if (ImGui::Checkbox("Use Sparse Volume", &voxelizer->useSparseVolume)) {
+                        voxelizer->refreshDebugVoxels();
+                    }
+                    ImGui::SetItemTooltip("Cone trace the sparse volume instead of the finest cascade inside its window");
+
+                    const Engine::SparseVoxelVolume& sparse = voxelizer->getSparseVolume();
+                    ImGui::Text("%d^3 voxels, %u of %d bricks allocated", sparse.getResolution(), sparse.getBrickCount(),
+                                sparse.getBricksPerAxis() * sparse.getBricksPerAxis() * sparse.getBricksPerAxis());
+                    ImGui::Text("Memory: %.1f MB (GPU %.1f MB), dense %.1f MB", sparse.getMemoryBytes() / (1024.0f * 1024.0f),
+                                voxelizer->getSparseGPUBytes() / (1024.0f * 1024.0f), sparse.getDenseMemoryBytes() / (1024.0f * 1024.0f));
+                }
                 ImGui::EndGroup();
             }
             
@@ -1040,6 +1226,159 @@ void renderSettingsWindow() {
                 }
                 ImGui::SetItemTooltip("Enable Bounding Volume Hierarchy for faster ray-triangle intersection");
                 
+                // BLAS builder: spatial splits help scenes with long, thin or large overlapping triangles,
+                // LBVH trades tree quality for build speed in scenes that change often
+                const char* bvhBuilders[] = {"Binned SAH", "Spatial Splits (SBVH)", "LBVH (Morton)"};
+                if (ImGui::Combo("BVH Builder", &preferences.radianceSettings.bvhBuilder, bvhBuilders, IM_ARRAYSIZE(bvhBuilders))) {
+                    settingsChanged = true;
+                }
+                ImGui::SetItemTooltip("Binned SAH: good trees for mostly static scenes\n"
+                                      "Spatial splits clip triangles at split planes, which gives tighter trees for\narchitectural scenes (floor slabs, beams, walls) at a higher build cost\n"
+                                      "LBVH sorts Morton codes instead of evaluating splits: several times faster to build\n"
+                                      "(also used for the top-level BVH), for scenes with many animated or edited models");
+                if (preferences.radianceSettings.bvhBuilder == 1) {
+                    ImGui::Indent();
+                    // Applied on release, every change rebuilds all BLAS
+                    static float budgetPercent = 30.0f;
+                    static bool budgetEditing = false;
+                    if (!budgetEditing) {
+                        budgetPercent = preferences.radianceSettings.spatialSplitBudget * 100.0f;
+                    }
+                    ImGui::SliderFloat("Split Budget", &budgetPercent, 0.0f, 100.0f, "%.0f%%");
+                    budgetEditing = ImGui::IsItemActive();
+                    if (ImGui::IsItemDeactivatedAfterEdit()) {
+                        preferences.radianceSettings.spatialSplitBudget = budgetPercent / 100.0f;
+                        settingsChanged = true;
+                    }
+                    ImGui::SetItemTooltip("Maximum extra triangle references created by spatial splits (memory growth)");
+                    ImGui::Unindent();
+                }
+                if (::sceneBVH.getBLASInputTriangleCount() > 0) {
+                    ImGui::Text("SAH Cost: %.2f, References: %u (+%.1f%%)", ::sceneBVH.getBLASSAHCost(), ::sceneBVH.getTriangleCount(),
+                                100.0f * (static_cast<float>(::sceneBVH.getTriangleCount()) / ::sceneBVH.getBLASInputTriangleCount() - 1.0f));
+                }
+                
+                // BLAS node layout: binary, or collapsed 4/8-wide with quantized child bounds
+                const char* bvhLayouts[] = {"Binary", "BVH4", "BVH8"};
+                int bvhLayoutIndex = preferences.radianceSettings.bvhWidth == 8 ? 2 : (preferences.radianceSettings.bvhWidth == 4 ? 1 : 0);
+                if (ImGui::Combo("BVH Layout", &bvhLayoutIndex, bvhLayouts, IM_ARRAYSIZE(bvhLayouts))) {
+                    const int bvhWidths[] = {2, 4, 8};
+                    preferences.radianceSettings.bvhWidth = bvhWidths[bvhLayoutIndex];
+                    settingsChanged = true;
+                }
+                ImGui::SetItemTooltip("Wide layouts test 4 or 8 children per node with 8-bit quantized bounds,\nvisiting fewer nodes per ray with a smaller node buffer");
+                
+                static Engine::WideBVH::TraversalComparison bvh4Traversal, bvh8Traversal;
+                if (ImGui::Button("Measure Traversal")) {
+                    bvh4Traversal = ::sceneBVH.measureTraversal(4);
+                    bvh8Traversal = ::sceneBVH.measureTraversal(8);
+                }
+                ImGui::SetItemTooltip("Cast random rays through every model on the CPU and compare nodes visited per ray");
+                if (bvh4Traversal.rayCount > 0) {
+                    ImGui::Text("Nodes/ray: Binary %.1f, BVH4 %.1f, BVH8 %.1f",
+                                bvh4Traversal.binaryNodesPerRay, bvh4Traversal.wideNodesPerRay, bvh8Traversal.wideNodesPerRay);
+                    ImGui::Text("Triangle tests/ray: Binary %.1f, BVH4 %.1f, BVH8 %.1f",
+                                bvh4Traversal.binaryTestsPerRay, bvh4Traversal.wideTestsPerRay, bvh8Traversal.wideTestsPerRay);
+                    if (bvh4Traversal.mismatches + bvh8Traversal.mismatches > 0) {
+                        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Hit mismatches: %u", bvh4Traversal.mismatches + bvh8Traversal.mismatches);
+                    }
+                }
+                
+                static Engine::SceneBVHStats bvhStats;
+                if (ImGui::Button("Analyze BVH") && ::sceneBVH.isBuilt()) {
+                    // Fixed 160x90 grid over the current view, so runs from the same camera compare builders
+                    glm::mat4 projection = camera.GetProjectionMatrix(16.0f / 9.0f, currentScene.settings.nearPlane, currentScene.settings.farPlane);
+                    bvhStats = ::sceneBVH.analyze(Engine::BVHStats::cameraRays(camera.GetViewMatrix(), projection, 160, 90));
+                    if (bvhStats.saveJson("bvh_stats.json")) {
+                        std::cout << "Saved BVH statistics to bvh_stats.json" << std::endl;
+                    }
+                }
+                ImGui::SetItemTooltip("Compute tree quality, memory and build phase statistics, trace a grid of camera rays\nthrough the scene on the CPU and save everything to bvh_stats.json");
+                if (bvhStats.traversal.rayCount > 0) {
+                    uint32_t blasNodes = 0, blasLeaves = 0, blasMaxDepth = 0;
+                    double leafSizeSum = 0.0, overlapCost = 0.0;
+                    for (const auto& blas : bvhStats.blas) {
+                        blasNodes += blas.nodeCount;
+                        blasLeaves += blas.leafCount;
+                        blasMaxDepth = std::max(blasMaxDepth, blas.maxDepth);
+                        leafSizeSum += blas.averageLeafSize * blas.leafCount;
+                        overlapCost += blas.overlapCost * blas.primitiveCount;
+                    }
+                    ImGui::Text("BLAS: %zu trees, %u nodes, %u leaves (%.1f tris/leaf), max depth %u",
+                                bvhStats.blas.size(), blasNodes, blasLeaves, blasLeaves > 0 ? leafSizeSum / blasLeaves : 0.0, blasMaxDepth);
+                    ImGui::Text("SAH %.2f, overlap %.2f, TLAS SAH %.2f", bvhStats.blasSAHCost,
+                                bvhStats.blasTriangles > 0 ? overlapCost / bvhStats.blasTriangles : 0.0, bvhStats.tlas.sahCost);
+                    ImGui::SetItemTooltip("Overlap: summed area of overlapping sibling boxes relative to the root area\n(triangle-weighted over the BLAS)");
+                    ImGui::Text("Build %.1f ms: prepare %.1f, sort %.1f, splits %.1f, refit %.1f, finalize %.1f",
+                                bvhStats.blasBuildMs, bvhStats.blasPhases.prepareMs, bvhStats.blasPhases.sortMs,
+                                bvhStats.blasPhases.hierarchyMs, bvhStats.blasPhases.refitMs, bvhStats.blasPhases.finalizeMs);
+                    ImGui::Text("Memory: %.2f MB", bvhStats.totalBytes / (1024.0 * 1024.0));
+                    ImGui::Text("Camera rays: %.1f nodes, %.1f tests, %.2f instances per ray (%u/%u hits)",
+                                bvhStats.traversal.nodesPerRay, bvhStats.traversal.testsPerRay, bvhStats.traversal.instancesPerRay,
+                                bvhStats.traversal.hitCount, bvhStats.traversal.rayCount);
+                }
+
+                static Engine::SimdBVH::Benchmark rayBenchmark;
+                if (ImGui::Button("Benchmark CPU Rays")) {
+                    rayBenchmark = Engine::RayQuery::benchmark(currentScene.models);
+                }
+                ImGui::SetItemTooltip("Trace a coherent grid of rays through every model's picking BVH on one core\nwith each kernel (%s detected)",
+                                      Engine::getSimdLevelName(Engine::detectSimdLevel()));
+                if (rayBenchmark.rayCount > 0) {
+                    ImGui::Text("Mrays/s: Binary %.1f, Scalar %.1f, SSE2 %.1f, AVX2 %.1f",
+                                rayBenchmark.binaryRaysPerSecond * 1e-6, rayBenchmark.scalarRaysPerSecond * 1e-6,
+                                rayBenchmark.sse2RaysPerSecond * 1e-6, rayBenchmark.avx2RaysPerSecond * 1e-6);
+                    ImGui::Text("Packets: %.1f Mrays/s", rayBenchmark.packetRaysPerSecond * 1e-6);
+                    if (rayBenchmark.mismatches > 0) {
+                        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Hit mismatches: %u", rayBenchmark.mismatches);
+                    }
+                }
+                
+                static Engine::ReferenceRenderer::Stats referenceStats;
+                if (ImGui::Button("Render CPU Reference") && ::sceneBVH.isBuilt()) {
+                    Engine::ReferenceRenderer::Settings referenceSettings;
+                    referenceSettings.maxBounces = ::radianceSettings.maxBounces;
+                    referenceSettings.samplesPerPixel = ::radianceSettings.samplesPerPixel;
+                    referenceSettings.rayMaxDistance = ::radianceSettings.rayMaxDistance;
+                    referenceSettings.enableIndirectLighting = ::radianceSettings.enableIndirectLighting;
+                    referenceSettings.enableEmissiveLighting = ::radianceSettings.enableEmissiveLighting;
+                    referenceSettings.indirectIntensity = ::radianceSettings.indirectIntensity;
+                    referenceSettings.skyIntensity = ::radianceSettings.skyIntensity;
+                    referenceSettings.emissiveIntensity = ::radianceSettings.emissiveIntensity;
+                    referenceSettings.enableBVH = ::enableBVH;
+                    
+                    Engine::ReferenceRenderer::Lighting referenceLighting;
+                    referenceLighting.sun = ::sun;
+                    referenceLighting.pointLights = ::pointLights;
+                    referenceLighting.skybox = Engine::ReferenceCubemap::fromTexture(::cubemapTexture);
+                    referenceLighting.background = glm::vec3(0.1f);
+                    
+                    Engine::ReferenceRenderer::View referenceView;
+                    referenceView.width = std::max(windowWidth / 2, 1);
+                    referenceView.height = std::max(windowHeight / 2, 1);
+                    referenceView.view = camera.GetViewMatrix();
+                    referenceView.projection = camera.GetProjectionMatrix(static_cast<float>(referenceView.width) / referenceView.height,
+                                                                          currentScene.settings.nearPlane, currentScene.settings.farPlane);
+                    
+                    Engine::ReferenceRenderer referenceRenderer;
+                    referenceRenderer.setScene(::sceneBVH);
+                    Engine::ReferenceRenderer::Image image = referenceRenderer.render(referenceView, referenceSettings, referenceLighting, &referenceStats);
+                    if (image.savePPM("reference_render.ppm")) {
+                        std::cout << "Saved CPU reference render (" << image.width << "x" << image.height << ", "
+                                  << referenceStats.renderMs << " ms) to reference_render.ppm" << std::endl;
+                    }
+                }
+                ImGui::SetItemTooltip("Path trace the current view at half resolution on the CPU with the radiance shader's\nlighting model and save it as reference_render.ppm (for checking shader changes)");
+                if (referenceStats.rays > 0) {
+                    ImGui::Text("CPU reference: %.0f ms, %.2f Mrays/s on %zu threads", referenceStats.renderMs,
+                                referenceStats.raysPerSecond * 1e-6, referenceStats.threads);
+                }
+                
+                ImGui::Text("Models: %zu, Triangles: %u", ::sceneBVH.getInstanceCount(), ::sceneBVH.getTriangleCount());
+                ImGui::Text("Scene Update (CPU): %.3f ms, %u triangles re-packed", ::radianceSceneUpdateMs, ::radianceRepackedTriangles);
+                ImGui::SetItemTooltip("Only models with changed materials are re-packed; moving a model only rebuilds the top-level BVH");
+                ImGui::Text("Frame Time: %.2f ms", ImGui::GetIO().DeltaTime * 1000.0f);
+                
                 if (ImGui::Checkbox("Show BVH Debug", &preferences.radianceSettings.showBVHDebug)) {
                     ::showBVHDebug = preferences.radianceSettings.showBVHDebug;
                     settingsChanged = true;
@@ -1947,6 +2286,19 @@ void renderCursorSettingsWindow() {
             savePreferences();
         }
     }
+
+    bool cpuPicking = cursorManager.isCPUPickingEnabled();
+    if (ImGui::Checkbox("CPU Point Cloud Picking", &cpuPicking)) {
+        cursorManager.setCPUPickingEnabled(cpuPicking);
+    }
+    ImGui::SetItemTooltip("Hit test point clouds on the CPU instead of reading back the depth buffer");
+
+    if (cpuPicking) {
+        float pickTolerance = cursorManager.getPickTolerancePixels();
+        if (ImGui::SliderFloat("Pick Tolerance (px)", &pickTolerance, 0.5f, 10.0f, "%.1f")) {
+            cursorManager.setPickTolerancePixels(pickTolerance);
+        }
+    }
     ImGui::EndGroup();
 
     ImGui::Spacing();
@@ -2415,6 +2767,120 @@ void renderPointCloudManipulationPanel(Engine::PointCloud& pointCloud) {
         ImGui::Checkbox("Visualize Chunks", &pointCloud.visualizeChunks);
     }
 
+    if (pointCloud.octreeRoot && ImGui::CollapsingHeader("Octree Leaves")) {
+        int maxLeafKB = static_cast<int>(pointCloud.maxLeafBytes / 1024);
+        if (ImGui::SliderInt("Max Leaf Size (KB)", &maxLeafKB, 16, 4096)) {
+            pointCloud.maxLeafBytes = static_cast<size_t>(maxLeafKB) * 1024;
+        }
+        ImGui::SetItemTooltip("Leaves above this size are split; applies to rebuilds and incremental updates");
+
+        static Engine::OctreeLeafHistogram leafHistogram;
+        if (ImGui::Button("Leaf Size Histogram")) {
+            leafHistogram = Engine::OctreePointCloudManager::computeLeafHistogram(pointCloud);
+            Engine::OctreePointCloudManager::printLeafHistogram(leafHistogram, pointCloud.name);
+        }
+
+        if (leafHistogram.leafCount > 0) {
+            float buckets[Engine::OctreeLeafHistogram::BUCKET_COUNT];
+            for (int i = 0; i < Engine::OctreeLeafHistogram::BUCKET_COUNT; i++) {
+                buckets[i] = static_cast<float>(leafHistogram.leafCounts[i]);
+            }
+            ImGui::PlotHistogram("##LeafSizes", buckets, Engine::OctreeLeafHistogram::BUCKET_COUNT, 0,
+                                 "Leaves per size (1 KB .. 32 MB, log2)", 0.0f, FLT_MAX, ImVec2(0, 80));
+            ImGui::Text("%zu leaves, depth %d, %zu - %zu KB (mean %.0f KB)",
+                        leafHistogram.leafCount, leafHistogram.maxDepth,
+                        leafHistogram.minLeafBytes / 1024, leafHistogram.maxLeafBytes / 1024,
+                        leafHistogram.meanLeafBytes / 1024.0);
+        }
+    }
+
+    if (pointCloud.octreeRoot && ImGui::CollapsingHeader("Edit Points")) {
+        // Edits run in the cloud's local (octree) space and only rewrite the touched leaves
+        static const Engine::PointCloud* editedCloud = nullptr;
+        static glm::vec3 editCenter(0.0f);
+        static float editSize = 1.0f;
+        static int addCount = 1000;
+        static glm::vec3 addColor(1.0f, 0.0f, 1.0f);
+        static std::string editStatus;
+        if (editedCloud != &pointCloud) {
+            editedCloud = &pointCloud;
+            editCenter = pointCloud.octreeCenter;
+            editStatus.clear();
+        }
+
+        ImGui::DragFloat3("Center (local)", glm::value_ptr(editCenter), 0.05f);
+        if (ImGui::Button("Use 3D Cursor") && cursorManager.isCursorPositionValid()) {
+            glm::mat4 worldToLocal = glm::inverse(Engine::OctreePointCloudManager::getModelMatrix(pointCloud));
+            editCenter = glm::vec3(worldToLocal * glm::vec4(cursorManager.getCursorPosition(), 1.0f));
+        }
+        ImGui::DragFloat("Radius / Half Size", &editSize, 0.01f, 0.001f, 1000.0f);
+
+        auto reportEdit = [&](const std::string& action) {
+            size_t nodeFiles = 0;
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(pointCloud.chunkCache.cacheDirectory, ec)) {
+                if (entry.is_regular_file(ec)) nodeFiles++;
+            }
+            Engine::OctreeLeafHistogram leaves = Engine::OctreePointCloudManager::computeLeafHistogram(pointCloud);
+            editStatus = action + "\n" + std::to_string(pointCloud.octreeRoot ? pointCloud.octreeRoot->totalPointCount : 0) +
+                         " points, " + std::to_string(leaves.leafCount) + " leaves, " +
+                         std::to_string(nodeFiles) + " node files in the cache";
+            std::cout << pointCloud.name << ": " << editStatus << std::endl;
+            updateSpaceMouseBounds();
+        };
+
+        if (ImGui::Button("Delete in Box")) {
+            size_t removed = Engine::OctreePointCloudManager::removePointsInBox(pointCloud, editCenter - glm::vec3(editSize), editCenter + glm::vec3(editSize));
+            reportEdit("Removed " + std::to_string(removed) + " points");
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Delete in Sphere")) {
+            size_t removed = Engine::OctreePointCloudManager::removePointsInRadius(pointCloud, editCenter, editSize);
+            reportEdit("Removed " + std::to_string(removed) + " points");
+        }
+
+        ImGui::SliderInt("Points to Add", &addCount, 1, 100000);
+        ImGui::ColorEdit3("Added Color", glm::value_ptr(addColor));
+        if (ImGui::Button("Add Points in Sphere")) {
+            // Uniform samples in the sphere (rejection from the enclosing cube)
+            std::mt19937 rng(static_cast<uint32_t>(pointCloud.nextNodeId));
+            std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+            std::vector<Engine::PointCloudPoint> added;
+            added.reserve(addCount);
+            while (added.size() < static_cast<size_t>(addCount)) {
+                glm::vec3 offset(unit(rng), unit(rng), unit(rng));
+                if (glm::dot(offset, offset) > 1.0f) continue;
+                added.push_back({ editCenter + offset * editSize, 1.0f, addColor });
+            }
+            Engine::OctreePointCloudManager::insertPoints(pointCloud, added);
+            reportEdit("Added " + std::to_string(added.size()) + " points");
+        }
+
+        if (!editStatus.empty()) {
+            ImGui::TextWrapped("%s", editStatus.c_str());
+        }
+    }
+
+    if (pointCloud.octreeRoot && ImGui::CollapsingHeader("Disk Cache")) {
+        const char* codecNames[] = { "Raw (HDF5, lossless)", "Delta + Bitpack (lossy)", "Delta + Bitpack + LZ (lossy)" };
+        int codecIndex = static_cast<int>(pointCloud.chunkCache.codec);
+        if (ImGui::Combo("Node Codec", &codecIndex, codecNames, IM_ARRAYSIZE(codecNames))) {
+            pointCloud.chunkCache.codec = static_cast<Engine::NodeCodecType>(codecIndex);
+        }
+        ImGui::SetItemTooltip("Encoding used for node files written from now on (existing files keep their codec)\n"
+                              "The delta codecs quantize positions to 20 bits over the node bounds, colors to 8 bits\n"
+                              "and intensity to 16 bits; every rewrite of an edited node quantizes it again");
+
+        static std::vector<Engine::NodeCodecBenchmark> codecResults;
+        if (ImGui::Button("Benchmark Codecs")) {
+            codecResults = Engine::OctreePointCloudManager::benchmarkCodecs(pointCloud);
+        }
+
+        for (const auto& result : codecResults) {
+            ImGui::Text("%s: %.2fx, decode %.2f GB/s", result.name, result.ratio, result.decodeGBps);
+        }
+    }
+
     ImGui::Separator();
 
     if (ImGui::CollapsingHeader("Export", ImGuiTreeNodeFlags_DefaultOpen)) {
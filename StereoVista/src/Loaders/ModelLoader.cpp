@@ -3,6 +3,7 @@
 #include <stb_image.h>
 #include <map>
 #include <filesystem>
+#include <atomic>
 #include "Gui/GuiTypes.h"
 
 // Access to application preferences for import settings
@@ -82,6 +83,12 @@ namespace Engine {
         glActiveTexture(GL_TEXTURE0);
     }
 
+    uint64_t Model::nextGeometryId() {
+        // Ids are never reused, so a deleted model cannot alias the caches of a later one
+        static std::atomic<uint64_t> nextId{ 1 };
+        return nextId.fetch_add(1);
+    }
+
     Model::Model(const std::string& path) {
         // Save the original path
         this->path = path;
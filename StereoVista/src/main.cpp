@@ -4,6 +4,8 @@
 #include <thread>
 #include <atomic>
 #include <iostream>
+#include <chrono>
+#include <unordered_map>
 
 // ---- Project-Specific Includes ----
 #include "Loaders/ModelLoader.h"
@@ -19,6 +21,9 @@
 #include "Gui/GuiTypes.h"
 #include "../headers/Engine/BVH.h"
 #include "../headers/Engine/BVHDebug.h"
+#include "../headers/Engine/SceneBVH.h"
+#include "../headers/Engine/RayQuery.h"
+#include "../headers/Engine/ReferenceChecks.h"
 
 // ---- GUI and Dialog ----
 #include "imgui/imgui_incl.h"
@@ -60,7 +65,9 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 
 // ---- Rendering Functions ----
-void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4& view, Engine::Shader* shader, ImGuiViewportP* viewport, ImGuiWindowFlags windowFlags, GLFWwindow* window);
+void prepareFrame(Engine::Shader* shader, const glm::mat4& projection, const glm::mat4& view, GLFWwindow* window);
+void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4& view, Engine::Shader* shader, ImGuiViewportP* viewport, ImGuiWindowFlags windowFlags);
+void renderDepthPrepass(const glm::mat4& projection, const glm::mat4& view);
 void renderModels(Engine::Shader* shader);
 void renderPointClouds(Engine::Shader* shader);
 void renderZeroPlane(Engine::Shader* shader, const glm::mat4& projection, const glm::mat4& view, float convergence);
@@ -76,6 +83,7 @@ glm::vec4 divw(glm::vec4 vec);
 void updatePointLights();
 void updateSpaceMouseBounds();
 void updateSpaceMouseCursorAnchor();
+void updateDistanceToNearestObject(const glm::mat4& projection, const glm::mat4& view);
 
 PointCloud loadPointCloudFile(const std::string& filePath, size_t downsampleFactor = 1);
 
@@ -87,7 +95,9 @@ void cleanup(Engine::Shader* shader);
 // ---- Utility Functions ----
 float calculateLargestModelDimension();
 void calculateMouseRay(float mouseX, float mouseY, glm::vec3& rayOrigin, glm::vec3& rayDirection, glm::vec3& rayNear, glm::vec3& rayFar, float aspect);
-bool rayIntersectsModel(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const Engine::Model& model, float& distance);
+bool sceneNeedsDepthReadback();
+Cursor::RaycastResult raycastScene(const glm::vec3& origin, const glm::vec3& direction, float angularTolerance);
+float calculateDistanceToNearestObject(const glm::mat4& projection, const glm::mat4& view);
 #pragma endregion
 
 
@@ -173,6 +183,7 @@ char editPresetNameBuffer[256] = "";
 // ---- Input and Interaction ----
 bool selectionMode = false;
 bool isMovingModel = false;
+glm::vec3 modelGrabOffset = glm::vec3(0.0f);   // Picked surface point relative to the dragged model's position
 bool isMouseCaptured = false;
 bool leftMousePressed = false;   // Left mouse button state
 bool rightMousePressed = false;  // Right mouse button state
@@ -241,60 +252,20 @@ GLuint skyboxVAO, skyboxVBO, cubemapTexture;
 float ambientStrengthFromSkybox = 0.1f;
 Engine::Shader* skyboxShader = nullptr;
 
-// ---- Raytracing Triangle Buffer ----
-GLuint triangleSSBO = 0;
-std::vector<float> triangleData;
-
 // ---- BVH System ----
-Engine::BVHBuilder bvhBuilder;
-GLuint bvhNodeSSBO = 0;
-GLuint triangleIndexSSBO = 0;
-std::vector<Engine::GPUBVHNode> gpuBVHNodes;
-std::vector<uint32_t> gpuTriangleIndices;
-std::vector<Engine::GPUTriangle> gpuTriangles;
-bool bvhBuilt = false;
-bool bvhBuffersUploaded = false;
+// Two-level BVH: cached per-model BLAS plus a TLAS over the model instances; also owns the
+// persistent triangle buffer
+Engine::SceneBVH sceneBVH;
+double radianceSceneUpdateMs = 0.0;         // CPU time of the radiance scene update, previous frame
+uint32_t radianceRepackedTriangles = 0;     // Triangles re-packed in the previous frame
+static double pendingSceneUpdateMs = 0.0;   // Accumulated over the eyes of the current frame
+static uint32_t pendingRepackedTriangles = 0;
 bool enableBVH = true; // BVH toggle
 
 // BVH Debug Renderer
 Engine::BVHDebugRenderer bvhDebugRenderer;
 bool showBVHDebug = false;
 
-// BVH invalidation tracking
-struct SceneState {
-    size_t modelCount = 0;
-    std::vector<glm::vec3> modelPositions;
-    std::vector<glm::vec3> modelRotations;
-    std::vector<glm::vec3> modelScales;
-    
-    bool hasChanged(const Engine::Scene& scene) const {
-        if (modelCount != scene.models.size()) return true;
-        
-        for (size_t i = 0; i < scene.models.size() && i < modelPositions.size(); i++) {
-            if (modelPositions[i] != scene.models[i].position ||  
-                modelRotations[i] != scene.models[i].rotation ||
-                modelScales[i] != scene.models[i].scale) {
-                return true;
-            }
-        }
-        return false;
-    }
-    
-    void update(const Engine::Scene& scene) {
-        modelCount = scene.models.size();
-        modelPositions.clear();
-        modelRotations.clear();
-        modelScales.clear();
-        
-        for (const auto& model : scene.models) {
-            modelPositions.push_back(model.position);
-            modelRotations.push_back(model.rotation);
-            modelScales.push_back(model.scale);
-        }
-    }
-};
-static SceneState lastSceneState;
-
 // ---- Zero Plane Rendering ----
 Engine::Shader* zeroPlaneShader = nullptr;
 GLuint zeroPlaneVAO, zeroPlaneVBO, zeroPlaneEBO;
@@ -628,131 +599,6 @@ void cleanupSkybox() {
     }
 }
 
-// ---- Triangle Buffer Setup for Raytracing ----
-void setupTriangleBuffer() {
-    if (triangleSSBO == 0) {
-        glGenBuffers(1, &triangleSSBO);
-    }
-}
-
-void updateTriangleBuffer(const std::vector<float>& data) {
-    if (triangleSSBO == 0) {
-        setupTriangleBuffer();
-    }
-    
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, triangleSSBO);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, data.size() * sizeof(float), data.data(), GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, triangleSSBO);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-}
-
-void cleanupTriangleBuffer() {
-    if (triangleSSBO != 0) {
-        glDeleteBuffers(1, &triangleSSBO);
-        triangleSSBO = 0;
-    }
-}
-
-// ---- BVH Buffer Setup ----
-void setupBVHBuffers() {
-    if (bvhNodeSSBO == 0) {
-        glGenBuffers(1, &bvhNodeSSBO);
-    }
-    if (triangleIndexSSBO == 0) {
-        glGenBuffers(1, &triangleIndexSSBO);
-    }
-}
-
-void updateBVHBuffers() {
-    if (!bvhBuilt) return;
-    
-    setupBVHBuffers();
-    
-    // Upload BVH nodes to SSBO binding 1
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, bvhNodeSSBO);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, gpuBVHNodes.size() * sizeof(Engine::GPUBVHNode), 
-                 gpuBVHNodes.data(), GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, bvhNodeSSBO);
-    
-    // Upload triangle indices to SSBO binding 2
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, triangleIndexSSBO);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, gpuTriangleIndices.size() * sizeof(uint32_t), 
-                 gpuTriangleIndices.data(), GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, triangleIndexSSBO);
-    
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-    
-    std::cout << "BVH buffers updated: " << gpuBVHNodes.size() << " nodes, " 
-              << gpuTriangleIndices.size() << " triangle indices" << std::endl;
-}
-
-void cleanupBVHBuffers() {
-    if (bvhNodeSSBO != 0) {
-        glDeleteBuffers(1, &bvhNodeSSBO);
-        bvhNodeSSBO = 0;
-    }
-    if (triangleIndexSSBO != 0) {
-        glDeleteBuffers(1, &triangleIndexSSBO);
-        triangleIndexSSBO = 0;
-    }
-}
-
-void buildBVH(const std::vector<Engine::BVHTriangle>& triangles) {
-    if (triangles.empty()) {
-        bvhBuilt = false;
-        return;
-    }
-    
-    std::cout << "Building BVH for " << triangles.size() << " triangles..." << std::endl;
-    
-    // Build BVH
-    bvhBuilder.build(triangles);
-    
-    // Convert to GPU format
-    const auto& nodes = bvhBuilder.getNodes();
-    const auto& indices = bvhBuilder.getTriangleIndices();
-    const auto& bvhTriangles = bvhBuilder.getTriangles();
-    
-    // Convert BVH nodes to GPU format
-    gpuBVHNodes.clear();
-    gpuBVHNodes.reserve(nodes.size());
-    for (const auto& node : nodes) {
-        Engine::GPUBVHNode gpuNode;
-        gpuNode.minX = node.minBounds.x;
-        gpuNode.minY = node.minBounds.y;
-        gpuNode.minZ = node.minBounds.z;
-        gpuNode.leftFirst = node.leftFirst;
-        gpuNode.maxX = node.maxBounds.x;
-        gpuNode.maxY = node.maxBounds.y;
-        gpuNode.maxZ = node.maxBounds.z;
-        gpuNode.triCount = node.triCount;
-        gpuBVHNodes.push_back(gpuNode);
-    }
-    
-    // Copy triangle indices
-    gpuTriangleIndices = indices;
-    
-    // Convert triangles to GPU format (reordered according to BVH)
-    gpuTriangles.clear();
-    gpuTriangles.reserve(bvhTriangles.size());
-    for (const auto& tri : bvhTriangles) {
-        Engine::GPUTriangle gpuTri;
-        gpuTri.v0[0] = tri.v0.x; gpuTri.v0[1] = tri.v0.y; gpuTri.v0[2] = tri.v0.z; gpuTri.v0[3] = 0.0f;
-        gpuTri.v1[0] = tri.v1.x; gpuTri.v1[1] = tri.v1.y; gpuTri.v1[2] = tri.v1.z; gpuTri.v1[3] = 0.0f;
-        gpuTri.v2[0] = tri.v2.x; gpuTri.v2[1] = tri.v2.y; gpuTri.v2[2] = tri.v2.z; gpuTri.v2[3] = 0.0f;
-        gpuTri.normal[0] = tri.normal.x; gpuTri.normal[1] = tri.normal.y; gpuTri.normal[2] = tri.normal.z; gpuTri.normal[3] = 0.0f;
-        gpuTri.color[0] = tri.color.x; gpuTri.color[1] = tri.color.y; gpuTri.color[2] = tri.color.z; gpuTri.color[3] = tri.emissiveness;
-        gpuTri.shininess = tri.shininess;
-        gpuTri.materialId = static_cast<uint32_t>(tri.materialId);
-        gpuTri.padding[0] = 0.0f; gpuTri.padding[1] = 0.0f;
-        gpuTriangles.push_back(gpuTri);
-    }
-    
-    bvhBuilt = true;
-    bvhBuffersUploaded = false;  // Mark that buffers need to be uploaded
-    std::cout << "BVH built successfully" << std::endl;
-}
-
 void updateSkybox() {
     // Clean up existing skybox resources, including shader
     cleanupSkybox();
@@ -1004,6 +850,64 @@ void bindSkyboxUniforms(Engine::Shader* shader) {
     shader->setInt("skybox", 6);  // Skybox texture unit
 }
 
+// Bind the voxel clipmap cascades and their windows. The finest cascade keeps texture unit 5
+// ("voxelGrid"); the coarser ones use the free units 7-9.
+void bindVoxelCascades(Engine::Shader* shader) {
+    static const int cascadeUnits[Engine::Voxelizer::MAX_CASCADES] = { 5, 7, 8, 9 };
+    static const char* cascadeSamplers[Engine::Voxelizer::MAX_CASCADES] = { "voxelGrid", "voxelCascade1", "voxelCascade2", "voxelCascade3" };
+
+    int cascadeCount = voxelizer->getCascadeCount();
+    for (int i = 0; i < Engine::Voxelizer::MAX_CASCADES; i++) {
+        glActiveTexture(GL_TEXTURE0 + cascadeUnits[i]);
+        glBindTexture(GL_TEXTURE_3D, i < cascadeCount ? voxelizer->getCascadeTexture(i) : 0);
+        shader->setInt(cascadeSamplers[i], cascadeUnits[i]);
+        if (i < cascadeCount) {
+            shader->setVec3("cascadeMin[" + std::to_string(i) + "]", voxelizer->getCascadeMin(i));
+            shader->setFloat("cascadeExtent[" + std::to_string(i) + "]", voxelizer->getCascadeExtent(i));
+        }
+    }
+    glActiveTexture(GL_TEXTURE0);
+    shader->setInt("voxelCascadeCount", cascadeCount);
+    shader->setFloat("cascadeResolution", static_cast<float>(voxelizer->getResolution()));
+
+    // Cone tracing stops at the outermost window
+    int outer = cascadeCount - 1;
+    shader->setVec3("gridMin", voxelizer->getCascadeMin(outer));
+    shader->setVec3("gridMax", voxelizer->getCascadeMin(outer) + voxelizer->getCascadeExtent(outer));
+
+    // Directional mips of the cascades on units 15-18
+    bool anisotropic = voxelizer->hasAnisotropicMips() && voxelizer->anisotropicMips;
+    for (int i = 0; i < Engine::Voxelizer::MAX_CASCADES; i++) {
+        glActiveTexture(GL_TEXTURE15 + i);
+        glBindTexture(GL_TEXTURE_3D, anisotropic && i < cascadeCount ? voxelizer->getCascadeDirectionalTexture(i) : 0);
+        shader->setInt("voxelAniso" + std::to_string(i), 15 + i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    shader->setBool("anisotropicMips", anisotropic);
+
+    // Sparse volume (brick map, brick atlases, coarse occupancy) on units 10-14
+    static const char* sparseSamplers[] = { "sparseBrickMap", "sparseBricks0", "sparseBricks1", "sparseBricks2", "sparseCoarse" };
+    bool sparseEnabled = voxelizer->hasSparseVolume() && voxelizer->useSparseVolume;
+    GLuint sparseTextures[] = {
+        voxelizer->getSparseBrickMapTexture(), voxelizer->getSparseAtlasTexture(0), voxelizer->getSparseAtlasTexture(1),
+        voxelizer->getSparseAtlasTexture(2), voxelizer->getSparseCoarseTexture() };
+    for (int i = 0; i < 5; i++) {
+        glActiveTexture(GL_TEXTURE10 + i);
+        glBindTexture(GL_TEXTURE_3D, sparseEnabled ? sparseTextures[i] : 0);
+        shader->setInt(sparseSamplers[i], 10 + i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    shader->setBool("sparseVolumeEnabled", sparseEnabled);
+    if (sparseEnabled) {
+        const Engine::SparseVoxelVolume& sparse = voxelizer->getSparseVolume();
+        shader->setInt("sparseAtlasBricks", Engine::Voxelizer::SPARSE_ATLAS_BRICKS);
+        shader->setVec3("sparseMin", voxelizer->getSparseMin());
+        shader->setFloat("sparseVoxelSize", sparse.getVoxelSize());
+        shader->setFloat("sparseResolution", static_cast<float>(sparse.getResolution()));
+        shader->setFloat("sparseLevelOffset", std::log2(voxelizer->getCascadeVoxelSize(0) / sparse.getVoxelSize()));
+    }
+}
+
 void savePreferences() {
     json j;
 
@@ -1559,7 +1463,13 @@ void PerspectiveProjection(GLfloat* frustum, GLfloat dir,
     frustum[5] = zfar;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // "--reference-checks" runs the headless checks of the CPU references and exits
+    bool runChecks = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--reference-checks") runChecks = true;
+    }
+
     // ---- Initialize Async Loading System ----
     OctreePointCloudManager::initializeAsyncSystem();
     
@@ -1574,6 +1484,30 @@ int main() {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    // ---- Headless Reference Checks ----
+    // A hidden window only provides the context the test meshes upload their buffers to
+    if (runChecks) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        GLFWwindow* checkWindow = glfwCreateWindow(64, 64, "StereoVista Reference Checks", nullptr, nullptr);
+        int result = -1;
+        if (checkWindow == nullptr) {
+            std::cout << "Failed to create GLFW window" << std::endl;
+        }
+        else {
+            glfwMakeContextCurrent(checkWindow);
+            if (gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+                result = Engine::runReferenceChecks();
+            }
+            else {
+                std::cout << "Failed to initialize GLAD" << std::endl;
+            }
+        }
+        glfwTerminate();
+        OctreePointCloudManager::shutdownAsyncSystem();
+        return result;
+    }
+
     glfwWindowHint(GLFW_STEREO, GLFW_TRUE);  // Enable stereo hint
     glfwWindowHint(GLFW_SAMPLES, currentScene.settings.msaaSamples);
 
@@ -1748,6 +1682,9 @@ int main() {
     // Initialize cursor manager
     cursorManager.initialize();
 
+    // Models and octree point clouds are picked on the CPU; other clouds still need the depth readback
+    cursorManager.setSceneRaycaster(raycastScene);
+
     setupShadowMapping();
     setupSkyboxVAO(skyboxVAO, skyboxVBO);
 
@@ -1781,11 +1718,15 @@ int main() {
     loadPreferences();
     initializeVCTSettings();
 
+    // Picking and hit tests share the radiance renderer's BLAS instead of building their own
+    Engine::RayQuery::setSceneBVH(&sceneBVH);
+
     // ---- Load Startup Scene ----
     if (preferences.loadStartupScene && !preferences.startupScenePath.empty()) {
         try {
             std::cout << "Loading startup scene: " << preferences.startupScenePath << std::endl;
             currentScene = Engine::loadScene(preferences.startupScenePath, camera);
+            sceneBVH.setCacheDirectory(Engine::getSceneBVHCacheDirectory(preferences.startupScenePath));
             // Start spawn animation for all loaded models
             for (auto& model : currentScene.models) {
                 glm::vec3 targetScale = model.scale;
@@ -1848,6 +1789,40 @@ int main() {
             camera.Orientation = glm::normalize(glm::quat_cast(rotationMatrix));
             std::cout << "SpaceMouse navigation ended" << std::endl;
         };
+        spaceMouseInput.OnHitTest = [](const glm::vec3& origin, const glm::vec3& direction, float aperture, bool selectionOnly, glm::vec3& hitPoint) {
+            // Central ray plus a ring across the aperture, traced as one coherent packet
+            Engine::Ray rays[Engine::SimdBVH::MAX_PACKET];
+            Engine::RayHit hits[Engine::SimdBVH::MAX_PACKET];
+            glm::vec3 side = glm::normalize(glm::abs(direction.y) < 0.99f ? glm::cross(direction, glm::vec3(0.0f, 1.0f, 0.0f))
+                                                                           : glm::cross(direction, glm::vec3(1.0f, 0.0f, 0.0f)));
+            glm::vec3 up = glm::cross(side, direction);
+            uint32_t rayCount = aperture > 0.0f ? Engine::SimdBVH::MAX_PACKET : 1;
+            rays[0] = { origin, direction };
+            for (uint32_t i = 1; i < rayCount; i++) {
+                float angle = 2.0f * glm::pi<float>() * (i - 1) / (rayCount - 1);
+                glm::vec3 offset = (side * std::cos(angle) + up * std::sin(angle)) * (aperture * 0.5f);
+                rays[i] = { origin + offset, direction };
+            }
+
+            if (selectionOnly) {
+                if (currentSelectedType != SelectedType::Model || currentSelectedIndex < 0 ||
+                    currentSelectedIndex >= static_cast<int>(currentScene.models.size())) {
+                    return false;
+                }
+                Engine::RayQuery::closestHitPacket(currentScene.models[currentSelectedIndex], currentSelectedIndex, rays, rayCount, hits);
+            }
+            else {
+                Engine::RayQuery::raycastPacket(currentScene.models, rays, rayCount, hits);
+            }
+
+            const Engine::RayHit* closest = nullptr;
+            for (uint32_t i = 0; i < rayCount; i++) {
+                if (hits[i].isHit() && (!closest || hits[i].t < closest->t)) closest = &hits[i];
+            }
+            if (!closest) return false;
+            hitPoint = closest->position;
+            return true;
+        };
     } else {
         std::cout << "Failed to initialize SpaceMouse - continuing without 3D navigation" << std::endl;
     }
@@ -1942,7 +1917,7 @@ int main() {
                 // Use proper screen-to-world space conversion for model dragging
                 // This ensures the cursor stays exactly on the model where it started
                 
-                glm::vec3 modelPos = currentScene.models[currentSelectedIndex].position;
+                glm::vec3 modelPos = currentScene.models[currentSelectedIndex].position + modelGrabOffset;
                 float distanceToModel = glm::distance(camera.Position, modelPos);
                 
                 // Project model position to screen space
@@ -1974,7 +1949,7 @@ int main() {
                 newWorldPos /= newWorldPos.w;
                 
                 // Update model position
-                currentScene.models[currentSelectedIndex].position = glm::vec3(newWorldPos);
+                currentScene.models[currentSelectedIndex].position = glm::vec3(newWorldPos) - modelGrabOffset;
             }
             else if ((camera.IsOrbiting || camera.IsPanning || rightMousePressed) && !camera.IsAnimating)
             {
@@ -2076,15 +2051,25 @@ int main() {
         }
 
         // ---- Rendering ----
+        // Radiance scene update totals of the previous frame for the GUI
+        radianceSceneUpdateMs = pendingSceneUpdateMs;
+        radianceRepackedTriangles = pendingRepackedTriangles;
+        pendingSceneUpdateMs = 0.0;
+        pendingRepackedTriangles = 0;
+
+        // Shadows, lights, voxels, scene buffers, view-independent uniforms and the cursor and
+        // distance queries (from the center view) are shared by both eyes
+        prepareFrame(activeShader, projection, view, window);
+
         if (isStereoWindow) {
-            // Render left eye to left buffer (cursor position will be calculated here first time)
-            renderEye(GL_BACK_LEFT, leftProjection, leftView, activeShader, viewport, windowFlags, window);
-            // Render right eye to right buffer (cursor position will use cached value)
-            renderEye(GL_BACK_RIGHT, rightProjection, rightView, activeShader, viewport, windowFlags, window);
+            // Render left eye to left buffer
+            renderEye(GL_BACK_LEFT, leftProjection, leftView, activeShader, viewport, windowFlags);
+            // Render right eye to right buffer
+            renderEye(GL_BACK_RIGHT, rightProjection, rightView, activeShader, viewport, windowFlags);
         }
         else {
-            // Render mono view to default buffer (cursor position will be calculated here)
-            renderEye(GL_BACK_LEFT, projection, view, activeShader, viewport, windowFlags, window);
+            // Render mono view to default buffer
+            renderEye(GL_BACK_LEFT, projection, view, activeShader, viewport, windowFlags);
         }
         
         // Update the cursor's captured position if available (after rendering)
@@ -2127,9 +2112,8 @@ void cleanup(Engine::Shader* shader) {
         glDeleteBuffers(1, &pointCloud.vbo);
     }
 
-    // Delete triangle buffer resources
-    cleanupTriangleBuffer();
-    cleanupBVHBuffers();
+    // Delete raytracing scene buffers
+    sceneBVH.cleanup();
     
     // Cleanup BVH debug renderer
     bvhDebugRenderer.cleanup();
@@ -2189,46 +2173,71 @@ float calculateLargestModelDimension() {
 
 // ---- Rendering ----
 #pragma region Rendering
-void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4& view, Engine::Shader* shader, ImGuiViewportP* viewport, ImGuiWindowFlags windowFlags, GLFWwindow* window) {
-    // Set the draw buffer and clear color and depth buffers
-    glDrawBuffer(drawBuffer);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// Uniform names of a point light array, built once instead of per light and pass
+struct PointLightUniformNames {
+    std::string position, color, intensity;
+};
 
-    // Reset OpenGL state
-    glUseProgram(0);
-    glBindVertexArray(0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindTexture(GL_TEXTURE_3D, 0);
+const std::vector<PointLightUniformNames>& getPointLightUniformNames(const std::string& arrayName) {
+    static std::unordered_map<std::string, std::vector<PointLightUniformNames>> cache;
+    auto& names = cache[arrayName];
+    if (names.empty()) {
+        for (int i = 0; i < MAX_LIGHTS; i++) {
+            std::string lightName = arrayName + "[" + std::to_string(i) + "]";
+            names.push_back({ lightName + ".position", lightName + ".color", lightName + ".intensity" });
+        }
+    }
+    return names;
+}
+
+void setPointLightUniforms(Engine::Shader* shader, const std::string& arrayName, const char* countName) {
+    const auto& names = getPointLightUniformNames(arrayName);
+    int count = std::min(static_cast<int>(pointLights.size()), MAX_LIGHTS);
+    for (int i = 0; i < count; i++) {
+        shader->setVec3(names[i].position, pointLights[i].position);
+        shader->setVec3(names[i].color, pointLights[i].color);
+        shader->setFloat(names[i].intensity, pointLights[i].intensity);
+    }
+    shader->setInt(countName, count);
+}
+
+glm::mat4 calculateLightSpaceMatrix() {
+    float sceneRadius = 10.0f;  // Adjust based on your scene size
+    glm::vec3 sceneCenter = glm::vec3(0.0f);
+    glm::vec3 lightDir = glm::normalize(sun.direction);
+    glm::vec3 lightPos = sceneCenter - lightDir * (sceneRadius * 2.0f);
+
+    glm::mat4 lightProjection = glm::ortho(
+        -sceneRadius, sceneRadius,
+        -sceneRadius, sceneRadius,
+        0.0f, sceneRadius * 4.0f);
+
+    glm::mat4 lightView = glm::lookAt(
+        lightPos,
+        sceneCenter,
+        glm::vec3(0.0f, 1.0f, 0.0f));
+    return lightProjection * lightView;
+}
 
+// Work shared by both eyes of a frame: voxel volume, light list, shadow map, scene BVH and the
+// view-independent uniforms of the scene shader (uniforms persist in the program, so renderEye
+// only sets the eye's matrices)
+void prepareFrame(Engine::Shader* shader, const glm::mat4& projection, const glm::mat4& view, GLFWwindow* window) {
     // 1. Update the voxel grid if voxel visualization is enabled or we're using voxel cone tracing
     if (currentLightingMode == GUI::LIGHTING_VOXEL_CONE_TRACING || voxelizer->showDebugVisualization) {
-        voxelizer->update(camera.Position, currentScene.models);
+        voxelizer->update(camera.Position, currentScene.models, currentScene.pointClouds);
     }
 
-    // 2. Shadow mapping pass (only if using shadow mapping AND shadows are enabled)
+    // 2. Lights from emissive models
+    updatePointLights();
+
+    // 3. Shadow mapping pass (only if using shadow mapping AND shadows are enabled)
+    glm::mat4 lightSpaceMatrix = calculateLightSpaceMatrix();
     if (currentLightingMode == GUI::LIGHTING_SHADOW_MAPPING && enableShadows) {
         glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
         glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
         glClear(GL_DEPTH_BUFFER_BIT);
 
-        // Calculate light's view and projection matrices
-        float sceneRadius = 10.0f;  // Adjust based on your scene size
-        glm::vec3 sceneCenter = glm::vec3(0.0f);
-        glm::vec3 lightDir = glm::normalize(sun.direction);
-        glm::vec3 lightPos = sceneCenter - lightDir * (sceneRadius * 2.0f);
-
-        glm::mat4 lightProjection = glm::ortho(
-            -sceneRadius, sceneRadius,
-            -sceneRadius, sceneRadius,
-            0.0f, sceneRadius * 4.0f);
-
-        glm::mat4 lightView = glm::lookAt(
-            lightPos,
-            sceneCenter,
-            glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::mat4 lightSpaceMatrix = lightProjection * lightView;
-
         // Use depth shader for shadow map generation
         simpleDepthShader->use();
         simpleDepthShader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
@@ -2237,22 +2246,18 @@ void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4&
         glDisable(GL_CULL_FACE);
         renderModels(simpleDepthShader);
         glEnable(GL_CULL_FACE);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
-    // 3. Regular rendering pass
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, windowWidth, windowHeight);
-
+    // 4. View-independent uniforms
     shader->use();
-    shader->setMat4("projection", projection);
-    shader->setMat4("view", view);
-    shader->setVec3("viewPos", camera.Position);
+    bindSkyboxUniforms(shader);
 
     // Set lighting mode uniforms - this is always needed
     shader->setInt("lightingMode", static_cast<int>(currentLightingMode));
     shader->setBool("enableShadows", enableShadows);
 
-    // Set common light properties - these are needed for both modes
+    // Set common light properties - these are needed for all modes
     shader->setVec3("sun.direction", sun.direction);
     shader->setVec3("sun.color", sun.color);
     shader->setFloat("sun.intensity", sun.intensity);
@@ -2260,23 +2265,6 @@ void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4&
 
     // Shadow mapping specific setup
     if (currentLightingMode == GUI::LIGHTING_SHADOW_MAPPING) {
-        // Calculate light space matrix for shadow mapping
-        float sceneRadius = 10.0f;
-        glm::vec3 sceneCenter = glm::vec3(0.0f);
-        glm::vec3 lightDir = glm::normalize(sun.direction);
-        glm::vec3 lightPos = sceneCenter - lightDir * (sceneRadius * 2.0f);
-
-        glm::mat4 lightProjection = glm::ortho(
-            -sceneRadius, sceneRadius,
-            -sceneRadius, sceneRadius,
-            0.0f, sceneRadius * 4.0f);
-
-        glm::mat4 lightView = glm::lookAt(
-            lightPos,
-            sceneCenter,
-            glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::mat4 lightSpaceMatrix = lightProjection * lightView;
-
         shader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
 
         // Bind shadow map if shadows are enabled
@@ -2284,26 +2272,15 @@ void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4&
             glActiveTexture(GL_TEXTURE4);  // Using texture unit 4 for shadow map
             glBindTexture(GL_TEXTURE_2D, depthMap);
             shader->setInt("shadowMap", 4);
+            glActiveTexture(GL_TEXTURE0);
         }
 
-        // Update point lights (for shadow mapping mode)
-        updatePointLights();
-
-        // Set point light uniforms
-        for (int i = 0; i < pointLights.size() && i < MAX_LIGHTS; i++) {
-            std::string lightName = "lights[" + std::to_string(i) + "]";
-            shader->setVec3(lightName + ".position", pointLights[i].position);
-            shader->setVec3(lightName + ".color", pointLights[i].color);
-            shader->setFloat(lightName + ".intensity", pointLights[i].intensity);
-        }
-        shader->setInt("numLights", std::min((int)pointLights.size(), MAX_LIGHTS));
+        setPointLightUniforms(shader, "lights", "numLights");
     }
     // Voxel cone tracing specific setup
     else if (currentLightingMode == GUI::LIGHTING_VOXEL_CONE_TRACING) {
         // Set voxel grid parameters - only when in VCT mode
-        float halfSize = voxelizer->getVoxelGridSize() * 0.5f;
-        shader->setVec3("gridMin", glm::vec3(-halfSize));
-        shader->setVec3("gridMax", glm::vec3(halfSize));
+        bindVoxelCascades(shader);
         shader->setFloat("voxelSize", vctSettings.voxelSize);
 
         // Set VCT settings - only when in VCT mode
@@ -2317,11 +2294,6 @@ void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4&
         shader->setInt("vctSettings.shadowSampleCount", vctSettings.shadowSampleCount);
         shader->setFloat("vctSettings.shadowStepMultiplier", vctSettings.shadowStepMultiplier);
 
-        // Bind voxel 3D texture - using texture unit 5
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_3D, voxelizer->getVoxelTexture());
-        shader->setInt("voxelGrid", 5);
-
         // Set default material properties for voxel cone tracing
         shader->setFloat("material.diffuseReflectivity", 0.8f);
         shader->setFloat("material.specularReflectivity", 0.0f);
@@ -2332,17 +2304,8 @@ void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4&
         // Set visualization flag (for debugging)
         shader->setBool("enableVoxelVisualization", voxelizer->showDebugVisualization);
 
-        // Update point lights (still needed for direct lighting in VCT)
-        updatePointLights();
-
-        // Set point light uniforms
-        for (int i = 0; i < pointLights.size() && i < MAX_LIGHTS; i++) {
-            std::string lightName = "lights[" + std::to_string(i) + "]";
-            shader->setVec3(lightName + ".position", pointLights[i].position);
-            shader->setVec3(lightName + ".color", pointLights[i].color);
-            shader->setFloat(lightName + ".intensity", pointLights[i].intensity);
-        }
-        shader->setInt("numLights", std::min((int)pointLights.size(), MAX_LIGHTS));
+        // Point lights are still needed for direct lighting in VCT
+        setPointLightUniforms(shader, "lights", "numLights");
     }
     // Radiance rendering specific setup
     else if (currentLightingMode == GUI::LIGHTING_RADIANCE) {
@@ -2357,125 +2320,41 @@ void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4&
         shader->setFloat("skyIntensity", radianceSettings.skyIntensity);
         shader->setFloat("emissiveIntensity", radianceSettings.emissiveIntensity);
         shader->setFloat("materialRoughness", radianceSettings.materialRoughness);
-        
-        // No camera matrices needed - using rasterized fragment positions
-        
-        // Set actual scene lights (same as other modes)
-        updatePointLights();
-        
-        // Set point light uniforms
-        for (int i = 0; i < pointLights.size() && i < MAX_LIGHTS; i++) {
-            std::string lightName = "pointLights[" + std::to_string(i) + "]";
-            shader->setVec3(lightName + ".position", pointLights[i].position);
-            shader->setVec3(lightName + ".color", pointLights[i].color);
-            shader->setFloat(lightName + ".intensity", pointLights[i].intensity);
-        }
-        shader->setInt("numPointLights", std::min((int)pointLights.size(), MAX_LIGHTS));
-        
-        // Set sun properties
-        shader->setBool("sun.enabled", sun.enabled);
-        shader->setVec3("sun.direction", sun.direction);
-        shader->setVec3("sun.color", sun.color);
-        shader->setFloat("sun.intensity", sun.intensity);
-        
-        // Extract triangle data from scene models and pack into SSBO
-        triangleData.clear();
-        std::vector<Engine::BVHTriangle> bvhTriangles;
-        int triangleCount = 0;
-        
-        for (const auto& model : currentScene.models) {
-            for (const auto& mesh : model.getMeshes()) {
-                // Calculate model matrix for this model
-                glm::mat4 modelMatrix = glm::mat4(1.0f);
-                modelMatrix = glm::translate(modelMatrix, model.position);
-                modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.x), glm::vec3(1, 0, 0));
-                modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.y), glm::vec3(0, 1, 0));
-                modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.z), glm::vec3(0, 0, 1));
-                modelMatrix = glm::scale(modelMatrix, model.scale);
-                
-                // Get mesh vertices and indices directly (they are public members)
-                const auto& vertices = mesh.vertices;
-                const auto& indices = mesh.indices;
-                
-                // Extract ALL triangles (no more skipping for performance)
-                for (size_t i = 0; i < indices.size(); i += 3) {
-                    if (i + 2 < indices.size()) {
-                        // Get triangle vertices
-                        glm::vec3 v0 = glm::vec3(modelMatrix * glm::vec4(vertices[indices[i]].position, 1.0f));
-                        glm::vec3 v1 = glm::vec3(modelMatrix * glm::vec4(vertices[indices[i+1]].position, 1.0f));
-                        glm::vec3 v2 = glm::vec3(modelMatrix * glm::vec4(vertices[indices[i+2]].position, 1.0f));
-                        
-                        // Calculate triangle normal
-                        glm::vec3 normal = normalize(cross(v1 - v0, v2 - v0));
-                        
-                        // Pack triangle data into buffer (matches shader Triangle struct layout)
-                        // struct Triangle { vec3 v0, v1, v2; vec3 normal; vec3 color; float emissiveness; float shininess; int materialId; }
-                        // std430 layout: vec3 takes 3 floats, then next vec3 starts at next 4-float boundary
-                        triangleData.insert(triangleData.end(), {v0.x, v0.y, v0.z}); // vec3 v0
-                        triangleData.push_back(0.0f); // padding for vec3 alignment
-                        triangleData.insert(triangleData.end(), {v1.x, v1.y, v1.z}); // vec3 v1  
-                        triangleData.push_back(0.0f); // padding for vec3 alignment
-                        triangleData.insert(triangleData.end(), {v2.x, v2.y, v2.z}); // vec3 v2
-                        triangleData.push_back(0.0f); // padding for vec3 alignment
-                        triangleData.insert(triangleData.end(), {normal.x, normal.y, normal.z}); // vec3 normal
-                        triangleData.push_back(0.0f); // padding for vec3 alignment
-                        triangleData.insert(triangleData.end(), {model.color.x, model.color.y, model.color.z}); // vec3 color
-                        triangleData.push_back(model.emissive); // float emissiveness (no padding needed, fills vec3 slot)
-                        triangleData.push_back(model.shininess); // float shininess
-                        // For int materialId, we need to use reinterpret_cast to pack as float bits
-                        int materialId = triangleCount;
-                        triangleData.push_back(*reinterpret_cast<float*>(&materialId)); // int materialId packed as float
-                        triangleData.push_back(0.0f); // padding for next struct alignment
-                        triangleData.push_back(0.0f); // padding for next struct alignment
-                        
-                        // Create BVH triangle
-                        Engine::BVHTriangle bvhTri(v0, v1, v2, normal, model.color, 
-                                                  model.emissive, model.shininess, materialId);
-                        bvhTriangles.push_back(bvhTri);
-                        
-                        triangleCount++;
-                    }
-                }
-            }
-        }
-        
-        // Update the SSBO with triangle data
-        if (!triangleData.empty()) {
-            updateTriangleBuffer(triangleData);
-        }
-        
-        // Build BVH only if scene has changed and we have triangles and BVH is enabled
-        bool sceneChanged = lastSceneState.hasChanged(currentScene);
-        if (!bvhTriangles.empty() && enableBVH && (sceneChanged || !bvhBuilt)) {
-            std::cout << "Scene changed, rebuilding BVH..." << std::endl;
-            buildBVH(bvhTriangles);
-            updateBVHBuffers();
-            bvhBuffersUploaded = true;
-            
-            // Update debug renderer if debug is enabled
-            if (showBVHDebug) {
-                // Get max depth from GUI settings
-                int maxDepth = preferences.radianceSettings.bvhDebugMaxDepth;
-                bvhDebugRenderer.updateFromBVH(bvhBuilder.getNodes(), maxDepth);
-                bvhDebugRenderer.setEnabled(true); // Enable rendering
-            }
-            
-            lastSceneState.update(currentScene);
-        } else if (bvhBuilt && enableBVH && !bvhBuffersUploaded) {
-            // BVH built but buffers not uploaded yet (e.g., BVH was just enabled)
-            updateBVHBuffers();
-            bvhBuffersUploaded = true;
+
+        // BLAS are built once per model, the TLAS follows transform changes and only models with
+        // material edits are re-packed. The instances are needed by the linear fallback too, so
+        // this runs even with the BVH disabled.
+        auto sceneUpdateStart = std::chrono::high_resolution_clock::now();
+        Engine::BVHBuilder::BuildSettings bvhBuildSettings;
+        const Engine::BVHBuilder::BuildMode bvhBuildModes[] = {Engine::BVHBuilder::BuildMode::BinnedSAH,
+                                                               Engine::BVHBuilder::BuildMode::SpatialSplits,
+                                                               Engine::BVHBuilder::BuildMode::LBVH};
+        bvhBuildSettings.mode = bvhBuildModes[std::clamp(preferences.radianceSettings.bvhBuilder, 0, 2)];
+        bvhBuildSettings.spatialSplitBudget = preferences.radianceSettings.spatialSplitBudget;
+        sceneBVH.setBuildSettings(bvhBuildSettings);
+        sceneBVH.setBVHWidth(static_cast<uint32_t>(preferences.radianceSettings.bvhWidth));
+        sceneBVH.update(currentScene.models);
+        sceneBVH.uploadBuffers();
+        pendingSceneUpdateMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - sceneUpdateStart).count();
+        pendingRepackedTriangles += sceneBVH.getLastRepackedTriangles();
+
+        // Update debug renderer if the TLAS changed
+        if (sceneBVH.wasRebuilt() && showBVHDebug) {
+            // Get max depth from GUI settings
+            int maxDepth = preferences.radianceSettings.bvhDebugMaxDepth;
+            bvhDebugRenderer.updateFromBVH(sceneBVH.getTLASNodes(), maxDepth);
+            bvhDebugRenderer.setEnabled(true); // Enable rendering
         }
-        
+
         // Update debug renderer if user toggled debug and BVH is already built
         static bool lastShowBVHDebug = false;
         if (showBVHDebug != lastShowBVHDebug) {
-            if (showBVHDebug && bvhBuilt) {
+            if (showBVHDebug && sceneBVH.isBuilt()) {
                 std::cout << "Enabling BVH debug visualization..." << std::endl;
                 int maxDepth = preferences.radianceSettings.bvhDebugMaxDepth;
-                bvhDebugRenderer.updateFromBVH(bvhBuilder.getNodes(), maxDepth);
+                bvhDebugRenderer.updateFromBVH(sceneBVH.getTLASNodes(), maxDepth);
                 bvhDebugRenderer.setEnabled(true); // Enable rendering
-                
+        
                 // Set render mode from GUI
                 Engine::BVHDebugRenderer::RenderMode mode = static_cast<Engine::BVHDebugRenderer::RenderMode>(preferences.radianceSettings.bvhDebugRenderMode);
                 bvhDebugRenderer.setRenderMode(mode);
@@ -2484,14 +2363,14 @@ void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4&
             }
             lastShowBVHDebug = showBVHDebug;
         }
-        
+
         // Update debug renderer settings if they changed
         static int lastMaxDepth = 3;
         static int lastRenderMode = 1;
-        if (showBVHDebug && bvhBuilt && 
+        if (showBVHDebug && sceneBVH.isBuilt() && 
             (preferences.radianceSettings.bvhDebugMaxDepth != lastMaxDepth)) {
             // Max depth changed - rebuild debug geometry
-            bvhDebugRenderer.updateFromBVH(bvhBuilder.getNodes(), preferences.radianceSettings.bvhDebugMaxDepth);
+            bvhDebugRenderer.updateFromBVH(sceneBVH.getTLASNodes(), preferences.radianceSettings.bvhDebugMaxDepth);
             lastMaxDepth = preferences.radianceSettings.bvhDebugMaxDepth;
         }
         if (showBVHDebug && 
@@ -2501,76 +2380,118 @@ void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4&
             bvhDebugRenderer.setRenderMode(mode);
             lastRenderMode = preferences.radianceSettings.bvhDebugRenderMode;
         }
-        
-        shader->setInt("numTriangles", triangleCount);
-        shader->setInt("numBVHNodes", static_cast<int>(gpuBVHNodes.size()));
-        shader->setBool("enableBVH", enableBVH && bvhBuilt);
-        
+
+        shader->setInt("numTriangles", static_cast<int>(sceneBVH.getTriangleCount()));
+        shader->setInt("numBVHNodes", static_cast<int>(sceneBVH.getBLASNodeCount()));
+        shader->setInt("numTLASNodes", static_cast<int>(sceneBVH.getTLASNodeCount()));
+        shader->setInt("numInstances", static_cast<int>(sceneBVH.getInstanceCount()));
+        shader->setInt("bvhWidth", static_cast<int>(sceneBVH.getBVHWidth()));
+        shader->setInt("numWideNodes", static_cast<int>(sceneBVH.getWideNodeCount()));
+        shader->setBool("enableBVH", enableBVH && sceneBVH.isBuilt());
+
+        // Set actual scene lights (same as other modes)
+        setPointLightUniforms(shader, "pointLights", "numPointLights");
+
         // Disable ground plane for pure raytracing (was causing unwanted lighting)
         shader->setBool("hasGroundPlane", false);
     }
 
+    // Ray query BVHs reuse the BLAS updated above in radiance mode; finished background builds
+    // are picked up here and new models start theirs before the first pick
+    Engine::RayQuery::prepare(currentScene.models);
+
+    // 5. Cursor placement and the nearest-object distance, traced on the CPU from the center view.
+    // Geometry the rays cannot test yet is read back from a depth-only pass instead, which
+    // renderEye clears before drawing.
+    if (sceneNeedsDepthReadback()) {
+        renderDepthPrepass(projection, view);
+    }
+    cursorManager.updateCursorPosition(window, projection, view, shader, false);
+    updateSpaceMouseCursorAnchor();
+    updateDistanceToNearestObject(projection, view);
+
+    // Cursor uniforms of the active shader, so both eyes draw the models with this frame's cursor
+    shader->use();
+    cursorManager.updateShaderUniforms(shader);
+}
+
+void renderDepthPrepass(const glm::mat4& projection, const glm::mat4& view) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowWidth, windowHeight);
+    glDrawBuffer(GL_BACK_LEFT);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    simpleDepthShader->use();
+    simpleDepthShader->setMat4("lightSpaceMatrix", projection * view);
+    renderModels(simpleDepthShader);
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void updateDistanceToNearestObject(const glm::mat4& projection, const glm::mat4& view) {
+    float distanceToNearestObject = calculateDistanceToNearestObject(projection, view);
+    camera.UpdateDistanceToObject(distanceToNearestObject);
+    float largestDimension = calculateLargestModelDimension();
+    camera.AdjustMovementSpeed(distanceToNearestObject, largestDimension, currentScene.settings.farPlane);
+
+    // Update convergence automatically if enabled
+    if (currentScene.settings.autoConvergence) {
+        float cameraDistance = camera.distanceToNearestObject;
+        if (cameraDistance < currentScene.settings.farPlane * 0.95f && camera.distanceUpdated) {
+            float autoConvergenceValue = cameraDistance * currentScene.settings.convergenceDistanceFactor;
+            float minSafeConvergence = cameraDistance + 0.5f;
+            autoConvergenceValue = glm::max(autoConvergenceValue, minSafeConvergence);
+            autoConvergenceValue = glm::clamp(autoConvergenceValue, 0.5f, 40.0f);
+            currentScene.settings.convergence = autoConvergenceValue;
+            preferences.convergence = autoConvergenceValue;
+        }
+        // If looking at empty space, keep previous convergence value
+    }
+}
+
+void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4& view, Engine::Shader* shader, ImGuiViewportP* viewport, ImGuiWindowFlags windowFlags) {
+    // Set the draw buffer and clear color and depth buffers
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowWidth, windowHeight);
+    glDrawBuffer(drawBuffer);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Reset OpenGL state
+    glUseProgram(0);
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    // The voxel debug view and splat passes of the previous eye borrow SSBO bindings 0 and 1
+    if (currentLightingMode == GUI::LIGHTING_RADIANCE) {
+        sceneBVH.bindBuffers();
+    }
+
+    // Only the eye's matrices; everything else was prepared once for the frame by prepareFrame()
+    shader->use();
+    shader->setMat4("projection", projection);
+    shader->setMat4("view", view);
+    shader->setVec3("viewPos", camera.Position);
+
     // Render scene
     renderModels(shader);
     renderPointClouds(shader);
     
     // Render BVH debug visualization (after main scene rendering)
-    if (showBVHDebug && bvhBuilt) {
+    if (showBVHDebug && sceneBVH.isBuilt()) {
         // BVH debug lines are now rendering
         bvhDebugRenderer.render(view, projection);
     }
     
-    // Calculate distance to nearest object AFTER scene rendering but BEFORE zero plane
-    // This ensures zero plane doesn't interfere with distance calculation
-    // Only calculate once per frame (left eye for stereo, or single eye for mono)
-    static bool distanceCalculatedThisFrame = false;
-    static double lastFrameTime = 0.0;
-    double currentFrameTime = glfwGetTime();
-    
-    if (currentFrameTime != lastFrameTime) {
-        distanceCalculatedThisFrame = false;
-        lastFrameTime = currentFrameTime;
-    }
-    
-    if (!distanceCalculatedThisFrame) {
-        float distanceToNearestObject = camera.getDistanceToNearestObject(camera, projection, view, currentScene.settings.farPlane, windowWidth, windowHeight);
-        camera.UpdateDistanceToObject(distanceToNearestObject);
-        float largestDimension = calculateLargestModelDimension();
-        camera.AdjustMovementSpeed(distanceToNearestObject, largestDimension, currentScene.settings.farPlane);
-        
-        // Update convergence automatically if enabled
-        if (currentScene.settings.autoConvergence) {
-            float cameraDistance = camera.distanceToNearestObject;
-            if (cameraDistance < currentScene.settings.farPlane * 0.95f && camera.distanceUpdated) {
-                float autoConvergenceValue = cameraDistance * currentScene.settings.convergenceDistanceFactor;
-                float minSafeConvergence = cameraDistance + 0.5f;
-                autoConvergenceValue = glm::max(autoConvergenceValue, minSafeConvergence);
-                autoConvergenceValue = glm::clamp(autoConvergenceValue, 0.5f, 40.0f);
-                currentScene.settings.convergence = autoConvergenceValue;
-                preferences.convergence = autoConvergenceValue;
-            }
-            // If looking at empty space, keep previous convergence value
-        }
-        distanceCalculatedThisFrame = true;
-    }
-    
-    // Render zero plane if enabled (AFTER distance calculation)
+    // Render zero plane if enabled
     if (currentScene.settings.showZeroPlane) {
         renderZeroPlane(shader, projection, view, currentScene.settings.convergence);
     }
 
     renderSkybox(projection, view, shader);
 
-    // Calculate cursor position AFTER scene rendering but BEFORE cursor rendering
-    // This ensures we read scene depth, not cursor depth from the buffer
-    cursorManager.updateCursorPosition(window, projection, view, shader, false);
-    
-    // Update SpaceMouse cursor anchor when cursor position changes
-    updateSpaceMouseCursorAnchor();
-
-    // Update shader uniforms for cursors (use active shader, not original shader)
-    cursorManager.updateShaderUniforms(shader);
-
     // Render orbit center if needed
     if (!orbitFollowsCursor && cursorManager.isShowOrbitCenter() && camera.IsOrbiting) {
         cursorManager.renderOrbitCenter(projection, view, camera.OrbitPoint);
@@ -2599,69 +2520,12 @@ void renderEye(GLenum drawBuffer, const glm::mat4& projection, const glm::mat4&
 }
 
 void renderModels(Engine::Shader* shader) {
-    // Don't do lighting setup for the depth shader
+    // Lighting uniforms are set once per frame by prepareFrame(); only per-draw state is set here
     if (shader != simpleDepthShader) {
-        // Bind skybox for reflections
-        bindSkyboxUniforms(shader);
-
-        // Set lighting mode
-        shader->setInt("lightingMode", static_cast<int>(currentLightingMode));
-        shader->setBool("enableShadows", enableShadows);
-
-        // Set lighting uniforms based on current lighting mode
-        if (currentLightingMode == GUI::LIGHTING_SHADOW_MAPPING) {
-            // Update point lights
-            updatePointLights();
-
-            // Set point light uniforms
-            for (int i = 0; i < pointLights.size() && i < MAX_LIGHTS; i++) {
-                std::string lightName = "lights[" + std::to_string(i) + "]";
-                shader->setVec3(lightName + ".position", pointLights[i].position);
-                shader->setVec3(lightName + ".color", pointLights[i].color);
-                shader->setFloat(lightName + ".intensity", pointLights[i].intensity);
-            }
-            shader->setInt("numLights", std::min((int)pointLights.size(), MAX_LIGHTS));
-
-            // Set sun properties
-            shader->setBool("sun.enabled", sun.enabled);
-            shader->setVec3("sun.direction", sun.direction);
-            shader->setVec3("sun.color", sun.color);
-            shader->setFloat("sun.intensity", sun.intensity);
-        }
-        else if (currentLightingMode == GUI::LIGHTING_VOXEL_CONE_TRACING) {
-            // Update point lights (still needed for direct lighting in VCT)
-            updatePointLights();
-
-            // Set point light uniforms
-            for (int i = 0; i < pointLights.size() && i < MAX_LIGHTS; i++) {
-                std::string lightName = "lights[" + std::to_string(i) + "]";
-                shader->setVec3(lightName + ".position", pointLights[i].position);
-                shader->setVec3(lightName + ".color", pointLights[i].color);
-                shader->setFloat(lightName + ".intensity", pointLights[i].intensity);
-            }
-            shader->setInt("numLights", std::min((int)pointLights.size(), MAX_LIGHTS));
-
-            // Set sun properties
-            shader->setBool("sun.enabled", sun.enabled);
-            shader->setVec3("sun.direction", sun.direction);
-            shader->setVec3("sun.color", sun.color);
-            shader->setFloat("sun.intensity", sun.intensity);
-
-            // Set VCT settings
-            shader->setBool("vctSettings.indirectSpecularLight", vctSettings.indirectSpecularLight);
-            shader->setBool("vctSettings.indirectDiffuseLight", vctSettings.indirectDiffuseLight);
-            shader->setBool("vctSettings.directLight", vctSettings.directLight);
-            shader->setBool("vctSettings.shadows", vctSettings.shadows);
-
-            // Set voxel grid parameters
-            float halfSize = voxelizer->getVoxelGridSize() * 0.5f;
-            shader->setVec3("gridMin", glm::vec3(-halfSize));
-            shader->setVec3("gridMax", glm::vec3(halfSize));
-            shader->setFloat("voxelSize", vctSettings.voxelSize);
-
-            // Set visualization flag (for debugging)
-            shader->setBool("enableVoxelVisualization", voxelizer->showDebugVisualization);
-        }
+        shader->setFloat("emissiveIntensity", radianceSettings.emissiveIntensity);
+        shader->setBool("selectionMode", selectionMode);
+        shader->setInt("selectedMeshIndex", currentSelectedMeshIndex);
+        shader->setBool("isMeshSelected", currentSelectedMeshIndex >= 0);
     }
 
     // Calculate view projection matrix for frustum culling
@@ -2700,9 +2564,6 @@ void renderModels(Engine::Shader* shader) {
         shader->setFloat("material.shininess", model.shininess);
         shader->setFloat("material.emissive", model.emissive);
         
-        // Set emissive intensity for all lighting modes
-        shader->setFloat("emissiveIntensity", radianceSettings.emissiveIntensity);
-
         // For VCT, set additional material properties
         if (currentLightingMode == GUI::LIGHTING_VOXEL_CONE_TRACING) {
             // Set VCT specific material properties
@@ -2715,10 +2576,7 @@ void renderModels(Engine::Shader* shader) {
         }
 
         // Set selection state
-        shader->setBool("selectionMode", selectionMode);
         shader->setBool("isSelected", selectionMode && (i == currentSelectedIndex) && (currentSelectedType == SelectedType::Model));
-        shader->setInt("selectedMeshIndex", currentSelectedMeshIndex);
-        shader->setBool("isMeshSelected", currentSelectedMeshIndex >= 0);
 
         // Set current mesh index for all meshes
         for (int j = 0; j < model.getMeshes().size(); j++) {
@@ -3260,66 +3118,85 @@ void calculateMouseRay(float mouseX, float mouseY, glm::vec3& rayOrigin, glm::ve
     rayDirection = glm::normalize(rayFar - rayNear);
 }
 
-bool rayIntersectsModel(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const Engine::Model& model, float& distance) {
-    float closestDistance = std::numeric_limits<float>::max();
-    bool intersected = false;
-    // Calculate model matrix
-    glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), model.position);
-    modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.x), glm::vec3(1, 0, 0));
-    modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.y), glm::vec3(0, 1, 0));
-    modelMatrix = glm::rotate(modelMatrix, glm::radians(model.rotation.z), glm::vec3(0, 0, 1));
-    modelMatrix = glm::scale(modelMatrix, model.scale);
-
-    // Transform ray to model space
-    glm::mat4 invModelMatrix = glm::inverse(modelMatrix);
-    glm::vec3 rayOriginModel = glm::vec3(invModelMatrix * glm::vec4(rayOrigin, 1.0f));
-    glm::vec3 rayDirectionModel = glm::normalize(glm::vec3(invModelMatrix * glm::vec4(rayDirection, 0.0f)));
-
-    // Check each mesh in the model
-    for (const auto& mesh : model.getMeshes()) {
-        // Iterate through all triangles in the mesh
-        for (size_t i = 0; i < mesh.indices.size(); i += 3) {
-            glm::vec3 v0 = mesh.vertices[mesh.indices[i]].position;
-            glm::vec3 v1 = mesh.vertices[mesh.indices[i + 1]].position;
-            glm::vec3 v2 = mesh.vertices[mesh.indices[i + 2]].position;
-
-            // Möller–Trumbore intersection algorithm
-            glm::vec3 edge1 = v1 - v0;
-            glm::vec3 edge2 = v2 - v0;
-            glm::vec3 h = glm::cross(rayDirectionModel, edge2);
-            float a = glm::dot(edge1, h);
-
-            if (a > -0.00001f && a < 0.00001f) continue; // Ray is parallel to triangle
-
-            float f = 1.0f / a;
-            glm::vec3 s = rayOriginModel - v0;
-            float u = f * glm::dot(s, h);
-
-            if (u < 0.0f || u > 1.0f) continue;
-
-            glm::vec3 q = glm::cross(s, edge1);
-            float v = f * glm::dot(rayDirectionModel, q);
-
-            if (v < 0.0f || u + v > 1.0f) continue;
-
-            float t = f * glm::dot(edge2, q);
-
-            if (t > 0.00001f && t < closestDistance) {
-                closestDistance = t;
-                intersected = true;
-            }
+bool sceneNeedsDepthReadback() {
+    // Models whose ray BVH is still building and point clouds without an octree
+    if (!Engine::RayQuery::prepare(currentScene.models)) return true;
+    for (const auto& pointCloud : currentScene.pointClouds) {
+        if (pointCloud.visible && !pointCloud.octreeRoot) return true;
+    }
+    return false;
+}
+
+Cursor::RaycastResult raycastScene(const glm::vec3& origin, const glm::vec3& direction, float angularTolerance) {
+    Cursor::RaycastResult result;
+    result.depthReadbackNeeded = false;
+
+    // Models through their ray BVHs (t is a distance, the direction is normalized); while a BVH
+    // is still building the depth buffer stands in rather than scanning every frame
+    float closestDistance = currentScene.settings.farPlane;
+    if (Engine::RayQuery::prepare(currentScene.models)) {
+        Engine::RayHit modelHit = Engine::RayQuery::raycast(currentScene.models, Engine::Ray{ origin, direction }, closestDistance);
+        if (modelHit.isHit()) {
+            closestDistance = modelHit.t;
+            result.hit = true;
+            result.position = modelHit.position;
         }
     }
+    else {
+        result.depthReadbackNeeded = true;
+    }
+
+    for (const auto& pointCloud : currentScene.pointClouds) {
+        if (!pointCloud.visible) continue;
+        if (!pointCloud.octreeRoot) {
+            result.depthReadbackNeeded = true;
+            continue;
+        }
 
-    if (intersected) {
-        // Transform the intersection point back to world space
-        glm::vec3 intersectionPointModel = rayOriginModel + rayDirectionModel * closestDistance;
-        glm::vec4 intersectionPointWorld = modelMatrix * glm::vec4(intersectionPointModel, 1.0f);
-        distance = glm::distance(rayOrigin, glm::vec3(intersectionPointWorld));
-        return true;
+        Engine::PointPickResult pick = Engine::OctreePointCloudManager::pickPoint(
+            pointCloud, origin, direction, angularTolerance, closestDistance);
+        if (pick.hit && pick.distance < closestDistance) {
+            closestDistance = pick.distance;
+            result.hit = true;
+            result.position = pick.position;
+        }
     }
+    return result;
+}
 
-    return false;
+float calculateDistanceToNearestObject(const glm::mat4& projection, const glm::mat4& view) {
+    float farPlane = currentScene.settings.farPlane;
+    if (windowWidth <= 0 || windowHeight <= 0) return farPlane;
+
+    // Same 3x3 grid around the screen center the depth readback samples, traced like the cursor
+    const int sampleOffset = 100;
+    glm::mat4 vpInv = glm::inverse(projection * view);
+    float fovY = 2.0f * std::atan(1.0f / projection[1][1]);
+    float angularTolerance = cursorManager.getPickTolerancePixels() * fovY / (float)windowHeight;
+
+    float distance = farPlane;
+    for (int i = -1; i <= 1; i++) {
+        for (int j = -1; j <= 1; j++) {
+            int x = windowWidth / 2 + i * sampleOffset;
+            int y = windowHeight / 2 + j * sampleOffset;
+            if (x < 0 || x >= windowWidth || y < 0 || y >= windowHeight) continue;
+
+            float ndcX = (2.0f * x) / windowWidth - 1.0f;
+            float ndcY = (2.0f * y) / windowHeight - 1.0f;
+            glm::vec4 nearWorld = vpInv * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+            glm::vec4 farWorld = vpInv * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+            glm::vec3 rayOrigin = glm::vec3(nearWorld) / nearWorld.w;
+            glm::vec3 rayDirection = glm::normalize(glm::vec3(farWorld) / farWorld.w - rayOrigin);
+
+            Cursor::RaycastResult result = raycastScene(rayOrigin, rayDirection, angularTolerance);
+            if (result.depthReadbackNeeded) {
+                // Clouds without an octree (or models still building their BVH) need the depth buffer
+                return camera.getDistanceToNearestObject(camera, projection, view, farPlane, windowWidth, windowHeight);
+            }
+            if (result.hit) distance = std::min(distance, glm::distance(camera.Position, result.position));
+        }
+    }
+    return distance;
 }
 #pragma endregion
 
@@ -3389,17 +3266,11 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
                 int closestModelIndex = -1;
                 int closestPointCloudIndex = -1;
 
-                // Check intersection with models
-                for (int i = 0; i < currentScene.models.size(); i++) {
-                    const auto& model = currentScene.models[i];
-                    float distance;
-                    if (rayIntersectsModel(rayOrigin, rayDirection, model, distance)) {
-                        if (distance < closestDistance) {
-                            closestDistance = distance;
-                            closestModelIndex = i;
-                            closestPointCloudIndex = -1;
-                        }
-                    }
+                // Check intersection with models (per-model BVH, triangles are scanned while it builds)
+                Engine::RayHit modelHit = Engine::RayQuery::raycast(currentScene.models, Engine::Ray{ rayOrigin, rayDirection });
+                if (modelHit.isHit()) {
+                    closestDistance = modelHit.t;
+                    closestModelIndex = modelHit.model;
                 }
 
                 // Check intersection with point clouds (simplified)
@@ -3432,6 +3303,9 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
                     currentSelectedType = SelectedType::Model;
                     currentSelectedMeshIndex = -1;
 
+                    // Drag by the picked surface point so it stays under the cursor
+                    modelGrabOffset = modelHit.position - currentScene.models[currentSelectedIndex].position;
+
                     if (!isMouseCaptured) {
                         isMouseCaptured = true;
                         firstMouse = true; // Reset flag for delta calculation
@@ -3683,7 +3557,7 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 
         // If switching to VCT, update the voxel grid
         if (currentLightingMode == GUI::LIGHTING_VOXEL_CONE_TRACING) {
-            voxelizer->update(camera.Position, currentScene.models);
+            voxelizer->update(camera.Position, currentScene.models, currentScene.pointClouds);
         }
 
         // Update preferences